@@ -0,0 +1,149 @@
+import sys
+import json
+import math
+import struct
+
+# Decoder for the binary (CBOR) telemetry frames published on
+# home/esp/<client_id>/telemetry when the telemetry format is "cbor".
+#
+# Frame layout: [schema_id, timestamp_ms, tag85(float32 little-endian bytes)]
+#
+# Usage:
+#   python decode_telemetry.py <hex-frame> [<hex-frame> ...]
+#   python decode_telemetry.py --file frame.bin
+#   mosquitto_sub -t 'home/esp/+/telemetry' -F '%x' | python decode_telemetry.py -
+
+# Reading names for each schema ID (must match TELEMETRY_SCHEMA_* in src/main.cpp)
+SCHEMAS = {
+    1: ["cpu_temperature_c", "dht_temperature_c", "dht_humidity_pct"],
+    2: [
+        f"{metric}_{stat}"
+        for metric in ("cpu_temperature_c", "dht_temperature_c", "dht_humidity_pct")
+        for stat in ("mean", "min", "max")
+    ],
+    # Low-power profile batches; timestamp is UTC epoch ms (ms since power-on if the clock never synced)
+    3: ["cpu_temperature_c", "dht_temperature_c", "dht_humidity_pct"],
+}
+
+TAG_FLOAT32_LE_ARRAY = 85
+
+
+class CBORDecodeError(Exception):
+    pass
+
+
+def decode_item(data, pos):
+    """Decode one CBOR item starting at pos; returns (value, next_pos)."""
+    if pos >= len(data):
+        raise CBORDecodeError("unexpected end of frame")
+
+    initial = data[pos]
+    major = initial >> 5
+    info = initial & 0x1F
+    pos += 1
+
+    # Floats and simple values
+    if major == 7:
+        if info == 25:
+            return struct.unpack(">e", data[pos:pos + 2])[0], pos + 2
+        if info == 26:
+            return struct.unpack(">f", data[pos:pos + 4])[0], pos + 4
+        if info == 27:
+            return struct.unpack(">d", data[pos:pos + 8])[0], pos + 8
+        simple = {20: False, 21: True, 22: None}
+        if info in simple:
+            return simple[info], pos
+        raise CBORDecodeError(f"unsupported simple value {info}")
+
+    # Argument (length, value or tag number)
+    if info < 24:
+        argument = info
+    elif info in (24, 25, 26, 27):
+        size = 1 << (info - 24)
+        if pos + size > len(data):
+            raise CBORDecodeError("truncated argument")
+        argument = int.from_bytes(data[pos:pos + size], "big")
+        pos += size
+    else:
+        raise CBORDecodeError("indefinite lengths are not supported")
+
+    if major == 0:
+        return argument, pos
+    if major == 1:
+        return -1 - argument, pos
+    if major in (2, 3):
+        if pos + argument > len(data):
+            raise CBORDecodeError("truncated string")
+        raw = bytes(data[pos:pos + argument])
+        return (raw if major == 2 else raw.decode("utf-8")), pos + argument
+    if major == 4:
+        items = []
+        for _ in range(argument):
+            item, pos = decode_item(data, pos)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        result = {}
+        for _ in range(argument):
+            key, pos = decode_item(data, pos)
+            value, pos = decode_item(data, pos)
+            result[key] = value
+        return result, pos
+    if major == 6:
+        value, pos = decode_item(data, pos)
+        if argument == TAG_FLOAT32_LE_ARRAY:
+            if not isinstance(value, bytes) or len(value) % 4 != 0:
+                raise CBORDecodeError("tag 85 must wrap a byte string of float32 values")
+            return list(struct.unpack(f"<{len(value) // 4}f", value)), pos
+        return {"tag": argument, "value": value}, pos
+
+    raise CBORDecodeError(f"unknown major type {major}")
+
+
+def decode_frame(data):
+    frame, pos = decode_item(data, 0)
+    if pos != len(data):
+        raise CBORDecodeError(f"{len(data) - pos} trailing bytes")
+    if not isinstance(frame, list) or len(frame) != 3:
+        raise CBORDecodeError("frame must be a 3-element array")
+
+    schema_id, timestamp, readings = frame
+    names = SCHEMAS.get(schema_id)
+    if names is None:
+        names = [f"reading_{i}" for i in range(len(readings))]
+
+    values = {}
+    for name, value in zip(names, readings):
+        values[name] = None if math.isnan(value) else round(value, 3)
+
+    return {
+        "schema_id": schema_id,
+        "timestamp_ms": timestamp,
+        "readings": values,
+        "frame_bytes": len(data),
+    }
+
+
+def print_frame(data):
+    try:
+        print(json.dumps(decode_frame(data)))
+    except CBORDecodeError as error:
+        print(f"Invalid frame ({error}): {data.hex()}", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python decode_telemetry.py <hex-frame>... | --file <frame.bin> | -")
+        sys.exit(1)
+
+    if sys.argv[1] == "--file":
+        with open(sys.argv[2], "rb") as f:
+            print_frame(f.read())
+    elif sys.argv[1] == "-":
+        for line in sys.stdin:
+            line = line.strip()
+            if line:
+                print_frame(bytes.fromhex(line))
+    else:
+        for frame_hex in sys.argv[1:]:
+            print_frame(bytes.fromhex(frame_hex))
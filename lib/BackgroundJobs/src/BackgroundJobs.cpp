@@ -0,0 +1,144 @@
+#include "BackgroundJobs.h"
+#include <DeviceLog.h>
+#include <SpanTracer.h>
+
+static LogModule logJobs("jobs");
+
+BackgroundJobs::BackgroundJobs()
+    : _task(nullptr),
+      _lock(portMUX_INITIALIZER_UNLOCKED),
+      _head(0),
+      _count(0),
+      _completed(0) {
+    memset(_jobs, 0, sizeof(_jobs));
+}
+
+bool BackgroundJobs::begin(uint32_t stackSize, UBaseType_t priority) {
+    if (_task != nullptr) {
+        return true;
+    }
+    if (xTaskCreate(taskEntry, "background_jobs", stackSize, this, priority, &_task) != pdPASS) {
+        DLOG_E(logJobs, "Failed to start background job task");
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool BackgroundJobs::submit(const char* name, JobFunction run, JobFunction complete, void* context) {
+    if (_task == nullptr || run == nullptr) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&_lock);
+    bool accepted = _count < BACKGROUND_JOBS_QUEUE_SIZE && findLocked(name) < 0;
+    if (accepted) {
+        Job& job = _jobs[(_head + _count) % BACKGROUND_JOBS_QUEUE_SIZE];
+        job.name = name;
+        job.run = run;
+        job.complete = complete;
+        job.context = context;
+        job.state = JOB_QUEUED;
+        job.runMs = 0;
+        _count++;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (accepted) {
+        xTaskNotifyGive(_task);
+    }
+    return accepted;
+}
+
+bool BackgroundJobs::isQueued(const char* name) {
+    portENTER_CRITICAL(&_lock);
+    bool queued = findLocked(name) >= 0;
+    portEXIT_CRITICAL(&_lock);
+    return queued;
+}
+
+void BackgroundJobs::poll() {
+    portENTER_CRITICAL(&_lock);
+    bool finished = _count > 0 && _jobs[_head].state == JOB_FINISHED;
+    Job job = _jobs[_head];
+    portEXIT_CRITICAL(&_lock);
+    if (!finished) {
+        return;
+    }
+
+    // The job stays at the head (and queued by name) until its completion is done
+    if (job.complete != nullptr) {
+        job.complete(job.context);
+    }
+    DLOG_I(logJobs, "%s: %lu ms", job.name, (unsigned long)job.runMs);
+
+    portENTER_CRITICAL(&_lock);
+    _head = (_head + 1) % BACKGROUND_JOBS_QUEUE_SIZE;
+    _count--;
+    _completed++;
+    bool more = _count > 0;
+    portEXIT_CRITICAL(&_lock);
+
+    if (more) {
+        xTaskNotifyGive(_task);
+    }
+}
+
+const char* BackgroundJobs::currentJob() {
+    portENTER_CRITICAL(&_lock);
+    const char* name = _count > 0 && _jobs[_head].state != JOB_QUEUED ? _jobs[_head].name : nullptr;
+    portEXIT_CRITICAL(&_lock);
+    return name;
+}
+
+size_t BackgroundJobs::pendingCount() {
+    portENTER_CRITICAL(&_lock);
+    size_t count = _count;
+    portEXIT_CRITICAL(&_lock);
+    return count;
+}
+
+int BackgroundJobs::findLocked(const char* name) const {
+    for (size_t i = 0; i < _count; i++) {
+        size_t index = (_head + i) % BACKGROUND_JOBS_QUEUE_SIZE;
+        if (strcmp(_jobs[index].name, name) == 0) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+void BackgroundJobs::runNext() {
+    portENTER_CRITICAL(&_lock);
+    bool ready = _count > 0 && _jobs[_head].state == JOB_QUEUED;
+    if (ready) {
+        _jobs[_head].state = JOB_RUNNING;
+    }
+    Job job = _jobs[_head];
+    portEXIT_CRITICAL(&_lock);
+    if (!ready) {
+        return;
+    }
+
+    uint32_t start = millis();
+    {
+        TRACE_SCOPE(job.name);
+        job.run(job.context);
+    }
+    uint32_t elapsed = millis() - start;
+
+    // Only poll() removes the head, so it is still this job
+    portENTER_CRITICAL(&_lock);
+    _jobs[_head].state = JOB_FINISHED;
+    _jobs[_head].runMs = elapsed;
+    portEXIT_CRITICAL(&_lock);
+}
+
+void BackgroundJobs::taskEntry(void* parameter) {
+    BackgroundJobs* self = static_cast<BackgroundJobs*>(parameter);
+    for (;;) {
+        // Woken by submit() and by poll() once the previous job has completed
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->runNext();
+    }
+}
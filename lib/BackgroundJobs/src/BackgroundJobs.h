@@ -0,0 +1,75 @@
+#ifndef BACKGROUND_JOBS_H
+#define BACKGROUND_JOBS_H
+
+#include <Arduino.h>
+
+#ifndef BACKGROUND_JOBS_QUEUE_SIZE
+#define BACKGROUND_JOBS_QUEUE_SIZE 8
+#endif
+
+// Runs slow, blocking work (HTTPS downloads, network scans) on a worker task
+// so the loop keeps serving HTTP and MQTT meanwhile.
+//
+// A job's run function executes on the worker. Its optional complete function
+// runs afterwards on the task that calls poll() (the Arduino loop), which is
+// where results should be applied to shared state. Jobs run one at a time in
+// submission order, and the next one starts only after the previous one has
+// completed, so a run function may read state that the loop only changes in
+// completions.
+//
+// Each job has a name (a string literal); a name can be queued only once, so
+// periodic jobs do not pile up behind a slow one. submit() and poll() must be
+// called from the same task.
+class BackgroundJobs {
+public:
+    typedef void (*JobFunction)(void* context);
+
+    BackgroundJobs();
+
+    // Start the worker task. HTTPS needs a larger stack than most tasks.
+    bool begin(uint32_t stackSize = 8192, UBaseType_t priority = 1);
+
+    // Queue a job. Returns false if the worker is not running, the queue is
+    // full or a job with this name is already queued, running or completing.
+    bool submit(const char* name, JobFunction run, JobFunction complete = nullptr, void* context = nullptr);
+
+    bool isQueued(const char* name);
+
+    // Run the completion of a finished job, if there is one, and let the
+    // worker start the next
+    void poll();
+
+    // Name of the job being run or completed, nullptr if idle
+    const char* currentJob();
+    size_t pendingCount();
+    uint32_t getCompletedCount() const { return _completed; }
+
+private:
+    enum JobState {
+        JOB_QUEUED,
+        JOB_RUNNING,
+        JOB_FINISHED
+    };
+
+    struct Job {
+        const char* name;
+        JobFunction run;
+        JobFunction complete;
+        void* context;
+        JobState state;
+        uint32_t runMs; // Time spent on the worker
+    };
+
+    TaskHandle_t _task;
+    portMUX_TYPE _lock;
+    Job _jobs[BACKGROUND_JOBS_QUEUE_SIZE]; // Ring; _head is the only job that may run
+    size_t _head;
+    size_t _count;
+    volatile uint32_t _completed;
+
+    int findLocked(const char* name) const;
+    void runNext();
+    static void taskEntry(void* parameter);
+};
+
+#endif
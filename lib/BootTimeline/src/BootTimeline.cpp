@@ -0,0 +1,77 @@
+#include "BootTimeline.h"
+
+BootTimeline::BootTimeline() : _lock(portMUX_INITIALIZER_UNLOCKED), _count(0) {
+    memset(_entries, 0, sizeof(_entries));
+}
+
+bool BootTimeline::begin(const char* name) {
+    return add(name, false);
+}
+
+bool BootTimeline::end(const char* name) {
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&_lock);
+    int index = findLocked(name);
+    bool ended = index >= 0 && _entries[index].running;
+    if (ended) {
+        _entries[index].endMs = now;
+        _entries[index].running = false;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return ended;
+}
+
+bool BootTimeline::mark(const char* name) {
+    return add(name, true);
+}
+
+bool BootTimeline::has(const char* name) {
+    portENTER_CRITICAL(&_lock);
+    bool found = findLocked(name) >= 0;
+    portEXIT_CRITICAL(&_lock);
+    return found;
+}
+
+bool BootTimeline::get(size_t index, Entry& entry) {
+    portENTER_CRITICAL(&_lock);
+    bool valid = index < _count;
+    if (valid) {
+        entry = _entries[index];
+    }
+    portEXIT_CRITICAL(&_lock);
+    return valid;
+}
+
+size_t BootTimeline::count() {
+    portENTER_CRITICAL(&_lock);
+    size_t count = _count;
+    portEXIT_CRITICAL(&_lock);
+    return count;
+}
+
+int BootTimeline::findLocked(const char* name) const {
+    for (size_t i = 0; i < _count; i++) {
+        if (strcmp(_entries[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool BootTimeline::add(const char* name, bool milestone) {
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&_lock);
+    bool added = _count < BOOT_TIMELINE_MAX_ENTRIES && findLocked(name) < 0;
+    if (added) {
+        Entry& entry = _entries[_count++];
+        entry.name = name;
+        entry.startMs = now;
+        entry.endMs = now;
+        entry.running = !milestone;
+        entry.milestone = milestone;
+    }
+    portEXIT_CRITICAL(&_lock);
+    return added;
+}
@@ -0,0 +1,56 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+#include <Arduino.h>
+
+// Phases and milestones recorded per boot
+#ifndef BOOT_TIMELINE_MAX_ENTRIES
+#define BOOT_TIMELINE_MAX_ENTRIES 20
+#endif
+
+// Start and end time (millis() since reset) of each boot phase, plus
+// milestones: zero-length entries such as the first HTTP response.
+//
+// Only the first occurrence of a name is kept, so the work a phase names
+// (e.g. an OTA check that repeats every few minutes) is timed on its boot
+// run only, and a milestone can be marked from a hot path without adding
+// entries. Names must be string literals.
+//
+// Safe to use from any task.
+class BootTimeline {
+public:
+    struct Entry {
+        const char* name;
+        uint32_t startMs;
+        uint32_t endMs;  // Equal to startMs for milestones
+        bool running;    // Started but not yet ended
+        bool milestone;
+    };
+
+    BootTimeline();
+
+    // Start a phase. Returns false if the name was already recorded or the table is full.
+    bool begin(const char* name);
+
+    // End a running phase
+    bool end(const char* name);
+
+    // Record a milestone at the current time (first call only)
+    bool mark(const char* name);
+
+    bool has(const char* name);
+
+    // Copy of the index'th entry, in the order they were recorded
+    bool get(size_t index, Entry& entry);
+    size_t count();
+
+private:
+    portMUX_TYPE _lock;
+    Entry _entries[BOOT_TIMELINE_MAX_ENTRIES];
+    size_t _count;
+
+    int findLocked(const char* name) const;
+    bool add(const char* name, bool milestone);
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "DHT22Async.h"
+#include <DeviceLog.h>
+
+static LogModule logDht("dht22");
+
+DHT22Async::DHT22Async(uint8_t pin, rmt_channel_t channel)
+    : _pin(pin),
+      _channel(channel),
+      _ringbuf(nullptr),
+      _task(nullptr),
+      _results(nullptr),
+      _callback(nullptr),
+      _callbackContext(nullptr),
+      _lock(portMUX_INITIALIZER_UNLOCKED),
+      _busy(false),
+      _lastStart(0),
+      _started(false),
+      _readCount(0),
+      _errorCount(0) {
+    _lastResult.status = DHT22_ERROR_TIMEOUT;
+    _lastResult.temperature = NAN;
+    _lastResult.humidity = NAN;
+    _lastResult.timestamp = 0;
+}
+
+bool DHT22Async::begin(UBaseType_t priority) {
+    // 1 us resolution; a gap of 200 us without edges ends the frame
+    rmt_config_t config = RMT_DEFAULT_CONFIG_RX((gpio_num_t)_pin, _channel);
+    config.clk_div = 80;
+    config.mem_block_num = 1;
+    config.rx_config.idle_threshold = 200;
+    config.rx_config.filter_en = true;
+    config.rx_config.filter_ticks_thresh = 100; // Ignore glitches shorter than ~1.25 us
+
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(_channel, 1024, 0) != ESP_OK) {
+        DLOG_E(logDht, "Failed to configure RMT receiver");
+        return false;
+    }
+    rmt_get_ringbuf_handle(_channel, &_ringbuf);
+
+    // Open-drain so the same pin can pull the bus low for the start signal
+    gpio_set_pull_mode((gpio_num_t)_pin, GPIO_PULLUP_ONLY);
+    gpio_set_direction((gpio_num_t)_pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_level((gpio_num_t)_pin, 1);
+
+    _results = xQueueCreate(1, sizeof(DHT22Result));
+    if (_results == nullptr ||
+        xTaskCreate(taskEntry, "dht22", 3072, this, priority, &_task) != pdPASS) {
+        DLOG_E(logDht, "Failed to start worker task");
+        return false;
+    }
+    return true;
+}
+
+bool DHT22Async::requestReading() {
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&_lock);
+    bool allowed = _task != nullptr && !_busy && (!_started || now - _lastStart + INTERVAL_SLACK_MS >= MIN_INTERVAL_MS);
+    if (allowed) {
+        _busy = true;
+        _started = true;
+        _lastStart = now;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    if (allowed) {
+        xQueueReset(_results);
+        xTaskNotifyGive(_task);
+    }
+    return allowed;
+}
+
+bool DHT22Async::read(DHT22Result& result, TickType_t timeout) {
+    if (!requestReading()) {
+        portENTER_CRITICAL(&_lock);
+        bool busy = _busy;
+        result = _lastResult;
+        portEXIT_CRITICAL(&_lock);
+
+        // A transaction started by someone else is still running: wait for it
+        if (busy) {
+            return xQueuePeek(_results, &result, timeout) == pdTRUE && result.status == DHT22_OK;
+        }
+        return result.status == DHT22_OK;
+    }
+
+    if (xQueuePeek(_results, &result, timeout) != pdTRUE) {
+        result.status = DHT22_ERROR_TIMEOUT;
+        return false;
+    }
+    return result.status == DHT22_OK;
+}
+
+void DHT22Async::setCallback(ReadingCallback callback, void* context) {
+    _callback = callback;
+    _callbackContext = context;
+}
+
+DHT22Result DHT22Async::lastResult() {
+    portENTER_CRITICAL(&_lock);
+    DHT22Result result = _lastResult;
+    portEXIT_CRITICAL(&_lock);
+    return result;
+}
+
+// Runs on the worker task: start signal, capture, decode
+DHT22Status DHT22Async::capture(DHT22Result& result) {
+    gpio_num_t pin = (gpio_num_t)_pin;
+
+    // Start signal: hold the bus low for at least 1 ms (the task sleeps meanwhile)
+    gpio_set_level(pin, 0);
+    vTaskDelay(pdMS_TO_TICKS(2));
+
+    // Arm the receiver, then release the bus and let the pull-up take it high
+    if (rmt_rx_start(_channel, true) != ESP_OK) {
+        gpio_set_level(pin, 1);
+        result.status = DHT22_ERROR_DRIVER;
+        return result.status;
+    }
+    gpio_set_level(pin, 1);
+
+    // The full frame takes ~5 ms; the RMT ends it after the idle threshold
+    size_t length = 0;
+    rmt_item32_t* items = (rmt_item32_t*)xRingbufferReceive(_ringbuf, &length, pdMS_TO_TICKS(20));
+    rmt_rx_stop(_channel);
+
+    if (items == nullptr) {
+        result.status = DHT22_ERROR_TIMEOUT;
+        result.temperature = NAN;
+        result.humidity = NAN;
+        return result.status;
+    }
+
+    DHT22Pulse pulses[MAX_PULSES];
+    size_t pulseCount = 0;
+    size_t itemCount = length / sizeof(rmt_item32_t);
+    for (size_t i = 0; i < itemCount && pulseCount + 2 <= MAX_PULSES; i++) {
+        pulses[pulseCount].level = items[i].level0;
+        pulses[pulseCount].durationUs = items[i].duration0;
+        pulseCount++;
+        pulses[pulseCount].level = items[i].level1;
+        pulses[pulseCount].durationUs = items[i].duration1;
+        pulseCount++;
+    }
+    vRingbufferReturnItem(_ringbuf, items);
+
+    return DHT22Decoder::decode(pulses, pulseCount, result);
+}
+
+void DHT22Async::complete(const DHT22Result& result) {
+    portENTER_CRITICAL(&_lock);
+    _lastResult = result;
+    _busy = false;
+    _readCount++;
+    if (result.status != DHT22_OK) {
+        _errorCount++;
+    }
+    portEXIT_CRITICAL(&_lock);
+
+    xQueueOverwrite(_results, &result);
+    if (_callback) {
+        _callback(result, _callbackContext);
+    }
+}
+
+void DHT22Async::taskEntry(void* parameter) {
+    DHT22Async* self = static_cast<DHT22Async*>(parameter);
+    uint32_t failedInRow = 0;
+
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        DHT22Result result;
+        self->capture(result);
+        result.timestamp = millis();
+        // One line when reads start failing, then one per FAILURE_REPORT_EVERY
+        // failed reads, so a missing sensor does not flood the log
+        if (result.status != DHT22_OK) {
+            failedInRow++;
+            if (failedInRow % FAILURE_REPORT_EVERY == 1) {
+                DLOG_W(logDht, "Read failed: %s (%lu in a row, %lu of %lu reads)",
+                       DHT22Decoder::statusName(result.status), (unsigned long)failedInRow,
+                       (unsigned long)(self->_errorCount + 1), (unsigned long)(self->_readCount + 1));
+            }
+        } else if (failedInRow > 0) {
+            DLOG_I(logDht, "Reads recovered after %lu failures", (unsigned long)failedInRow);
+            failedInRow = 0;
+        }
+        self->complete(result);
+    }
+}
@@ -0,0 +1,74 @@
+#ifndef DHT22_ASYNC_H
+#define DHT22_ASYNC_H
+
+#include <Arduino.h>
+#include <driver/rmt.h>
+#include <freertos/ringbuf.h>
+#include "DHT22Decoder.h"
+
+// Default RMT receive channel (ESP32-S3 can only receive on channels 4-7)
+#if CONFIG_IDF_TARGET_ESP32S3
+#define DHT22_DEFAULT_RMT_CHANNEL RMT_CHANNEL_4
+#else
+#define DHT22_DEFAULT_RMT_CHANNEL RMT_CHANNEL_2
+#endif
+
+// DHT22 driver that captures the pulse train with the RMT receiver instead of
+// bit-banging with interrupts disabled. A small worker task sends the start
+// signal, waits (blocked, not spinning) for the captured frame, decodes it and
+// delivers the result through a callback and/or a waiting reader.
+class DHT22Async {
+public:
+    typedef void (*ReadingCallback)(const DHT22Result& result, void* context);
+
+    // The sensor needs at least this long between transactions
+    static const uint32_t MIN_INTERVAL_MS = 2000;
+    // A request this close to MIN_INTERVAL_MS is still accepted, so a caller
+    // polling on a fixed period does not slip a whole round on timer jitter
+    static const uint32_t INTERVAL_SLACK_MS = 20;
+
+    DHT22Async(uint8_t pin, rmt_channel_t channel = DHT22_DEFAULT_RMT_CHANNEL);
+
+    bool begin(UBaseType_t priority = 2);
+
+    // Start a transaction without waiting. Returns false if one is already
+    // running or the sensor was read less than MIN_INTERVAL_MS ago.
+    bool requestReading();
+
+    // Start a transaction (if allowed) and wait for its result. Within
+    // MIN_INTERVAL_MS of the previous read, returns the cached result.
+    bool read(DHT22Result& result, TickType_t timeout = pdMS_TO_TICKS(100));
+
+    void setCallback(ReadingCallback callback, void* context = nullptr);
+    DHT22Result lastResult();
+
+    uint32_t getReadCount() const { return _readCount; }
+    uint32_t getErrorCount() const { return _errorCount; }
+
+private:
+    static const size_t MAX_PULSES = 100;
+    // While reads keep failing, the failure is logged again every this many reads
+    static const uint32_t FAILURE_REPORT_EVERY = 30;
+
+    uint8_t _pin;
+    rmt_channel_t _channel;
+    RingbufHandle_t _ringbuf;
+    TaskHandle_t _task;
+    QueueHandle_t _results;
+    ReadingCallback _callback;
+    void* _callbackContext;
+
+    portMUX_TYPE _lock;
+    DHT22Result _lastResult;
+    bool _busy;
+    uint32_t _lastStart;
+    bool _started;
+    uint32_t _readCount;
+    uint32_t _errorCount;
+
+    DHT22Status capture(DHT22Result& result);
+    void complete(const DHT22Result& result);
+    static void taskEntry(void* parameter);
+};
+
+#endif
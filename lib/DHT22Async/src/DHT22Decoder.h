@@ -0,0 +1,114 @@
+#ifndef DHT22_DECODER_H
+#define DHT22_DECODER_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Outcome of one DHT22 transaction
+enum DHT22Status {
+    DHT22_OK,
+    DHT22_ERROR_TIMEOUT,    // No frame captured
+    DHT22_ERROR_BIT_COUNT,  // Fewer than 40 data bits in the frame
+    DHT22_ERROR_CHECKSUM,   // Bits decoded but the checksum byte does not match
+    DHT22_ERROR_DRIVER      // Peripheral could not be started
+};
+
+struct DHT22Result {
+    DHT22Status status;
+    float temperature; // °C
+    float humidity;    // %RH
+    uint8_t raw[5];
+    uint32_t timestamp; // millis() when the transaction completed
+};
+
+// One captured level of the single-wire bus
+struct DHT22Pulse {
+    uint8_t level;
+    uint16_t durationUs;
+};
+
+// Pure decoding of a captured DHT22 pulse train; no hardware access, so it
+// can be exercised against recorded waveforms.
+//
+// After the start signal the sensor answers with 80 us low / 80 us high, then
+// sends 40 bits, each a ~50 us low followed by a high of ~27 us (0) or ~70 us
+// (1). Leading glitches from releasing the bus are tolerated by decoding the
+// last 40 high pulses of the frame.
+class DHT22Decoder {
+public:
+    // High pulses longer than this are 1 bits
+    static const uint16_t BIT_THRESHOLD_US = 48;
+    static const size_t DATA_BITS = 40;
+
+    static DHT22Status decode(const DHT22Pulse* pulses, size_t count, DHT22Result& result) {
+        size_t highCount = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (pulses[i].level && pulses[i].durationUs > 0) {
+                highCount++;
+            }
+        }
+        if (highCount < DATA_BITS) {
+            return fail(result, DHT22_ERROR_BIT_COUNT);
+        }
+
+        uint8_t data[5] = {0, 0, 0, 0, 0};
+        size_t skip = highCount - DATA_BITS;
+        size_t bit = 0;
+        for (size_t i = 0; i < count && bit < DATA_BITS; i++) {
+            if (!pulses[i].level || pulses[i].durationUs == 0) {
+                continue;
+            }
+            if (skip > 0) {
+                skip--;
+                continue;
+            }
+            data[bit / 8] <<= 1;
+            if (pulses[i].durationUs > BIT_THRESHOLD_US) {
+                data[bit / 8] |= 1;
+            }
+            bit++;
+        }
+
+        return decodeBytes(data, result);
+    }
+
+    static DHT22Status decodeBytes(const uint8_t data[5], DHT22Result& result) {
+        for (size_t i = 0; i < 5; i++) {
+            result.raw[i] = data[i];
+        }
+
+        uint8_t checksum = (uint8_t)(data[0] + data[1] + data[2] + data[3]);
+        if (checksum != data[4]) {
+            return fail(result, DHT22_ERROR_CHECKSUM);
+        }
+
+        // Humidity is unsigned tenths; temperature is sign-magnitude tenths
+        result.humidity = (float)(((uint16_t)data[0] << 8) | data[1]) * 0.1f;
+        float temperature = (float)((((uint16_t)data[2] & 0x7F) << 8) | data[3]) * 0.1f;
+        result.temperature = (data[2] & 0x80) ? -temperature : temperature;
+        result.status = DHT22_OK;
+        return DHT22_OK;
+    }
+
+    static const char* statusName(DHT22Status status) {
+        switch (status) {
+            case DHT22_OK: return "ok";
+            case DHT22_ERROR_TIMEOUT: return "timeout";
+            case DHT22_ERROR_BIT_COUNT: return "bit count";
+            case DHT22_ERROR_CHECKSUM: return "checksum";
+            case DHT22_ERROR_DRIVER: return "driver";
+        }
+        return "unknown";
+    }
+
+private:
+    static DHT22Status fail(DHT22Result& result, DHT22Status status) {
+        result.status = status;
+        result.temperature = NAN;
+        result.humidity = NAN;
+        return status;
+    }
+};
+
+#endif
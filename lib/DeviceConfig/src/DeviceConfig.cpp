@@ -0,0 +1,267 @@
+#include "DeviceConfig.h"
+#include <DeviceLog.h>
+#include <esp_system.h>
+
+static LogModule logConfig("config");
+
+DeviceConfig* DeviceConfig::_shutdownInstance = nullptr;
+
+DeviceConfig::DeviceConfig(const char* nvsNamespace, uint32_t flushDelayMs)
+    : _namespace(nvsNamespace),
+      _flushDelayMs(flushDelayMs),
+      _ledBrightness(0),
+      _telemetryFormat(0),
+      _lastFirmwareVersion(0),
+      _blobCount(0),
+      _dirty(0),
+      _firstChange(0),
+      _lastChange(0),
+      _flushCount(0),
+      _writeCount(0),
+      _coalescedCount(0) {
+    _clientId[0] = '\0';
+    _wifiSsid[0] = '\0';
+    _wifiPassword[0] = '\0';
+    _lastCommit[0] = '\0';
+}
+
+bool DeviceConfig::begin(const DeviceConfigDefaults& defaults) {
+    // A namespace that does not exist yet (first boot) cannot be opened
+    // read-only; every field then keeps its default
+    bool opened = _preferences.begin(_namespace, true);
+
+    loadString("client_id", _clientId, sizeof(_clientId), defaults.clientId);
+    loadString("wifi_ssid", _wifiSsid, sizeof(_wifiSsid), defaults.wifiSsid);
+    loadString("wifi_password", _wifiPassword, sizeof(_wifiPassword), defaults.wifiPassword);
+    loadString("last_commit", _lastCommit, sizeof(_lastCommit), "");
+    if (opened) {
+        _ledBrightness = constrain(_preferences.getInt("led_brightness", defaults.ledBrightness), 0, 255);
+        _telemetryFormat = _preferences.getUChar("telemetry_fmt", defaults.telemetryFormat);
+        _lastFirmwareVersion = _preferences.getInt("last_fw_version", 0);
+        _preferences.end();
+    } else {
+        _ledBrightness = defaults.ledBrightness;
+        _telemetryFormat = defaults.telemetryFormat;
+        _lastFirmwareVersion = 0;
+    }
+
+    if (_shutdownInstance == nullptr) {
+        _shutdownInstance = this;
+        esp_register_shutdown_handler(onShutdown);
+    }
+    return opened;
+}
+
+void DeviceConfig::loadString(const char* key, char* field, size_t fieldSize, const char* defaultValue) {
+    strlcpy(field, defaultValue, fieldSize);
+    if (_preferences.isKey(key)) {
+        _preferences.getString(key, field, fieldSize);
+    }
+}
+
+void DeviceConfig::loop(uint32_t now) {
+    if (_dirty == 0) {
+        return;
+    }
+    if (now - _lastChange >= _flushDelayMs || now - _firstChange >= DEVICE_CONFIG_MAX_FLUSH_DELAY_MS) {
+        flush();
+    }
+}
+
+bool DeviceConfig::flush() {
+    if (_dirty == 0) {
+        return true;
+    }
+    if (!_preferences.begin(_namespace, false)) {
+        DLOG_E(logConfig, "Cannot open NVS namespace %s", _namespace);
+        return false;
+    }
+
+    // A field stays dirty if its write fails, so the next flush retries it
+    uint16_t failed = 0;
+    if (_dirty & FIELD_CLIENT_ID) {
+        if (_preferences.putString("client_id", _clientId) != strlen(_clientId)) failed |= FIELD_CLIENT_ID;
+        _writeCount++;
+    }
+    if (_dirty & FIELD_LED_BRIGHTNESS) {
+        if (_preferences.putInt("led_brightness", _ledBrightness) == 0) failed |= FIELD_LED_BRIGHTNESS;
+        _writeCount++;
+    }
+    if (_dirty & FIELD_TELEMETRY_FORMAT) {
+        if (_preferences.putUChar("telemetry_fmt", _telemetryFormat) == 0) failed |= FIELD_TELEMETRY_FORMAT;
+        _writeCount++;
+    }
+    if (_dirty & FIELD_WIFI_SSID) {
+        if (_preferences.putString("wifi_ssid", _wifiSsid) != strlen(_wifiSsid)) failed |= FIELD_WIFI_SSID;
+        _writeCount++;
+    }
+    if (_dirty & FIELD_WIFI_PASSWORD) {
+        if (_preferences.putString("wifi_password", _wifiPassword) != strlen(_wifiPassword)) failed |= FIELD_WIFI_PASSWORD;
+        _writeCount++;
+    }
+    if (_dirty & FIELD_LAST_COMMIT) {
+        if (_preferences.putString("last_commit", _lastCommit) != strlen(_lastCommit)) failed |= FIELD_LAST_COMMIT;
+        _writeCount++;
+    }
+    if (_dirty & FIELD_LAST_FIRMWARE_VERSION) {
+        if (_preferences.putInt("last_fw_version", _lastFirmwareVersion) == 0) failed |= FIELD_LAST_FIRMWARE_VERSION;
+        _writeCount++;
+    }
+    if (_dirty & FIELD_BLOBS) {
+        for (size_t i = 0; i < _blobCount; i++) {
+            Blob& blob = _blobs[i];
+            if (!blob.dirty) {
+                continue;
+            }
+            if (_preferences.putBytes(blob.key, blob.data, blob.size) == blob.size) {
+                blob.dirty = false;
+            } else {
+                failed |= FIELD_BLOBS;
+            }
+            _writeCount++;
+        }
+    }
+    _preferences.end();
+
+    _flushCount++;
+    _dirty = failed;
+    if (failed != 0) {
+        DLOG_W(logConfig, "NVS write failed (fields 0x%02x), will retry", failed);
+        _firstChange = _lastChange = millis();
+        return false;
+    }
+    return true;
+}
+
+void DeviceConfig::markDirty(Field flag) {
+    uint32_t now = millis();
+    if (_dirty == 0) {
+        _firstChange = now;
+    } else if ((_dirty & flag) && flag != FIELD_BLOBS) {
+        // Blobs count coalesced changes per key in setBlob()
+        _coalescedCount++;
+    }
+    _dirty |= flag;
+    _lastChange = now;
+}
+
+bool DeviceConfig::setString(char* field, size_t fieldSize, const char* value, Field flag) {
+    if (strlen(value) >= fieldSize) {
+        return false;
+    }
+    if (strcmp(field, value) != 0) {
+        strcpy(field, value);
+        markDirty(flag);
+    }
+    return true;
+}
+
+bool DeviceConfig::setClientId(const char* clientId) {
+    return setString(_clientId, sizeof(_clientId), clientId, FIELD_CLIENT_ID);
+}
+
+void DeviceConfig::setLedBrightness(uint8_t brightness) {
+    if (brightness != _ledBrightness) {
+        _ledBrightness = brightness;
+        markDirty(FIELD_LED_BRIGHTNESS);
+    }
+}
+
+void DeviceConfig::setTelemetryFormat(uint8_t format) {
+    if (format != _telemetryFormat) {
+        _telemetryFormat = format;
+        markDirty(FIELD_TELEMETRY_FORMAT);
+    }
+}
+
+bool DeviceConfig::setWifiCredentials(const char* ssid, const char* password) {
+    if (strlen(ssid) >= sizeof(_wifiSsid) || strlen(password) >= sizeof(_wifiPassword)) {
+        return false;
+    }
+    setString(_wifiSsid, sizeof(_wifiSsid), ssid, FIELD_WIFI_SSID);
+    setString(_wifiPassword, sizeof(_wifiPassword), password, FIELD_WIFI_PASSWORD);
+    return true;
+}
+
+bool DeviceConfig::setLastCommit(const char* commit) {
+    return setString(_lastCommit, sizeof(_lastCommit), commit, FIELD_LAST_COMMIT);
+}
+
+void DeviceConfig::setLastFirmwareVersion(int version) {
+    if (version != _lastFirmwareVersion) {
+        _lastFirmwareVersion = version;
+        markDirty(FIELD_LAST_FIRMWARE_VERSION);
+    }
+}
+
+DeviceConfig::Blob* DeviceConfig::findBlob(const char* key) {
+    for (size_t i = 0; i < _blobCount; i++) {
+        if (strcmp(_blobs[i].key, key) == 0) {
+            return &_blobs[i];
+        }
+    }
+    return nullptr;
+}
+
+DeviceConfig::Blob* DeviceConfig::loadBlob(const char* key) {
+    Blob* blob = findBlob(key);
+    if (blob != nullptr) {
+        return blob;
+    }
+    if (strlen(key) >= sizeof(Blob::key) || _blobCount >= DEVICE_CONFIG_MAX_BLOBS) {
+        DLOG_W(logConfig, "No room for setting %s", key);
+        return nullptr;
+    }
+
+    blob = &_blobs[_blobCount++];
+    strcpy(blob->key, key);
+    blob->size = 0;
+    blob->dirty = false;
+
+    // Absent keys are cached too, so a miss costs one NVS lookup per boot
+    if (_preferences.begin(_namespace, true)) {
+        size_t length = _preferences.getBytesLength(key);
+        if (length > 0 && length <= sizeof(blob->data)) {
+            blob->size = _preferences.getBytes(key, blob->data, sizeof(blob->data));
+        }
+        _preferences.end();
+    }
+    return blob;
+}
+
+bool DeviceConfig::getBlob(const char* key, void* data, size_t size) {
+    Blob* blob = loadBlob(key);
+    if (blob == nullptr || blob->size != size) {
+        return false;
+    }
+    memcpy(data, blob->data, size);
+    return true;
+}
+
+bool DeviceConfig::setBlob(const char* key, const void* data, size_t size) {
+    if (size == 0 || size > DEVICE_CONFIG_MAX_BLOB_SIZE) {
+        return false;
+    }
+    Blob* blob = loadBlob(key);
+    if (blob == nullptr) {
+        return false;
+    }
+    if (blob->size == size && memcmp(blob->data, data, size) == 0) {
+        return true;
+    }
+
+    memcpy(blob->data, data, size);
+    blob->size = size;
+    if (blob->dirty) {
+        _coalescedCount++;
+    }
+    blob->dirty = true;
+    markDirty(FIELD_BLOBS);
+    return true;
+}
+
+void DeviceConfig::onShutdown() {
+    if (_shutdownInstance != nullptr && _shutdownInstance->isDirty()) {
+        _shutdownInstance->flush();
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef DEVICE_CONFIG_H
+#define DEVICE_CONFIG_H
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Quiet time after the last change before dirty fields are written
+#ifndef DEVICE_CONFIG_FLUSH_DELAY_MS
+#define DEVICE_CONFIG_FLUSH_DELAY_MS 5000
+#endif
+
+// Upper bound on how long a change may stay in RAM while changes keep coming
+#ifndef DEVICE_CONFIG_MAX_FLUSH_DELAY_MS
+#define DEVICE_CONFIG_MAX_FLUSH_DELAY_MS 60000
+#endif
+
+// Keyed binary settings (e.g. one publish policy per sensor channel)
+#ifndef DEVICE_CONFIG_MAX_BLOBS
+#define DEVICE_CONFIG_MAX_BLOBS 12
+#endif
+
+#ifndef DEVICE_CONFIG_MAX_BLOB_SIZE
+#define DEVICE_CONFIG_MAX_BLOB_SIZE 40
+#endif
+
+// Values used for anything not yet stored in NVS
+struct DeviceConfigDefaults {
+    const char* clientId;
+    uint8_t ledBrightness;
+    uint8_t telemetryFormat;
+    const char* wifiSsid;
+    const char* wifiPassword;
+};
+
+// Write-back cache for the settings in one Preferences namespace. begin()
+// reads every field once; after that getters never touch NVS. Setters only
+// update RAM and mark the field dirty (setting the current value is a no-op),
+// and loop() writes the dirty fields once changes have been quiet for
+// DEVICE_CONFIG_FLUSH_DELAY_MS, so dragging a slider costs one NVS write
+// instead of one per step.
+//
+// Pending changes are flushed from a shutdown handler as well, so any
+// esp_restart()/ESP.restart() (web reboot, MQTT reboot, OTA) persists them.
+// Only a crash or power loss inside the debounce window loses a change.
+//
+// Not thread-safe: use from the loop task only.
+class DeviceConfig {
+public:
+    explicit DeviceConfig(const char* nvsNamespace = "esp-config",
+                          uint32_t flushDelayMs = DEVICE_CONFIG_FLUSH_DELAY_MS);
+
+    bool begin(const DeviceConfigDefaults& defaults);
+
+    // Write dirty fields once the debounce window has passed; call from loop()
+    void loop(uint32_t now);
+
+    // Write dirty fields now; returns false if NVS could not be opened or written
+    bool flush();
+
+    const char* clientId() const { return _clientId; }
+    uint8_t ledBrightness() const { return _ledBrightness; }
+    uint8_t telemetryFormat() const { return _telemetryFormat; }
+    const char* wifiSsid() const { return _wifiSsid; }
+    const char* wifiPassword() const { return _wifiPassword; }
+    const char* lastCommit() const { return _lastCommit; }         // Template commit ("" if unknown)
+    int lastFirmwareVersion() const { return _lastFirmwareVersion; } // Firmware the templates were synced for
+
+    // Strings longer than the field are rejected (returns false)
+    bool setClientId(const char* clientId);
+    void setLedBrightness(uint8_t brightness);
+    void setTelemetryFormat(uint8_t format);
+    bool setWifiCredentials(const char* ssid, const char* password);
+    bool setLastCommit(const char* commit);
+    void setLastFirmwareVersion(int version);
+
+    // Keyed blobs are read from NVS on first access and cached. getBlob()
+    // returns false if nothing of exactly this size is stored under key.
+    bool getBlob(const char* key, void* data, size_t size);
+    bool setBlob(const char* key, const void* data, size_t size);
+
+    bool isDirty() const { return _dirty != 0; }
+    uint32_t getFlushCount() const { return _flushCount; } // NVS commits
+    uint32_t getWriteCount() const { return _writeCount; } // Keys written
+    uint32_t getCoalescedCount() const { return _coalescedCount; } // Changes absorbed by a pending write
+
+private:
+    enum Field : uint16_t {
+        FIELD_CLIENT_ID = 1 << 0,
+        FIELD_LED_BRIGHTNESS = 1 << 1,
+        FIELD_TELEMETRY_FORMAT = 1 << 2,
+        FIELD_WIFI_SSID = 1 << 3,
+        FIELD_WIFI_PASSWORD = 1 << 4,
+        FIELD_LAST_COMMIT = 1 << 5,
+        FIELD_LAST_FIRMWARE_VERSION = 1 << 6,
+        FIELD_BLOBS = 1 << 7
+    };
+
+    struct Blob {
+        char key[16]; // NVS keys are at most 15 characters
+        uint8_t data[DEVICE_CONFIG_MAX_BLOB_SIZE];
+        uint8_t size; // 0 = nothing stored
+        bool dirty;
+    };
+
+    const char* _namespace;
+    uint32_t _flushDelayMs;
+    Preferences _preferences;
+
+    char _clientId[33];
+    uint8_t _ledBrightness;
+    uint8_t _telemetryFormat;
+    char _wifiSsid[33];
+    char _wifiPassword[65];
+    char _lastCommit[41];
+    int _lastFirmwareVersion;
+
+    Blob _blobs[DEVICE_CONFIG_MAX_BLOBS];
+    size_t _blobCount;
+
+    uint16_t _dirty;
+    uint32_t _firstChange;
+    uint32_t _lastChange;
+    uint32_t _flushCount;
+    uint32_t _writeCount;
+    uint32_t _coalescedCount;
+
+    static DeviceConfig* _shutdownInstance;
+    static void onShutdown();
+
+    bool setString(char* field, size_t fieldSize, const char* value, Field flag);
+    void markDirty(Field flag);
+    Blob* findBlob(const char* key);
+    Blob* loadBlob(const char* key);
+    void loadString(const char* key, char* field, size_t fieldSize, const char* defaultValue);
+};
+
+#endif
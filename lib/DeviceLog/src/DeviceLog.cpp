@@ -0,0 +1,180 @@
+#include "DeviceLog.h"
+#include <stdarg.h>
+
+// SequenceRing capacities are powers of two
+static_assert((DEVICE_LOG_ENTRIES & (DEVICE_LOG_ENTRIES - 1)) == 0, "DEVICE_LOG_ENTRIES must be a power of two");
+
+// How often the drain task looks for new lines
+#ifndef DEVICE_LOG_DRAIN_MS
+#define DEVICE_LOG_DRAIN_MS 20
+#endif
+
+static const char* LEVEL_NAMES[] = {"none", "error", "warn", "info", "debug", "verbose"};
+static const char LEVEL_LETTERS[] = "-EWIDV";
+
+// Constant-initialized, so modules constructed during static initialization
+// of other files can log right away
+SequenceRing<DeviceLog::Entry>::Slot DeviceLog::_slots[DEVICE_LOG_ENTRIES];
+SequenceRing<DeviceLog::Entry> DeviceLog::_ring(_slots, DEVICE_LOG_ENTRIES);
+uint32_t DeviceLog::_readSeq = 0;
+uint32_t DeviceLog::_dropped = 0;
+Print* DeviceLog::_out = nullptr;
+TaskHandle_t DeviceLog::_task = nullptr;
+SemaphoreHandle_t DeviceLog::_drainMutex = nullptr;
+
+LogModule::LogModule(const char* name, uint8_t level) : _name(name), _level(level) {
+    enlist();
+}
+
+LogModule* LogModule::find(const char* name) {
+    for (LogModule* module = head(); module != nullptr; module = module->next()) {
+        if (strcmp(module->_name, name) == 0) {
+            return module;
+        }
+    }
+    return nullptr;
+}
+
+bool DeviceLog::begin(Print& out, UBaseType_t priority, uint32_t stackSize) {
+    if (_task != nullptr) {
+        return true;
+    }
+    _drainMutex = xSemaphoreCreateMutex();
+    if (_drainMutex == nullptr) {
+        return false;
+    }
+    _out = &out;
+    if (xTaskCreate(taskEntry, "log", stackSize, nullptr, priority, &_task) != pdPASS) {
+        out.println("Failed to start log task");
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void DeviceLog::flush() {
+    if (_drainMutex == nullptr) {
+        return;
+    }
+    xSemaphoreTake(_drainMutex, portMAX_DELAY);
+    drain();
+    xSemaphoreGive(_drainMutex);
+    _out->flush();
+}
+
+void DeviceLog::write(const LogModule& module, uint8_t level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    _ring.write([&](Entry& entry) {
+        entry.uptimeMs = millis();
+        entry.module = module.name();
+        entry.level = level;
+        int length = vsnprintf(entry.text, sizeof(entry.text), format, args);
+
+        // A trailing newline from converted Serial.printf calls is added back on output
+        size_t end = length < 0 ? 0 : ((size_t)length < sizeof(entry.text) ? length : sizeof(entry.text) - 1);
+        while (end > 0 && (entry.text[end - 1] == '\n' || entry.text[end - 1] == '\r')) {
+            end--;
+        }
+        entry.text[end] = '\0';
+    });
+    va_end(args);
+}
+
+void DeviceLog::writeRecent(ChunkWriter write, void* context, uint32_t since, uint32_t end) {
+    uint32_t start = _ring.oldest(end);
+    if ((int32_t)(since - start) > 0) {
+        start = (int32_t)(end - since) >= 0 ? since : end;
+    }
+
+    Entry copy;
+    char line[DEVICE_LOG_LINE_SIZE + 48];
+    for (uint32_t seq = start; seq != end; seq++) {
+        // Lines overwritten or still being written are skipped
+        if (copyEntry(seq, copy)) {
+            write(line, formatLine(copy, seq, true, line, sizeof(line)), context);
+        }
+    }
+}
+
+const char* DeviceLog::levelName(uint8_t level) {
+    return level <= DLOG_LEVEL_VERBOSE ? LEVEL_NAMES[level] : "unknown";
+}
+
+bool DeviceLog::parseLevel(const char* text, uint8_t& level) {
+    for (uint8_t i = 0; i <= DLOG_LEVEL_VERBOSE; i++) {
+        if (strcasecmp(text, LEVEL_NAMES[i]) == 0) {
+            level = i;
+            return true;
+        }
+    }
+    if (text[0] >= '0' && text[0] <= '0' + DLOG_LEVEL_VERBOSE && text[1] == '\0') {
+        level = text[0] - '0';
+        return true;
+    }
+    return false;
+}
+
+bool DeviceLog::copyEntry(uint32_t seq, Entry& copy) {
+    if (!_ring.read(seq, copy)) {
+        return false;
+    }
+    copy.text[sizeof(copy.text) - 1] = '\0';
+    return true;
+}
+
+size_t DeviceLog::formatLine(const Entry& entry, uint32_t seq, bool withSeq, char* line, size_t size) {
+    char level = LEVEL_LETTERS[entry.level <= DLOG_LEVEL_VERBOSE ? entry.level : 0];
+    int length;
+    if (withSeq) {
+        length = snprintf(line, size, "%lu %lu.%03lu %c %s: %s\n", (unsigned long)seq,
+                          (unsigned long)(entry.uptimeMs / 1000), (unsigned long)(entry.uptimeMs % 1000), level,
+                          entry.module, entry.text);
+    } else {
+        length = snprintf(line, size, "%6lu.%03lu %c %s: %s\n", (unsigned long)(entry.uptimeMs / 1000),
+                          (unsigned long)(entry.uptimeMs % 1000), level, entry.module, entry.text);
+    }
+    if (length < 0) {
+        return 0;
+    }
+    return (size_t)length < size ? length : size - 1;
+}
+
+void DeviceLog::drain() {
+    Entry copy;
+    char line[DEVICE_LOG_LINE_SIZE + 48];
+    while (true) {
+        uint32_t end = _ring.end();
+        if (end - _readSeq > DEVICE_LOG_ENTRIES) {
+            uint32_t lost = end - DEVICE_LOG_ENTRIES - _readSeq;
+            _dropped += lost;
+            _readSeq = end - DEVICE_LOG_ENTRIES;
+            int length = snprintf(line, sizeof(line), "[log] %lu lines dropped\n", (unsigned long)lost);
+            _out->write((const uint8_t*)line, length);
+        }
+        if (_readSeq == end) {
+            return;
+        }
+
+        if (!copyEntry(_readSeq, copy)) {
+            if (_ring.pending(_readSeq)) {
+                return; // Still being written; picked up on the next pass
+            }
+            _dropped++; // Overwritten while it was copied
+            _readSeq++;
+            continue;
+        }
+        _out->write((const uint8_t*)line, formatLine(copy, _readSeq, false, line, sizeof(line)));
+        _readSeq++;
+    }
+}
+
+void DeviceLog::taskEntry(void* parameter) {
+    (void)parameter;
+    for (;;) {
+        xSemaphoreTake(_drainMutex, portMAX_DELAY);
+        drain();
+        xSemaphoreGive(_drainMutex);
+        vTaskDelay(pdMS_TO_TICKS(DEVICE_LOG_DRAIN_MS));
+    }
+}
@@ -0,0 +1,159 @@
+#ifndef DEVICE_LOG_H
+#define DEVICE_LOG_H
+
+#include <Arduino.h>
+#include <Registered.h>
+#include <SequenceRing.h>
+#include <atomic>
+
+#define DLOG_LEVEL_NONE 0
+#define DLOG_LEVEL_ERROR 1
+#define DLOG_LEVEL_WARN 2
+#define DLOG_LEVEL_INFO 3
+#define DLOG_LEVEL_DEBUG 4
+#define DLOG_LEVEL_VERBOSE 5
+
+// Most detailed level compiled in. Calls above it are removed by the
+// compiler, format strings included, and their arguments are not evaluated.
+#ifndef DLOG_MIN_LEVEL
+#define DLOG_MIN_LEVEL DLOG_LEVEL_INFO
+#endif
+
+// Lines kept in RAM; the oldest is overwritten when the ring is full
+#ifndef DEVICE_LOG_ENTRIES
+#define DEVICE_LOG_ENTRIES 64
+#endif
+
+// Longest line, including the terminator; longer lines are cut
+#ifndef DEVICE_LOG_LINE_SIZE
+#define DEVICE_LOG_LINE_SIZE 128
+#endif
+
+// A named source of log lines with its own runtime level, e.g.
+//
+//   static LogModule logMqtt("mqtt");
+//   DLOG_I(logMqtt, "connected to %s", server);
+//
+// Modules register themselves in one list when constructed and are never
+// removed, so they are globals or file-scope statics. name must stay valid.
+class LogModule : public Registered<LogModule> {
+public:
+    explicit LogModule(const char* name, uint8_t level = DLOG_MIN_LEVEL);
+
+    const char* name() const { return _name; }
+    uint8_t level() const { return _level.load(std::memory_order_relaxed); }
+    void setLevel(uint8_t level) { _level.store(level, std::memory_order_relaxed); }
+    bool enabled(uint8_t level) const { return level <= this->level(); }
+
+    static LogModule* find(const char* name);
+
+private:
+    const char* _name;
+    std::atomic<uint8_t> _level;
+};
+
+// Leveled logging that never waits for the UART.
+//
+// A call formats its line straight into a slot of a RAM ring and returns; a
+// low-priority task writes the ring to Serial when the CPU is otherwise
+// idle. The ring is a SequenceRing, so any task (not ISRs) can log without
+// taking a lock. When lines come faster than the UART drains them, the oldest are
+// overwritten and counted as dropped on serial; the ring still holds the
+// most recent ones, which writeRecent() serves over HTTP.
+class DeviceLog {
+public:
+    // Start the task that drains the ring to out. Lines logged earlier are
+    // kept and written once it runs.
+    static bool begin(Print& out, UBaseType_t priority = 1, uint32_t stackSize = 3072);
+
+    // Write everything still queued from the calling task, e.g. before a
+    // restart or deep sleep
+    static void flush();
+
+    // Use the DLOG_* macros, which skip disabled levels without formatting
+    static void write(const LogModule& module, uint8_t level, const char* format, ...)
+        __attribute__((format(printf, 3, 4)));
+
+    // The lines still in the ring with a sequence number in [since, end), one
+    // "seq uptime level module: text" line each. Take end from lineCount()
+    // once and hand it out as the next since, so lines logged meanwhile go
+    // out exactly once, in the next call.
+    static void writeRecent(ChunkWriter write, void* context, uint32_t since, uint32_t end);
+
+    static uint32_t lineCount() { return _ring.end(); }
+    static uint32_t droppedCount() { return _dropped; }
+
+    // "error", "warn", ... for DLOG_LEVEL_ERROR, DLOG_LEVEL_WARN, ...
+    static const char* levelName(uint8_t level);
+    // Level from its name or number; returns false if text is neither
+    static bool parseLevel(const char* text, uint8_t& level);
+
+private:
+    struct Entry {
+        uint32_t uptimeMs;
+        const char* module;
+        uint8_t level;
+        char text[DEVICE_LOG_LINE_SIZE];
+    };
+
+    static SequenceRing<Entry>::Slot _slots[DEVICE_LOG_ENTRIES];
+    static SequenceRing<Entry> _ring;
+    static uint32_t _readSeq;               // Next line to drain; drain side only
+    static uint32_t _dropped;
+    static Print* _out;
+    static TaskHandle_t _task;
+    static SemaphoreHandle_t _drainMutex;
+
+    static bool copyEntry(uint32_t seq, Entry& copy);
+    static size_t formatLine(const Entry& entry, uint32_t seq, bool withSeq, char* line, size_t size);
+    static void drain();
+    static void taskEntry(void* parameter);
+};
+
+#define DLOG_AT(module, level, ...) \
+    do { \
+        if ((module).enabled(level)) { \
+            DeviceLog::write((module), (level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+// Compiled out: the branch is dead, so the call and its format string are
+// dropped, but arguments still count as used and formats are still checked
+#define DLOG_OFF(module, level, ...) \
+    do { \
+        if (false) { \
+            DeviceLog::write((module), (level), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#if DLOG_MIN_LEVEL >= DLOG_LEVEL_ERROR
+#define DLOG_E(module, ...) DLOG_AT(module, DLOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define DLOG_E(module, ...) DLOG_OFF(module, DLOG_LEVEL_ERROR, __VA_ARGS__)
+#endif
+
+#if DLOG_MIN_LEVEL >= DLOG_LEVEL_WARN
+#define DLOG_W(module, ...) DLOG_AT(module, DLOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define DLOG_W(module, ...) DLOG_OFF(module, DLOG_LEVEL_WARN, __VA_ARGS__)
+#endif
+
+#if DLOG_MIN_LEVEL >= DLOG_LEVEL_INFO
+#define DLOG_I(module, ...) DLOG_AT(module, DLOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define DLOG_I(module, ...) DLOG_OFF(module, DLOG_LEVEL_INFO, __VA_ARGS__)
+#endif
+
+#if DLOG_MIN_LEVEL >= DLOG_LEVEL_DEBUG
+#define DLOG_D(module, ...) DLOG_AT(module, DLOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define DLOG_D(module, ...) DLOG_OFF(module, DLOG_LEVEL_DEBUG, __VA_ARGS__)
+#endif
+
+#if DLOG_MIN_LEVEL >= DLOG_LEVEL_VERBOSE
+#define DLOG_V(module, ...) DLOG_AT(module, DLOG_LEVEL_VERBOSE, __VA_ARGS__)
+#else
+#define DLOG_V(module, ...) DLOG_OFF(module, DLOG_LEVEL_VERBOSE, __VA_ARGS__)
+#endif
+
+#endif
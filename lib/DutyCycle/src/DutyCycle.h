@@ -0,0 +1,215 @@
+#ifndef DUTY_CYCLE_H
+#define DUTY_CYCLE_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Values stored per wake
+#ifndef DUTY_CYCLE_MAX_CHANNELS
+#define DUTY_CYCLE_MAX_CHANNELS 4
+#endif
+
+// Samples kept between network sessions; when full the oldest is dropped.
+// 48 records take about 1.2 KB of the 8 KB of RTC slow memory.
+#ifndef DUTY_CYCLE_CAPACITY
+#define DUTY_CYCLE_CAPACITY 48
+#endif
+
+// Shortest sleep, even after a wake that took longer than the period
+#ifndef DUTY_CYCLE_MIN_SLEEP_MS
+#define DUTY_CYCLE_MIN_SLEEP_MS 1000
+#endif
+
+struct DutyCycleConfig {
+    uint32_t periodMs;     // Wake to wake
+    uint16_t publishEvery; // Wakes per network session (1 = every wake)
+};
+
+struct DutyCycleRecord {
+    uint64_t clockMs; // Controller clock when the wake that took it began
+    float values[DUTY_CYCLE_MAX_CHANNELS];
+};
+
+// Everything that has to survive deep sleep. The application keeps one in
+// RTC memory (RTC_DATA_ATTR); begin() tells a valid one from a fresh boot.
+struct DutyCycleState {
+    uint32_t magic;
+    uint8_t channelCount;
+    uint16_t wakesSinceSession;
+    uint16_t first;           // Oldest record in the ring
+    uint16_t count;
+    uint64_t clockMs;         // Since power-on: awake time plus requested sleep
+    uint64_t awakeMs;         // Total time awake since power-on
+    uint32_t lastAwakeMs;
+    uint32_t wakes;
+    uint32_t sessions;        // Network sessions that delivered the whole batch
+    uint32_t failedSessions;  // No connection, or the batch was only partly sent
+    uint32_t dropped;         // Records lost to a full buffer
+    DutyCycleRecord records[DUTY_CYCLE_CAPACITY];
+};
+
+enum DutyCyclePhase {
+    DUTY_CYCLE_SAMPLE,  // Take this wake's sample
+    DUTY_CYCLE_CONNECT, // Bring up WiFi and MQTT
+    DUTY_CYCLE_PUBLISH, // Send the batch
+    DUTY_CYCLE_SLEEP    // Back to deep sleep
+};
+
+// Decisions of one wake of a duty-cycled sensor: every wake stores a sample,
+// and only every publishEvery'th wake brings up the network to send the whole
+// batch in one session. No hardware access, so the sleep / sample / batch /
+// publish transitions can be run on a host.
+//
+// The clock advances by the measured awake time plus the sleep that was
+// requested, which keeps record ages right without a wall clock; the
+// application turns ages into timestamps once NTP has synced. Sleeps are
+// shortened by the awake time so wakes stay one period apart.
+//
+// Sessions are counted per attempt: when the network is down the batch waits
+// (dropping its oldest records once full) and the next try comes publishEvery
+// wakes later, rather than on every wake.
+class DutyCycleController {
+public:
+    static const uint32_t STATE_MAGIC = 0x44435943; // "DCYC"
+
+    DutyCycleController(DutyCycleState& state, const DutyCycleConfig& config)
+        : _state(state), _config(config), _phase(DUTY_CYCLE_SAMPLE) {}
+
+    // Call first on every wake. Anything but a timer wake (power-on, reset,
+    // crash) starts from a fresh state, and the first wake after that
+    // publishes, so a new device shows up and syncs its clock right away.
+    void begin(bool wokeFromSleep, uint8_t channelCount) {
+        if (channelCount > DUTY_CYCLE_MAX_CHANNELS) {
+            channelCount = DUTY_CYCLE_MAX_CHANNELS;
+        }
+        if (!wokeFromSleep || _state.magic != STATE_MAGIC || _state.channelCount != channelCount ||
+            _state.count > DUTY_CYCLE_CAPACITY || _state.first >= DUTY_CYCLE_CAPACITY) {
+            memset(&_state, 0, sizeof(_state));
+            _state.magic = STATE_MAGIC;
+            _state.channelCount = channelCount;
+            _state.wakesSinceSession = publishEvery() - 1;
+        }
+        _state.wakes++;
+        _phase = DUTY_CYCLE_SAMPLE;
+    }
+
+    // Store this wake's sample (NAN for a failed read) and decide whether a
+    // session is due
+    void addSample(const float* values) {
+        if (_phase != DUTY_CYCLE_SAMPLE) {
+            return;
+        }
+
+        if (_state.count == DUTY_CYCLE_CAPACITY) {
+            _state.first = (_state.first + 1) % DUTY_CYCLE_CAPACITY;
+            _state.count--;
+            _state.dropped++;
+        }
+        DutyCycleRecord& record = _state.records[(_state.first + _state.count) % DUTY_CYCLE_CAPACITY];
+        record.clockMs = _state.clockMs;
+        for (uint8_t i = 0; i < DUTY_CYCLE_MAX_CHANNELS; i++) {
+            record.values[i] = i < _state.channelCount ? values[i] : NAN;
+        }
+        _state.count++;
+
+        _state.wakesSinceSession++;
+        if (_state.wakesSinceSession >= publishEvery()) {
+            _state.wakesSinceSession = 0;
+            _phase = DUTY_CYCLE_CONNECT;
+        } else {
+            _phase = DUTY_CYCLE_SLEEP;
+        }
+    }
+
+    void connected() {
+        if (_phase == DUTY_CYCLE_CONNECT) {
+            _phase = DUTY_CYCLE_PUBLISH;
+        }
+    }
+
+    // The batch stays for the next session
+    void connectFailed() {
+        if (_phase == DUTY_CYCLE_CONNECT) {
+            _state.failedSessions++;
+            _phase = DUTY_CYCLE_SLEEP;
+        }
+    }
+
+    size_t pending() const { return _state.count; }
+
+    // index 0 is the oldest record
+    const DutyCycleRecord& record(size_t index) const {
+        return _state.records[(_state.first + index) % DUTY_CYCLE_CAPACITY];
+    }
+
+    // How long before now (awakeMs into this wake) the record was taken
+    uint64_t recordAgeMs(size_t index, uint32_t awakeMs) const {
+        return _state.clockMs + awakeMs - record(index).clockMs;
+    }
+
+    // The oldest count records were delivered; the session is done once all are
+    void published(size_t count) {
+        if (_phase != DUTY_CYCLE_PUBLISH) {
+            return;
+        }
+        if (count > _state.count) {
+            count = _state.count;
+        }
+        _state.first = (_state.first + count) % DUTY_CYCLE_CAPACITY;
+        _state.count -= count;
+        if (_state.count == 0) {
+            _state.sessions++;
+            _phase = DUTY_CYCLE_SLEEP;
+        }
+    }
+
+    // Undelivered records stay for the next session
+    void publishFailed() {
+        if (_phase == DUTY_CYCLE_PUBLISH) {
+            _state.failedSessions++;
+            _phase = DUTY_CYCLE_SLEEP;
+        }
+    }
+
+    // How long to sleep so the next wake begins one period after this one
+    // did. Advances the clock past this wake and the sleep, so call it once,
+    // right before sleeping.
+    uint32_t sleepMs(uint32_t awakeMs) {
+        uint32_t sleep = awakeMs + DUTY_CYCLE_MIN_SLEEP_MS <= _config.periodMs ? _config.periodMs - awakeMs
+                                                                                : DUTY_CYCLE_MIN_SLEEP_MS;
+        _state.clockMs += (uint64_t)awakeMs + sleep;
+        _state.awakeMs += awakeMs;
+        _state.lastAwakeMs = awakeMs;
+        _phase = DUTY_CYCLE_SLEEP;
+        return sleep;
+    }
+
+    // Fraction of the time since power-on spent awake
+    float dutyCycle() const {
+        return _state.clockMs > 0 ? (float)((double)_state.awakeMs / (double)_state.clockMs) : 0.0f;
+    }
+
+    DutyCyclePhase phase() const { return _phase; }
+    const DutyCycleState& state() const { return _state; }
+
+    static const char* phaseName(DutyCyclePhase phase) {
+        switch (phase) {
+        case DUTY_CYCLE_SAMPLE: return "sample";
+        case DUTY_CYCLE_CONNECT: return "connect";
+        case DUTY_CYCLE_PUBLISH: return "publish";
+        case DUTY_CYCLE_SLEEP: return "sleep";
+        }
+        return "unknown";
+    }
+
+private:
+    DutyCycleState& _state;
+    DutyCycleConfig _config;
+    DutyCyclePhase _phase;
+
+    uint16_t publishEvery() const { return _config.publishEvery > 0 ? _config.publishEvery : 1; }
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Minimal CBOR (RFC 8949) encoder writing into a caller-supplied buffer.
+// Only the item types needed for telemetry frames are provided. Any write
+// that does not fit marks the writer as overflowed and is dropped.
+class CBORWriter {
+public:
+    // RFC 8746 typed array tag: float32, little endian
+    static const uint16_t TAG_FLOAT32_LE_ARRAY = 85;
+
+    CBORWriter(uint8_t* buffer, size_t capacity)
+        : _buffer(buffer), _capacity(capacity), _length(0), _overflow(false) {}
+
+    void writeUInt(uint64_t value) { writeHead(0, value); }
+
+    void writeInt(int64_t value) {
+        if (value < 0) {
+            writeHead(1, (uint64_t)(-1 - value));
+        } else {
+            writeHead(0, (uint64_t)value);
+        }
+    }
+
+    void writeBytes(const uint8_t* data, size_t length) {
+        writeHead(2, length);
+        writeRaw(data, length);
+    }
+
+    void writeText(const char* text) {
+        size_t length = strlen(text);
+        writeHead(3, length);
+        writeRaw((const uint8_t*)text, length);
+    }
+
+    void writeArrayHeader(size_t count) { writeHead(4, count); }
+    void writeMapHeader(size_t count) { writeHead(5, count); }
+    void writeTag(uint64_t tag) { writeHead(6, tag); }
+
+    void writeFloat(float value) {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint8_t encoded[5] = {0xFA, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16), (uint8_t)(bits >> 8), (uint8_t)bits};
+        writeRaw(encoded, sizeof(encoded));
+    }
+
+    // Packed float32 array (tag 85 around a little-endian byte string)
+    void writeFloat32Array(const float* values, size_t count) {
+        writeTag(TAG_FLOAT32_LE_ARRAY);
+        writeHead(2, count * 4);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            uint8_t encoded[4] = {(uint8_t)bits, (uint8_t)(bits >> 8), (uint8_t)(bits >> 16), (uint8_t)(bits >> 24)};
+            writeRaw(encoded, sizeof(encoded));
+        }
+    }
+
+    const uint8_t* data() const { return _buffer; }
+    size_t length() const { return _length; }
+    bool ok() const { return !_overflow; }
+
+private:
+    uint8_t* _buffer;
+    size_t _capacity;
+    size_t _length;
+    bool _overflow;
+
+    void writeHead(uint8_t majorType, uint64_t value) {
+        uint8_t head[9];
+        size_t size;
+        uint8_t major = majorType << 5;
+
+        if (value < 24) {
+            head[0] = major | (uint8_t)value;
+            size = 1;
+        } else if (value <= 0xFF) {
+            head[0] = major | 24;
+            head[1] = (uint8_t)value;
+            size = 2;
+        } else if (value <= 0xFFFF) {
+            head[0] = major | 25;
+            head[1] = (uint8_t)(value >> 8);
+            head[2] = (uint8_t)value;
+            size = 3;
+        } else if (value <= 0xFFFFFFFFULL) {
+            head[0] = major | 26;
+            for (int i = 0; i < 4; i++) {
+                head[1 + i] = (uint8_t)(value >> (24 - 8 * i));
+            }
+            size = 5;
+        } else {
+            head[0] = major | 27;
+            for (int i = 0; i < 8; i++) {
+                head[1 + i] = (uint8_t)(value >> (56 - 8 * i));
+            }
+            size = 9;
+        }
+        writeRaw(head, size);
+    }
+
+    void writeRaw(const uint8_t* data, size_t length) {
+        if (_overflow || _length + length > _capacity) {
+            _overflow = true;
+            return;
+        }
+        memcpy(_buffer + _length, data, length);
+        _length += length;
+    }
+};
+
+#endif
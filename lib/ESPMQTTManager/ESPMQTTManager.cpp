@@ -1,27 +1,44 @@
 #include "ESPMQTTManager.h"
+#include "CBORWriter.h"
+#include <DeviceLog.h>
+#include <ESPMetrics.h>
+#include <SpanTracer.h>
 
-// Static instance for callback
-ESPMQTTManager* ESPMQTTManager::_instance = nullptr;
+static LogModule logMqtt("mqtt");
+
+static MetricCounter publishOk("mqtt_publish_total", "MQTT publishes by result", "result=\"ok\"");
+static MetricCounter publishFailed("mqtt_publish_total", "MQTT publishes by result", "result=\"error\"");
+static MetricHistogram publishDuration("mqtt_publish_duration_seconds", "Time to hand one PUBLISH to the socket");
+static MetricCounter connectOk("mqtt_connect_total", "MQTT connection attempts by result", "result=\"ok\"");
+static MetricCounter connectFailed("mqtt_connect_total", "MQTT connection attempts by result", "result=\"error\"");
+static MetricHistogram connectDuration("mqtt_connect_duration_seconds", "Time of one MQTT connection attempt");
 
 ESPMQTTManager::ESPMQTTManager(const char* username, const char* password, const char* fallbackIP, int port)
     : _username(username), _password(password), _serverIP(fallbackIP), _port(port),
-      _mqttClient(_wifiClient), _rebootCallback(nullptr),
-      _lastTempPublish(0), _lastVersionPublish(0), _lastDiscovery(0) {
-    _instance = this;
+      _telemetryEncoding(TELEMETRY_ASCII),
+      _lastTempPublish(0), _lastVersionPublish(0), _lastDiscovery(0),
+      _lastConnectAttempt(0), _connectAttempted(false),
+      _clientTap(_wifiClient), _mqttClient(_clientTap), _rebootCallback(nullptr) {
+    for (size_t i = 0; i < MQTT_MAX_COMMANDS; i++) {
+        _commands[i].used = false;
+    }
+    _clientTap.setPubAckCallback(handlePubAck, this);
+    _outbox.setWriter(writeRawPacket, this);
 }
 
-void ESPMQTTManager::begin(String clientId) {
-    _clientId = clientId;
+void ESPMQTTManager::begin(const char* clientId) {
     updateTopics(clientId);
     _mqttClient.setServer(_serverIP.c_str(), _port);
-    _mqttClient.setCallback(mqttCallback);
+    _mqttClient.setCallback([this](char* topic, byte* payload, unsigned int length) {
+        handleMessage(topic, payload, length);
+    });
 }
 
-void ESPMQTTManager::setTopicTemplates(String tempTopic, String cpuTempTopic, String rebootTopic, String firmwareVersionTopic) {
-    _topicTemp = tempTopic;
-    _topicCpuTemp = cpuTempTopic;
-    _topicReboot = rebootTopic;
-    _topicFirmwareVersion = firmwareVersionTopic;
+void ESPMQTTManager::setTopicTemplates(const char* tempTopic, const char* cpuTempTopic, const char* rebootTopic, const char* firmwareVersionTopic) {
+    _topicTemp.assign(tempTopic);
+    _topicCpuTemp.assign(cpuTempTopic);
+    setRebootTopic(TopicString(rebootTopic));
+    _topicFirmwareVersion.assign(firmwareVersionTopic);
 }
 
 void ESPMQTTManager::setRebootCallback(void (*callback)()) {
@@ -33,19 +50,28 @@ bool ESPMQTTManager::connect() {
         return true;
     }
     
-    while (!_mqttClient.connected()) {
-        if (_mqttClient.connect(_clientId.c_str(), _username, _password)) {
-            _mqttClient.subscribe(_topicReboot.c_str());
-            Serial.println("MQTT connected with Client ID: " + _clientId);
-            Serial.println("MQTT server: " + _serverIP);
-            return true;
-        } else {
-            Serial.print("MQTT connection failed, rc=");
-            Serial.print(_mqttClient.state());
-            Serial.println(" retrying in 5 seconds");
-            delay(5000);
-        }
+    // One attempt per call: a broker that is down must not stall the caller's loop
+    unsigned long now = millis();
+    if (_connectAttempted && now - _lastConnectAttempt < _reconnectInterval) {
+        return false;
     }
+    _connectAttempted = true;
+    _lastConnectAttempt = now;
+    TRACE_SCOPE("mqtt.connect");
+    
+    uint32_t start = micros();
+    bool connected = _mqttClient.connect(_clientId.c_str(), _username, _password);
+    connectDuration.observe(micros() - start);
+    (connected ? connectOk : connectFailed).increment();
+    
+    if (connected) {
+        resubscribeAll();
+        _outbox.onReconnect(); // Resend unacknowledged QoS 1 messages with DUP
+        DLOG_I(logMqtt, "MQTT connected with Client ID: %s", _clientId.c_str());
+        DLOG_I(logMqtt, "MQTT server: %s", _serverIP.c_str());
+        return true;
+    }
+    DLOG_W(logMqtt, "MQTT connection failed, rc=%d retrying in 5 seconds", _mqttClient.state());
     return false;
 }
 
@@ -59,10 +85,12 @@ bool ESPMQTTManager::isConnected() {
 
 void ESPMQTTManager::loop() {
     _mqttClient.loop();
+    _outbox.poll(_mqttClient.connected(), millis());
 }
 
 String ESPMQTTManager::discoverServer() {
-    Serial.println("Searching for Home Assistant server...");
+    TRACE_SCOPE("mqtt.discover");
+    DLOG_I(logMqtt, "Searching for Home Assistant server...");
     
     // Scan network for Home Assistant
     String foundIP = scanForHomeAssistant();
@@ -70,85 +98,225 @@ String ESPMQTTManager::discoverServer() {
         return foundIP;
     }
     
-    Serial.println("Home Assistant server not found, using fallback IP");
-    return _serverIP; // Return the current fallback IP
+    DLOG_W(logMqtt, "Home Assistant server not found, using fallback IP");
+    return String(_serverIP.c_str()); // Return the current fallback IP
 }
 
-void ESPMQTTManager::updateServerIP(String newIP) {
-    if (newIP != _serverIP) {
-        Serial.println("MQTT server changed from " + _serverIP + " to " + newIP);
-        _serverIP = newIP;
+void ESPMQTTManager::updateServerIP(const char* newIP) {
+    if (newIP != nullptr && _serverIP != newIP) {
+        DLOG_I(logMqtt, "MQTT server changed from %s to %s", _serverIP.c_str(), newIP);
+        _serverIP.assign(newIP);
         _mqttClient.disconnect();
         _mqttClient.setServer(_serverIP.c_str(), _port);
     }
 }
 
-String ESPMQTTManager::getCurrentServerIP() {
-    return _serverIP;
+const char* ESPMQTTManager::getCurrentServerIP() {
+    return _serverIP.c_str();
+}
+
+void ESPMQTTManager::updateTopics(const char* clientId) {
+    TopicString commandTopic;
+    
+    // Detach command routes registered under the old client ID
+    for (size_t i = 0; i < MQTT_MAX_COMMANDS; i++) {
+        if (_commands[i].used) {
+            buildCommandTopic(commandTopic, _clientId.c_str(), _commands[i].name.c_str());
+            off(commandTopic.c_str(), _commands[i].handler, _commands[i].context);
+        }
+    }
+    
+    _clientId.assign(clientId);
+    _topicTemp.format("home/esp/%s/temperature_f", _clientId.c_str());
+    _topicCpuTemp.format("home/esp/%s/cpu_temperature_c", _clientId.c_str());
+    _topicHumidity.format("home/esp/%s/humidity", _clientId.c_str());
+    _topicFirmwareVersion.format("home/esp/%s/firmware_version", _clientId.c_str());
+    _topicTelemetry.format("home/esp/%s/telemetry", _clientId.c_str());
+    
+    TopicString rebootTopic;
+    rebootTopic.format("home/esp/%s/reboot", _clientId.c_str());
+    setRebootTopic(rebootTopic);
+    
+    // Re-attach command routes under the new client ID
+    for (size_t i = 0; i < MQTT_MAX_COMMANDS; i++) {
+        if (_commands[i].used) {
+            buildCommandTopic(commandTopic, _clientId.c_str(), _commands[i].name.c_str());
+            if (!on(commandTopic.c_str(), _commands[i].handler, _commands[i].context)) {
+                DLOG_E(logMqtt, "MQTT command %s no longer routed", _commands[i].name.c_str());
+            }
+        }
+    }
+}
+
+void ESPMQTTManager::setRebootTopic(const TopicString& topic) {
+    if (!_topicReboot.isEmpty()) {
+        off(_topicReboot.c_str(), handleRebootMessage, this);
+    }
+    _topicReboot.assign(topic.c_str());
+    if (!on(_topicReboot.c_str(), handleRebootMessage, this)) {
+        DLOG_E(logMqtt, "MQTT reboot command not routed: %s", _topicReboot.c_str());
+    }
+}
+
+void ESPMQTTManager::buildCommandTopic(TopicString& topic, const char* clientId, const char* command) {
+    topic.format("home/esp/%s/%s", clientId, command);
 }
 
-void ESPMQTTManager::updateTopics(String clientId) {
-    _clientId = clientId;
-    _topicTemp = "home/esp/" + clientId + "/temperature_f";
-    _topicCpuTemp = "home/esp/" + clientId + "/cpu_temperature_c";
-    _topicReboot = "home/esp/" + clientId + "/reboot";
-    _topicFirmwareVersion = "home/esp/" + clientId + "/firmware_version";
+const char* ESPMQTTManager::getTempTopic() {
+    return _topicTemp.c_str();
 }
 
-String ESPMQTTManager::getTempTopic() {
-    return _topicTemp;
+const char* ESPMQTTManager::getCpuTempTopic() {
+    return _topicCpuTemp.c_str();
 }
 
-String ESPMQTTManager::getCpuTempTopic() {
-    return _topicCpuTemp;
+const char* ESPMQTTManager::getHumidityTopic() {
+    return _topicHumidity.c_str();
 }
 
-String ESPMQTTManager::getRebootTopic() {
-    return _topicReboot;
+const char* ESPMQTTManager::getRebootTopic() {
+    return _topicReboot.c_str();
 }
 
-String ESPMQTTManager::getFirmwareVersionTopic() {
-    return _topicFirmwareVersion;
+const char* ESPMQTTManager::getFirmwareVersionTopic() {
+    return _topicFirmwareVersion.c_str();
+}
+
+const char* ESPMQTTManager::getTelemetryTopic() {
+    return _topicTelemetry.c_str();
 }
 
 bool ESPMQTTManager::publishTemperature(float temperature) {
-    String tempStr = String(temperature, 1); // 1 decimal place
+    return publishFloat(_topicTemp, temperature, "temperature", "°F");
+}
+
+bool ESPMQTTManager::publishCpuTemperature(float temperature) {
+    return publishFloat(_topicCpuTemp, temperature, "CPU temperature", "°C");
+}
+
+bool ESPMQTTManager::publishHumidity(float humidity) {
+    return publishFloat(_topicHumidity, humidity, "humidity", "%");
+}
+
+// Format a reading with 1 decimal place into a stack buffer and publish it
+bool ESPMQTTManager::publishMetric(const char* metric, float value, const char* unit) {
+    TopicString topic;
+    buildCommandTopic(topic, _clientId.c_str(), metric);
+    return publishFloat(topic, value, metric, unit);
+}
+
+bool ESPMQTTManager::publishFloat(const TopicString& topic, float value, const char* label, const char* unit) {
+    char payload[16];
+    snprintf(payload, sizeof(payload), "%.1f", value);
     
-    if (_mqttClient.publish(_topicTemp.c_str(), tempStr.c_str())) {
-        Serial.printf("Published temperature: %s°F to topic: %s\n", tempStr.c_str(), _topicTemp.c_str());
+    if (publishPacket(topic.c_str(), (const uint8_t*)payload, strlen(payload), false)) {
+        DLOG_D(logMqtt, "Published %s: %s%s to topic: %s", label, payload, unit, topic.c_str());
         return true;
     } else {
-        Serial.println("Failed to publish temperature");
+        DLOG_W(logMqtt, "Failed to publish %s", label);
         return false;
     }
 }
 
-bool ESPMQTTManager::publishCpuTemperature(float temperature) {
-    String tempStr = String(temperature, 1); // 1 decimal place
+bool ESPMQTTManager::publishFirmwareVersion(int version) {
+    char payload[12];
+    snprintf(payload, sizeof(payload), "%d", version);
     
-    if (_mqttClient.publish(_topicCpuTemp.c_str(), tempStr.c_str())) {
-        Serial.printf("Published CPU temperature: %s°C to topic: %s\n", tempStr.c_str(), _topicCpuTemp.c_str());
+    if (publishReliable(_topicFirmwareVersion.c_str(), payload, true)) { // Retain message, QoS 1
+        DLOG_D(logMqtt, "Queued firmware version (QoS 1): %s to topic: %s", payload, _topicFirmwareVersion.c_str());
         return true;
     } else {
-        Serial.println("Failed to publish CPU temperature");
+        DLOG_W(logMqtt, "Failed to publish firmware version");
         return false;
     }
 }
 
-bool ESPMQTTManager::publishFirmwareVersion(int version) {
-    String versionStr = String(version);
+bool ESPMQTTManager::publish(const char* topic, const char* payload, bool retain) {
+    return publishPacket(topic, (const uint8_t*)payload, strlen(payload), retain);
+}
+
+// Every QoS 0 publish goes through here, so the metrics see all of them
+bool ESPMQTTManager::publishPacket(const char* topic, const uint8_t* payload, size_t length, bool retain) {
+    uint32_t start = micros();
+    bool sent = _mqttClient.publish(topic, payload, length, retain);
+    uint32_t elapsed = micros() - start;
+    publishDuration.observe(elapsed);
+    TRACE_SPAN_US("mqtt.publish", elapsed);
+    (sent ? publishOk : publishFailed).increment();
+    return sent;
+}
+
+void ESPMQTTManager::setTelemetryEncoding(TelemetryEncoding encoding) {
+    _telemetryEncoding = encoding;
+}
+
+ESPMQTTManager::TelemetryEncoding ESPMQTTManager::getTelemetryEncoding() {
+    return _telemetryEncoding;
+}
+
+bool ESPMQTTManager::publishTelemetry(uint16_t schemaId, uint64_t timestamp, const float* readings, size_t count) {
+    if (count > MQTT_TELEMETRY_MAX_READINGS) {
+        DLOG_W(logMqtt, "Telemetry frame has too many readings: %u", (unsigned)count);
+        return false;
+    }
     
-    if (_mqttClient.publish(_topicFirmwareVersion.c_str(), versionStr.c_str(), true)) { // Retain message
-        Serial.printf("Published firmware version: %s to topic: %s\n", versionStr.c_str(), _topicFirmwareVersion.c_str());
+    // Array header + schema ID + 64-bit timestamp + tag + byte string header + packed readings
+    uint8_t frame[1 + 3 + 9 + 2 + 2 + MQTT_TELEMETRY_MAX_READINGS * 4];
+    CBORWriter writer(frame, sizeof(frame));
+    writer.writeArrayHeader(3);
+    writer.writeUInt(schemaId);
+    writer.writeUInt(timestamp);
+    writer.writeFloat32Array(readings, count);
+    
+    if (!writer.ok()) {
+        DLOG_W(logMqtt, "Failed to encode telemetry frame");
+        return false;
+    }
+    
+    if (publishPacket(_topicTelemetry.c_str(), writer.data(), writer.length(), false)) {
+        DLOG_D(logMqtt, "Published telemetry frame: schema %u, %u readings, %u bytes",
+                        schemaId, (unsigned)count, (unsigned)writer.length());
         return true;
     } else {
-        Serial.println("Failed to publish firmware version");
+        DLOG_W(logMqtt, "Failed to publish telemetry frame");
         return false;
     }
 }
 
-bool ESPMQTTManager::publish(const char* topic, const char* payload, bool retain) {
-    return _mqttClient.publish(topic, payload, retain);
+bool ESPMQTTManager::publishReliable(const char* topic, const char* payload, bool retain) {
+    uint16_t packetId = _outbox.publish(topic, (const uint8_t*)payload, strlen(payload), retain,
+                                        _mqttClient.connected(), millis());
+    if (packetId == 0) {
+        DLOG_W(logMqtt, "QoS 1 publish rejected (%s): %s",
+               _outbox.inFlight() >= _outbox.window() ? "window full" : "topic or payload too long", topic);
+        return false;
+    }
+    return true;
+}
+
+void ESPMQTTManager::setDeliveryCallback(MQTTOutbox::DeliveryCallback callback, void* context) {
+    _outbox.setDeliveryCallback(callback, context);
+}
+
+const MQTTOutbox::Stats& ESPMQTTManager::getOutboxStats() {
+    return _outbox.stats();
+}
+
+size_t ESPMQTTManager::getMessagesInFlight() {
+    return _outbox.inFlight();
+}
+
+bool ESPMQTTManager::writeRawPacket(const uint8_t* data, size_t length, void* context) {
+    ESPMQTTManager* self = static_cast<ESPMQTTManager*>(context);
+    if (!self->_mqttClient.connected()) {
+        return false;
+    }
+    return self->_clientTap.write(data, length) == length;
+}
+
+void ESPMQTTManager::handlePubAck(uint16_t packetId, void* context) {
+    ESPMQTTManager* self = static_cast<ESPMQTTManager*>(context);
+    self->_outbox.onPubAck(packetId, millis());
 }
 
 bool ESPMQTTManager::subscribe(const char* topic) {
@@ -159,6 +327,61 @@ bool ESPMQTTManager::unsubscribe(const char* topic) {
     return _mqttClient.unsubscribe(topic);
 }
 
+bool ESPMQTTManager::on(const char* topicFilter, MessageHandler handler, void* context) {
+    bool alreadySubscribed = _router.hasFilter(topicFilter);
+    
+    if (!_router.add(topicFilter, handler, context)) {
+        DLOG_W(logMqtt, "Failed to register MQTT route: %s", topicFilter ? topicFilter : "(null)");
+        return false;
+    }
+    
+    // Routes added while offline are subscribed by resubscribeAll() on connect
+    if (!alreadySubscribed && _mqttClient.connected()) {
+        _mqttClient.subscribe(topicFilter);
+    }
+    return true;
+}
+
+bool ESPMQTTManager::off(const char* topicFilter, MessageHandler handler, void* context) {
+    if (!_router.remove(topicFilter, handler, context)) {
+        return false;
+    }
+    
+    if (!_router.hasFilter(topicFilter) && _mqttClient.connected()) {
+        _mqttClient.unsubscribe(topicFilter);
+    }
+    return true;
+}
+
+bool ESPMQTTManager::onCommand(const char* command, MessageHandler handler, void* context) {
+    for (size_t i = 0; i < MQTT_MAX_COMMANDS; i++) {
+        if (!_commands[i].used) {
+            TopicString commandTopic;
+            buildCommandTopic(commandTopic, _clientId.c_str(), command);
+            if (!on(commandTopic.c_str(), handler, context)) {
+                return false;
+            }
+            
+            _commands[i].name.assign(command);
+            _commands[i].handler = handler;
+            _commands[i].context = context;
+            _commands[i].used = true;
+            return true;
+        }
+    }
+    
+    DLOG_W(logMqtt, "No free MQTT command slots for: %s", command);
+    return false;
+}
+
+void ESPMQTTManager::resubscribeAll() {
+    for (size_t i = 0; i < _router.capacity(); i++) {
+        if (_router.isFirstRouteFor(i)) {
+            _mqttClient.subscribe(_router.routeFilter(i));
+        }
+    }
+}
+
 bool ESPMQTTManager::shouldPublishTemperature(unsigned long currentTime) {
     return (currentTime - _lastTempPublish > _tempPublishInterval);
 }
@@ -187,13 +410,13 @@ String ESPMQTTManager::scanForHomeAssistant() {
     IPAddress localIP = WiFi.localIP();
     String subnet = String(localIP[0]) + "." + String(localIP[1]) + "." + String(localIP[2]) + ".";
     
-    Serial.println("Scanning network for Home Assistant on port 8123...");
+    DLOG_I(logMqtt, "Scanning network for Home Assistant on port 8123...");
     
     // Scan a limited range to avoid taking too long
     for (int i = 1; i <= 254; i += 10) { // Check every 10th IP to speed up
         String testIP = subnet + String(i);
         if (testHomeAssistantConnection(testIP)) {
-            Serial.printf("Found Home Assistant at: %s\n", testIP.c_str());
+            DLOG_I(logMqtt, "Found Home Assistant at: %s", testIP.c_str());
             return testIP;
         }
         
@@ -204,14 +427,14 @@ String ESPMQTTManager::scanForHomeAssistant() {
             for (int j = 0; j < 10; j++) {
                 String commonIP = subnet + String(commonIPs[j]);
                 if (testHomeAssistantConnection(commonIP)) {
-                    Serial.printf("Found Home Assistant at: %s\n", commonIP.c_str());
+                    DLOG_I(logMqtt, "Found Home Assistant at: %s", commonIP.c_str());
                     return commonIP;
                 }
             }
         }
     }
     
-    Serial.println("Network scan completed, no Home Assistant found");
+    DLOG_I(logMqtt, "Network scan completed, no Home Assistant found");
     return "";
 }
 
@@ -228,19 +451,18 @@ bool ESPMQTTManager::testHomeAssistantConnection(String ip) {
     return (httpCode == 401 || httpCode == 200);
 }
 
-void ESPMQTTManager::mqttCallback(char* topic, byte* payload, unsigned int length) {
-    if (_instance) {
-        _instance->handleMessage(topic, payload, length);
-    }
+void ESPMQTTManager::handleMessage(char* topic, byte* payload, unsigned int length) {
+    _router.dispatch(topic, payload, length);
 }
 
-void ESPMQTTManager::handleMessage(char* topic, byte* payload, unsigned int length) {
-    if (String(topic) == _topicReboot) {
-        Serial.println("Reboot command received via MQTT!");
-        if (_rebootCallback) {
-            _rebootCallback();
-        } else {
-            ESP.restart();
-        }
+void ESPMQTTManager::handleRebootMessage(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+    ESPMQTTManager* self = static_cast<ESPMQTTManager*>(context);
+    
+    DLOG_I(logMqtt, "Reboot command received via MQTT!");
+    if (self->_rebootCallback) {
+        self->_rebootCallback();
+    } else {
+        DeviceLog::flush();
+        ESP.restart();
     }
 }
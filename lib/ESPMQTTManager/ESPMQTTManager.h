@@ -4,18 +4,46 @@
 #include <WiFi.h>
 #include <PubSubClient.h>
 #include <HTTPClient.h>
+#include "FixedString.h"
+#include "TopicRouter.h"
+#include "MQTTOutbox.h"
+#include "MQTTClientTap.h"
+#include "PublishPolicy.h"
+
+#ifndef MQTT_TELEMETRY_MAX_READINGS
+#define MQTT_TELEMETRY_MAX_READINGS 16
+#endif
+
+#ifndef MQTT_MAX_COMMANDS
+#define MQTT_MAX_COMMANDS 8
+#endif
 
 class ESPMQTTManager {
 public:
+    // Inline storage sizes (client IDs are limited to 32 characters by the web UI)
+    typedef FixedString<32> ClientIdString;
+    typedef FixedString<64> TopicString;
+    typedef FixedString<15> IPString;
+    typedef FixedString<24> CommandString;
+    typedef TopicRouter::Handler MessageHandler;
+    
+    // Telemetry payload encodings
+    enum TelemetryEncoding {
+        TELEMETRY_ASCII, // One topic per metric, decimal text payloads
+        TELEMETRY_CBOR   // One CBOR frame per sample set on the telemetry topic
+    };
+    
+
     // Constructor
     ESPMQTTManager(const char* username, const char* password, const char* fallbackIP = "192.168.1.12", int port = 1883);
     
     // Initialization and setup
-    void begin(String clientId);
-    void setTopicTemplates(String tempTopic, String cpuTempTopic, String rebootTopic, String firmwareVersionTopic);
+    void begin(const char* clientId);
+    void setTopicTemplates(const char* tempTopic, const char* cpuTempTopic, const char* rebootTopic, const char* firmwareVersionTopic);
     void setRebootCallback(void (*callback)());
     
-    // Connection management
+    // Connection management. connect() makes one attempt and returns; calls
+    // within 5 seconds of a failed attempt return false without trying.
     bool connect();
     void disconnect();
     bool isConnected();
@@ -23,26 +51,50 @@ public:
     
     // Server discovery
     String discoverServer();
-    void updateServerIP(String newIP);
-    String getCurrentServerIP();
+    void updateServerIP(const char* newIP);
+    const char* getCurrentServerIP();
     
     // Topic management
-    void updateTopics(String clientId);
-    String getTempTopic();
-    String getCpuTempTopic();
-    String getRebootTopic();
-    String getFirmwareVersionTopic();
+    void updateTopics(const char* clientId);
+    const char* getTempTopic();
+    const char* getCpuTempTopic();
+    const char* getHumidityTopic();
+    const char* getRebootTopic();
+    const char* getFirmwareVersionTopic();
+    const char* getTelemetryTopic();
     
     // Publishing
     bool publishTemperature(float temperature);
     bool publishCpuTemperature(float temperature);
+    bool publishHumidity(float humidity);
+    bool publishMetric(const char* metric, float value, const char* unit); // home/esp/<client_id>/<metric>
     bool publishFirmwareVersion(int version);
     bool publish(const char* topic, const char* payload, bool retain = false);
     
+    // Binary telemetry: publishes [schemaId, timestamp, float32[] readings] as one
+    // CBOR frame to the telemetry topic. The schema ID identifies the reading order.
+    void setTelemetryEncoding(TelemetryEncoding encoding);
+    TelemetryEncoding getTelemetryEncoding();
+    bool publishTelemetry(uint16_t schemaId, uint64_t timestamp, const float* readings, size_t count);
+    
+    // QoS 1 publishing (confirmed by PUBACK, retransmitted until acknowledged).
+    // Returns false if the in-flight window is full.
+    bool publishReliable(const char* topic, const char* payload, bool retain = false);
+    void setDeliveryCallback(MQTTOutbox::DeliveryCallback callback, void* context = nullptr);
+    const MQTTOutbox::Stats& getOutboxStats();
+    size_t getMessagesInFlight();
+    
     // Subscription
     bool subscribe(const char* topic);
     bool unsubscribe(const char* topic);
     
+    // Inbound message routing (filters support '+' and '#', and are
+    // resubscribed automatically after every reconnect)
+    bool on(const char* topicFilter, MessageHandler handler, void* context = nullptr);
+    bool off(const char* topicFilter, MessageHandler handler, void* context = nullptr);
+    // Register a handler for home/esp/{client_id}/{command}; follows client ID changes
+    bool onCommand(const char* command, MessageHandler handler, void* context = nullptr);
+    
     // Timing management
     bool shouldPublishTemperature(unsigned long currentTime);
     bool shouldPublishFirmwareVersion(unsigned long currentTime);
@@ -55,37 +107,61 @@ private:
     // MQTT credentials and settings
     const char* _username;
     const char* _password;
-    String _serverIP;
+    IPString _serverIP;
     int _port;
-    String _clientId;
+    ClientIdString _clientId;
     
     // Topic templates
-    String _topicTemp;
-    String _topicCpuTemp;
-    String _topicReboot;
-    String _topicFirmwareVersion;
+    TopicString _topicTemp;
+    TopicString _topicCpuTemp;
+    TopicString _topicHumidity;
+    TopicString _topicReboot;
+    TopicString _topicFirmwareVersion;
+    TopicString _topicTelemetry;
+    TelemetryEncoding _telemetryEncoding;
     
     // Timing variables
     unsigned long _lastTempPublish;
     unsigned long _lastVersionPublish;
     unsigned long _lastDiscovery;
+    unsigned long _lastConnectAttempt;
+    bool _connectAttempted;
     static const unsigned long _tempPublishInterval = 10 * 1000UL; // 10 seconds
     static const unsigned long _versionPublishInterval = 1 * 60 * 1000UL; // 5 minutes
     static const unsigned long _discoveryInterval = 15 * 60 * 1000UL; // 15 minutes
+    static const unsigned long _reconnectInterval = 5 * 1000UL; // 5 seconds
     
-    // MQTT client
+    // MQTT client (the tap observes PUBACKs for the QoS 1 outbox)
     WiFiClient _wifiClient;
+    MQTTClientTap _clientTap;
     PubSubClient _mqttClient;
+    MQTTOutbox _outbox;
     
     // Callback function for reboot command
     void (*_rebootCallback)();
     
+    // Inbound routing
+    struct CommandRoute {
+        CommandString name;
+        MessageHandler handler;
+        void* context;
+        bool used;
+    };
+    TopicRouter _router;
+    CommandRoute _commands[MQTT_MAX_COMMANDS];
+    
     // Private helper methods
     String scanForHomeAssistant();
     bool testHomeAssistantConnection(String ip);
-    static void mqttCallback(char* topic, byte* payload, unsigned int length);
-    static ESPMQTTManager* _instance; // For static callback
     void handleMessage(char* topic, byte* payload, unsigned int length);
+    void resubscribeAll();
+    void setRebootTopic(const TopicString& topic);
+    void buildCommandTopic(TopicString& topic, const char* clientId, const char* command);
+    static bool writeRawPacket(const uint8_t* data, size_t length, void* context);
+    static void handlePubAck(uint16_t packetId, void* context);
+    static void handleRebootMessage(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+    bool publishFloat(const TopicString& topic, float value, const char* label, const char* unit);
+    bool publishPacket(const char* topic, const uint8_t* payload, size_t length, bool retain);
 };
 
 #endif
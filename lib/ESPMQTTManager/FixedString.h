@@ -0,0 +1,108 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// Fixed-capacity, inline, always NUL-terminated string.
+// Never touches the heap; writes that do not fit are truncated and flagged.
+template <size_t Capacity>
+class FixedString {
+public:
+    FixedString() : _length(0), _truncated(false) {
+        _buffer[0] = '\0';
+    }
+
+    FixedString(const char* value) : FixedString() {
+        assign(value);
+    }
+
+    // Replace the contents with value (nullptr clears)
+    bool assign(const char* value) {
+        clear();
+        return append(value);
+    }
+
+    // Append value, truncating at capacity
+    bool append(const char* value) {
+        if (value == nullptr) {
+            return true;
+        }
+        return append(value, strlen(value));
+    }
+
+    bool append(const char* value, size_t length) {
+        size_t space = Capacity - _length;
+        size_t count = length < space ? length : space;
+        memcpy(_buffer + _length, value, count);
+        _length += count;
+        _buffer[_length] = '\0';
+        if (count < length) {
+            _truncated = true;
+        }
+        return count == length;
+    }
+
+    // Replace the contents with printf-style formatted text
+    bool format(const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        int written = vsnprintf(_buffer, sizeof(_buffer), fmt, args);
+        va_end(args);
+        return finishFormat(written, 0);
+    }
+
+    // Append printf-style formatted text
+    bool appendFormat(const char* fmt, ...) {
+        va_list args;
+        va_start(args, fmt);
+        int written = vsnprintf(_buffer + _length, sizeof(_buffer) - _length, fmt, args);
+        va_end(args);
+        return finishFormat(written, _length);
+    }
+
+    void clear() {
+        _length = 0;
+        _truncated = false;
+        _buffer[0] = '\0';
+    }
+
+    bool equals(const char* other) const {
+        return other != nullptr && strcmp(_buffer, other) == 0;
+    }
+
+    bool operator==(const char* other) const { return equals(other); }
+    bool operator!=(const char* other) const { return !equals(other); }
+
+    const char* c_str() const { return _buffer; }
+    size_t length() const { return _length; }
+    bool isEmpty() const { return _length == 0; }
+    bool isTruncated() const { return _truncated; }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    char _buffer[Capacity + 1];
+    size_t _length;
+    bool _truncated;
+
+    bool finishFormat(int written, size_t offset) {
+        if (written < 0) {
+            _buffer[offset] = '\0';
+            _length = offset;
+            _truncated = true;
+            return false;
+        }
+        size_t wanted = offset + (size_t)written;
+        if (wanted > Capacity) {
+            _length = Capacity;
+            _truncated = true;
+            return false;
+        }
+        _length = wanted;
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,115 @@
+#include "MQTTClientTap.h"
+
+static const uint8_t MQTT_PACKET_PUBACK = 4;
+
+MQTTClientTap::MQTTClientTap(Client& inner)
+    : _inner(inner), _pubAckCallback(nullptr), _pubAckContext(nullptr) {
+    resetParser();
+}
+
+void MQTTClientTap::setPubAckCallback(PubAckCallback callback, void* context) {
+    _pubAckCallback = callback;
+    _pubAckContext = context;
+}
+
+int MQTTClientTap::connect(IPAddress ip, uint16_t port) {
+    resetParser();
+    return _inner.connect(ip, port);
+}
+
+int MQTTClientTap::connect(const char* host, uint16_t port) {
+    resetParser();
+    return _inner.connect(host, port);
+}
+
+size_t MQTTClientTap::write(uint8_t value) {
+    return _inner.write(value);
+}
+
+size_t MQTTClientTap::write(const uint8_t* buf, size_t size) {
+    return _inner.write(buf, size);
+}
+
+int MQTTClientTap::available() {
+    return _inner.available();
+}
+
+int MQTTClientTap::read() {
+    int value = _inner.read();
+    if (value >= 0) {
+        observe((uint8_t)value);
+    }
+    return value;
+}
+
+int MQTTClientTap::read(uint8_t* buf, size_t size) {
+    int count = _inner.read(buf, size);
+    for (int i = 0; i < count; i++) {
+        observe(buf[i]);
+    }
+    return count;
+}
+
+int MQTTClientTap::peek() {
+    return _inner.peek();
+}
+
+void MQTTClientTap::flush() {
+    _inner.flush();
+}
+
+void MQTTClientTap::stop() {
+    resetParser();
+    _inner.stop();
+}
+
+uint8_t MQTTClientTap::connected() {
+    return _inner.connected();
+}
+
+MQTTClientTap::operator bool() {
+    return (bool)_inner;
+}
+
+void MQTTClientTap::resetParser() {
+    _state = PARSE_HEADER;
+    _packetType = 0;
+    _remaining = 0;
+    _multiplier = 1;
+    _bodyPos = 0;
+}
+
+void MQTTClientTap::observe(uint8_t value) {
+    switch (_state) {
+        case PARSE_HEADER:
+            _packetType = value >> 4;
+            _remaining = 0;
+            _multiplier = 1;
+            _bodyPos = 0;
+            _state = PARSE_LENGTH;
+            break;
+
+        case PARSE_LENGTH:
+            _remaining += (value & 0x7F) * _multiplier;
+            _multiplier *= 128;
+            if ((value & 0x80) == 0) {
+                _state = _remaining > 0 ? PARSE_BODY : PARSE_HEADER;
+            } else if (_multiplier > 128UL * 128 * 128) {
+                resetParser(); // Malformed length, resynchronise on the next byte
+            }
+            break;
+
+        case PARSE_BODY:
+            if (_packetType == MQTT_PACKET_PUBACK && _bodyPos < 2) {
+                _packetId[_bodyPos] = value;
+            }
+            _bodyPos = _bodyPos < 255 ? _bodyPos + 1 : _bodyPos;
+            if (--_remaining == 0) {
+                if (_packetType == MQTT_PACKET_PUBACK && _bodyPos == 2 && _pubAckCallback) {
+                    _pubAckCallback(((uint16_t)_packetId[0] << 8) | _packetId[1], _pubAckContext);
+                }
+                _state = PARSE_HEADER;
+            }
+            break;
+    }
+}
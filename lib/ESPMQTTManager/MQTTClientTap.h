@@ -0,0 +1,54 @@
+#ifndef MQTT_CLIENT_TAP_H
+#define MQTT_CLIENT_TAP_H
+
+#include <Arduino.h>
+#include <Client.h>
+
+// Pass-through Client that sits between PubSubClient and the network socket.
+// It follows MQTT packet framing on the inbound byte stream and reports
+// PUBACK packet IDs, which PubSubClient reads and silently discards.
+class MQTTClientTap : public Client {
+public:
+    typedef void (*PubAckCallback)(uint16_t packetId, void* context);
+
+    explicit MQTTClientTap(Client& inner);
+
+    void setPubAckCallback(PubAckCallback callback, void* context);
+
+    // Client interface
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(const char* host, uint16_t port) override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buf, size_t size) override;
+    int peek() override;
+    void flush() override;
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override;
+
+private:
+    enum ParseState : uint8_t {
+        PARSE_HEADER,
+        PARSE_LENGTH,
+        PARSE_BODY
+    };
+
+    Client& _inner;
+    PubAckCallback _pubAckCallback;
+    void* _pubAckContext;
+
+    ParseState _state;
+    uint8_t _packetType;
+    uint32_t _remaining;
+    uint32_t _multiplier;
+    uint8_t _bodyPos;
+    uint8_t _packetId[2];
+
+    void resetParser();
+    void observe(uint8_t value);
+};
+
+#endif
@@ -0,0 +1,203 @@
+#include "MQTTOutbox.h"
+#include <string.h>
+
+// MQTT control packet header for PUBLISH with QoS 1
+static const uint8_t MQTT_PUBLISH_QOS1 = 0x32;
+static const uint8_t MQTT_FLAG_DUP = 0x08;
+static const uint8_t MQTT_FLAG_RETAIN = 0x01;
+
+MQTTOutbox::MQTTOutbox()
+    : _nextPacketId(1), _retryTimeout(5000), _maxAttempts(5),
+      _writer(nullptr), _writerContext(nullptr),
+      _deliveryCallback(nullptr), _deliveryContext(nullptr) {
+    memset(&_stats, 0, sizeof(_stats));
+    for (size_t i = 0; i < MQTT_OUTBOX_WINDOW; i++) {
+        _slots[i].state = SLOT_FREE;
+    }
+}
+
+void MQTTOutbox::setWriter(WriteFunction writer, void* context) {
+    _writer = writer;
+    _writerContext = context;
+}
+
+void MQTTOutbox::setDeliveryCallback(DeliveryCallback callback, void* context) {
+    _deliveryCallback = callback;
+    _deliveryContext = context;
+}
+
+uint16_t MQTTOutbox::publish(const char* topic, const uint8_t* payload, size_t length, bool retain,
+                             bool connected, unsigned long now) {
+    if (topic == nullptr || length > MQTT_OUTBOX_MAX_PAYLOAD || strlen(topic) > TopicString::capacity()) {
+        _stats.invalid++;
+        return 0;
+    }
+
+    Slot* slot = nullptr;
+    for (size_t i = 0; i < MQTT_OUTBOX_WINDOW; i++) {
+        if (_slots[i].state == SLOT_FREE) {
+            slot = &_slots[i];
+            break;
+        }
+    }
+    if (slot == nullptr) {
+        _stats.rejected++;
+        return 0;
+    }
+
+    slot->topic.assign(topic);
+    memcpy(slot->payload, payload, length);
+    slot->length = (uint16_t)length;
+    slot->packetId = allocatePacketId();
+    slot->attempts = 0;
+    slot->retain = retain;
+    slot->firstSentAt = now;
+    slot->lastSentAt = now;
+    slot->state = SLOT_PENDING;
+    _stats.enqueued++;
+
+    if (connected) {
+        send(*slot, now);
+    }
+    return slot->packetId;
+}
+
+bool MQTTOutbox::onPubAck(uint16_t packetId, unsigned long now) {
+    for (size_t i = 0; i < MQTT_OUTBOX_WINDOW; i++) {
+        Slot& slot = _slots[i];
+        if (slot.state == SLOT_IN_FLIGHT && slot.packetId == packetId) {
+            _stats.lastAckLatency = now - slot.firstSentAt;
+            release(slot, true);
+            return true;
+        }
+    }
+    return false; // Duplicate or unknown PUBACK
+}
+
+void MQTTOutbox::poll(bool connected, unsigned long now) {
+    if (!connected) {
+        return;
+    }
+
+    for (size_t i = 0; i < MQTT_OUTBOX_WINDOW; i++) {
+        Slot& slot = _slots[i];
+        bool due = slot.state == SLOT_PENDING ||
+                   (slot.state == SLOT_IN_FLIGHT && now - slot.lastSentAt >= _retryTimeout);
+        if (!due) {
+            continue;
+        }
+
+        if (slot.attempts >= _maxAttempts) {
+            release(slot, false);
+            continue;
+        }
+        if (slot.attempts > 0) {
+            _stats.retransmitted++;
+        }
+        send(slot, now);
+    }
+}
+
+void MQTTOutbox::onReconnect() {
+    for (size_t i = 0; i < MQTT_OUTBOX_WINDOW; i++) {
+        if (_slots[i].state == SLOT_IN_FLIGHT) {
+            _slots[i].state = SLOT_PENDING;
+        }
+    }
+}
+
+size_t MQTTOutbox::inFlight() const {
+    size_t count = 0;
+    for (size_t i = 0; i < MQTT_OUTBOX_WINDOW; i++) {
+        if (_slots[i].state != SLOT_FREE) {
+            count++;
+        }
+    }
+    return count;
+}
+
+uint16_t MQTTOutbox::allocatePacketId() {
+    // Packet ID 0 is reserved; skip IDs still awaiting PUBACK
+    while (true) {
+        uint16_t candidate = _nextPacketId++;
+        if (_nextPacketId == 0) {
+            _nextPacketId = 1;
+        }
+        if (candidate == 0) {
+            continue;
+        }
+
+        bool inUse = false;
+        for (size_t i = 0; i < MQTT_OUTBOX_WINDOW; i++) {
+            if (_slots[i].state != SLOT_FREE && _slots[i].packetId == candidate) {
+                inUse = true;
+                break;
+            }
+        }
+        if (!inUse) {
+            return candidate;
+        }
+    }
+}
+
+bool MQTTOutbox::send(Slot& slot, unsigned long now) {
+    if (_writer == nullptr) {
+        return false;
+    }
+
+    // Fixed header (1) + remaining length (<= 2 bytes here) + topic length (2) + topic + packet ID (2) + payload
+    uint8_t packet[1 + 2 + 2 + TopicString::capacity() + 2 + MQTT_OUTBOX_MAX_PAYLOAD];
+    size_t topicLength = slot.topic.length();
+    size_t remaining = 2 + topicLength + 2 + slot.length;
+    size_t pos = 0;
+
+    uint8_t header = MQTT_PUBLISH_QOS1;
+    if (slot.attempts > 0) {
+        header |= MQTT_FLAG_DUP;
+    }
+    if (slot.retain) {
+        header |= MQTT_FLAG_RETAIN;
+    }
+    packet[pos++] = header;
+
+    do {
+        uint8_t encoded = remaining % 128;
+        remaining /= 128;
+        if (remaining > 0) {
+            encoded |= 0x80;
+        }
+        packet[pos++] = encoded;
+    } while (remaining > 0);
+
+    packet[pos++] = (uint8_t)(topicLength >> 8);
+    packet[pos++] = (uint8_t)(topicLength & 0xFF);
+    memcpy(packet + pos, slot.topic.c_str(), topicLength);
+    pos += topicLength;
+    packet[pos++] = (uint8_t)(slot.packetId >> 8);
+    packet[pos++] = (uint8_t)(slot.packetId & 0xFF);
+    memcpy(packet + pos, slot.payload, slot.length);
+    pos += slot.length;
+
+    if (slot.attempts == 0) {
+        slot.firstSentAt = now;
+    }
+    slot.attempts++;
+    slot.lastSentAt = now;
+    // Stay in flight even if the write failed; the retry timer resends it
+    slot.state = SLOT_IN_FLIGHT;
+    return _writer(packet, pos, _writerContext);
+}
+
+void MQTTOutbox::release(Slot& slot, bool delivered) {
+    uint16_t packetId = slot.packetId;
+    slot.state = SLOT_FREE;
+
+    if (delivered) {
+        _stats.delivered++;
+    } else {
+        _stats.dropped++;
+    }
+    if (_deliveryCallback) {
+        _deliveryCallback(packetId, delivered, _deliveryContext);
+    }
+}
@@ -0,0 +1,100 @@
+#ifndef MQTT_OUTBOX_H
+#define MQTT_OUTBOX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FixedString.h"
+
+// Number of QoS 1 messages that may be awaiting PUBACK at once
+#ifndef MQTT_OUTBOX_WINDOW
+#define MQTT_OUTBOX_WINDOW 8
+#endif
+
+#ifndef MQTT_OUTBOX_MAX_PAYLOAD
+#define MQTT_OUTBOX_MAX_PAYLOAD 128
+#endif
+
+// Outbound QoS 1 engine. Builds PUBLISH packets itself (PubSubClient only
+// publishes at QoS 0), keeps up to MQTT_OUTBOX_WINDOW of them in flight,
+// matches PUBACKs by packet ID and retransmits with the DUP flag on timeout
+// or reconnect. Keeping a window open means delivery confirmation does not
+// throttle throughput to one message per round trip.
+class MQTTOutbox {
+public:
+    typedef FixedString<64> TopicString;
+
+    // Writes a complete packet to the broker connection
+    typedef bool (*WriteFunction)(const uint8_t* data, size_t length, void* context);
+    // Reports the final outcome of a message (delivered, or dropped after maxAttempts)
+    typedef void (*DeliveryCallback)(uint16_t packetId, bool delivered, void* context);
+
+    struct Stats {
+        uint32_t enqueued;
+        uint32_t delivered;
+        uint32_t retransmitted;
+        uint32_t dropped;
+        uint32_t rejected;       // enqueue refused because the window was full
+        uint32_t invalid;        // enqueue refused: no topic, or topic or payload too long
+        uint32_t lastAckLatency; // ms from first send to PUBACK
+    };
+
+    MQTTOutbox();
+
+    void setWriter(WriteFunction writer, void* context);
+    void setDeliveryCallback(DeliveryCallback callback, void* context);
+    void setRetryTimeout(unsigned long timeoutMs) { _retryTimeout = timeoutMs; }
+    void setMaxAttempts(uint8_t attempts) { _maxAttempts = attempts; }
+
+    // Queue a message and send it immediately if connected.
+    // Returns the packet ID, or 0 if the window is full or the message is invalid.
+    uint16_t publish(const char* topic, const uint8_t* payload, size_t length, bool retain,
+                     bool connected, unsigned long now);
+
+    // Feed a PUBACK packet ID received from the broker
+    bool onPubAck(uint16_t packetId, unsigned long now);
+
+    // Retransmit timed-out messages; call regularly while connected
+    void poll(bool connected, unsigned long now);
+
+    // Mark every in-flight message for immediate retransmission with DUP set
+    void onReconnect();
+
+    size_t inFlight() const;
+    size_t window() const { return MQTT_OUTBOX_WINDOW; }
+    const Stats& stats() const { return _stats; }
+
+private:
+    enum SlotState : uint8_t {
+        SLOT_FREE,
+        SLOT_PENDING,   // queued, never sent (or must be resent after reconnect)
+        SLOT_IN_FLIGHT  // sent, awaiting PUBACK
+    };
+
+    struct Slot {
+        TopicString topic;
+        uint8_t payload[MQTT_OUTBOX_MAX_PAYLOAD];
+        uint16_t length;
+        uint16_t packetId;
+        unsigned long firstSentAt;
+        unsigned long lastSentAt;
+        uint8_t attempts;
+        bool retain;
+        SlotState state;
+    };
+
+    Slot _slots[MQTT_OUTBOX_WINDOW];
+    uint16_t _nextPacketId;
+    unsigned long _retryTimeout;
+    uint8_t _maxAttempts;
+    WriteFunction _writer;
+    void* _writerContext;
+    DeliveryCallback _deliveryCallback;
+    void* _deliveryContext;
+    Stats _stats;
+
+    uint16_t allocatePacketId();
+    bool send(Slot& slot, unsigned long now);
+    void release(Slot& slot, bool delivered);
+};
+
+#endif
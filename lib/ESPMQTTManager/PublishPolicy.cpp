@@ -0,0 +1,98 @@
+#include "PublishPolicy.h"
+
+PublishPolicy::PublishPolicy() {
+    configure(defaults(0.0f, 0));
+}
+
+PublishPolicy::PublishPolicy(const PublishPolicyConfig& config) {
+    configure(config);
+}
+
+void PublishPolicy::configure(const PublishPolicyConfig& config) {
+    _config = config;
+    reset();
+}
+
+void PublishPolicy::reset() {
+    _hasPublished = false;
+    _lastValue = 0.0f;
+    _lastPublish = 0;
+    _publishedZone = ZONE_NORMAL;
+}
+
+PublishPolicy::Decision PublishPolicy::evaluate(float value, float sample, unsigned long now) const {
+    if (isnan(value)) {
+        return SUPPRESS;
+    }
+    if (!_hasPublished) {
+        return PUBLISH_FIRST;
+    }
+
+    // Threshold crossings skip the rate limit so alerts are not delayed
+    if (!isnan(sample) && zoneFor(sample) != _publishedZone) {
+        return PUBLISH_ALERT;
+    }
+
+    unsigned long elapsed = now - _lastPublish;
+    if (elapsed < _config.minIntervalMs) {
+        return SUPPRESS;
+    }
+    if (fabsf(value - _lastValue) > _config.deadband) {
+        return PUBLISH_CHANGE;
+    }
+    if (_config.maxIntervalMs > 0 && elapsed >= _config.maxIntervalMs) {
+        return PUBLISH_HEARTBEAT;
+    }
+    return SUPPRESS;
+}
+
+void PublishPolicy::markPublished(float value, float sample, unsigned long now) {
+    if (!isnan(sample)) {
+        _publishedZone = zoneFor(sample);
+    }
+    _lastValue = value;
+    _lastPublish = now;
+    _hasPublished = true;
+}
+
+const char* PublishPolicy::decisionName(Decision decision) {
+    switch (decision) {
+        case PUBLISH_FIRST: return "first";
+        case PUBLISH_CHANGE: return "change";
+        case PUBLISH_HEARTBEAT: return "heartbeat";
+        case PUBLISH_ALERT: return "alert";
+        default: return "suppress";
+    }
+}
+
+PublishPolicyConfig PublishPolicy::defaults(float deadband, uint32_t maxIntervalMs) {
+    PublishPolicyConfig config;
+    config.deadband = deadband;
+    config.minIntervalMs = 0;
+    config.maxIntervalMs = maxIntervalMs;
+    config.lowThreshold = NAN;
+    config.highThreshold = NAN;
+    config.hysteresis = 0.0f;
+    return config;
+}
+
+// Hysteresis keeps the zone "sticky": leaving an alert zone requires moving
+// back past the threshold by the hysteresis margin.
+PublishPolicy::Zone PublishPolicy::zoneFor(float value) const {
+    float lowExit = _config.lowThreshold;
+    float highExit = _config.highThreshold;
+
+    if (_publishedZone == ZONE_LOW) {
+        lowExit += _config.hysteresis;
+    } else if (_publishedZone == ZONE_HIGH) {
+        highExit -= _config.hysteresis;
+    }
+
+    if (!isnan(_config.lowThreshold) && value < lowExit) {
+        return ZONE_LOW;
+    }
+    if (!isnan(_config.highThreshold) && value > highExit) {
+        return ZONE_HIGH;
+    }
+    return ZONE_NORMAL;
+}
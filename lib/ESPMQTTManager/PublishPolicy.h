@@ -0,0 +1,69 @@
+#ifndef PUBLISH_POLICY_H
+#define PUBLISH_POLICY_H
+
+#include <math.h>
+#include <stdint.h>
+
+// Per-metric publish settings. Plain data so it can be persisted as a blob.
+struct PublishPolicyConfig {
+    float deadband;          // Suppress changes of this size or smaller
+    uint32_t minIntervalMs;  // Rate limit between ordinary publishes
+    uint32_t maxIntervalMs;  // Heartbeat: publish at least this often (0 = never)
+    float lowThreshold;      // Publish immediately when crossing below (NAN = disabled)
+    float highThreshold;     // Publish immediately when crossing above (NAN = disabled)
+    float hysteresis;        // Margin required to leave an alert zone
+};
+
+// Decides whether a new sample of one metric is worth publishing.
+// Ordinary changes are subject to the deadband and the minimum interval;
+// threshold crossings bypass both so alerts go out on the next sample.
+class PublishPolicy {
+public:
+    enum Decision {
+        SUPPRESS,
+        PUBLISH_FIRST,     // Nothing published yet
+        PUBLISH_CHANGE,    // Moved by more than the deadband
+        PUBLISH_HEARTBEAT, // maxIntervalMs elapsed
+        PUBLISH_ALERT      // Crossed a threshold (in either direction)
+    };
+
+    PublishPolicy();
+    explicit PublishPolicy(const PublishPolicyConfig& config);
+
+    void configure(const PublishPolicyConfig& config);
+    const PublishPolicyConfig& config() const { return _config; }
+
+    // Evaluate a sample; does not change state until markPublished() is called
+    Decision evaluate(float value, unsigned long now) const { return evaluate(value, value, now); }
+    void markPublished(float value, unsigned long now) { markPublished(value, value, now); }
+
+    // As above, but the thresholds are checked against sample instead of the
+    // published value (e.g. the latest reading behind a window mean). A NAN
+    // sample leaves the alert zone unchanged.
+    Decision evaluate(float value, float sample, unsigned long now) const;
+    void markPublished(float value, float sample, unsigned long now);
+    void reset();
+
+    // True while the last published value is outside the thresholds
+    bool inAlert() const { return _publishedZone != ZONE_NORMAL; }
+
+    static const char* decisionName(Decision decision);
+    static PublishPolicyConfig defaults(float deadband, uint32_t maxIntervalMs);
+
+private:
+    enum Zone : int8_t {
+        ZONE_LOW = -1,
+        ZONE_NORMAL = 0,
+        ZONE_HIGH = 1
+    };
+
+    PublishPolicyConfig _config;
+    bool _hasPublished;
+    float _lastValue;
+    unsigned long _lastPublish;
+    Zone _publishedZone;
+
+    Zone zoneFor(float value) const;
+};
+
+#endif
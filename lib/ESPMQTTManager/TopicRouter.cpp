@@ -0,0 +1,275 @@
+#include "TopicRouter.h"
+#include <string.h>
+
+TopicRouter::TopicRouter() {
+    clear();
+}
+
+void TopicRouter::clear() {
+    // Node 0 is the root and has no label
+    _nodeCount = 1;
+    _freeNodes = -1;
+    _nodes[0].label[0] = '\0';
+    _nodes[0].labelLength = 0;
+    _nodes[0].parent = -1;
+    _nodes[0].firstChild = -1;
+    _nodes[0].nextSibling = -1;
+    _nodes[0].firstRoute = -1;
+
+    for (size_t i = 0; i < TOPIC_ROUTER_MAX_ROUTES; i++) {
+        _routes[i].used = false;
+        _routes[i].next = -1;
+        _routes[i].node = -1;
+    }
+}
+
+bool TopicRouter::add(const char* filter, Handler handler, void* context) {
+    if (handler == nullptr || !isValidFilter(filter)) {
+        return false;
+    }
+
+    int16_t slot = -1;
+    for (size_t i = 0; i < TOPIC_ROUTER_MAX_ROUTES; i++) {
+        if (!_routes[i].used) {
+            slot = (int16_t)i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return false;
+    }
+
+    int16_t node = findNode(filter, true);
+    if (node < 0) {
+        return false;
+    }
+
+    Route& route = _routes[slot];
+    route.filter.assign(filter);
+    route.handler = handler;
+    route.context = context;
+    route.node = node;
+    route.next = _nodes[node].firstRoute;
+    route.used = true;
+    _nodes[node].firstRoute = slot;
+    return true;
+}
+
+bool TopicRouter::remove(const char* filter, Handler handler, void* context) {
+    int16_t node = findNode(filter, false);
+    if (node < 0) {
+        return false;
+    }
+
+    // Unlink the route from its node, then free the levels nothing else uses
+    int16_t* link = &_nodes[node].firstRoute;
+    while (*link >= 0) {
+        Route& route = _routes[*link];
+        if (route.handler == handler && route.context == context) {
+            int16_t removed = *link;
+            *link = route.next;
+            _routes[removed].used = false;
+            _routes[removed].next = -1;
+            _routes[removed].node = -1;
+            prune(node);
+            return true;
+        }
+        link = &route.next;
+    }
+    return false;
+}
+
+size_t TopicRouter::dispatch(const char* topic, const uint8_t* payload, unsigned int length) const {
+    if (topic == nullptr) {
+        return 0;
+    }
+    return match(0, topic, true, topic, payload, length);
+}
+
+bool TopicRouter::isRouteUsed(size_t index) const {
+    return index < TOPIC_ROUTER_MAX_ROUTES && _routes[index].used;
+}
+
+const char* TopicRouter::routeFilter(size_t index) const {
+    return isRouteUsed(index) ? _routes[index].filter.c_str() : nullptr;
+}
+
+bool TopicRouter::isFirstRouteFor(size_t index) const {
+    if (!isRouteUsed(index)) {
+        return false;
+    }
+    for (size_t i = 0; i < index; i++) {
+        if (_routes[i].used && _routes[i].node == _routes[index].node) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TopicRouter::hasFilter(const char* filter) const {
+    for (size_t i = 0; i < TOPIC_ROUTER_MAX_ROUTES; i++) {
+        if (_routes[i].used && _routes[i].filter == filter) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TopicRouter::isValidFilter(const char* filter) {
+    if (filter == nullptr || filter[0] == '\0' || strlen(filter) > FilterString::capacity()) {
+        return false;
+    }
+
+    const char* level = filter;
+    while (true) {
+        const char* end = strchr(level, '/');
+        size_t length = end ? (size_t)(end - level) : strlen(level);
+        if (length > TOPIC_ROUTER_MAX_LEVEL_LENGTH) {
+            return false;
+        }
+
+        // Wildcards must occupy a whole level, and '#' must be the last level
+        for (size_t i = 0; i < length; i++) {
+            if ((level[i] == '+' || level[i] == '#') && length != 1) {
+                return false;
+            }
+        }
+        if (length == 1 && level[0] == '#' && end != nullptr) {
+            return false;
+        }
+
+        if (end == nullptr) {
+            return true;
+        }
+        level = end + 1;
+    }
+}
+
+int16_t TopicRouter::findChild(int16_t parent, const char* label, size_t length) const {
+    for (int16_t child = _nodes[parent].firstChild; child >= 0; child = _nodes[child].nextSibling) {
+        const Node& node = _nodes[child];
+        if (node.labelLength == length && memcmp(node.label, label, length) == 0) {
+            return child;
+        }
+    }
+    return -1;
+}
+
+int16_t TopicRouter::findOrAddChild(int16_t parent, const char* label, size_t length) {
+    int16_t child = findChild(parent, label, length);
+    if (child >= 0) {
+        return child;
+    }
+    if (_freeNodes >= 0) {
+        child = _freeNodes;
+        _freeNodes = _nodes[child].nextSibling;
+    } else if (_nodeCount < TOPIC_ROUTER_MAX_NODES) {
+        child = (int16_t)_nodeCount++;
+    } else {
+        return -1;
+    }
+
+    Node& node = _nodes[child];
+    memcpy(node.label, label, length);
+    node.label[length] = '\0';
+    node.labelLength = (uint8_t)length;
+    node.parent = parent;
+    node.firstChild = -1;
+    node.firstRoute = -1;
+    node.nextSibling = _nodes[parent].firstChild;
+    _nodes[parent].firstChild = child;
+    return child;
+}
+
+int16_t TopicRouter::findNode(const char* filter, bool create) {
+    if (filter == nullptr) {
+        return -1;
+    }
+
+    int16_t node = 0;
+    const char* level = filter;
+    while (node >= 0) {
+        const char* end = strchr(level, '/');
+        size_t length = end ? (size_t)(end - level) : strlen(level);
+        int16_t child = create ? findOrAddChild(node, level, length) : findChild(node, level, length);
+        if (child < 0) {
+            // Out of nodes part way down: give back the levels just added
+            if (create) {
+                prune(node);
+            }
+            return -1;
+        }
+        node = child;
+        if (end == nullptr) {
+            break;
+        }
+        level = end + 1;
+    }
+    return node;
+}
+
+// Returns node and its ancestors to the free list for as long as they have
+// no routes and no children left
+void TopicRouter::prune(int16_t node) {
+    while (node > 0 && _nodes[node].firstRoute < 0 && _nodes[node].firstChild < 0) {
+        int16_t parent = _nodes[node].parent;
+        int16_t* link = &_nodes[parent].firstChild;
+        while (*link != node) {
+            link = &_nodes[*link].nextSibling;
+        }
+        *link = _nodes[node].nextSibling;
+
+        _nodes[node].nextSibling = _freeNodes;
+        _freeNodes = node;
+        node = parent;
+    }
+}
+
+size_t TopicRouter::invokeRoutes(int16_t node, const char* topic, const uint8_t* payload, unsigned int length) const {
+    size_t count = 0;
+    for (int16_t index = _nodes[node].firstRoute; index >= 0; index = _routes[index].next) {
+        const Route& route = _routes[index];
+        route.handler(topic, payload, length, route.context);
+        count++;
+    }
+    return count;
+}
+
+// level points at the start of the current topic level, or is nullptr once
+// every level has been consumed (distinguishes "a" from the empty level in "a/").
+size_t TopicRouter::match(int16_t node, const char* level, bool firstLevel, const char* topic,
+                          const uint8_t* payload, unsigned int length) const {
+    if (level == nullptr) {
+        size_t count = invokeRoutes(node, topic, payload, length);
+        // "a/#" also matches the parent level "a"
+        int16_t hash = findChild(node, "#", 1);
+        if (hash >= 0) {
+            count += invokeRoutes(hash, topic, payload, length);
+        }
+        return count;
+    }
+
+    const char* end = strchr(level, '/');
+    size_t levelLength = end ? (size_t)(end - level) : strlen(level);
+    const char* next = end ? end + 1 : nullptr;
+
+    // Wildcards never match topics beginning with '$' (e.g. $SYS)
+    bool wildcardsAllowed = !(firstLevel && level[0] == '$');
+
+    size_t count = 0;
+    for (int16_t child = _nodes[node].firstChild; child >= 0; child = _nodes[child].nextSibling) {
+        const Node& candidate = _nodes[child];
+        if (candidate.labelLength == 1 && candidate.label[0] == '#') {
+            if (wildcardsAllowed) {
+                count += invokeRoutes(child, topic, payload, length);
+            }
+        } else if (candidate.labelLength == 1 && candidate.label[0] == '+') {
+            if (wildcardsAllowed) {
+                count += match(child, next, false, topic, payload, length);
+            }
+        } else if (candidate.labelLength == levelLength && memcmp(candidate.label, level, levelLength) == 0) {
+            count += match(child, next, false, topic, payload, length);
+        }
+    }
+    return count;
+}
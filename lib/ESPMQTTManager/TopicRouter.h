@@ -0,0 +1,85 @@
+#ifndef TOPIC_ROUTER_H
+#define TOPIC_ROUTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "FixedString.h"
+
+// Capacity limits (override with build flags if more handlers are needed)
+#ifndef TOPIC_ROUTER_MAX_ROUTES
+#define TOPIC_ROUTER_MAX_ROUTES 16
+#endif
+
+#ifndef TOPIC_ROUTER_MAX_NODES
+#define TOPIC_ROUTER_MAX_NODES 64
+#endif
+
+#ifndef TOPIC_ROUTER_MAX_LEVEL_LENGTH
+#define TOPIC_ROUTER_MAX_LEVEL_LENGTH 32
+#endif
+
+// Routes inbound MQTT messages to handlers registered against topic filters.
+// Filters are stored one topic level per trie node, so dispatch cost grows with
+// topic depth rather than handler count, and matching walks the raw topic
+// without allocating. Supports the MQTT '+' (single level) and '#' (multi level)
+// wildcards.
+class TopicRouter {
+public:
+    typedef void (*Handler)(const char* topic, const uint8_t* payload, unsigned int length, void* context);
+    typedef FixedString<64> FilterString;
+
+    TopicRouter();
+
+    // Registration (returns false if the filter is invalid or capacity is exhausted)
+    bool add(const char* filter, Handler handler, void* context = nullptr);
+    bool remove(const char* filter, Handler handler, void* context = nullptr);
+    void clear();
+
+    // Invoke every handler whose filter matches topic; returns the number invoked
+    size_t dispatch(const char* topic, const uint8_t* payload, unsigned int length) const;
+
+    // Iterate registered filters (used to resubscribe after reconnect).
+    // firstRouteFor() is true only for the first route using a given filter,
+    // so callers can subscribe each distinct filter once.
+    size_t capacity() const { return TOPIC_ROUTER_MAX_ROUTES; }
+    bool isRouteUsed(size_t index) const;
+    const char* routeFilter(size_t index) const;
+    bool isFirstRouteFor(size_t index) const;
+    bool hasFilter(const char* filter) const;
+
+    static bool isValidFilter(const char* filter);
+
+private:
+    struct Node {
+        char label[TOPIC_ROUTER_MAX_LEVEL_LENGTH + 1];
+        uint8_t labelLength;
+        int16_t parent;
+        int16_t firstChild;
+        int16_t nextSibling; // Next free node while on the free list
+        int16_t firstRoute;
+    };
+
+    struct Route {
+        FilterString filter;
+        Handler handler;
+        void* context;
+        int16_t node;
+        int16_t next;
+        bool used;
+    };
+
+    Node _nodes[TOPIC_ROUTER_MAX_NODES];
+    size_t _nodeCount;       // Nodes ever handed out; freed ones go to _freeNodes
+    int16_t _freeNodes;
+    Route _routes[TOPIC_ROUTER_MAX_ROUTES];
+
+    int16_t findChild(int16_t parent, const char* label, size_t length) const;
+    int16_t findOrAddChild(int16_t parent, const char* label, size_t length);
+    int16_t findNode(const char* filter, bool create);
+    void prune(int16_t node);
+    size_t invokeRoutes(int16_t node, const char* topic, const uint8_t* payload, unsigned int length) const;
+    size_t match(int16_t node, const char* level, bool firstLevel, const char* topic,
+                 const uint8_t* payload, unsigned int length) const;
+};
+
+#endif
@@ -26,11 +26,11 @@ void setup() {
     Serial.println("\nWiFi connected!");
     
     // Initialize MQTT manager
-    mqttManager.begin(client_id);
+    mqttManager.begin(client_id.c_str());
     
     // Discover Home Assistant server (optional - will use fallback if not found)
     String serverIP = mqttManager.discoverServer();
-    mqttManager.updateServerIP(serverIP);
+    mqttManager.updateServerIP(serverIP.c_str());
     
     Serial.println("Setup complete!");
 }
@@ -61,7 +61,7 @@ void loop() {
     // Re-discover server every 15 minutes
     if (mqttManager.shouldRediscoverServer(currentTime)) {
         String newServer = mqttManager.discoverServer();
-        mqttManager.updateServerIP(newServer);
+        mqttManager.updateServerIP(newServer.c_str());
         mqttManager.updateLastDiscoveryTime(currentTime);
     }
     
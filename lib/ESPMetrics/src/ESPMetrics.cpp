@@ -0,0 +1,163 @@
+#include "ESPMetrics.h"
+
+const uint32_t MetricHistogram::LATENCY_BUCKETS_US[] = {
+    100, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000, 10000000
+};
+
+const uint32_t MetricHistogram::SLOW_BUCKETS_US[] = {
+    100000, 500000, 1000000, 2500000, 5000000, 10000000, 30000000, 60000000, 120000000, 300000000
+};
+
+const char* ESPMetrics::CONTENT_TYPE = "text/plain; version=0.0.4";
+
+static void writeText(ChunkWriter write, void* context, const char* text) {
+    write(text, strlen(text), context);
+}
+
+Metric::Metric(const char* name, const char* help, const char* labels, Type type)
+    : _name(name), _help(help), _labels(labels), _type(type) {
+    // Families are exported in the order they were defined
+    enlist();
+}
+
+void Metric::writeSample(ChunkWriter write, void* context, const char* suffix, const char* extraLabel,
+                         const char* value) const {
+    char line[192];
+    bool hasLabels = _labels[0] != '\0';
+    bool hasExtra = extraLabel != nullptr;
+    int length = snprintf(line, sizeof(line), "%s%s%s%s%s%s%s %s\n", _name, suffix,
+                          hasLabels || hasExtra ? "{" : "", _labels, hasLabels && hasExtra ? "," : "",
+                          hasExtra ? extraLabel : "", hasLabels || hasExtra ? "}" : "", value);
+    if (length > 0) {
+        write(line, (size_t)length < sizeof(line) ? length : sizeof(line) - 1, context);
+    }
+}
+
+MetricCounter::MetricCounter(const char* name, const char* help, const char* labels)
+    : Metric(name, help, labels, METRIC_COUNTER), _value(0) {}
+
+void MetricCounter::writeSamples(ChunkWriter write, void* context) const {
+    char value[12];
+    snprintf(value, sizeof(value), "%lu", (unsigned long)this->value());
+    writeSample(write, context, "", nullptr, value);
+}
+
+MetricGauge::MetricGauge(const char* name, const char* help, const char* labels)
+    : Metric(name, help, labels, METRIC_GAUGE), _bits(0) {
+    set(0.0f);
+}
+
+void MetricGauge::set(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    _bits.store(bits, std::memory_order_relaxed);
+}
+
+float MetricGauge::value() const {
+    uint32_t bits = _bits.load(std::memory_order_relaxed);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void MetricGauge::writeSamples(ChunkWriter write, void* context) const {
+    float current = value();
+    char text[24];
+    if (isnan(current)) {
+        strcpy(text, "NaN");
+    } else {
+        snprintf(text, sizeof(text), "%.9g", current);
+    }
+    writeSample(write, context, "", nullptr, text);
+}
+
+MetricHistogram::MetricHistogram(const char* name, const char* help, const char* labels, const uint32_t* boundsUs,
+                                 size_t boundCount)
+    : Metric(name, help, labels, METRIC_HISTOGRAM),
+      _boundsUs(boundsUs),
+      _boundCount(boundCount < METRICS_MAX_BUCKETS ? boundCount : METRICS_MAX_BUCKETS),
+      _sumUs(0) {
+    for (size_t i = 0; i <= METRICS_MAX_BUCKETS; i++) {
+        _buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void MetricHistogram::observe(uint32_t durationUs) {
+    size_t bucket = 0;
+    while (bucket < _boundCount && durationUs > _boundsUs[bucket]) {
+        bucket++;
+    }
+    _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    _sumUs.fetch_add(durationUs, std::memory_order_relaxed);
+}
+
+uint32_t MetricHistogram::count() const {
+    uint32_t total = 0;
+    for (size_t i = 0; i <= _boundCount; i++) {
+        total += _buckets[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void MetricHistogram::writeSamples(ChunkWriter write, void* context) const {
+    // Buckets are read once, so the cumulative counts and _count agree even
+    // while other tasks keep observing
+    uint32_t counts[METRICS_MAX_BUCKETS + 1];
+    for (size_t i = 0; i <= _boundCount; i++) {
+        counts[i] = _buckets[i].load(std::memory_order_relaxed);
+    }
+
+    char label[32];
+    char value[24];
+    uint32_t cumulative = 0;
+    for (size_t i = 0; i <= _boundCount; i++) {
+        cumulative += counts[i];
+        if (i < _boundCount) {
+            snprintf(label, sizeof(label), "le=\"%g\"", _boundsUs[i] / 1e6);
+        } else {
+            strcpy(label, "le=\"+Inf\"");
+        }
+        snprintf(value, sizeof(value), "%lu", (unsigned long)cumulative);
+        writeSample(write, context, "_bucket", label, value);
+    }
+
+    snprintf(value, sizeof(value), "%.6f", _sumUs.load(std::memory_order_relaxed) / 1e6);
+    writeSample(write, context, "_sum", nullptr, value);
+    snprintf(value, sizeof(value), "%lu", (unsigned long)cumulative);
+    writeSample(write, context, "_count", nullptr, value);
+}
+
+void ESPMetrics::write(ChunkWriter write, void* context) {
+    static const char* TYPE_NAMES[] = {"counter", "gauge", "histogram"};
+
+    // Every series of a family must follow its HELP and TYPE lines, so each
+    // family is written when its first member comes up in the list
+    for (const Metric* metric = Metric::first(); metric != nullptr; metric = metric->next()) {
+        bool seen = false;
+        for (const Metric* earlier = Metric::first(); earlier != metric; earlier = earlier->next()) {
+            if (strcmp(earlier->name(), metric->name()) == 0) {
+                seen = true;
+                break;
+            }
+        }
+        if (seen) {
+            continue;
+        }
+
+        writeText(write, context, "# HELP ");
+        writeText(write, context, metric->name());
+        writeText(write, context, " ");
+        writeText(write, context, metric->help());
+        writeText(write, context, "\n# TYPE ");
+        writeText(write, context, metric->name());
+        writeText(write, context, " ");
+        writeText(write, context, TYPE_NAMES[metric->type()]);
+        writeText(write, context, "\n");
+
+        for (const Metric* member = metric; member != nullptr; member = member->next()) {
+            if (strcmp(member->name(), metric->name()) == 0) {
+                member->writeSamples(write, context);
+            }
+        }
+    }
+}
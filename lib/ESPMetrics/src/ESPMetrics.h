@@ -0,0 +1,139 @@
+#ifndef ESP_METRICS_H
+#define ESP_METRICS_H
+
+#include <Arduino.h>
+#include <Registered.h>
+#include <SequenceRing.h>
+#include <atomic>
+
+// Finite buckets per histogram (+Inf is added on top)
+#ifndef METRICS_MAX_BUCKETS
+#define METRICS_MAX_BUCKETS 16
+#endif
+
+// Base of every metric. Metrics register themselves in one process-wide list
+// when constructed and are never removed, so they are normally globals or
+// file-scope statics; a metric created at runtime (e.g. one per HTTP route)
+// must live until reboot. Several metrics may share a name if their labels
+// differ; they are exported as one family.
+//
+// Updates are atomic and lock-free (except the 64-bit histogram sum, which
+// the toolchain guards with a few-instruction critical section), so any task
+// may update a metric while another exports.
+class Metric : public Registered<Metric> {
+public:
+    enum Type {
+        METRIC_COUNTER,
+        METRIC_GAUGE,
+        METRIC_HISTOGRAM
+    };
+
+    const char* name() const { return _name; }
+    const char* help() const { return _help; }
+    const char* labels() const { return _labels; }
+    Type type() const { return _type; }
+
+protected:
+    // labels is the Prometheus label list without braces, e.g. route="/api",
+    // or "" for none. name, help and labels must stay valid.
+    Metric(const char* name, const char* help, const char* labels, Type type);
+
+    virtual void writeSamples(ChunkWriter write, void* context) const = 0;
+
+    // One "name_suffix{labels,extra} value" line
+    void writeSample(ChunkWriter write, void* context, const char* suffix, const char* extraLabel,
+                     const char* value) const;
+
+private:
+    const char* _name;
+    const char* _help;
+    const char* _labels;
+    Type _type;
+
+    friend class ESPMetrics;
+};
+
+// Monotonic count of events (wraps at 2^32, which Prometheus treats as a reset)
+class MetricCounter : public Metric {
+public:
+    MetricCounter(const char* name, const char* help, const char* labels = "");
+
+    void increment(uint32_t count = 1) { _value.fetch_add(count, std::memory_order_relaxed); }
+    uint32_t value() const { return _value.load(std::memory_order_relaxed); }
+
+protected:
+    void writeSamples(ChunkWriter write, void* context) const override;
+
+private:
+    std::atomic<uint32_t> _value;
+};
+
+// Value that goes up and down; usually set right before an export
+class MetricGauge : public Metric {
+public:
+    MetricGauge(const char* name, const char* help, const char* labels = "");
+
+    void set(float value);
+    float value() const;
+
+protected:
+    void writeSamples(ChunkWriter write, void* context) const override;
+
+private:
+    std::atomic<uint32_t> _bits; // float, so the store is a single atomic word
+};
+
+// Durations in fixed buckets. Observations are in microseconds and exported
+// in seconds, so p50/p99 come from histogram_quantile() on the server.
+class MetricHistogram : public Metric {
+public:
+    // Upper bounds (us) for handlers and publishes: 100 us to 10 s
+    static const uint32_t LATENCY_BUCKETS_US[];
+    static const size_t LATENCY_BUCKET_COUNT = 14;
+
+    // Upper bounds (us) for downloads and syncs: 100 ms to 5 min
+    static const uint32_t SLOW_BUCKETS_US[];
+    static const size_t SLOW_BUCKET_COUNT = 10;
+
+    // boundsUs must be ascending and stay valid; at most METRICS_MAX_BUCKETS are used
+    MetricHistogram(const char* name, const char* help, const char* labels = "",
+                    const uint32_t* boundsUs = LATENCY_BUCKETS_US, size_t boundCount = LATENCY_BUCKET_COUNT);
+
+    void observe(uint32_t durationUs);
+
+    uint32_t count() const;
+
+protected:
+    void writeSamples(ChunkWriter write, void* context) const override;
+
+private:
+    const uint32_t* _boundsUs;
+    size_t _boundCount;
+    std::atomic<uint32_t> _buckets[METRICS_MAX_BUCKETS + 1]; // Per bucket, not cumulative; last is +Inf
+    std::atomic<uint64_t> _sumUs;
+};
+
+// Observes the time from construction to destruction, so every return path
+// of a function is timed
+class MetricTimer {
+public:
+    explicit MetricTimer(MetricHistogram& histogram) : _histogram(histogram), _start(micros()) {}
+    ~MetricTimer() { _histogram.observe(micros() - _start); }
+
+    uint32_t elapsedUs() const { return micros() - _start; }
+
+private:
+    MetricHistogram& _histogram;
+    uint32_t _start;
+};
+
+// Export of every registered metric
+class ESPMetrics {
+public:
+    // Prometheus text exposition format (version 0.0.4), one family at a time
+    static void write(ChunkWriter write, void* context);
+
+    static const char* CONTENT_TYPE;
+};
+
+#endif
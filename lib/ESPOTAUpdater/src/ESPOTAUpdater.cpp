@@ -1,4 +1,17 @@
 #include "ESPOTAUpdater.h"
+#include "ReleaseVersion.h"
+#include <DeviceLog.h>
+#include <ESPMetrics.h>
+#include <SpanTracer.h>
+
+static LogModule logOta("ota");
+
+static MetricHistogram checkDuration("ota_check_duration_seconds", "Time to query GitHub for the latest release", "",
+                                     MetricHistogram::SLOW_BUCKETS_US, MetricHistogram::SLOW_BUCKET_COUNT);
+static MetricHistogram installDuration("ota_install_duration_seconds", "Time to download and flash a firmware image", "",
+                                       MetricHistogram::SLOW_BUCKETS_US, MetricHistogram::SLOW_BUCKET_COUNT);
+static MetricCounter installOk("ota_install_total", "Firmware installs by result", "result=\"ok\"");
+static MetricCounter installFailed("ota_install_total", "Firmware installs by result", "result=\"error\"");
 
 ESPOTAUpdater::ESPOTAUpdater(const char* githubRepo, int currentFirmwareVersion) 
     : _githubRepo(githubRepo), 
@@ -59,7 +72,9 @@ void ESPOTAUpdater::setUpdateCompleteCallback(UpdateCompleteCallback callback) {
 }
 
 void ESPOTAUpdater::checkForUpdates() {
-    Serial.println("Checking for updates from GitHub releases...");
+    MetricTimer timer(checkDuration);
+    TRACE_SCOPE("ota.check");
+    DLOG_I(logOta, "Checking for updates from GitHub releases...");
     HTTPClient http;
     
     // Use GitHub API to get latest release
@@ -67,10 +82,14 @@ void ESPOTAUpdater::checkForUpdates() {
     http.begin(url);
     http.addHeader("User-Agent", "ESP32-OTA-Updater");
     
-    int httpCode = http.GET();
+    int httpCode;
+    {
+        TRACE_SCOPE("ota.check.get"); // DNS, TLS handshake, request and headers
+        httpCode = http.GET();
+    }
 
     if (httpCode != HTTP_CODE_OK) {
-        Serial.printf("Failed to get GitHub release info, error: %s\n", http.errorToString(httpCode).c_str());
+        DLOG_W(logOta, "Failed to get GitHub release info, error: %s", http.errorToString(httpCode).c_str());
         http.end();
         return;
     }
@@ -83,18 +102,17 @@ void ESPOTAUpdater::checkForUpdates() {
     DeserializationError error = deserializeJson(doc, payload);
 
     if (error) {
-        Serial.print(F("deserializeJson() failed: "));
-        Serial.println(error.c_str());
+        DLOG_W(logOta, "deserializeJson() failed: %s", error.c_str());
         return;
     }
 
     // Extract version from tag_name
     String tagName = doc["tag_name"].as<String>();
-    Serial.println("Latest release tag: " + tagName);
+    DLOG_I(logOta, "Latest release tag: %s", tagName.c_str());
     
     int newVersion = parseVersionFromTag(tagName);
     if (newVersion == 0) {
-        Serial.println("Could not parse version from tag");
+        DLOG_W(logOta, "Could not parse version from tag");
         return;
     }
 
@@ -107,15 +125,15 @@ void ESPOTAUpdater::checkForUpdates() {
     }
     
     if (binaryUrl == "") {
-        Serial.println("No firmware binary found in release assets");
+        DLOG_W(logOta, "No firmware binary found in release assets");
         return;
     }
     
-    Serial.printf("Current version: %d, Latest version: %d\n", _currentFirmwareVersion, newVersion);
+    DLOG_I(logOta, "Current version: %d, Latest version: %d", _currentFirmwareVersion, newVersion);
 
     if (newVersion > _currentFirmwareVersion) {
-        Serial.println("*** NEW FIRMWARE AVAILABLE ***");
-        Serial.println("Download URL: " + binaryUrl);
+        DLOG_I(logOta, "*** NEW FIRMWARE AVAILABLE ***");
+        DLOG_I(logOta, "Download URL: %s", binaryUrl.c_str());
         
         // Call callback if set
         if (_updateAvailableCallback) {
@@ -124,23 +142,24 @@ void ESPOTAUpdater::checkForUpdates() {
         
         // Auto-update if enabled
         if (_autoUpdateEnabled) {
-            Serial.println("Starting OTA update...");
+            DLOG_I(logOta, "Starting OTA update...");
             performUpdate(binaryUrl.c_str());
         } else {
-            Serial.println("Auto-update disabled. Manual update required.");
+            DLOG_I(logOta, "Auto-update disabled. Manual update required.");
         }
     } else if (newVersion == _currentFirmwareVersion) {
-        Serial.println("Current firmware is up to date.");
+        DLOG_I(logOta, "Current firmware is up to date.");
     } else {
-        Serial.println("Current firmware is newer than latest release.");
+        DLOG_I(logOta, "Current firmware is newer than latest release.");
     }
 }
 
 void ESPOTAUpdater::performUpdate(const char* url) {
-    Serial.println("Starting OTA update process...");
-    Serial.printf("Downloading from: %s\n", url);
+    DLOG_I(logOta, "Starting OTA update process...");
+    DLOG_I(logOta, "Downloading from: %s", url);
     
     bool success = downloadAndInstallFirmware(String(url));
+    (success ? installOk : installFailed).increment();
     
     if (_updateCompleteCallback) {
         String message = success ? "Update completed successfully" : "Update failed";
@@ -148,32 +167,18 @@ void ESPOTAUpdater::performUpdate(const char* url) {
     }
     
     if (success) {
-        Serial.println("Update successful! Rebooting...");
+        DLOG_I(logOta, "Update successful! Rebooting...");
         delay(1000);
+        DeviceLog::flush();
         ESP.restart();
     }
 }
 
 int ESPOTAUpdater::parseVersionFromTag(const String& tagName) {
-    int newVersion = 0;
-    if (tagName.startsWith("v")) {
-        String versionStr = tagName.substring(1); // Remove 'v'
-        
-        // Parse major.minor format with proper multi-digit support
-        int dotIndex = versionStr.indexOf('.');
-        if (dotIndex > 0) {
-            int major = versionStr.substring(0, dotIndex).toInt();
-            int minor = versionStr.substring(dotIndex + 1).toInt();
-            // Use a larger multiplier to handle multi-digit minor versions
-            // Format: MMMMNN where MMMM = major, NN = minor (up to 99)
-            newVersion = major * 100 + minor;
-            Serial.printf("Parsed version: %d.%d -> %d\n", major, minor, newVersion);
-        } else {
-            // Fallback for old single number format
-            float versionFloat = versionStr.toFloat();
-            newVersion = (int)(versionFloat * 100); // Updated multiplier
-            Serial.printf("Legacy version format: %f -> %d\n", versionFloat, newVersion);
-        }
+    int newVersion = ReleaseVersion::parse(tagName.c_str());
+    if (newVersion != 0) {
+        DLOG_D(logOta, "Parsed version %s -> %d%s", tagName.c_str(), newVersion,
+                       ReleaseVersion::isLegacy(tagName.c_str()) ? " (legacy format)" : "");
     }
     return newVersion;
 }
@@ -194,7 +199,7 @@ String ESPOTAUpdater::findBoardSpecificFirmware(JsonArray assets) {
         for (JsonObject asset : assets) {
             String assetName = asset["name"].as<String>();
             if (assetName == boardSpecificFile) {
-                Serial.println("Found board-specific firmware: " + assetName);
+                DLOG_D(logOta, "Found board-specific firmware: %s", assetName.c_str());
                 return asset["browser_download_url"].as<String>();
             }
         }
@@ -207,7 +212,7 @@ String ESPOTAUpdater::findGenericFirmware(JsonArray assets) {
     for (JsonObject asset : assets) {
         String assetName = asset["name"].as<String>();
         if (assetName == "firmware.bin") {
-            Serial.println("Found generic firmware: " + assetName);
+            DLOG_D(logOta, "Found generic firmware: %s", assetName.c_str());
             return asset["browser_download_url"].as<String>();
         }
     }
@@ -215,24 +220,30 @@ String ESPOTAUpdater::findGenericFirmware(JsonArray assets) {
 }
 
 bool ESPOTAUpdater::downloadAndInstallFirmware(const String& url) {
+    MetricTimer timer(installDuration);
+    TRACE_SCOPE("ota.install");
     HTTPClient http;
     http.setTimeout(30000); // 30 second timeout for large files
     http.setFollowRedirects(HTTPC_STRICT_FOLLOW_REDIRECTS);
     http.begin(url);
     http.addHeader("User-Agent", "ESP32-OTA-Updater");
     
-    Serial.println("Sending GET request...");
-    int httpCode = http.GET();
+    DLOG_D(logOta, "Sending GET request...");
+    int httpCode;
+    {
+        TRACE_SCOPE("ota.install.get");
+        httpCode = http.GET();
+    }
     
-    Serial.printf("HTTP response code: %d\n", httpCode);
+    DLOG_D(logOta, "HTTP response code: %d", httpCode);
 
     if (httpCode != HTTP_CODE_OK) {
-        Serial.printf("Failed to download binary, HTTP code: %d\n", httpCode);
-        Serial.printf("Error description: %s\n", http.errorToString(httpCode).c_str());
+        DLOG_E(logOta, "Failed to download binary, HTTP code: %d", httpCode);
+        DLOG_W(logOta, "Error description: %s", http.errorToString(httpCode).c_str());
         
         String response = http.getString();
         if (response.length() > 0) {
-            Serial.printf("Response body: %s\n", response.c_str());
+            DLOG_W(logOta, "Response body: %s", response.c_str());
         }
         
         http.end();
@@ -240,25 +251,25 @@ bool ESPOTAUpdater::downloadAndInstallFirmware(const String& url) {
     }
     
     int contentLength = http.getSize();
-    Serial.printf("Content length: %d bytes\n", contentLength);
+    DLOG_D(logOta, "Content length: %d bytes", contentLength);
     
     if (contentLength <= 0) {
-        Serial.println("Content-Length header invalid or missing.");
+        DLOG_W(logOta, "Content-Length header invalid or missing.");
         http.end();
         return false;
     }
 
-    Serial.printf("Available heap before update: %d bytes\n", ESP.getFreeHeap());
+    DLOG_D(logOta, "Available heap before update: %d bytes", ESP.getFreeHeap());
     
     bool canBegin = Update.begin(contentLength);
     if (!canBegin) {
-        Serial.printf("Not enough space to begin OTA. Required: %d bytes\n", contentLength);
-        Serial.printf("Available space: %d bytes\n", Update.size());
+        DLOG_E(logOta, "Not enough space to begin OTA. Required: %d bytes", contentLength);
+        DLOG_I(logOta, "Available space: %d bytes", Update.size());
         http.end();
         return false;
     }
 
-    Serial.println("Starting firmware write...");
+    DLOG_D(logOta, "Starting firmware write...");
     WiFiClient& stream = http.getStream();
     
     size_t written = 0;
@@ -273,7 +284,7 @@ bool ESPOTAUpdater::downloadAndInstallFirmware(const String& url) {
         
         written = Update.write(buffer, bytesRead);
         if (written != bytesRead) {
-            Serial.printf("Write error: expected %d, got %d\n", bytesRead, written);
+            DLOG_E(logOta, "Write error: expected %d, got %d", bytesRead, written);
             break;
         }
         
@@ -286,24 +297,24 @@ bool ESPOTAUpdater::downloadAndInstallFirmware(const String& url) {
         
         // Print progress every 10KB
         if (totalWritten % 10240 == 0 || totalWritten == contentLength) {
-            Serial.printf("Progress: %d/%d bytes (%.1f%%)\n", 
-                         totalWritten, contentLength, 
-                         (float)totalWritten / contentLength * 100);
+            DLOG_D(logOta, "Progress: %d/%d bytes (%.1f%%)",
+                   totalWritten, contentLength,
+                   (float)totalWritten / contentLength * 100);
         }
     }
 
     http.end();
 
-    Serial.printf("Bytes written: %d/%d\n", totalWritten, contentLength);
+    DLOG_D(logOta, "Bytes written: %d/%d", totalWritten, contentLength);
 
     if (totalWritten != contentLength) {
-        Serial.printf("Written only %d/%d bytes. Update failed.\n", totalWritten, contentLength);
-        Serial.printf("Update error: %s\n", Update.errorString());
+        DLOG_E(logOta, "Written only %d/%d bytes. Update failed.", totalWritten, contentLength);
+        DLOG_E(logOta, "Update error: %s", Update.errorString());
         return false;
     }
     
     if (!Update.end()) {
-        Serial.printf("Error occurred from Update.end(): %s\n", Update.errorString());
+        DLOG_E(logOta, "Error occurred from Update.end(): %s", Update.errorString());
         return false;
     }
 
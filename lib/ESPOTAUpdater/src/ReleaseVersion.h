@@ -0,0 +1,33 @@
+#ifndef RELEASE_VERSION_H
+#define RELEASE_VERSION_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// Release tags to firmware version numbers, without String temporaries and
+// without Arduino, so it builds on a host as well.
+//
+// "vMAJOR.MINOR" becomes MAJOR * 100 + MINOR (v9.14 -> 914); a tag without a
+// dot is the old "v<float>" format (v9 -> 900). Anything not starting with
+// 'v' is 0.
+class ReleaseVersion {
+public:
+    static int parse(const char* tag) {
+        if (tag == nullptr || tag[0] != 'v') {
+            return 0;
+        }
+        const char* version = tag + 1;
+        const char* dot = strchr(version, '.');
+        if (dot != nullptr && dot > version) {
+            return atoi(version) * 100 + atoi(dot + 1);
+        }
+        return (int)(atof(version) * 100);
+    }
+
+    static bool isLegacy(const char* tag) {
+        const char* dot = tag != nullptr && tag[0] == 'v' ? strchr(tag + 1, '.') : nullptr;
+        return dot == nullptr || dot == tag + 1;
+    }
+};
+
+#endif
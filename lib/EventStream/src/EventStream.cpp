@@ -0,0 +1,130 @@
+#include "EventStream.h"
+#include <DeviceLog.h>
+#include <lwip/sockets.h>
+
+static LogModule logEvents("events");
+
+// Largest formatted event (event name, data and framing)
+static const size_t EVENT_BUFFER_SIZE = 768;
+
+EventStream::EventStream() : _lastActivity(0), _eventsSent(0), _droppedClients(0) {
+    for (size_t i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+        _subscribers[i].active = false;
+    }
+}
+
+int EventStream::subscribe(WiFiClient client, uint32_t retryMs) {
+    int slot = -1;
+    for (size_t i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+        if (_subscribers[i].active && !_subscribers[i].client.connected()) {
+            drop(_subscribers[i]);
+        }
+        if (!_subscribers[i].active && slot < 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        return -1;
+    }
+
+    // Headers go out with a normal (blocking) write: the socket was just accepted
+    client.setNoDelay(true);
+    client.printf("HTTP/1.1 200 OK\r\n"
+                  "Content-Type: text/event-stream\r\n"
+                  "Cache-Control: no-cache\r\n"
+                  "Connection: keep-alive\r\n"
+                  "Access-Control-Allow-Origin: *\r\n"
+                  "\r\n"
+                  "retry: %lu\n\n",
+                  (unsigned long)retryMs);
+
+    _subscribers[slot].client = client;
+    _subscribers[slot].active = true;
+    return slot;
+}
+
+size_t EventStream::format(char* buffer, size_t size, const char* event, const char* data) {
+    int length = snprintf(buffer, size, "event: %s\ndata: %s\n\n", event, data);
+    return length > 0 && (size_t)length < size ? (size_t)length : 0;
+}
+
+size_t EventStream::broadcast(const char* event, const char* data) {
+    if (!hasSubscribers()) {
+        return 0;
+    }
+
+    char buffer[EVENT_BUFFER_SIZE];
+    size_t length = format(buffer, sizeof(buffer), event, data);
+    if (length == 0) {
+        DLOG_W(logEvents, "%s event too large, not sent", event);
+        return 0;
+    }
+
+    size_t delivered = 0;
+    for (size_t i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+        if (_subscribers[i].active && write(_subscribers[i], buffer, length)) {
+            delivered++;
+        }
+    }
+    _lastActivity = millis();
+    return delivered;
+}
+
+bool EventStream::send(int slot, const char* event, const char* data) {
+    if (slot < 0 || slot >= EVENT_STREAM_MAX_SUBSCRIBERS || !_subscribers[slot].active) {
+        return false;
+    }
+
+    char buffer[EVENT_BUFFER_SIZE];
+    size_t length = format(buffer, sizeof(buffer), event, data);
+    return length > 0 && write(_subscribers[slot], buffer, length);
+}
+
+void EventStream::poll(uint32_t now) {
+    if (!hasSubscribers() || now - _lastActivity < EVENT_STREAM_KEEPALIVE_MS) {
+        return;
+    }
+
+    static const char keepAlive[] = ": keep-alive\n\n";
+    for (size_t i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+        if (_subscribers[i].active) {
+            write(_subscribers[i], keepAlive, sizeof(keepAlive) - 1);
+        }
+    }
+    _lastActivity = now;
+}
+
+size_t EventStream::subscriberCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < EVENT_STREAM_MAX_SUBSCRIBERS; i++) {
+        if (_subscribers[i].active) {
+            count++;
+        }
+    }
+    return count;
+}
+
+// All or nothing: a partial event would corrupt the stream, so a socket
+// without room for the whole event (slow reader) or with an error is dropped
+bool EventStream::write(Subscriber& subscriber, const char* data, size_t length) {
+    int fd = subscriber.client.fd();
+    if (fd < 0) {
+        drop(subscriber);
+        return false;
+    }
+
+    int sent = ::send(fd, data, length, MSG_DONTWAIT);
+    if (sent != (int)length) {
+        drop(subscriber);
+        return false;
+    }
+    _eventsSent++;
+    return true;
+}
+
+void EventStream::drop(Subscriber& subscriber) {
+    subscriber.client.stop();
+    subscriber.client = WiFiClient();
+    subscriber.active = false;
+    _droppedClients++;
+}
@@ -0,0 +1,63 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+
+#ifndef EVENT_STREAM_MAX_SUBSCRIBERS
+#define EVENT_STREAM_MAX_SUBSCRIBERS 4
+#endif
+
+// Comment line sent to idle subscribers so proxies and browsers keep the stream open
+#ifndef EVENT_STREAM_KEEPALIVE_MS
+#define EVENT_STREAM_KEEPALIVE_MS 15000
+#endif
+
+// Server-Sent Events on top of the synchronous WebServer. A request handler
+// hands its client to subscribe(), which answers with the event-stream headers
+// and keeps a copy of the connection after the handler returns.
+//
+// Events are formatted once and written to every subscriber with a
+// non-blocking send. A subscriber whose socket cannot take a whole event is
+// dropped instead of stalling the loop; the browser's EventSource reconnects
+// and receives a fresh snapshot, so no subscriber ever sees a gap in deltas.
+class EventStream {
+public:
+    EventStream();
+
+    // Returns the subscriber slot, or -1 if all slots are taken (the caller
+    // should answer 503)
+    int subscribe(WiFiClient client, uint32_t retryMs = 2000);
+
+    // Send to every subscriber; returns how many received the event
+    size_t broadcast(const char* event, const char* data);
+
+    // Send to one subscriber (e.g. the initial snapshot after subscribe())
+    bool send(int slot, const char* event, const char* data);
+
+    // Keep-alive and disconnect detection; call regularly
+    void poll(uint32_t now);
+
+    size_t subscriberCount() const;
+    bool hasSubscribers() const { return subscriberCount() > 0; }
+
+    uint32_t getEventsSent() const { return _eventsSent; }
+    uint32_t getDroppedClients() const { return _droppedClients; }
+
+private:
+    struct Subscriber {
+        WiFiClient client;
+        bool active;
+    };
+
+    Subscriber _subscribers[EVENT_STREAM_MAX_SUBSCRIBERS];
+    uint32_t _lastActivity;
+    uint32_t _eventsSent;
+    uint32_t _droppedClients;
+
+    bool write(Subscriber& subscriber, const char* data, size_t length);
+    void drop(Subscriber& subscriber);
+    static size_t format(char* buffer, size_t size, const char* event, const char* data);
+};
+
+#endif
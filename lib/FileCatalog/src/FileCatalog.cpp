@@ -0,0 +1,107 @@
+#include "FileCatalog.h"
+#include <DeviceLog.h>
+#include <esp_rom_crc.h>
+
+static LogModule logCatalog("catalog");
+
+// Read buffer for hashing, on the stack
+static const size_t HASH_BUFFER_SIZE = 512;
+
+FileCatalog::FileCatalog(fs::FS& fs) : _fs(fs), _nextHashSlot(0), _hashHits(0), _hashMisses(0) {
+    memset(_hashes, 0, sizeof(_hashes));
+}
+
+uint32_t FileCatalog::list(const char* root, uint32_t cursor, size_t limit, EntryCallback callback, void* context) {
+    File stack[FILE_CATALOG_MAX_DEPTH];
+    size_t depth = 0;
+
+    stack[0] = _fs.open(root);
+    if (!stack[0] || !stack[0].isDirectory()) {
+        return 0;
+    }
+    depth = 1;
+
+    uint32_t position = 0;
+    size_t delivered = 0;
+    while (depth > 0) {
+        File file = stack[depth - 1].openNextFile();
+        if (!file) {
+            stack[--depth].close();
+            continue;
+        }
+
+        if (file.isDirectory()) {
+            if (depth < FILE_CATALOG_MAX_DEPTH) {
+                stack[depth++] = file;
+            } else {
+                DLOG_W(logCatalog, "%s is too deep, skipped", file.path());
+            }
+            continue;
+        }
+
+        if (position++ < cursor) {
+            continue;
+        }
+        if (delivered == limit) {
+            // One file past the page: there is a next page starting here
+            return position - 1;
+        }
+
+        Entry entry = {file.path(), file.size(), file.getLastWrite()};
+        delivered++;
+        if (!callback(entry, context)) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+bool FileCatalog::hash(const Entry& entry, uint32_t& crc) {
+    uint32_t key = pathHash(entry.path);
+    for (size_t i = 0; i < FILE_CATALOG_HASH_CACHE; i++) {
+        const HashSlot& slot = _hashes[i];
+        if (slot.pathHash == key && slot.size == entry.size && slot.modified == entry.modified) {
+            crc = slot.crc;
+            _hashHits++;
+            return true;
+        }
+    }
+
+    File file = _fs.open(entry.path, "r");
+    if (!file) {
+        return false;
+    }
+
+    uint8_t buffer[HASH_BUFFER_SIZE];
+    uint32_t value = 0;
+    size_t count;
+    while ((count = file.read(buffer, sizeof(buffer))) > 0) {
+        value = esp_rom_crc32_le(value, buffer, count);
+    }
+    file.close();
+    _hashMisses++;
+
+    // Replace an older result for the same path, otherwise the oldest slot
+    size_t index = _nextHashSlot;
+    for (size_t i = 0; i < FILE_CATALOG_HASH_CACHE; i++) {
+        if (_hashes[i].pathHash == key) {
+            index = i;
+            break;
+        }
+    }
+    if (index == _nextHashSlot) {
+        _nextHashSlot = (_nextHashSlot + 1) % FILE_CATALOG_HASH_CACHE;
+    }
+    _hashes[index] = {key, entry.size, entry.modified, value};
+
+    crc = value;
+    return true;
+}
+
+uint32_t FileCatalog::pathHash(const char* path) {
+    uint32_t hash = 2166136261u;
+    while (*path) {
+        hash = (hash ^ (uint8_t)*path++) * 16777619u;
+    }
+    return hash != 0 ? hash : 1;
+}
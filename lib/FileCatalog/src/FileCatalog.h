@@ -0,0 +1,70 @@
+#ifndef FILE_CATALOG_H
+#define FILE_CATALOG_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Deepest directory level walked; each level keeps one directory handle open
+#ifndef FILE_CATALOG_MAX_DEPTH
+#define FILE_CATALOG_MAX_DEPTH 6
+#endif
+
+// CRC32 results remembered between listings
+#ifndef FILE_CATALOG_HASH_CACHE
+#define FILE_CATALOG_HASH_CACHE 32
+#endif
+
+// Recursive, paginated file listing on any fs::FS (LittleFS on the device).
+//
+// list() walks the tree depth-first and hands each file to a callback as it
+// is found, so memory use depends on the directory depth, not on the number
+// of files. A page is addressed by a cursor, the walk position of its first
+// file; resuming re-walks the skipped entries without reporting them.
+// Files added or removed between pages can shift the positions, so a client
+// may see an entry twice or miss one, but never a torn page.
+//
+// CRC32 hashes are computed on request and cached by path, size and
+// modification time, so repeated listings only read files that changed.
+//
+// Not thread-safe: use from one task (the Arduino loop on this device).
+class FileCatalog {
+public:
+    struct Entry {
+        const char* path;
+        size_t size;
+        time_t modified; // 0 if the filesystem does not record it
+    };
+
+    // Return false to stop the listing
+    typedef bool (*EntryCallback)(const Entry& entry, void* context);
+
+    explicit FileCatalog(fs::FS& fs);
+
+    // Deliver up to limit files below root, starting at cursor. Returns the
+    // cursor of the next page, or 0 once the walk is complete.
+    uint32_t list(const char* root, uint32_t cursor, size_t limit, EntryCallback callback, void* context);
+
+    // CRC32 of a file's contents; size and modified come from its Entry
+    bool hash(const Entry& entry, uint32_t& crc);
+
+    uint32_t getHashHits() const { return _hashHits; }
+    uint32_t getHashMisses() const { return _hashMisses; }
+
+private:
+    struct HashSlot {
+        uint32_t pathHash; // FNV-1a of the path; 0 = empty slot
+        size_t size;
+        time_t modified;
+        uint32_t crc;
+    };
+
+    fs::FS& _fs;
+    HashSlot _hashes[FILE_CATALOG_HASH_CACHE];
+    size_t _nextHashSlot;
+    uint32_t _hashHits;
+    uint32_t _hashMisses;
+
+    static uint32_t pathHash(const char* path);
+};
+
+#endif
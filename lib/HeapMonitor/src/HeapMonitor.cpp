@@ -0,0 +1,150 @@
+#include "HeapMonitor.h"
+#include <DeviceLog.h>
+#include <esp_heap_caps.h>
+
+static LogModule logHeap("heap");
+
+thread_local HeapScope* HeapScope::_current = nullptr;
+
+HeapMonitor::HeapMonitor()
+    : _tagCount(0),
+      _lock(portMUX_INITIALIZER_UNLOCKED),
+      _samples(nullptr),
+      _head(0),
+      _count(0),
+      _intervalMs(60000),
+      _lastSample(0) {
+    memset(_tagNames, 0, sizeof(_tagNames));
+    memset(_tags, 0, sizeof(_tags));
+}
+
+int HeapMonitor::addTag(const char* name) {
+    if (_tagCount >= HEAP_MONITOR_MAX_TAGS) {
+        return -1;
+    }
+    _tagNames[_tagCount] = name;
+    return _tagCount++;
+}
+
+bool HeapMonitor::begin(uint32_t sampleIntervalMs) {
+    _intervalMs = sampleIntervalMs;
+    size_t size = sizeof(Sample) * HEAP_MONITOR_SAMPLES;
+    // Kept out of the internal heap it measures where possible
+    _samples = static_cast<Sample*>(psramFound() ? ps_malloc(size) : malloc(size));
+    if (_samples == nullptr) {
+        DLOG_E(logHeap, "No memory for samples");
+        return false;
+    }
+    takeSample(millis());
+    return true;
+}
+
+void HeapMonitor::loop(uint32_t now) {
+    if (_samples != nullptr && now - _lastSample >= _intervalMs) {
+        takeSample(now);
+    }
+}
+
+HeapMonitor::TagStats HeapMonitor::tagStats(uint8_t tag) {
+    portENTER_CRITICAL(&_lock);
+    TagStats stats = _tags[tag];
+    portEXIT_CRITICAL(&_lock);
+    return stats;
+}
+
+size_t HeapMonitor::sampleCount() {
+    portENTER_CRITICAL(&_lock);
+    size_t count = _count;
+    portEXIT_CRITICAL(&_lock);
+    return count;
+}
+
+bool HeapMonitor::getSample(size_t index, Sample& sample) {
+    portENTER_CRITICAL(&_lock);
+    bool valid = index < _count;
+    if (valid) {
+        sample = _samples[(_head + HEAP_MONITOR_SAMPLES - _count + index) % HEAP_MONITOR_SAMPLES];
+    }
+    portEXIT_CRITICAL(&_lock);
+    return valid;
+}
+
+float HeapMonitor::fragmentation(uint32_t freeBytes, uint32_t largestBlock) {
+    if (freeBytes == 0) {
+        return 0.0f;
+    }
+    return 1.0f - (float)largestBlock / (float)freeBytes;
+}
+
+uint32_t HeapMonitor::freeBytes() {
+    return heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+}
+
+uint32_t HeapMonitor::largestFreeBlock() {
+    return heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+}
+
+void HeapMonitor::takeSample(uint32_t now) {
+    Sample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.uptimeS = now / 1000;
+    sample.freeBytes = freeBytes();
+    sample.largestBlock = largestFreeBlock();
+    sample.minFreeBytes = heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+
+    portENTER_CRITICAL(&_lock);
+    for (uint8_t i = 0; i < _tagCount; i++) {
+        sample.retained[i] = _tags[i].retained;
+    }
+    _samples[_head] = sample;
+    _head = (_head + 1) % HEAP_MONITOR_SAMPLES;
+    if (_count < HEAP_MONITOR_SAMPLES) {
+        _count++;
+    }
+    portEXIT_CRITICAL(&_lock);
+    _lastSample = now;
+}
+
+void HeapMonitor::charge(uint8_t tag, int32_t retained, int32_t blockLoss) {
+    if (tag >= _tagCount) {
+        return;
+    }
+    portENTER_CRITICAL(&_lock);
+    TagStats& stats = _tags[tag];
+    stats.scopes++;
+    stats.retained += retained;
+    if (stats.retained > stats.highWater) {
+        stats.highWater = stats.retained;
+    }
+    if (retained > stats.largestScope) {
+        stats.largestScope = retained;
+    }
+    if (blockLoss > 0) {
+        stats.blockLoss += blockLoss;
+    }
+    portEXIT_CRITICAL(&_lock);
+}
+
+HeapScope::HeapScope(HeapMonitor& monitor, uint8_t tag)
+    : _monitor(monitor),
+      _tag(tag),
+      _freeBefore(HeapMonitor::freeBytes()),
+      _largestBefore(HeapMonitor::largestFreeBlock()),
+      _childRetained(0),
+      _childBlockLoss(0),
+      _parent(_current) {
+    _current = this;
+}
+
+HeapScope::~HeapScope() {
+    int32_t retained = (int32_t)(_freeBefore - HeapMonitor::freeBytes());
+    int32_t blockLoss = (int32_t)(_largestBefore - HeapMonitor::largestFreeBlock());
+
+    _monitor.charge(_tag, retained - _childRetained, blockLoss - _childBlockLoss);
+
+    _current = _parent;
+    if (_parent != nullptr) {
+        _parent->_childRetained += retained;
+        _parent->_childBlockLoss += blockLoss;
+    }
+}
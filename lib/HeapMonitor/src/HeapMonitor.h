@@ -0,0 +1,112 @@
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+
+#ifndef HEAP_MONITOR_MAX_TAGS
+#define HEAP_MONITOR_MAX_TAGS 6
+#endif
+
+// Samples kept; at the default interval of one minute that is two hours
+#ifndef HEAP_MONITOR_SAMPLES
+#define HEAP_MONITOR_SAMPLES 120
+#endif
+
+// Attributes internal-heap usage to subsystem tags and keeps a time series of
+// free heap, largest free block and fragmentation.
+//
+// This IDF has no allocation hooks, so attribution is by scope: a HeapScope
+// around a piece of work reads the free heap and the largest free block on
+// entry and exit, and charges the difference to its tag. What a tag
+// accumulates is therefore what its scopes left allocated (net of frees) and
+// how much they shrank the largest free block, which is what makes a large
+// allocation such as an OTA buffer fail later. Nested scopes charge only
+// their own share; the enclosing scope gets the rest. Allocations by other
+// tasks while a scope is open are charged to it as well, so keep scopes
+// short and read the totals as trends.
+//
+// Scopes may be used from any task. Tags are added before begin().
+class HeapMonitor {
+public:
+    struct TagStats {
+        uint32_t scopes;
+        int32_t retained;      // Bytes left allocated by the tag's scopes, net of frees
+        int32_t highWater;     // Largest value retained has had
+        int32_t largestScope;  // Most one scope left allocated
+        uint32_t blockLoss;    // Total shrinkage of the largest free block
+    };
+
+    struct Sample {
+        uint32_t uptimeS;
+        uint32_t freeBytes;
+        uint32_t largestBlock;
+        uint32_t minFreeBytes;
+        int32_t retained[HEAP_MONITOR_MAX_TAGS];
+    };
+
+    HeapMonitor();
+
+    // Returns the tag's index, or -1 if the table is full. name must stay valid.
+    int addTag(const char* name);
+
+    // Allocate the sample ring (in PSRAM when there is some) and take the first sample
+    bool begin(uint32_t sampleIntervalMs = 60000);
+
+    // Take a sample when the interval has passed; call from the loop
+    void loop(uint32_t now);
+
+    uint8_t tagCount() const { return _tagCount; }
+    const char* tagName(uint8_t tag) const { return _tagNames[tag]; }
+    TagStats tagStats(uint8_t tag);
+
+    // index 0 is the oldest sample
+    size_t sampleCount();
+    bool getSample(size_t index, Sample& sample);
+    uint32_t sampleIntervalMs() const { return _intervalMs; }
+
+    // 1 - largest free block / free heap: 0 when the free heap is one block
+    static float fragmentation(uint32_t freeBytes, uint32_t largestBlock);
+
+    // Internal heap right now
+    static uint32_t freeBytes();
+    static uint32_t largestFreeBlock();
+
+private:
+    friend class HeapScope;
+
+    const char* _tagNames[HEAP_MONITOR_MAX_TAGS];
+    TagStats _tags[HEAP_MONITOR_MAX_TAGS];
+    uint8_t _tagCount;
+
+    portMUX_TYPE _lock;
+    Sample* _samples;
+    size_t _head;      // Next slot to write
+    size_t _count;
+    uint32_t _intervalMs;
+    uint32_t _lastSample;
+
+    void takeSample(uint32_t now);
+    void charge(uint8_t tag, int32_t retained, int32_t blockLoss);
+};
+
+// Charges the heap used between construction and destruction to a tag:
+//
+//   HeapScope scope(heapMonitor, HEAP_TAG_WEB);
+class HeapScope {
+public:
+    HeapScope(HeapMonitor& monitor, uint8_t tag);
+    ~HeapScope();
+
+private:
+    HeapMonitor& _monitor;
+    uint8_t _tag;
+    uint32_t _freeBefore;
+    uint32_t _largestBefore;
+    int32_t _childRetained;   // Already charged by nested scopes
+    int32_t _childBlockLoss;
+    HeapScope* _parent;       // Enclosing scope on the same task
+
+    static thread_local HeapScope* _current;
+};
+
+#endif
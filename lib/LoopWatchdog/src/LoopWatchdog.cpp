@@ -0,0 +1,152 @@
+#include "LoopWatchdog.h"
+#include <DeviceLog.h>
+#include <esp_task_wdt.h>
+
+static LogModule logWatchdog("watchdog");
+
+// Survives the task watchdog reset; begin() on the next boot reads and clears it
+static const uint32_t ESCALATION_MAGIC = 0x57444F47;
+struct EscalationRecord {
+    uint32_t magic;
+    WatchdogEscalation escalation;
+};
+static RTC_NOINIT_ATTR EscalationRecord escalationRecord;
+
+TaskHandle_t LoopWatchdog::_watched = nullptr;
+TaskHandle_t LoopWatchdog::_task = nullptr;
+portMUX_TYPE LoopWatchdog::_lock = portMUX_INITIALIZER_UNLOCKED;
+WatchdogScope* LoopWatchdog::_current = nullptr;
+uint32_t LoopWatchdog::_escalateAfterMs = 0;
+bool LoopWatchdog::_escalated = false;
+bool LoopWatchdog::_hasEscalation = false;
+
+// The counter keeps a pointer to _labels, which is filled in before any export
+WatchdogSection::WatchdogSection(const char* name, uint32_t budgetMs)
+    : _name(name), _budgetMs(budgetMs),
+      _stalls("loop_stalls_total", "Main task sections that ran past their time budget", _labels),
+      _longestStallMs(0) {
+    snprintf(_labels, sizeof(_labels), "section=\"%s\"", name);
+    enlist();
+}
+
+bool LoopWatchdog::begin(uint32_t escalateAfterMs, UBaseType_t priority, uint32_t stackSize) {
+    if (_task != nullptr) {
+        return true;
+    }
+    _hasEscalation = escalationRecord.magic == ESCALATION_MAGIC && esp_reset_reason() == ESP_RST_TASK_WDT;
+    if (_hasEscalation) {
+        escalationRecord.escalation.section[LOOP_WATCHDOG_NAME_SIZE - 1] = '\0';
+    }
+    escalationRecord.magic = 0;
+
+    _escalateAfterMs = escalateAfterMs;
+    _watched = xTaskGetCurrentTaskHandle();
+    if (xTaskCreate(taskEntry, "loop_wdt", stackSize, nullptr, priority, &_task) != pdPASS) {
+        DLOG_E(logWatchdog, "Failed to start loop watchdog task");
+        _watched = nullptr;
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+const WatchdogEscalation* LoopWatchdog::lastEscalation() {
+    return _hasEscalation ? &escalationRecord.escalation : nullptr;
+}
+
+void LoopWatchdog::check(uint32_t now) {
+    portENTER_CRITICAL(&_lock);
+    if (_current == nullptr || _escalated) {
+        portEXIT_CRITICAL(&_lock);
+        return;
+    }
+    // Read under the lock; the scope may close as soon as it is released
+    WatchdogSection& section = _current->_section;
+    uint32_t elapsed = now - _current->_ownStartMs;
+    bool stalled = !_current->_reported && elapsed > section._budgetMs;
+    bool hung = _escalateAfterMs > 0 && elapsed > section._budgetMs + _escalateAfterMs;
+    if (stalled) {
+        _current->_reported = true;
+    }
+    if (stalled && elapsed > section._longestStallMs) {
+        section._longestStallMs = elapsed;
+    }
+    _escalated = hung;
+    portEXIT_CRITICAL(&_lock);
+
+    if (!stalled && !hung) {
+        return;
+    }
+    // Bytes on ESP-IDF, not words
+    uint32_t stackFree = uxTaskGetStackHighWaterMark(_watched);
+    if (stalled) {
+        section._stalls.increment();
+        DLOG_W(logWatchdog, "Stall in %s: %lu ms so far (budget %lu ms), %lu bytes of stack never used",
+               section._name, (unsigned long)elapsed, (unsigned long)section._budgetMs, (unsigned long)stackFree);
+    }
+    if (hung) {
+        WatchdogEscalation& escalation = escalationRecord.escalation;
+        strncpy(escalation.section, section._name, LOOP_WATCHDOG_NAME_SIZE - 1);
+        escalation.section[LOOP_WATCHDOG_NAME_SIZE - 1] = '\0';
+        escalation.durationMs = elapsed;
+        escalation.stackFreeBytes = stackFree;
+        escalationRecord.magic = ESCALATION_MAGIC;
+        DLOG_E(logWatchdog, "%s hung for %lu ms; resetting through the task watchdog", section._name,
+               (unsigned long)elapsed);
+        DeviceLog::flush();
+    }
+}
+
+void LoopWatchdog::taskEntry(void* parameter) {
+    (void)parameter;
+    bool feeding = false;
+    if (_escalateAfterMs > 0) {
+        // Reconfigures the watchdog the Arduino core already started
+        feeding = esp_task_wdt_init(LOOP_WATCHDOG_TWDT_TIMEOUT_S, true) == ESP_OK && esp_task_wdt_add(nullptr) == ESP_OK;
+        if (!feeding) {
+            DLOG_W(logWatchdog, "Task watchdog unavailable; hung sections are only logged");
+        }
+    }
+    for (;;) {
+        check(millis());
+        if (feeding && !_escalated) {
+            esp_task_wdt_reset();
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOOP_WATCHDOG_CHECK_MS));
+    }
+}
+
+WatchdogScope::WatchdogScope(WatchdogSection& section)
+    : _section(section), _startMs(millis()), _ownStartMs(_startMs), _active(false), _reported(false),
+      _parent(nullptr) {
+    if (LoopWatchdog::_watched == nullptr || xTaskGetCurrentTaskHandle() != LoopWatchdog::_watched) {
+        return;
+    }
+    _active = true;
+    portENTER_CRITICAL(&LoopWatchdog::_lock);
+    _parent = LoopWatchdog::_current;
+    LoopWatchdog::_current = this;
+    portEXIT_CRITICAL(&LoopWatchdog::_lock);
+}
+
+WatchdogScope::~WatchdogScope() {
+    if (!_active) {
+        return;
+    }
+    uint32_t now = millis();
+    uint32_t elapsed = now - _ownStartMs;
+    portENTER_CRITICAL(&LoopWatchdog::_lock);
+    LoopWatchdog::_current = _parent;
+    if (_parent != nullptr) {
+        _parent->_ownStartMs += now - _startMs;
+    }
+    if (_reported && elapsed > _section._longestStallMs) {
+        _section._longestStallMs = elapsed;
+    }
+    portEXIT_CRITICAL(&LoopWatchdog::_lock);
+
+    if (_reported) {
+        DLOG_W(logWatchdog, "%s returned after %lu ms (budget %lu ms)", _section._name, (unsigned long)elapsed,
+               (unsigned long)_section._budgetMs);
+    }
+}
@@ -0,0 +1,126 @@
+#ifndef LOOP_WATCHDOG_H
+#define LOOP_WATCHDOG_H
+
+#include <Arduino.h>
+#include <ESPMetrics.h>
+#include <Registered.h>
+
+// How often the monitor task looks at the open section
+#ifndef LOOP_WATCHDOG_CHECK_MS
+#define LOOP_WATCHDOG_CHECK_MS 100
+#endif
+
+// Task watchdog timeout once escalation is on. The monitor feeds the task
+// watchdog on every check, so the reset comes this long after it stops.
+#ifndef LOOP_WATCHDOG_TWDT_TIMEOUT_S
+#define LOOP_WATCHDOG_TWDT_TIMEOUT_S 5
+#endif
+
+// Longest section name kept across a reset, including the terminator
+#define LOOP_WATCHDOG_NAME_SIZE 24
+
+// A part of the main loop with a time budget, e.g.
+//
+//   WatchdogSection mqttConnectSection("mqtt_connect", 5000);
+//
+// Sections register themselves in one list when constructed and are never
+// removed, so they are globals. name must stay valid. Each section exports
+// its stalls as loop_stalls_total{section="name"}.
+class WatchdogSection : public Registered<WatchdogSection> {
+public:
+    WatchdogSection(const char* name, uint32_t budgetMs);
+
+    const char* name() const { return _name; }
+    uint32_t budgetMs() const { return _budgetMs; }
+    uint32_t stallCount() const { return _stalls.value(); }
+    // Longest time a stalled visit to this section took, so far
+    uint32_t longestStallMs() const { return _longestStallMs; }
+
+private:
+    const char* _name;
+    uint32_t _budgetMs;
+    char _labels[LOOP_WATCHDOG_NAME_SIZE + 12]; // section="name"
+    MetricCounter _stalls;
+    uint32_t _longestStallMs;
+
+    friend class LoopWatchdog;
+    friend class WatchdogScope;
+};
+
+// The section a reset by LoopWatchdog escalation was stuck in
+struct WatchdogEscalation {
+    char section[LOOP_WATCHDOG_NAME_SIZE];
+    uint32_t durationMs;
+    uint32_t stackFreeBytes; // Stack the stuck task had never used
+};
+
+class WatchdogScope;
+
+// Finds out which call hung the main task.
+//
+// The task that calls begin() (the Arduino loop task) marks what it is doing
+// with WatchdogScopes. A monitor task at a higher priority checks the
+// innermost open scope every LOOP_WATCHDOG_CHECK_MS. When it has been open
+// longer than its section's budget, the monitor logs a warning with the
+// section, how long it has run and the stalled task's stack high-water mark,
+// and counts it in the section's metric; when the scope finally closes, how
+// long it took is logged too. A section's budget covers its own time only:
+// time spent in a nested scope is charged to that scope.
+//
+// With escalation on, a scope still open escalateAfterMs past its budget is
+// treated as hung. The monitor writes the section to RTC memory, flushes the
+// log and stops feeding the task watchdog, which then resets the device. The
+// next boot finds the section in lastEscalation().
+class LoopWatchdog {
+public:
+    // Watch the calling task and start the monitor task. escalateAfterMs 0
+    // leaves the task watchdog alone. Otherwise the task watchdog is set to
+    // reset on timeout (LOOP_WATCHDOG_TWDT_TIMEOUT_S) for every task it watches.
+    static bool begin(uint32_t escalateAfterMs = 0, UBaseType_t priority = 3, uint32_t stackSize = 3072);
+
+    // Set when the last reset was this watchdog escalating, else nullptr
+    static const WatchdogEscalation* lastEscalation();
+
+private:
+    friend class WatchdogScope;
+
+    static TaskHandle_t _watched;
+    static TaskHandle_t _task;
+    static portMUX_TYPE _lock;
+    static WatchdogScope* _current; // Innermost open scope of the watched task
+    static uint32_t _escalateAfterMs;
+    static bool _escalated;
+    static bool _hasEscalation;
+
+    static void check(uint32_t now);
+    static void taskEntry(void* parameter);
+};
+
+// Marks the watched task as inside a section until the end of the block:
+//
+//   {
+//     WatchdogScope watchdogScope(mqttConnectSection);
+//     mqttManager.connect();
+//   }
+//
+// Scopes opened on other tasks, or before LoopWatchdog::begin(), do nothing.
+class WatchdogScope {
+public:
+    explicit WatchdogScope(WatchdogSection& section);
+    ~WatchdogScope();
+
+    WatchdogScope(const WatchdogScope&) = delete;
+    WatchdogScope& operator=(const WatchdogScope&) = delete;
+
+private:
+    WatchdogSection& _section;
+    uint32_t _startMs;
+    uint32_t _ownStartMs;     // _startMs moved forward by the time spent in nested scopes
+    bool _active;             // Opened on the watched task
+    bool _reported;           // Counted as a stall
+    WatchdogScope* _parent;
+
+    friend class LoopWatchdog;
+};
+
+#endif
@@ -0,0 +1,210 @@
+#ifndef ROLLING_STATS_H
+#define ROLLING_STATS_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Aggregates over the most recent samples of one metric
+struct WindowSummary {
+    float min;
+    float max;
+    float mean;
+    float variance; // Population variance of the window
+    float ema;      // Exponential moving average over all samples
+    uint16_t count; // Samples currently in the window
+};
+
+// Fixed-capacity ring buffer; push() overwrites the oldest element when full
+template <typename T, size_t Capacity>
+class RingBuffer {
+public:
+    RingBuffer() : _head(0), _count(0) {}
+
+    void push(const T& value) {
+        _items[(_head + _count) % Capacity] = value;
+        if (_count < Capacity) {
+            _count++;
+        } else {
+            _head = (_head + 1) % Capacity;
+        }
+    }
+
+    // 0 = oldest
+    const T& operator[](size_t index) const { return _items[(_head + index) % Capacity]; }
+    const T& oldest() const { return _items[_head]; }
+    const T& newest() const { return _items[(_head + _count - 1) % Capacity]; }
+
+    void dropOldest() {
+        if (_count > 0) {
+            _head = (_head + 1) % Capacity;
+            _count--;
+        }
+    }
+
+    void dropNewest() {
+        if (_count > 0) {
+            _count--;
+        }
+    }
+
+    void clear() {
+        _head = 0;
+        _count = 0;
+    }
+
+    size_t size() const { return _count; }
+    bool isFull() const { return _count == Capacity; }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    T _items[Capacity];
+    size_t _head;
+    size_t _count;
+};
+
+// Sliding-window statistics in O(1) amortized time per sample with no heap use:
+// Welford's algorithm (with removal) for mean and variance, monotonic queues for
+// min and max, and an EMA. The window length can be changed at runtime up to
+// Capacity samples.
+template <size_t Capacity>
+class RollingStats {
+public:
+    explicit RollingStats(size_t window = Capacity, float emaAlpha = 0.2f)
+        : _emaAlpha(emaAlpha) {
+        setWindow(window);
+    }
+
+    void setWindow(size_t window) {
+        _window = window == 0 ? 1 : (window > Capacity ? Capacity : window);
+        reset();
+    }
+
+    void setEmaAlpha(float alpha) { _emaAlpha = alpha; }
+    size_t window() const { return _window; }
+
+    void reset() {
+        _samples.clear();
+        _minQueue.clear();
+        _maxQueue.clear();
+        _sequence = 0;
+        _mean = 0.0;
+        _m2 = 0.0;
+        _ema = NAN;
+        _removalsSinceRebuild = 0;
+    }
+
+    void add(float value) {
+        if (isnan(value)) {
+            return;
+        }
+
+        if (_samples.size() == _window) {
+            remove(_samples.oldest());
+            _samples.dropOldest();
+        }
+
+        Sample sample = {value, _sequence++};
+        _samples.push(value);
+
+        // Welford update
+        double n = (double)_samples.size();
+        double delta = value - _mean;
+        _mean += delta / n;
+        _m2 += delta * (value - _mean);
+
+        // Monotonic queues: drop entries that can no longer be the extreme
+        uint32_t firstLive = _sequence - (uint32_t)_samples.size();
+        pushMonotonic(_minQueue, sample, firstLive, true);
+        pushMonotonic(_maxQueue, sample, firstLive, false);
+
+        _ema = isnan(_ema) ? value : _ema + _emaAlpha * (value - _ema);
+
+        // Removal accumulates rounding error; rebuild once per window (amortized O(1))
+        if (_removalsSinceRebuild >= _window) {
+            rebuildMoments();
+        }
+    }
+
+    WindowSummary summary() const {
+        WindowSummary result;
+        result.count = (uint16_t)_samples.size();
+        if (result.count == 0) {
+            result.min = result.max = result.mean = result.variance = result.ema = NAN;
+            return result;
+        }
+        result.min = _minQueue.oldest().value;
+        result.max = _maxQueue.oldest().value;
+        result.mean = (float)_mean;
+        result.variance = _m2 > 0.0 ? (float)(_m2 / result.count) : 0.0f;
+        result.ema = _ema;
+        return result;
+    }
+
+    size_t size() const { return _samples.size(); }
+
+private:
+    struct Sample {
+        float value;
+        uint32_t sequence;
+    };
+
+    RingBuffer<float, Capacity> _samples;
+    RingBuffer<Sample, Capacity> _minQueue;
+    RingBuffer<Sample, Capacity> _maxQueue;
+    size_t _window;
+    uint32_t _sequence;
+    double _mean;
+    double _m2;
+    float _ema;
+    float _emaAlpha;
+    size_t _removalsSinceRebuild;
+
+    void remove(float value) {
+        double n = (double)_samples.size();
+        if (n <= 1.0) {
+            _mean = 0.0;
+            _m2 = 0.0;
+            return;
+        }
+        double delta = value - _mean;
+        _mean -= delta / (n - 1.0);
+        _m2 -= delta * (value - _mean);
+        if (_m2 < 0.0) {
+            _m2 = 0.0;
+        }
+        _removalsSinceRebuild++;
+    }
+
+    void rebuildMoments() {
+        _mean = 0.0;
+        _m2 = 0.0;
+        for (size_t i = 0; i < _samples.size(); i++) {
+            double delta = _samples[i] - _mean;
+            _mean += delta / (double)(i + 1);
+            _m2 += delta * (_samples[i] - _mean);
+        }
+        _removalsSinceRebuild = 0;
+    }
+
+    // The queue is kept in push order; entries are removed from the back while
+    // they are dominated by the new sample, and expired entries from the front.
+    static void pushMonotonic(RingBuffer<Sample, Capacity>& queue, const Sample& sample,
+                              uint32_t firstLive, bool isMin) {
+        while (queue.size() > 0 && (int32_t)(queue.oldest().sequence - firstLive) < 0) {
+            queue.dropOldest();
+        }
+
+        while (queue.size() > 0) {
+            const Sample& back = queue.newest();
+            bool dominated = isMin ? back.value >= sample.value : back.value <= sample.value;
+            if (!dominated) {
+                break;
+            }
+            queue.dropNewest();
+        }
+        queue.push(sample);
+    }
+};
+
+#endif
@@ -0,0 +1,169 @@
+#include "SensorRegistry.h"
+#include <DeviceLog.h>
+#include <SpanTracer.h>
+
+extern LogModule logSensors; // SensorSampler.cpp
+
+SensorRegistry::SensorRegistry(uint32_t readBudgetUs)
+    : _sensorCount(0),
+      _channelCount(0),
+      _readBudgetUs(readBudgetUs),
+      _statsLock(portMUX_INITIALIZER_UNLOCKED) {}
+
+int SensorRegistry::add(SensorSlotBase& sensor) {
+    if (_sensorCount >= SENSOR_REGISTRY_MAX_SENSORS ||
+        _channelCount + sensor.channelCount() > SENSOR_SAMPLER_MAX_CHANNELS) {
+        DLOG_E(logSensors, "Sensor registry full, %s not added", sensor.name());
+        return -1;
+    }
+
+    Entry& entry = _sensors[_sensorCount++];
+    entry.slot = &sensor;
+    entry.firstChannel = _channelCount;
+    entry.nextDue = 0;
+    memset(&entry.stats, 0, sizeof(entry.stats));
+
+    _channelCount += sensor.channelCount();
+    return entry.firstChannel;
+}
+
+bool SensorRegistry::begin() {
+    bool ok = true;
+    uint32_t now = millis();
+
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        Entry& entry = _sensors[i];
+        if (!entry.slot->begin()) {
+            DLOG_E(logSensors, "Sensor %s failed to start", entry.slot->name());
+            ok = false;
+        }
+
+        // Spread first reads over one period so equal-rate sensors alternate
+        entry.nextDue = now + (entry.slot->minPeriodMs() * i) / _sensorCount;
+    }
+    return ok;
+}
+
+void SensorRegistry::sampleFunction(SensorSnapshot& snapshot, void* context) {
+    static_cast<SensorRegistry*>(context)->sample(snapshot, millis());
+}
+
+void SensorRegistry::sample(SensorSnapshot& snapshot, uint32_t now) {
+    uint32_t spentUs = 0;
+    bool readAny = false;
+
+    // Most overdue first, until the round's budget is used up
+    while (true) {
+        Entry* next = nullptr;
+        for (uint8_t i = 0; i < _sensorCount; i++) {
+            Entry& entry = _sensors[i];
+            if ((int32_t)(now - entry.nextDue) < 0) {
+                continue;
+            }
+            if (next == nullptr || (int32_t)(entry.nextDue - next->nextDue) < 0) {
+                next = &entry;
+            }
+        }
+        if (next == nullptr) {
+            break;
+        }
+
+        uint32_t cost = next->stats.lastCostUs > next->slot->readCostUs() ? next->stats.lastCostUs
+                                                                           : next->slot->readCostUs();
+        if (readAny && spentUs + cost > _readBudgetUs) {
+            // Everything still due waits for the next round
+            for (uint8_t i = 0; i < _sensorCount; i++) {
+                if ((int32_t)(now - _sensors[i].nextDue) >= 0) {
+                    portENTER_CRITICAL(&_statsLock);
+                    _sensors[i].stats.deferrals++;
+                    portEXIT_CRITICAL(&_statsLock);
+                }
+            }
+            break;
+        }
+
+        uint32_t start = micros();
+        readSensor(*next, snapshot, now);
+        spentUs += micros() - start;
+        readAny = true;
+    }
+}
+
+void SensorRegistry::readSensor(Entry& entry, SensorSnapshot& snapshot, uint32_t now) {
+    float values[SENSOR_SAMPLER_MAX_CHANNELS];
+    uint8_t count = entry.slot->channelCount();
+    for (uint8_t c = 0; c < count; c++) {
+        values[c] = NAN;
+    }
+
+    uint32_t start = micros();
+    SensorReadStatus status = entry.slot->read(values);
+    uint32_t cost = micros() - start;
+    TRACE_SPAN_US(entry.slot->name(), cost);
+
+    if (status == SENSOR_READ_NOT_READY) {
+        // Try again next round without advancing the schedule
+        entry.nextDue = now + 1;
+    } else {
+        // No catch-up bursts after a stall: the next read is one period from now
+        uint32_t period = entry.slot->minPeriodMs();
+        entry.nextDue += period;
+        if ((int32_t)(now - entry.nextDue) >= 0) {
+            entry.nextDue = now + period;
+        }
+
+        uint32_t timestamp = millis();
+        for (uint8_t c = 0; c < count; c++) {
+            SensorReading& reading = snapshot.readings[entry.firstChannel + c];
+            reading.value = status == SENSOR_READ_OK ? values[c] : NAN;
+            reading.valid = !isnan(reading.value);
+            reading.timestamp = timestamp;
+        }
+    }
+
+    portENTER_CRITICAL(&_statsLock);
+    entry.stats.lastCostUs = cost;
+    if (status != SENSOR_READ_NOT_READY) {
+        entry.stats.reads++;
+        if (status == SENSOR_READ_FAILED) {
+            entry.stats.failures++;
+        }
+    }
+    portEXIT_CRITICAL(&_statsLock);
+}
+
+SensorRegistry::SensorStats SensorRegistry::stats(uint8_t index) const {
+    portENTER_CRITICAL(const_cast<portMUX_TYPE*>(&_statsLock));
+    SensorStats result = _sensors[index].stats;
+    portEXIT_CRITICAL(const_cast<portMUX_TYPE*>(&_statsLock));
+    return result;
+}
+
+const char* SensorRegistry::channelName(uint8_t channel) const {
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        const Entry& entry = _sensors[i];
+        if (channel >= entry.firstChannel && channel < entry.firstChannel + entry.slot->channelCount()) {
+            return entry.slot->channel(channel - entry.firstChannel).name;
+        }
+    }
+    return "";
+}
+
+const char* SensorRegistry::channelUnit(uint8_t channel) const {
+    for (uint8_t i = 0; i < _sensorCount; i++) {
+        const Entry& entry = _sensors[i];
+        if (channel >= entry.firstChannel && channel < entry.firstChannel + entry.slot->channelCount()) {
+            return entry.slot->channel(channel - entry.firstChannel).unit;
+        }
+    }
+    return "";
+}
+
+int SensorRegistry::findChannel(const char* name) const {
+    for (uint8_t channel = 0; channel < _channelCount; channel++) {
+        if (strcmp(channelName(channel), name) == 0) {
+            return channel;
+        }
+    }
+    return -1;
+}
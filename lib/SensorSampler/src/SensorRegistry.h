@@ -0,0 +1,128 @@
+#ifndef SENSOR_REGISTRY_H
+#define SENSOR_REGISTRY_H
+
+#include <Arduino.h>
+#include <utility>
+#include "SensorSampler.h"
+
+#ifndef SENSOR_REGISTRY_MAX_SENSORS
+#define SENSOR_REGISTRY_MAX_SENSORS 8
+#endif
+
+// Time the sampler task may spend in sensor reads per round before due
+// sensors are deferred to the next round
+#ifndef SENSOR_REGISTRY_READ_BUDGET_US
+#define SENSOR_REGISTRY_READ_BUDGET_US 200000
+#endif
+
+struct SensorChannel {
+    const char* name; // Metric name used in topics, APIs and settings keys
+    const char* unit;
+};
+
+enum SensorReadStatus {
+    SENSOR_READ_OK,        // values[] filled (NAN for a channel that failed)
+    SENSOR_READ_FAILED,    // No values; every channel is marked invalid
+    SENSOR_READ_NOT_READY  // Nothing new yet (e.g. conversion running); retried next round
+};
+
+// Type-erased view of a registered sensor, used by the scheduler
+class SensorSlotBase {
+public:
+    virtual ~SensorSlotBase() {}
+
+    virtual const char* name() const = 0;
+    virtual uint8_t channelCount() const = 0;
+    virtual const SensorChannel& channel(uint8_t index) const = 0;
+    virtual uint32_t minPeriodMs() const = 0;
+    virtual uint32_t readCostUs() const = 0;
+    virtual bool begin() = 0;
+    virtual SensorReadStatus read(float* values) = 0;
+};
+
+// Holds one driver instance. A driver declares its shape at compile time:
+//
+//   static const uint8_t CHANNEL_COUNT;
+//   static const uint32_t MIN_PERIOD_MS;  // Fastest useful read rate
+//   static const uint32_t READ_COST_US;   // Typical time read() keeps the sampler busy
+//   const SensorChannel& channel(uint8_t index) const;
+//   bool begin();
+//   SensorReadStatus read(float values[CHANNEL_COUNT]);
+//
+// Constructor arguments after the slot name are forwarded to the driver.
+template <typename Driver>
+class SensorSlot : public SensorSlotBase {
+public:
+    template <typename... Args>
+    explicit SensorSlot(const char* name, Args&&... args)
+        : _name(name), _driver(std::forward<Args>(args)...) {}
+
+    const char* name() const override { return _name; }
+    uint8_t channelCount() const override { return Driver::CHANNEL_COUNT; }
+    const SensorChannel& channel(uint8_t index) const override { return _driver.channel(index); }
+    uint32_t minPeriodMs() const override { return Driver::MIN_PERIOD_MS; }
+    uint32_t readCostUs() const override { return Driver::READ_COST_US; }
+    bool begin() override { return _driver.begin(); }
+    SensorReadStatus read(float* values) override { return _driver.read(values); }
+
+    Driver& driver() { return _driver; }
+
+private:
+    const char* _name;
+    Driver _driver;
+};
+
+// Maps registered sensors onto consecutive SensorSampler channels and
+// schedules their reads. Each sensor is read no faster than its minimum
+// period; first reads are staggered so sensors with equal periods fall into
+// different rounds, and the reads in one round are capped by a time budget
+// (the most overdue sensor always runs).
+class SensorRegistry {
+public:
+    struct SensorStats {
+        uint32_t reads;
+        uint32_t failures;
+        uint32_t deferrals;  // Rounds a due sensor waited because of the budget
+        uint32_t lastCostUs; // Measured duration of the last read
+    };
+
+    explicit SensorRegistry(uint32_t readBudgetUs = SENSOR_REGISTRY_READ_BUDGET_US);
+
+    // Register before begin(). Returns the sampler channel of the sensor's
+    // first channel, or -1 if the sensor or channel table is full.
+    int add(SensorSlotBase& sensor);
+
+    // Start every driver and set the staggered schedule
+    bool begin();
+
+    // SensorSampler::SampleFunction; pass the registry as the context
+    static void sampleFunction(SensorSnapshot& snapshot, void* context);
+    void sample(SensorSnapshot& snapshot, uint32_t now);
+
+    uint8_t channelCount() const { return _channelCount; }
+    const char* channelName(uint8_t channel) const;
+    const char* channelUnit(uint8_t channel) const;
+    int findChannel(const char* name) const;
+
+    uint8_t sensorCount() const { return _sensorCount; }
+    const SensorSlotBase& sensor(uint8_t index) const { return *_sensors[index].slot; }
+    SensorStats stats(uint8_t index) const;
+
+private:
+    struct Entry {
+        SensorSlotBase* slot;
+        uint8_t firstChannel;
+        uint32_t nextDue;
+        SensorStats stats;
+    };
+
+    Entry _sensors[SENSOR_REGISTRY_MAX_SENSORS];
+    uint8_t _sensorCount;
+    uint8_t _channelCount;
+    uint32_t _readBudgetUs;
+    portMUX_TYPE _statsLock;
+
+    void readSensor(Entry& entry, SensorSnapshot& snapshot, uint32_t now);
+};
+
+#endif
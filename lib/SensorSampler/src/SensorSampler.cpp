@@ -0,0 +1,142 @@
+#include "SensorSampler.h"
+#include <DeviceLog.h>
+
+// Shared with SensorRegistry.cpp
+LogModule logSensors("sensors");
+
+SensorSampler::SensorSampler(uint8_t channelCount, unsigned long intervalMs)
+    : _channelCount(channelCount < SENSOR_SAMPLER_MAX_CHANNELS ? channelCount : SENSOR_SAMPLER_MAX_CHANNELS),
+      _intervalMs(intervalMs),
+      _sampleFunction(nullptr),
+      _context(nullptr),
+      _task(nullptr),
+      _writeSequence(0) {
+    _snapshot.channelCount = _channelCount;
+    _snapshot.sequence = 0;
+    for (uint8_t i = 0; i < SENSOR_SAMPLER_MAX_CHANNELS; i++) {
+        _snapshot.readings[i].value = NAN;
+        _snapshot.readings[i].timestamp = 0;
+        _snapshot.readings[i].valid = false;
+        _snapshot.readings[i].window = _stats[i].summary();
+        _lastSampleTime[i] = 0;
+    }
+}
+
+void SensorSampler::setChannelCount(uint8_t channelCount) {
+    if (_task != nullptr) {
+        return;
+    }
+    _channelCount = channelCount < SENSOR_SAMPLER_MAX_CHANNELS ? channelCount : SENSOR_SAMPLER_MAX_CHANNELS;
+    _snapshot.channelCount = _channelCount;
+}
+
+void SensorSampler::setChannelWindow(uint8_t channel, size_t samples, float emaAlpha) {
+    if (_task != nullptr || channel >= _channelCount) {
+        return;
+    }
+    _stats[channel].setWindow(samples);
+    _stats[channel].setEmaAlpha(emaAlpha);
+}
+
+// Applies to every channel, including ones added by a later setChannelCount()
+void SensorSampler::setWindow(size_t samples, float emaAlpha) {
+    if (_task != nullptr) {
+        return;
+    }
+    for (uint8_t i = 0; i < SENSOR_SAMPLER_MAX_CHANNELS; i++) {
+        _stats[i].setWindow(samples);
+        _stats[i].setEmaAlpha(emaAlpha);
+    }
+}
+
+bool SensorSampler::begin(SampleFunction sampleFunction, void* context, uint32_t stackSize, UBaseType_t priority) {
+    if (_task != nullptr || sampleFunction == nullptr) {
+        return false;
+    }
+
+    _sampleFunction = sampleFunction;
+    _context = context;
+
+    if (xTaskCreate(taskEntry, "sensor_sampler", stackSize, this, priority, &_task) != pdPASS) {
+        DLOG_E(logSensors, "Failed to start sensor sampler task");
+        _task = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void SensorSampler::read(SensorSnapshot& snapshot) const {
+    while (true) {
+        uint32_t before = _writeSequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            taskYIELD(); // Writer is mid-update (a copy of a few hundred bytes)
+            continue;
+        }
+
+        snapshot = _snapshot;
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (_writeSequence.load(std::memory_order_relaxed) == before) {
+            return;
+        }
+    }
+}
+
+SensorReading SensorSampler::latest(uint8_t channel) const {
+    SensorSnapshot snapshot;
+    read(snapshot);
+
+    if (channel >= snapshot.channelCount) {
+        SensorReading missing = {NAN, 0, false, RollingStats<1>().summary()};
+        return missing;
+    }
+    return snapshot.readings[channel];
+}
+
+uint32_t SensorSampler::sequence() const {
+    return _writeSequence.load(std::memory_order_acquire) / 2;
+}
+
+uint32_t SensorSampler::ageOf(const SensorReading& reading, uint32_t now) {
+    return now - reading.timestamp;
+}
+
+// A channel that is sampled slower than the sampler interval (or returns a
+// cached value) keeps its timestamp, and is not counted twice
+void SensorSampler::updateStatistics(SensorSnapshot& snapshot) {
+    for (uint8_t i = 0; i < _channelCount; i++) {
+        SensorReading& reading = snapshot.readings[i];
+        if (reading.valid && reading.timestamp != _lastSampleTime[i]) {
+            _stats[i].add(reading.value);
+            _lastSampleTime[i] = reading.timestamp;
+        }
+        reading.window = _stats[i].summary();
+    }
+}
+
+void SensorSampler::publish(const SensorSnapshot& snapshot) {
+    uint32_t sequence = _writeSequence.load(std::memory_order_relaxed);
+    _writeSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _snapshot = snapshot;
+    _snapshot.channelCount = _channelCount;
+    _snapshot.sequence = (sequence + 2) / 2;
+
+    _writeSequence.store(sequence + 2, std::memory_order_release);
+}
+
+void SensorSampler::taskEntry(void* parameter) {
+    SensorSampler* self = static_cast<SensorSampler*>(parameter);
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (true) {
+        SensorSnapshot working;
+        self->read(working);
+        self->_sampleFunction(working, self->_context);
+        self->updateStatistics(working);
+        self->publish(working);
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(self->_intervalMs));
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef SENSOR_SAMPLER_H
+#define SENSOR_SAMPLER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "RollingStats.h"
+
+#ifndef SENSOR_SAMPLER_MAX_CHANNELS
+#define SENSOR_SAMPLER_MAX_CHANNELS 8
+#endif
+
+// Longest statistics window per channel, in samples
+#ifndef SENSOR_STATS_CAPACITY
+#define SENSOR_STATS_CAPACITY 60
+#endif
+
+// Latest value of one channel
+struct SensorReading {
+    float value;
+    uint32_t timestamp; // millis() when the sample was taken
+    bool valid;         // false if the last read failed (value is then NAN)
+    WindowSummary window; // Aggregates over the channel's statistics window
+};
+
+// Consistent copy of every channel from one sampling round
+struct SensorSnapshot {
+    SensorReading readings[SENSOR_SAMPLER_MAX_CHANNELS];
+    uint8_t channelCount;
+    uint32_t sequence; // Completed sampling rounds (0 = nothing sampled yet)
+};
+
+// Samples sensors on its own FreeRTOS task and publishes the results through
+// a sequence lock. Readers never block and never touch the sensor bus: they
+// copy the last published snapshot and retry only if a write raced them.
+//
+// Every new valid sample (a reading whose timestamp changed) is also fed into
+// a per-channel RollingStats window, so spikes between publishes show up in
+// the window min/max even when only aggregates leave the device.
+class SensorSampler {
+public:
+    // Fills snapshot.readings[0..channelCount) for one sampling round.
+    // Runs on the sampler task.
+    typedef void (*SampleFunction)(SensorSnapshot& snapshot, void* context);
+
+    SensorSampler(uint8_t channelCount, unsigned long intervalMs);
+
+    // Number of channels in each snapshot (capped at SENSOR_SAMPLER_MAX_CHANNELS).
+    // Call before begin(), e.g. once every sensor is registered.
+    void setChannelCount(uint8_t channelCount);
+
+    // Window length in samples (capped at SENSOR_STATS_CAPACITY) and EMA
+    // smoothing factor. Call before begin().
+    void setWindow(size_t samples, float emaAlpha = 0.2f);
+    void setChannelWindow(uint8_t channel, size_t samples, float emaAlpha = 0.2f);
+
+    // Start the sampling task
+    bool begin(SampleFunction sampleFunction, void* context = nullptr,
+               uint32_t stackSize = 4096, UBaseType_t priority = 1);
+
+    // Lock-free access to the latest values
+    void read(SensorSnapshot& snapshot) const;
+    SensorReading latest(uint8_t channel) const;
+    uint32_t sequence() const;
+
+    // Age of a reading in milliseconds
+    static uint32_t ageOf(const SensorReading& reading, uint32_t now);
+
+    uint8_t getChannelCount() const { return _channelCount; }
+    unsigned long getInterval() const { return _intervalMs; }
+
+private:
+    uint8_t _channelCount;
+    unsigned long _intervalMs;
+    SampleFunction _sampleFunction;
+    void* _context;
+    TaskHandle_t _task;
+
+    // Even = stable, odd = write in progress
+    std::atomic<uint32_t> _writeSequence;
+    SensorSnapshot _snapshot;
+
+    // Only touched by the sampler task once it is running
+    RollingStats<SENSOR_STATS_CAPACITY> _stats[SENSOR_SAMPLER_MAX_CHANNELS];
+    uint32_t _lastSampleTime[SENSOR_SAMPLER_MAX_CHANNELS];
+
+    void updateStatistics(SensorSnapshot& snapshot);
+    void publish(const SensorSnapshot& snapshot);
+    static void taskEntry(void* parameter);
+};
+
+#endif
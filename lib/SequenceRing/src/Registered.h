@@ -0,0 +1,54 @@
+#ifndef REGISTERED_H
+#define REGISTERED_H
+
+#include <Arduino.h>
+
+// Base of objects that join one process-wide list of their type and are
+// never removed, so they are globals, file-scope statics, or live until
+// reboot. The derived constructor calls enlist() once its fields are set,
+// so a task walking the list never sees a half-built object. Appended, so
+// the list is in definition order.
+//
+//   class LogModule : public Registered<LogModule> { ... };
+template <typename T>
+class Registered {
+public:
+    const T* next() const { return _next; }
+    T* next() { return _next; }
+    static const T* first() { return _first; }
+
+protected:
+    Registered() : _next(nullptr) {}
+
+    void enlist() {
+        portENTER_CRITICAL(&_registryLock);
+        T* self = static_cast<T*>(this);
+        if (_last != nullptr) {
+            _last->_next = self;
+        } else {
+            _first = self;
+        }
+        _last = self;
+        portEXIT_CRITICAL(&_registryLock);
+    }
+
+    static T* head() { return _first; }
+
+private:
+    T* _next;
+
+    static T* _first;
+    static T* _last;
+    static portMUX_TYPE _registryLock;
+};
+
+// Constant-initialized, so objects constructed during static initialization
+// of other files can register safely
+template <typename T>
+T* Registered<T>::_first = nullptr;
+template <typename T>
+T* Registered<T>::_last = nullptr;
+template <typename T>
+portMUX_TYPE Registered<T>::_registryLock = portMUX_INITIALIZER_UNLOCKED;
+
+#endif
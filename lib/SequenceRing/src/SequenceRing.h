@@ -0,0 +1,91 @@
+#ifndef SEQUENCE_RING_H
+#define SEQUENCE_RING_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+#include <type_traits>
+
+// Receives exported text a piece at a time
+typedef void (*ChunkWriter)(const char* data, size_t length, void* context);
+
+// Fixed ring of T that any task (not ISRs) writes without taking a lock
+// while others copy entries out. A writer claims a slot with an atomic
+// increment and publishes it with the entry's sequence number; a reader
+// keeps a copy only if the slot held that number before and after copying,
+// so it sees gaps (entries overwritten or still being written), never torn
+// entries. When the ring is full the oldest entry is overwritten.
+//
+// Sequence numbers wrap at 2^32, which must stay a multiple of the capacity,
+// so the capacity is a power of two.
+template <typename T>
+class SequenceRing {
+    static_assert(std::is_trivially_copyable<T>::value, "ring entries are copied with memcpy");
+
+public:
+    struct Slot {
+        std::atomic<uint32_t> seq; // Sequence number + 1 of the entry held, 0 while it is written
+        T value;
+    };
+
+    // Without storage, write() does nothing until attach()
+    constexpr SequenceRing() : _slots(nullptr), _mask(0), _writeSeq(0) {}
+    // Constant-initialized, so it can be written during static initialization
+    constexpr SequenceRing(Slot* slots, size_t capacity) : _slots(slots), _mask(capacity - 1), _writeSeq(0) {}
+
+    void attach(Slot* slots, size_t capacity) {
+        _mask = capacity - 1;
+        _slots.store(slots, std::memory_order_release); // Last, so write() sees the capacity too
+    }
+
+    bool attached() const { return _slots.load(std::memory_order_acquire) != nullptr; }
+    size_t capacity() const { return attached() ? _mask + 1 : 0; }
+
+    // Sequence number of the next entry, i.e. entries written so far
+    uint32_t end() const { return _writeSeq.load(std::memory_order_acquire); }
+    // Oldest sequence number that can still be in the ring, given end()
+    uint32_t oldest(uint32_t end) const { return end > _mask ? end - _mask - 1 : 0; }
+
+    // Claim the next slot and fill it in place with fill(T&); returns its sequence number
+    template <typename Fill>
+    uint32_t write(Fill fill) {
+        Slot* slots = _slots.load(std::memory_order_acquire);
+        if (slots == nullptr) {
+            return 0;
+        }
+        uint32_t seq = _writeSeq.fetch_add(1, std::memory_order_relaxed);
+        Slot& slot = slots[seq & _mask];
+
+        // Readers that find 0, or a sequence number that changed while they
+        // copied, discard what they read
+        slot.seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        fill(slot.value);
+        slot.seq.store(seq + 1, std::memory_order_release);
+        return seq;
+    }
+
+    // Copy entry seq; false if it was overwritten or is still being written
+    bool read(uint32_t seq, T& copy) const {
+        const Slot& slot = _slots.load(std::memory_order_relaxed)[seq & _mask];
+        if (slot.seq.load(std::memory_order_acquire) != seq + 1) {
+            return false;
+        }
+        memcpy(static_cast<void*>(&copy), &slot.value, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot.seq.load(std::memory_order_relaxed) == seq + 1;
+    }
+
+    // True while entry seq is claimed but not published yet, as opposed to overwritten
+    bool pending(uint32_t seq) const {
+        uint32_t held = _slots.load(std::memory_order_relaxed)[seq & _mask].seq.load(std::memory_order_relaxed);
+        return held == 0 || (int32_t)(held - (seq + 1)) < 0;
+    }
+
+private:
+    std::atomic<Slot*> _slots;
+    size_t _mask;
+    std::atomic<uint32_t> _writeSeq; // Next sequence number to claim
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "SpanTracer.h"
+
+#ifdef SPAN_TRACING
+
+SequenceRing<Tracer::Event> Tracer::_ring;
+
+char Tracer::_taskNames[TRACE_MAX_TASKS][configMAX_TASK_NAME_LEN];
+uint8_t Tracer::_taskCount = 0;
+portMUX_TYPE Tracer::_taskLock = portMUX_INITIALIZER_UNLOCKED;
+thread_local uint8_t Tracer::_task = 0;
+
+// Tasks past TRACE_MAX_TASKS record tid 0; _task caches this so they do not retry
+static const uint8_t TASK_UNNAMED = 0xFF;
+
+static void writeText(ChunkWriter write, void* context, const char* text) {
+    write(text, strlen(text), context);
+}
+
+bool Tracer::begin(size_t capacity) {
+    if (_ring.attached()) {
+        return true;
+    }
+    size_t rounded = 1;
+    while (rounded * 2 <= capacity) {
+        rounded *= 2;
+    }
+    size_t size = sizeof(SequenceRing<Event>::Slot) * rounded;
+    void* slots = psramFound() ? ps_calloc(1, size) : calloc(1, size);
+    if (slots == nullptr) {
+        return false;
+    }
+    _ring.attach(static_cast<SequenceRing<Event>::Slot*>(slots), rounded);
+    return true;
+}
+
+void Tracer::record(const char* name, int64_t startUs, uint32_t durationUs) {
+    if (!_ring.attached()) {
+        return;
+    }
+    uint8_t task = _task != 0 ? _task : registerTask();
+    _ring.write([&](Event& event) {
+        event.name = name;
+        event.startUs = startUs;
+        event.durationUs = durationUs;
+        event.task = task == TASK_UNNAMED ? 0 : task;
+        event.core = xPortGetCoreID();
+    });
+}
+
+void Tracer::write(ChunkWriter write, void* context) {
+    char text[160];
+    writeText(write, context, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    writeText(write, context, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"esp32\"}}");
+
+    portENTER_CRITICAL(&_taskLock);
+    uint8_t taskCount = _taskCount;
+    portEXIT_CRITICAL(&_taskLock);
+    for (uint8_t i = 0; i < taskCount; i++) {
+        snprintf(text, sizeof(text), ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                 (unsigned)(i + 1), _taskNames[i]);
+        writeText(write, context, text);
+    }
+
+    if (_ring.attached()) {
+        uint32_t end = _ring.end();
+        Event copy;
+        for (uint32_t seq = _ring.oldest(end); seq != end; seq++) {
+            // Spans overwritten or still being written are left out
+            if (!_ring.read(seq, copy)) {
+                continue;
+            }
+            snprintf(text, sizeof(text),
+                     ",{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lu,\"pid\":1,\"tid\":%u,\"args\":{\"core\":%u}}",
+                     copy.name, (long long)copy.startUs, (unsigned long)copy.durationUs, (unsigned)copy.task,
+                     (unsigned)copy.core);
+            writeText(write, context, text);
+        }
+    }
+    writeText(write, context, "]}");
+}
+
+uint8_t Tracer::registerTask() {
+    const char* name = pcTaskGetTaskName(nullptr);
+    portENTER_CRITICAL(&_taskLock);
+    uint8_t task = TASK_UNNAMED;
+    if (_taskCount < TRACE_MAX_TASKS) {
+        strncpy(_taskNames[_taskCount], name, configMAX_TASK_NAME_LEN - 1);
+        _taskNames[_taskCount][configMAX_TASK_NAME_LEN - 1] = '\0';
+        task = ++_taskCount;
+    }
+    portEXIT_CRITICAL(&_taskLock);
+    _task = task;
+    return task;
+}
+
+#endif
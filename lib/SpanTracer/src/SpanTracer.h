@@ -0,0 +1,104 @@
+#ifndef SPAN_TRACER_H
+#define SPAN_TRACER_H
+
+// Spans of work with microsecond timestamps and the task and core that did
+// them, exported as Chrome trace-event JSON for Perfetto or chrome://tracing.
+//
+//   void syncTemplates() {
+//     TRACE_SCOPE("templates.sync");      // From here to the end of the block
+//     ...
+//   }
+//   TRACE_SPAN_US("dht22", micros() - start); // A span that ends now
+//
+// Tracing is compiled in only with -DSPAN_TRACING. Without it the macros
+// expand to nothing, their arguments are not evaluated and no tracer code
+// or buffer is linked, so instrumented code costs nothing.
+
+#ifdef SPAN_TRACING
+
+#include <Arduino.h>
+#include <SequenceRing.h>
+#include <esp_timer.h>
+
+// Events kept when begin() gets no capacity; the oldest are overwritten.
+// 32 bytes each, in PSRAM when the board has it. Must be a power of two.
+#ifndef TRACE_BUFFER_EVENTS
+#define TRACE_BUFFER_EVENTS 2048
+#endif
+
+// Distinct tasks named in the trace; spans of further tasks share tid 0
+#ifndef TRACE_MAX_TASKS
+#define TRACE_MAX_TASKS 16
+#endif
+
+// Records spans into a fixed ring. A span is one complete ("X") event
+// written when it ends, so an unfinished span is never in the trace and
+// nesting shows from the timestamps. The ring is a SequenceRing: any task
+// may record without taking a lock (not ISRs), and export copies events
+// while recording goes on. Span and task names are stored as pointers, so they
+// must stay valid until reboot (string literals, sensor slot names, job names).
+class Tracer {
+public:
+    // Allocate the ring; until then spans are ignored. capacity is rounded
+    // down to a power of two.
+    static bool begin(size_t capacity = TRACE_BUFFER_EVENTS);
+
+    // Microseconds since boot (64-bit, does not wrap)
+    static int64_t nowUs() { return esp_timer_get_time(); }
+
+    static void record(const char* name, int64_t startUs, uint32_t durationUs);
+
+    // The ring, oldest span first, as {"traceEvents":[...]} with one thread
+    // per task. Timestamps are microseconds since boot.
+    static void write(ChunkWriter write, void* context);
+
+    static uint32_t spanCount() { return _ring.end(); }
+    static size_t capacity() { return _ring.capacity(); }
+
+private:
+    struct Event {
+        const char* name;
+        int64_t startUs;
+        uint32_t durationUs;
+        uint8_t task;              // Index into _taskNames + 1, or 0
+        uint8_t core;
+    };
+
+    static SequenceRing<Event> _ring;
+
+    static char _taskNames[TRACE_MAX_TASKS][configMAX_TASK_NAME_LEN];
+    static uint8_t _taskCount;
+    static portMUX_TYPE _taskLock;
+    static thread_local uint8_t _task; // This task's tid, 0 until its first span
+
+    static uint8_t registerTask();
+};
+
+// Records the time from construction to the end of the enclosing block
+class TraceScope {
+public:
+    explicit TraceScope(const char* name) : _name(name), _startUs(Tracer::nowUs()) {}
+    ~TraceScope() { Tracer::record(_name, _startUs, (uint32_t)(Tracer::nowUs() - _startUs)); }
+
+private:
+    const char* _name;
+    int64_t _startUs;
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __COUNTER__)(name)
+#define TRACE_SPAN_US(name, durationUs) \
+    do { \
+        uint32_t traceDurationUs = (durationUs); \
+        Tracer::record((name), Tracer::nowUs() - traceDurationUs, traceDurationUs); \
+    } while (0)
+
+#else
+
+#define TRACE_SCOPE(name)
+#define TRACE_SPAN_US(name, durationUs) do {} while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,249 @@
+#include "TemplateCache.h"
+#include <DeviceLog.h>
+
+static LogModule logCache("template_cache");
+
+// Longest placeholder name render() looks for
+static const size_t MAX_NAME_LENGTH = 32;
+
+TemplateCache::TemplateCache(fs::FS& fs, size_t ramBudget)
+    : _fs(fs),
+      _ramBudget(ramBudget),
+      _usePsram(false),
+      _pathCount(0),
+      _bytes(0),
+      _useCounter(0),
+      _hits(0),
+      _misses(0),
+      _evictions(0) {
+    memset(_entries, 0, sizeof(_entries));
+}
+
+void TemplateCache::addPath(const char* path) {
+    if (_pathCount < TEMPLATE_CACHE_MAX_ENTRIES) {
+        _paths[_pathCount++] = path;
+    }
+}
+
+void TemplateCache::begin() {
+#ifdef BOARD_HAS_PSRAM
+    // The build flag only says the board may have PSRAM; the module decides
+    _usePsram = psramFound();
+#endif
+    if (_usePsram) {
+        preload();
+    }
+}
+
+void TemplateCache::reload() {
+    clear();
+    if (_usePsram) {
+        preload();
+    }
+}
+
+void TemplateCache::invalidate(const char* path) {
+    Entry* entry = find(path);
+    if (entry != nullptr) {
+        release(*entry);
+    }
+}
+
+const char* TemplateCache::get(const char* path, size_t& length) {
+    Entry* entry = find(path);
+    if (entry != nullptr) {
+        _hits++;
+    } else {
+        _misses++;
+        entry = load(path);
+        if (entry == nullptr) {
+            return nullptr;
+        }
+    }
+    entry->lastUsed = ++_useCounter;
+    length = entry->length;
+    return entry->data;
+}
+
+size_t TemplateCache::entryCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < TEMPLATE_CACHE_MAX_ENTRIES; i++) {
+        if (_entries[i].data != nullptr) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t TemplateCache::render(const char* text, size_t length, const TemplateVar* vars, size_t count,
+                             ChunkWriter write, void* context) {
+    size_t total = 0;
+    size_t literalStart = 0;
+    size_t i = 0;
+
+    while (i + 1 < length) {
+        if (text[i] != '{' || text[i + 1] != '{') {
+            i++;
+            continue;
+        }
+
+        size_t nameStart = i + 2;
+        size_t nameEnd = nameStart;
+        while (nameEnd + 1 < length && nameEnd - nameStart <= MAX_NAME_LENGTH &&
+               !(text[nameEnd] == '}' && text[nameEnd + 1] == '}')) {
+            nameEnd++;
+        }
+
+        const TemplateVar* var = nullptr;
+        if (nameEnd + 1 < length && nameEnd - nameStart <= MAX_NAME_LENGTH) {
+            size_t nameLength = nameEnd - nameStart;
+            for (size_t v = 0; v < count; v++) {
+                if (strncmp(vars[v].name, text + nameStart, nameLength) == 0 && vars[v].name[nameLength] == '\0') {
+                    var = &vars[v];
+                    break;
+                }
+            }
+        }
+        if (var == nullptr) {
+            i += 2;
+            continue;
+        }
+
+        if (write != nullptr) {
+            if (i > literalStart) {
+                write(text + literalStart, i - literalStart, context);
+            }
+            if (var->value.length() > 0) {
+                write(var->value.c_str(), var->value.length(), context);
+            }
+        }
+        total += (i - literalStart) + var->value.length();
+        i = nameEnd + 2;
+        literalStart = i;
+    }
+
+    if (write != nullptr && length > literalStart) {
+        write(text + literalStart, length - literalStart, context);
+    }
+    return total + (length - literalStart);
+}
+
+void TemplateCache::clear() {
+    for (size_t i = 0; i < TEMPLATE_CACHE_MAX_ENTRIES; i++) {
+        if (_entries[i].data != nullptr) {
+            release(_entries[i]);
+        }
+    }
+}
+
+void TemplateCache::preload() {
+    for (size_t p = 0; p < _pathCount; p++) {
+        File file = _fs.open(_paths[p]);
+        if (!file) {
+            continue;
+        }
+        if (!file.isDirectory()) {
+            file.close();
+            load(_paths[p]);
+            continue;
+        }
+
+        File child = file.openNextFile();
+        while (child) {
+            if (!child.isDirectory()) {
+                String path = child.path();
+                child.close();
+                load(path.c_str());
+            }
+            child = file.openNextFile();
+        }
+        file.close();
+    }
+    DLOG_I(logCache, "✓ %u files, %u bytes in PSRAM", (unsigned)entryCount(), (unsigned)_bytes);
+}
+
+TemplateCache::Entry* TemplateCache::find(const char* path) {
+    for (size_t i = 0; i < TEMPLATE_CACHE_MAX_ENTRIES; i++) {
+        if (_entries[i].data != nullptr && strcmp(_entries[i].path, path) == 0) {
+            return &_entries[i];
+        }
+    }
+    return nullptr;
+}
+
+TemplateCache::Entry* TemplateCache::load(const char* path) {
+    if (strlen(path) >= sizeof(_entries[0].path)) {
+        return nullptr;
+    }
+    invalidate(path);
+
+    File file = _fs.open(path, "r");
+    if (!file || file.isDirectory()) {
+        return nullptr;
+    }
+    size_t length = file.size();
+    if (!makeRoom(length)) {
+        return nullptr;
+    }
+
+    char* data = static_cast<char*>(_usePsram ? ps_malloc(length + 1) : malloc(length + 1));
+    if (data == nullptr) {
+        DLOG_W(logCache, "No memory for %s (%u bytes)", path, (unsigned)length);
+        return nullptr;
+    }
+    if (file.read(reinterpret_cast<uint8_t*>(data), length) != length) {
+        free(data);
+        return nullptr;
+    }
+    data[length] = '\0';
+    file.close();
+
+    for (size_t i = 0; i < TEMPLATE_CACHE_MAX_ENTRIES; i++) {
+        Entry& entry = _entries[i];
+        if (entry.data == nullptr) {
+            strcpy(entry.path, path);
+            entry.data = data;
+            entry.length = length;
+            entry.lastUsed = ++_useCounter;
+            _bytes += length;
+            return &entry;
+        }
+    }
+    free(data); // Unreachable: makeRoom() guarantees a free slot
+    return nullptr;
+}
+
+void TemplateCache::release(Entry& entry) {
+    _bytes -= entry.length;
+    free(entry.data);
+    entry.data = nullptr;
+    entry.path[0] = '\0';
+    entry.length = 0;
+}
+
+// Evict least recently used entries until there is a free slot and (without
+// PSRAM) the new file fits the budget. Fails only if no slot can be freed.
+bool TemplateCache::makeRoom(size_t length) {
+    while (true) {
+        bool slotFree = false;
+        Entry* oldest = nullptr;
+        for (size_t i = 0; i < TEMPLATE_CACHE_MAX_ENTRIES; i++) {
+            Entry& entry = _entries[i];
+            if (entry.data == nullptr) {
+                slotFree = true;
+            } else if (oldest == nullptr || (int32_t)(entry.lastUsed - oldest->lastUsed) < 0) {
+                oldest = &entry;
+            }
+        }
+
+        bool overBudget = !_usePsram && _bytes + length > _ramBudget;
+        if (slotFree && !overBudget) {
+            return true;
+        }
+        if (oldest == nullptr) {
+            return slotFree; // Nothing left to evict: an oversized file is still served
+        }
+        release(*oldest);
+        _evictions++;
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef TEMPLATE_CACHE_H
+#define TEMPLATE_CACHE_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SequenceRing.h>
+
+#ifndef TEMPLATE_CACHE_MAX_ENTRIES
+#define TEMPLATE_CACHE_MAX_ENTRIES 16
+#endif
+
+// Internal RAM the LRU may hold on boards without PSRAM
+#ifndef TEMPLATE_CACHE_RAM_BUDGET
+#define TEMPLATE_CACHE_RAM_BUDGET (24 * 1024)
+#endif
+
+// One {{NAME}} substitution
+struct TemplateVar {
+    const char* name; // Without the braces
+    String value;
+};
+
+// Keeps HTML templates in memory so requests do not touch the filesystem.
+//
+// With PSRAM every registered template is read into PSRAM by begin() and
+// reload() and stays there. Without PSRAM templates are loaded on first use
+// into internal RAM, and the least recently used ones are dropped to stay
+// within the RAM budget (a single template larger than the budget is still
+// served; it just evicts everything else).
+//
+// get() hands out a pointer into the cache instead of a copy; render()
+// streams a template with its placeholders substituted, so a page is never
+// assembled in one String.
+//
+// Not thread-safe: use from one task (the Arduino loop on this device).
+class TemplateCache {
+public:
+    explicit TemplateCache(fs::FS& fs, size_t ramBudget = TEMPLATE_CACHE_RAM_BUDGET);
+
+    // Register a template file, or a directory whose files are all templates
+    void addPath(const char* path);
+
+    // Choose PSRAM or the LRU and preload (PSRAM only)
+    void begin();
+
+    // Drop all cached contents and preload again, e.g. after templates were downloaded
+    void reload();
+
+    // Forget one file (re-read on next use), e.g. after it was overwritten
+    void invalidate(const char* path);
+
+    // Contents (NUL-terminated) and length, or nullptr if the file does not
+    // exist. In LRU mode the pointer is valid until the next get()/reload().
+    const char* get(const char* path, size_t& length);
+
+    // Stream text with every known {{NAME}} replaced (unknown placeholders are
+    // left as they are). Returns the rendered length; pass write = nullptr to
+    // only measure it.
+    static size_t render(const char* text, size_t length, const TemplateVar* vars, size_t count,
+                         ChunkWriter write, void* context);
+
+    bool usesPsram() const { return _usePsram; }
+    size_t entryCount() const;
+    size_t bytesCached() const { return _bytes; }
+    uint32_t getHits() const { return _hits; }
+    uint32_t getMisses() const { return _misses; }
+    uint32_t getEvictions() const { return _evictions; }
+
+private:
+    struct Entry {
+        char path[48];
+        char* data; // nullptr = not loaded
+        size_t length;
+        uint32_t lastUsed;
+    };
+
+    fs::FS& _fs;
+    size_t _ramBudget;
+    bool _usePsram;
+    const char* _paths[TEMPLATE_CACHE_MAX_ENTRIES];
+    size_t _pathCount;
+    Entry _entries[TEMPLATE_CACHE_MAX_ENTRIES];
+    size_t _bytes;
+    uint32_t _useCounter;
+    uint32_t _hits;
+    uint32_t _misses;
+    uint32_t _evictions;
+
+    void clear();
+    void preload();
+    Entry* find(const char* path);
+    Entry* load(const char* path);
+    void release(Entry& entry);
+    bool makeRoom(size_t length);
+};
+
+#endif
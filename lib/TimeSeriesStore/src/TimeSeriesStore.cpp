@@ -0,0 +1,475 @@
+#include "TimeSeriesStore.h"
+#include <DeviceLog.h>
+#include <esp_system.h>
+
+static LogModule logHistory("timeseries");
+
+TimeSeriesStore* TimeSeriesStore::_shutdownInstance = nullptr;
+
+// 10 s -> 1 min -> 15 min buckets; segments hold 1 h, 1 day and 1 week
+static const uint32_t TIER_BUCKET_SECONDS[TimeSeriesStore::TIER_COUNT] = {10, 60, 900};
+static const uint32_t TIER_SEGMENT_SECONDS[TimeSeriesStore::TIER_COUNT] = {3600, 86400, 604800};
+
+static const size_t READ_CHUNK_RECORDS = 16;
+
+// Output bucket of a running query
+struct QueryState {
+    uint8_t metric;
+    uint32_t from;
+    uint32_t to;
+    uint32_t step;
+    TimeSeriesStore::PointCallback callback;
+    void* context;
+    TimeSeriesStore::Point point;
+    double sum;
+    size_t delivered;
+    bool stopped;
+    bool done;
+};
+
+static void deliverPoint(QueryState& state) {
+    if (state.point.count == 0 || state.stopped) {
+        return;
+    }
+    state.point.mean = (float)(state.sum / state.point.count);
+    if (!state.callback(state.point, state.context)) {
+        state.stopped = true;
+    }
+    state.delivered++;
+    state.point.count = 0;
+}
+
+static void consumeRecord(QueryState& state, const TimeSeriesRecord& record) {
+    if (record.time > state.to) {
+        state.done = true;
+        return;
+    }
+    if (record.metric != state.metric || record.time < state.from || record.count == 0) {
+        return;
+    }
+
+    uint32_t bucket = record.time - record.time % state.step;
+    if (state.point.count > 0 && state.point.time != bucket) {
+        deliverPoint(state);
+    }
+    if (state.point.count == 0) {
+        state.point.time = bucket;
+        state.point.min = record.min;
+        state.point.max = record.max;
+        state.sum = 0.0;
+    }
+    state.point.count += record.count;
+    state.sum += (double)record.mean * record.count;
+    if (record.min < state.point.min) state.point.min = record.min;
+    if (record.max > state.point.max) state.point.max = record.max;
+}
+
+// Directory entries are returned as a bare name or a full path depending on the core version
+static uint32_t parseSegmentName(const char* name, bool& isSegment) {
+    const char* slash = strrchr(name, '/');
+    const char* base = slash ? slash + 1 : name;
+    const char* dot = strrchr(base, '.');
+    isSegment = dot != nullptr && strcmp(dot, ".seg") == 0 && dot != base;
+    return isSegment ? (uint32_t)strtoul(base, nullptr, 10) : 0;
+}
+
+TimeSeriesStore::TimeSeriesStore(fs::FS& fs, const char* root, size_t maxBytes)
+    : _fs(fs),
+      _maxBytes(maxBytes),
+      _ready(false),
+      _pendingCount(0),
+      _droppedSegments(0),
+      _recordsWritten(0) {
+    strncpy(_root, root, sizeof(_root) - 1);
+    _root[sizeof(_root) - 1] = '\0';
+    memset(_accumulators, 0, sizeof(_accumulators));
+    memset(_clock, 0, sizeof(_clock));
+}
+
+TimeSeriesStore::~TimeSeriesStore() {
+    if (_shutdownInstance == this) {
+        esp_unregister_shutdown_handler(onShutdown);
+        _shutdownInstance = nullptr;
+    }
+}
+
+bool TimeSeriesStore::begin() {
+    if (!_fs.exists(_root) && !_fs.mkdir(_root)) {
+        DLOG_E(logHistory, "Cannot create %s", _root);
+        return false;
+    }
+
+    char path[32];
+    for (uint8_t tier = 0; tier < TIER_COUNT; tier++) {
+        tierPath(path, sizeof(path), tier);
+        if (!_fs.exists(path) && !_fs.mkdir(path)) {
+            DLOG_E(logHistory, "Cannot create %s", path);
+            return false;
+        }
+    }
+
+    _ready = true;
+    enforceCap();
+
+    if (_shutdownInstance == nullptr) {
+        _shutdownInstance = this;
+        esp_register_shutdown_handler(onShutdown);
+    }
+    return true;
+}
+
+uint32_t TimeSeriesStore::bucketSeconds(uint8_t tier) {
+    return TIER_BUCKET_SECONDS[tier < TIER_COUNT ? tier : TIER_COUNT - 1];
+}
+
+uint32_t TimeSeriesStore::segmentSeconds(uint8_t tier) {
+    return TIER_SEGMENT_SECONDS[tier < TIER_COUNT ? tier : TIER_COUNT - 1];
+}
+
+void TimeSeriesStore::add(uint8_t metric, uint32_t time, float value) {
+    if (!_ready || metric >= TS_STORE_MAX_METRICS || isnan(value)) {
+        return;
+    }
+    accumulate(0, metric, time - time % bucketSeconds(0), 1, value, value, value);
+}
+
+void TimeSeriesStore::accumulate(uint8_t tier, uint8_t metric, uint32_t start, uint32_t count,
+                                 double sum, float min, float max) {
+    // Records of a tier must stay in time order for the index; late data is dropped
+    if (start < _clock[tier]) {
+        return;
+    }
+
+    // A newer bucket closes every older open bucket of the tier, for all metrics
+    if (start > _clock[tier]) {
+        _clock[tier] = start;
+        for (uint8_t i = 0; i < TS_STORE_MAX_METRICS; i++) {
+            Accumulator& open = _accumulators[tier][i];
+            if (open.count > 0 && open.start < start) {
+                Accumulator closed = open;
+                open.count = 0;
+                emit(tier, i, closed);
+            }
+        }
+    }
+
+    Accumulator& bucket = _accumulators[tier][metric];
+    if (bucket.count == 0) {
+        bucket.start = start;
+        bucket.sum = 0.0;
+        bucket.min = min;
+        bucket.max = max;
+    }
+    bucket.count += count;
+    bucket.sum += sum;
+    if (min < bucket.min) bucket.min = min;
+    if (max > bucket.max) bucket.max = max;
+}
+
+void TimeSeriesStore::emit(uint8_t tier, uint8_t metric, const Accumulator& bucket) {
+    TimeSeriesRecord record;
+    record.time = bucket.start;
+    record.metric = metric;
+    record.tier = tier;
+    record.count = bucket.count > 0xFFFF ? 0xFFFF : (uint16_t)bucket.count;
+    record.mean = (float)(bucket.sum / bucket.count);
+    record.min = bucket.min;
+    record.max = bucket.max;
+
+    _pending[_pendingCount++] = record;
+    if (_pendingCount == TS_STORE_WRITE_BUFFER) {
+        flush();
+    }
+
+    // Downsample into the next tier
+    if (tier + 1 < TIER_COUNT) {
+        uint32_t coarse = bucket.start - bucket.start % bucketSeconds(tier + 1);
+        accumulate(tier + 1, metric, coarse, bucket.count, bucket.sum, bucket.min, bucket.max);
+    }
+}
+
+void TimeSeriesStore::onShutdown() {
+    if (_shutdownInstance != nullptr) {
+        _shutdownInstance->flush();
+    }
+}
+
+bool TimeSeriesStore::flush() {
+    if (!_ready || _pendingCount == 0) {
+        return true;
+    }
+
+    bool ok = true;
+    bool newSegment = false;
+    char path[40];
+
+    for (uint8_t tier = 0; tier < TIER_COUNT; tier++) {
+        File segment;
+        File index;
+        uint32_t openStart = 0;
+
+        for (size_t i = 0; i < _pendingCount; i++) {
+            const TimeSeriesRecord& record = _pending[i];
+            if (record.tier != tier) {
+                continue;
+            }
+
+            uint32_t start = record.time - record.time % segmentSeconds(tier);
+            if (!segment || start != openStart) {
+                segment.close();
+                index.close();
+                segmentPath(path, sizeof(path), tier, start, ".seg");
+                segment = _fs.open(path, FILE_APPEND);
+                segmentPath(path, sizeof(path), tier, start, ".idx");
+                index = _fs.open(path, FILE_APPEND);
+                openStart = start;
+                if (!segment || !index) {
+                    ok = false;
+                    break;
+                }
+                newSegment = newSegment || segment.size() == 0;
+            }
+
+            if (!appendRecord(segment, index, record)) {
+                ok = false;
+                break;
+            }
+        }
+
+        segment.close();
+        index.close();
+    }
+
+    // Records that could not be written are dropped rather than retried forever
+    _pendingCount = 0;
+    if (!ok) {
+        DLOG_W(logHistory, "Write failed, records dropped");
+    }
+    if (newSegment || !ok) {
+        enforceCap();
+    }
+    return ok;
+}
+
+bool TimeSeriesStore::appendRecord(File& segment, File& index, const TimeSeriesRecord& record) {
+    uint32_t offset = segment.size();
+    if ((offset / sizeof(TimeSeriesRecord)) % INDEX_STRIDE == 0) {
+        IndexEntry entry = {record.time, offset};
+        if (index.write((const uint8_t*)&entry, sizeof(entry)) != sizeof(entry)) {
+            return false;
+        }
+    }
+    if (segment.write((const uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+        return false;
+    }
+    _recordsWritten++;
+    return true;
+}
+
+uint32_t TimeSeriesStore::resolutionFor(uint32_t from, uint32_t step) {
+    uint8_t tier = 0;
+    while (tier + 1 < TIER_COUNT && bucketSeconds(tier + 1) <= step) {
+        tier++;
+    }
+
+    // Fall back to coarser tiers when this one no longer reaches back to from
+    while (tier + 1 < TIER_COUNT) {
+        uint32_t oldest = oldestTime(tier);
+        if (oldest <= from || oldestTime(tier + 1) >= oldest) {
+            break;
+        }
+        tier++;
+    }
+    return bucketSeconds(tier);
+}
+
+size_t TimeSeriesStore::query(uint8_t metric, uint32_t from, uint32_t to, uint32_t step,
+                              PointCallback callback, void* context) {
+    if (!_ready || callback == nullptr || from > to) {
+        return 0;
+    }
+
+    uint32_t resolution = resolutionFor(from, step);
+    uint8_t tier = 0;
+    while (bucketSeconds(tier) != resolution) {
+        tier++;
+    }
+
+    QueryState state;
+    state.metric = metric;
+    state.from = from;
+    state.to = to;
+    state.step = step > resolution ? step : resolution;
+    state.callback = callback;
+    state.context = context;
+    state.point.count = 0;
+    state.sum = 0.0;
+    state.delivered = 0;
+    state.stopped = false;
+    state.done = false;
+
+    uint32_t starts[TS_STORE_MAX_SEGMENTS];
+    size_t segmentCount = listSegments(tier, starts, TS_STORE_MAX_SEGMENTS);
+    char path[40];
+
+    for (size_t s = 0; s < segmentCount && !state.done && !state.stopped; s++) {
+        if (starts[s] + segmentSeconds(tier) <= from) {
+            continue;
+        }
+        if (starts[s] > to) {
+            break;
+        }
+
+        segmentPath(path, sizeof(path), tier, starts[s], ".seg");
+        File segment = _fs.open(path, FILE_READ);
+        if (!segment) {
+            continue;
+        }
+        segment.seek(findOffset(tier, starts[s], from));
+
+        TimeSeriesRecord records[READ_CHUNK_RECORDS];
+        while (!state.done && !state.stopped) {
+            size_t count = segment.read((uint8_t*)records, sizeof(records)) / sizeof(TimeSeriesRecord);
+            if (count == 0) {
+                break;
+            }
+            for (size_t i = 0; i < count && !state.done; i++) {
+                consumeRecord(state, records[i]);
+            }
+        }
+        segment.close();
+    }
+
+    // Closed buckets not yet flushed are newer than anything on flash
+    for (size_t i = 0; i < _pendingCount && !state.done && !state.stopped; i++) {
+        if (_pending[i].tier == tier) {
+            consumeRecord(state, _pending[i]);
+        }
+    }
+
+    deliverPoint(state);
+    return state.delivered;
+}
+
+// Offset of the last indexed record before from; the scan starts there
+uint32_t TimeSeriesStore::findOffset(uint8_t tier, uint32_t segmentStart, uint32_t from) {
+    char path[40];
+    segmentPath(path, sizeof(path), tier, segmentStart, ".idx");
+    File index = _fs.open(path, FILE_READ);
+    if (!index) {
+        return 0;
+    }
+
+    uint32_t offset = 0;
+    IndexEntry entry;
+    while (index.read((uint8_t*)&entry, sizeof(entry)) == sizeof(entry)) {
+        if (entry.time >= from) {
+            break; // Records with this time may precede the entry
+        }
+        offset = entry.offset;
+    }
+    index.close();
+    return offset;
+}
+
+size_t TimeSeriesStore::totalBytes() {
+    size_t total = 0;
+    char path[32];
+    for (uint8_t tier = 0; tier < TIER_COUNT; tier++) {
+        tierPath(path, sizeof(path), tier);
+        File dir = _fs.open(path);
+        if (!dir || !dir.isDirectory()) {
+            continue;
+        }
+        File file = dir.openNextFile();
+        while (file) {
+            total += file.size();
+            file = dir.openNextFile();
+        }
+        dir.close();
+    }
+    return total;
+}
+
+// Deletes the oldest segment of the finest tier that has more than one, so
+// the segment being written is never removed and coarse history lasts longest
+void TimeSeriesStore::enforceCap() {
+    size_t total = totalBytes();
+    char path[40];
+    uint32_t starts[2];
+
+    while (total > _maxBytes) {
+        uint8_t tier = 0;
+        while (tier < TIER_COUNT && listSegments(tier, starts, 2) < 2) {
+            tier++;
+        }
+        if (tier == TIER_COUNT) {
+            break;
+        }
+
+        size_t freed = 0;
+        const char* extensions[] = {".seg", ".idx"};
+        for (size_t e = 0; e < 2; e++) {
+            segmentPath(path, sizeof(path), tier, starts[0], extensions[e]);
+            File file = _fs.open(path, FILE_READ);
+            if (file) {
+                freed += file.size();
+                file.close();
+            }
+            _fs.remove(path);
+        }
+
+        _droppedSegments++;
+        total = freed < total ? total - freed : 0;
+    }
+}
+
+// Segment start times of a tier in ascending order (the oldest maxCount)
+size_t TimeSeriesStore::listSegments(uint8_t tier, uint32_t* starts, size_t maxCount) {
+    char path[32];
+    tierPath(path, sizeof(path), tier);
+    File dir = _fs.open(path);
+    if (!dir || !dir.isDirectory()) {
+        return 0;
+    }
+
+    size_t count = 0;
+    File file = dir.openNextFile();
+    while (file) {
+        bool isSegment;
+        uint32_t start = parseSegmentName(file.name(), isSegment);
+        file = dir.openNextFile();
+        if (!isSegment || (count == maxCount && start >= starts[count - 1])) {
+            continue;
+        }
+
+        // Insertion sort, keeping the oldest maxCount
+        size_t position = count < maxCount ? count++ : count - 1;
+        while (position > 0 && starts[position - 1] > start) {
+            starts[position] = starts[position - 1];
+            position--;
+        }
+        starts[position] = start;
+    }
+    dir.close();
+    return count;
+}
+
+uint32_t TimeSeriesStore::oldestTime(uint8_t tier) {
+    uint32_t starts[1];
+    uint32_t oldest = listSegments(tier, starts, 1) > 0 ? starts[0] : UINT32_MAX;
+    for (size_t i = 0; i < _pendingCount; i++) {
+        if (_pending[i].tier == tier && _pending[i].time < oldest) {
+            oldest = _pending[i].time;
+        }
+    }
+    return oldest;
+}
+
+void TimeSeriesStore::tierPath(char* buffer, size_t size, uint8_t tier) {
+    snprintf(buffer, size, "%s/%u", _root, (unsigned)tier);
+}
+
+void TimeSeriesStore::segmentPath(char* buffer, size_t size, uint8_t tier, uint32_t start, const char* extension) {
+    snprintf(buffer, size, "%s/%u/%lu%s", _root, (unsigned)tier, (unsigned long)start, extension);
+}
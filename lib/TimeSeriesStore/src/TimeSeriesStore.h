@@ -0,0 +1,139 @@
+#ifndef TIME_SERIES_STORE_H
+#define TIME_SERIES_STORE_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+#ifndef TS_STORE_MAX_METRICS
+#define TS_STORE_MAX_METRICS 8
+#endif
+
+// Total bytes of segment and index files before the oldest data is dropped
+#ifndef TS_STORE_MAX_BYTES
+#define TS_STORE_MAX_BYTES (256 * 1024)
+#endif
+
+// Records held in RAM between flushes to flash
+#ifndef TS_STORE_WRITE_BUFFER
+#define TS_STORE_WRITE_BUFFER 32
+#endif
+
+// Segments considered per tier by queries and retention
+#ifndef TS_STORE_MAX_SEGMENTS
+#define TS_STORE_MAX_SEGMENTS 64
+#endif
+
+// One aggregated bucket as stored on flash (20 bytes, little-endian)
+struct TimeSeriesRecord {
+    uint32_t time;   // Bucket start, seconds since the epoch
+    uint8_t metric;
+    uint8_t tier;
+    uint16_t count;  // Samples aggregated into the bucket
+    float mean;
+    float min;
+    float max;
+};
+
+// Append-only time-series store on any fs::FS (LittleFS on the device).
+//
+// Samples are aggregated into 10 s buckets; every closed bucket is also
+// folded into 1 min and 15 min buckets, so each resolution tier is written
+// as the data arrives and old fine-grained segments can simply be deleted.
+// Each tier writes fixed-width records to rolling segment files
+//   <root>/<tier>/<segment start>.seg
+// next to a sparse index (<segment start>.idx) holding the time and offset of
+// every INDEX_STRIDE-th record, so range queries seek instead of scanning.
+// When the files exceed the storage cap, the oldest segment of the finest
+// tier with more than one segment is removed first, so coarse history is
+// kept longest.
+//
+// Not thread-safe: use from one task (the Arduino loop on this device).
+class TimeSeriesStore {
+public:
+    static const uint8_t TIER_COUNT = 3;
+    static const uint16_t INDEX_STRIDE = 64;
+
+    struct Point {
+        uint32_t time;
+        uint32_t count;
+        float mean;
+        float min;
+        float max;
+    };
+
+    // Return false to stop the query
+    typedef bool (*PointCallback)(const Point& point, void* context);
+
+    TimeSeriesStore(fs::FS& fs, const char* root = "/ts", size_t maxBytes = TS_STORE_MAX_BYTES);
+    ~TimeSeriesStore();
+
+    // The first store to begin() also flushes from a shutdown handler, so
+    // buffered records survive esp_restart()
+    bool begin();
+
+    // Add one sample; time is seconds since the epoch and must not go backwards
+    void add(uint8_t metric, uint32_t time, float value);
+
+    // Write buffered records to flash
+    bool flush();
+
+    // Stream points of one metric in [from, to] at a resolution of at least
+    // step seconds. Uses the coarsest tier not coarser than step that still
+    // covers from. Returns the number of points delivered.
+    size_t query(uint8_t metric, uint32_t from, uint32_t to, uint32_t step,
+                 PointCallback callback, void* context);
+
+    // Bucket length of the tier a query with this step would use
+    uint32_t resolutionFor(uint32_t from, uint32_t step);
+
+    static uint32_t bucketSeconds(uint8_t tier);
+    static uint32_t segmentSeconds(uint8_t tier);
+
+    size_t totalBytes();
+    uint32_t getDroppedSegments() const { return _droppedSegments; }
+    uint32_t getRecordsWritten() const { return _recordsWritten; }
+
+private:
+    struct Accumulator {
+        uint32_t start;
+        uint32_t count;
+        double sum;
+        float min;
+        float max;
+    };
+
+    struct IndexEntry {
+        uint32_t time;
+        uint32_t offset;
+    };
+
+    fs::FS& _fs;
+    char _root[16];
+    size_t _maxBytes;
+    bool _ready;
+
+    Accumulator _accumulators[TIER_COUNT][TS_STORE_MAX_METRICS];
+    uint32_t _clock[TIER_COUNT]; // Newest bucket start seen per tier
+    TimeSeriesRecord _pending[TS_STORE_WRITE_BUFFER];
+    size_t _pendingCount;
+
+    uint32_t _droppedSegments;
+    uint32_t _recordsWritten;
+
+    static TimeSeriesStore* _shutdownInstance;
+    static void onShutdown();
+
+    void accumulate(uint8_t tier, uint8_t metric, uint32_t start, uint32_t count,
+                    double sum, float min, float max);
+    void emit(uint8_t tier, uint8_t metric, const Accumulator& bucket);
+    bool appendRecord(File& segment, File& index, const TimeSeriesRecord& record);
+    void enforceCap();
+
+    size_t listSegments(uint8_t tier, uint32_t* starts, size_t maxCount);
+    uint32_t oldestTime(uint8_t tier);
+    void segmentPath(char* buffer, size_t size, uint8_t tier, uint32_t start, const char* extension);
+    void tierPath(char* buffer, size_t size, uint8_t tier);
+    uint32_t findOffset(uint8_t tier, uint32_t segmentStart, uint32_t from);
+};
+
+#endif
@@ -0,0 +1,304 @@
+#include "WiFiConnection.h"
+#include <DeviceLog.h>
+#include <esp_attr.h>
+#include <esp_netif.h>
+#include <esp_rom_crc.h>
+#include <esp_wifi_types.h>
+#include <lwip/dhcp.h>
+#include <time.h>
+
+static LogModule logWifi("wifi");
+
+static const uint32_t RTC_LINK_MAGIC = 0x574c4e4b; // "WLNK"
+
+// Survives restarts and deep sleep; the CRC tells a saved link from the
+// random contents RTC memory has after power-on
+struct RtcLink {
+    uint32_t magic;
+    WiFiLink link;
+    uint8_t leaseReuses;
+    uint8_t reserved[3];
+    uint32_t crc;
+};
+
+RTC_NOINIT_ATTR static RtcLink rtcLink;
+
+static uint32_t rtcLinkCrc() {
+    return esp_rom_crc32_le(0, reinterpret_cast<const uint8_t*>(&rtcLink), offsetof(RtcLink, crc));
+}
+
+static bool rtcLinkValid() {
+    return rtcLink.magic == RTC_LINK_MAGIC && rtcLink.crc == rtcLinkCrc();
+}
+
+static void saveRtcLink(const WiFiLink& link, uint8_t leaseReuses) {
+    rtcLink.magic = RTC_LINK_MAGIC;
+    rtcLink.link = link;
+    rtcLink.leaseReuses = leaseReuses;
+    memset(rtcLink.reserved, 0, sizeof(rtcLink.reserved));
+    rtcLink.crc = rtcLinkCrc();
+}
+
+static bool sameLink(const WiFiLink& a, const WiFiLink& b) {
+    return a.ssidHash == b.ssidHash && memcmp(a.bssid, b.bssid, sizeof(a.bssid)) == 0 && a.channel == b.channel &&
+           a.ip == b.ip && a.gateway == b.gateway && a.subnet == b.subnet && a.dns == b.dns;
+}
+
+WiFiConnection::WiFiConnection()
+    : _ssid(""),
+      _password(""),
+      _ssidHash(0),
+      _state(WIFI_IDLE),
+      _linkCallback(nullptr),
+      _linkContext(nullptr),
+      _eventsRegistered(false),
+      _lock(portMUX_INITIALIZER_UNLOCKED),
+      _events(0),
+      _disconnectReason(0),
+      _hintValid(false),
+      _hintHasLease(false),
+      _storedValid(false),
+      _leaseReuses(0),
+      _connectStart(0),
+      _attemptStart(0),
+      _retryDelay(WIFI_RETRY_MIN_MS),
+      _usedLease(false),
+      _lastConnectMs(0),
+      _lastConnectFast(false),
+      _fastConnects(0),
+      _scanConnects(0),
+      _fastFailures(0),
+      _disconnects(0) {
+    memset(&_hint, 0, sizeof(_hint));
+    memset(&_stored, 0, sizeof(_stored));
+}
+
+void WiFiConnection::setLinkCallback(LinkCallback callback, void* context) {
+    _linkCallback = callback;
+    _linkContext = context;
+}
+
+void WiFiConnection::begin(const char* ssid, const char* password, const WiFiLink* storedLink) {
+    _ssid = ssid;
+    _password = password;
+    _ssidHash = hashSsid(ssid);
+
+    _storedValid = storedLink != nullptr;
+    if (_storedValid) {
+        _stored = *storedLink;
+    }
+
+    // RTC first: it is the newest and its lease is still fresh
+    if (rtcLinkValid() && rtcLink.link.ssidHash == _ssidHash && rtcLink.link.channel != 0) {
+        _hint = rtcLink.link;
+        _hintValid = true;
+        _hintHasLease = true;
+        _leaseReuses = rtcLink.leaseReuses;
+    } else if (_storedValid && _stored.ssidHash == _ssidHash && _stored.channel != 0) {
+        _hint = _stored;
+        _hintValid = true;
+        _hintHasLease = false;
+    }
+
+    // This class reconnects and persists the link itself; the driver's NVS
+    // copy of the station config would cost a flash write per hint change
+    WiFi.persistent(false);
+    WiFi.setAutoReconnect(false);
+    WiFi.mode(WIFI_STA);
+    if (!_eventsRegistered) {
+        WiFi.onEvent([this](arduino_event_id_t event, arduino_event_info_t info) { onEvent(event, info); });
+        _eventsRegistered = true;
+    }
+
+    uint32_t now = millis();
+    _connectStart = now;
+    startConnect(now);
+}
+
+void WiFiConnection::loop(uint32_t now) {
+    uint8_t reason = 0;
+    uint8_t events = takeEvents(reason);
+
+    // Our own disconnect before a new attempt reports ASSOC_LEAVE; it is not a failure
+    bool failed = (events & EVENT_DISCONNECTED) && reason != WIFI_REASON_ASSOC_LEAVE;
+
+    switch (_state) {
+    case WIFI_FAST_CONNECT:
+        if (events & EVENT_GOT_IP) {
+            connected(now);
+        } else if (failed || now - _attemptStart >= WIFI_FAST_CONNECT_TIMEOUT_MS) {
+            _fastFailures++;
+            DLOG_W(logWifi, "Fast connect failed (reason %u), scanning", failed ? reason : 0);
+            startScan(now);
+        }
+        break;
+
+    case WIFI_SCAN_CONNECT:
+        if (events & EVENT_GOT_IP) {
+            connected(now);
+        } else if (failed || now - _attemptStart >= WIFI_SCAN_CONNECT_TIMEOUT_MS) {
+            DLOG_W(logWifi, "Connect failed (reason %u), retrying in %lu ms", failed ? reason : 0,
+                   (unsigned long)_retryDelay);
+            WiFi.disconnect();
+            _state = WIFI_RETRY_WAIT;
+            _attemptStart = now;
+        }
+        break;
+
+    case WIFI_RETRY_WAIT:
+        if (now - _attemptStart >= _retryDelay) {
+            _retryDelay = _retryDelay * 2 < WIFI_RETRY_MAX_MS ? _retryDelay * 2 : WIFI_RETRY_MAX_MS;
+            startConnect(now);
+        }
+        break;
+
+    case WIFI_CONNECTED:
+        if (events & EVENT_DISCONNECTED) {
+            _disconnects++;
+            DLOG_W(logWifi, "Connection lost (reason %u), reconnecting", reason);
+            _connectStart = now;
+            startConnect(now);
+        }
+        break;
+
+    case WIFI_IDLE:
+        break;
+    }
+}
+
+const char* WiFiConnection::stateName() const {
+    switch (_state) {
+    case WIFI_FAST_CONNECT: return "fast_connect";
+    case WIFI_SCAN_CONNECT: return "scan_connect";
+    case WIFI_CONNECTED: return "connected";
+    case WIFI_RETRY_WAIT: return "retry_wait";
+    default: return "idle";
+    }
+}
+
+// Runs on the WiFi event task
+void WiFiConnection::onEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    if (event == ARDUINO_EVENT_WIFI_STA_GOT_IP) {
+        portENTER_CRITICAL(&_lock);
+        _events |= EVENT_GOT_IP;
+        portEXIT_CRITICAL(&_lock);
+    } else if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+        portENTER_CRITICAL(&_lock);
+        _events |= EVENT_DISCONNECTED;
+        _disconnectReason = info.wifi_sta_disconnected.reason;
+        portEXIT_CRITICAL(&_lock);
+    }
+}
+
+uint8_t WiFiConnection::takeEvents(uint8_t& reason) {
+    portENTER_CRITICAL(&_lock);
+    uint8_t events = _events;
+    reason = _disconnectReason;
+    _events = 0;
+    portEXIT_CRITICAL(&_lock);
+    return events;
+}
+
+void WiFiConnection::startConnect(uint32_t now) {
+    if (_hintValid) {
+        startFast(now);
+    } else {
+        startScan(now);
+    }
+}
+
+void WiFiConnection::startFast(uint32_t now) {
+    _usedLease = _hintHasLease && _leaseReuses < WIFI_LEASE_MAX_REUSES && leaseCurrent(_hint);
+    if (_usedLease) {
+        WiFi.config(IPAddress(_hint.ip), IPAddress(_hint.gateway), IPAddress(_hint.subnet), IPAddress(_hint.dns));
+    } else {
+        WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE); // DHCP
+    }
+    WiFi.begin(_ssid, _password, _hint.channel, _hint.bssid);
+    _state = WIFI_FAST_CONNECT;
+    _attemptStart = now;
+}
+
+void WiFiConnection::startScan(uint32_t now) {
+    // The AP may have moved channel, or the cached address may be taken
+    _usedLease = false;
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    WiFi.begin(_ssid, _password);
+    _state = WIFI_SCAN_CONNECT;
+    _attemptStart = now;
+}
+
+void WiFiConnection::connected(uint32_t now) {
+    _lastConnectFast = _state == WIFI_FAST_CONNECT;
+    _lastConnectMs = now - _connectStart;
+    if (_lastConnectFast) {
+        _fastConnects++;
+    } else {
+        _scanConnects++;
+    }
+    _state = WIFI_CONNECTED;
+    _retryDelay = WIFI_RETRY_MIN_MS;
+    _leaseReuses = _usedLease ? _leaseReuses + 1 : 0;
+
+    WiFiLink link;
+    memset(&link, 0, sizeof(link));
+    link.ssidHash = _ssidHash;
+    memcpy(link.bssid, WiFi.BSSID(), sizeof(link.bssid));
+    link.channel = WiFi.channel();
+    link.ip = WiFi.localIP();
+    link.gateway = WiFi.gatewayIP();
+    link.subnet = WiFi.subnetMask();
+    link.dns = WiFi.dnsIP();
+    if (_usedLease) {
+        // Still the lease DHCP handed out earlier; its clock keeps running
+        link.leaseStart = _hint.leaseStart;
+        link.leaseRenewS = _hint.leaseRenewS;
+    } else {
+        link.leaseStart = (uint32_t)time(nullptr);
+        link.leaseRenewS = leaseRenewSeconds();
+    }
+
+    // Reconnects go to this AP with this address from now on
+    _hint = link;
+    _hintValid = true;
+    _hintHasLease = true;
+    saveRtcLink(link, _leaseReuses);
+
+    if (!_storedValid || !sameLink(link, _stored)) {
+        _stored = link;
+        _storedValid = true;
+        if (_linkCallback != nullptr) {
+            _linkCallback(link, _linkContext);
+        }
+    }
+
+    DLOG_I(logWifi, "✓ Connected in %lu ms (%s%s), IP %s, channel %u", (unsigned long)_lastConnectMs,
+           _lastConnectFast ? "cached BSSID/channel" : "full scan", _usedLease ? ", cached lease" : "",
+           WiFi.localIP().toString().c_str(), link.channel);
+}
+
+bool WiFiConnection::leaseCurrent(const WiFiLink& link) {
+    uint32_t now = (uint32_t)time(nullptr);
+    // A clock that went backwards, or jumped forward when NTP set it, says nothing about the lease
+    return now >= link.leaseStart && now - link.leaseStart < link.leaseRenewS;
+}
+
+// T1 the DHCP server offered for the current lease. Read from lwIP's client
+// state right after GOT_IP; the fields only change on the next DHCP exchange.
+uint32_t WiFiConnection::leaseRenewSeconds() {
+    esp_netif_t* netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    struct netif* lwipNetif = static_cast<struct netif*>(esp_netif_get_netif_impl(netif));
+    struct dhcp* dhcp = lwipNetif != nullptr ? netif_dhcp_data(lwipNetif) : nullptr;
+    if (dhcp == nullptr || dhcp->offered_t1_renew == 0) {
+        return WIFI_LEASE_DEFAULT_RENEW_S;
+    }
+    return dhcp->offered_t1_renew;
+}
+
+uint32_t WiFiConnection::hashSsid(const char* ssid) {
+    uint32_t hash = 2166136261u;
+    while (*ssid) {
+        hash = (hash ^ (uint8_t)*ssid++) * 16777619u;
+    }
+    return hash;
+}
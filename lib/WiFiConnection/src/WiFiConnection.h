@@ -0,0 +1,148 @@
+#ifndef WIFI_CONNECTION_H
+#define WIFI_CONNECTION_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+// Association on a known channel and BSSID normally takes a few hundred ms
+#ifndef WIFI_FAST_CONNECT_TIMEOUT_MS
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 2000
+#endif
+
+#ifndef WIFI_SCAN_CONNECT_TIMEOUT_MS
+#define WIFI_SCAN_CONNECT_TIMEOUT_MS 15000
+#endif
+
+// Wait after a failed full scan, doubling up to the maximum
+#ifndef WIFI_RETRY_MIN_MS
+#define WIFI_RETRY_MIN_MS 1000
+#endif
+#ifndef WIFI_RETRY_MAX_MS
+#define WIFI_RETRY_MAX_MS 30000
+#endif
+
+// Connects in a row that reuse the cached address before one asks DHCP
+// again, so the router's lease is renewed now and then
+#ifndef WIFI_LEASE_MAX_REUSES
+#define WIFI_LEASE_MAX_REUSES 10
+#endif
+
+// Renewal time (T1) assumed when the DHCP client did not report one
+#ifndef WIFI_LEASE_DEFAULT_RENEW_S
+#define WIFI_LEASE_DEFAULT_RENEW_S 1800
+#endif
+
+// Access point and address of the last successful connection. 36 bytes, so
+// it fits a DeviceConfig blob.
+struct WiFiLink {
+    uint32_t ssidHash; // Hints for another network are ignored
+    uint8_t bssid[6];
+    uint8_t channel;   // 0 = no link recorded
+    uint8_t reserved;
+    uint32_t ip;       // DHCP lease (IPAddress as uint32_t)
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+    uint32_t leaseStart;   // time() when DHCP handed out ip
+    uint32_t leaseRenewS;  // Seconds from leaseStart to the lease's T1
+};
+
+// WiFi station connection as a non-blocking state machine driven by WiFi
+// events (loop() does the work; the event handler only records what happened).
+//
+// Each connection first goes straight to the BSSID and channel that worked
+// last time, skipping the scan. If the link is in RTC memory (it survives
+// restarts and deep sleep, not power loss) the cached DHCP lease is reused
+// as a static address as well, skipping DHCP, until the lease reaches T1.
+// The RTC clock keeps counting through restarts and deep sleep; if it was
+// set in between (NTP), the lease counts as expired. A copy kept in NVS by the
+// application supplies BSSID and channel after a power cycle; its lease may
+// have expired, so that connect still uses DHCP. Only if the fast connect
+// fails does the full scan run, and failed scans back off up to
+// WIFI_RETRY_MAX_MS. A lost connection starts a fast reconnect right away.
+//
+// Not thread-safe: use from one task (the Arduino loop on this device).
+class WiFiConnection {
+public:
+    enum State {
+        WIFI_IDLE,
+        WIFI_FAST_CONNECT,
+        WIFI_SCAN_CONNECT,
+        WIFI_CONNECTED,
+        WIFI_RETRY_WAIT
+    };
+
+    // A connection produced a link that differs from the stored one
+    typedef void (*LinkCallback)(const WiFiLink& link, void* context);
+
+    WiFiConnection();
+
+    void setLinkCallback(LinkCallback callback, void* context = nullptr);
+
+    // Start connecting. ssid and password must stay valid; storedLink is the
+    // copy saved from the link callback (nullptr if there is none).
+    void begin(const char* ssid, const char* password, const WiFiLink* storedLink = nullptr);
+
+    // Advance the state machine; call often (every few tens of ms)
+    void loop(uint32_t now);
+
+    bool isConnected() const { return _state == WIFI_CONNECTED; }
+    State state() const { return _state; }
+    const char* stateName() const;
+
+    // Time from losing (or starting) the connection to having an address
+    uint32_t getLastConnectMs() const { return _lastConnectMs; }
+    bool lastConnectWasFast() const { return _lastConnectFast; }
+    uint32_t getFastConnects() const { return _fastConnects; }
+    uint32_t getScanConnects() const { return _scanConnects; }
+    uint32_t getFastFailures() const { return _fastFailures; }
+    uint32_t getDisconnects() const { return _disconnects; }
+
+private:
+    enum EventFlag : uint8_t {
+        EVENT_GOT_IP = 1,
+        EVENT_DISCONNECTED = 2
+    };
+
+    const char* _ssid;
+    const char* _password;
+    uint32_t _ssidHash;
+    State _state;
+    LinkCallback _linkCallback;
+    void* _linkContext;
+    bool _eventsRegistered;
+
+    portMUX_TYPE _lock;
+    uint8_t _events;          // EventFlag bits set by the event handler
+    uint8_t _disconnectReason;
+
+    WiFiLink _hint;           // Where the fast connect goes
+    bool _hintValid;
+    bool _hintHasLease;       // Reuse _hint's address (it came from RTC memory)
+    WiFiLink _stored;         // What the application has saved
+    bool _storedValid;
+    uint8_t _leaseReuses;
+
+    uint32_t _connectStart;   // When the current (re)connect began
+    uint32_t _attemptStart;
+    uint32_t _retryDelay;
+    bool _usedLease;
+    uint32_t _lastConnectMs;
+    bool _lastConnectFast;
+    uint32_t _fastConnects;
+    uint32_t _scanConnects;
+    uint32_t _fastFailures;
+    uint32_t _disconnects;
+
+    void onEvent(arduino_event_id_t event, arduino_event_info_t info);
+    uint8_t takeEvents(uint8_t& reason);
+    void startConnect(uint32_t now);
+    void startFast(uint32_t now);
+    void startScan(uint32_t now);
+    void connected(uint32_t now);
+    static bool leaseCurrent(const WiFiLink& link);
+    static uint32_t leaseRenewSeconds();
+    static uint32_t hashSsid(const char* ssid);
+};
+
+#endif
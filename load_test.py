@@ -0,0 +1,374 @@
+import sys
+import json
+import time
+import random
+import argparse
+import threading
+import http.client
+import urllib.parse
+
+# HTTP load generator for the device web server. Replays a weighted mix of
+# page, API, download and upload requests from a number of concurrent
+# clients, samples the device heap through /metrics while it runs, and
+# reports throughput, p50/p95/p99 latency and error rate per request kind.
+#
+# Usage:
+#   python load_test.py <device-ip> [--concurrency 3] [--duration 60]
+#   python load_test.py esp32-abc.local --mix page=2,api=1 --report before.json
+#   python load_test.py <device-ip> --report after.json --baseline before.json
+#   python load_test.py 127.0.0.1 --port 8080      (the host build, see README)
+#
+# Upload requests write /<name> to LittleFS (wearing the flash), so they are
+# off unless --mix gives them a weight. The exit status is 1 when the error
+# rate exceeds --max-error-rate, so the script can gate a CI job.
+
+REQUESTS = {
+    "page": [("GET", "/"), ("GET", "/debug"), ("GET", "/files")],
+    "api": [
+        ("GET", "/api/v1/sensors"),
+        ("GET", "/api/v1/boot"),
+        ("GET", "/api/v1/files?limit=50"),
+        ("GET", "/api/v1/heap"),
+    ],
+    "download": [("GET", "/download?file={file}")],
+    "upload": [("POST", "/upload")],
+}
+
+DEFAULT_MIX = {"page": 2, "api": 3, "download": 1, "upload": 0}
+
+PERCENTILES = (50, 95, 99)
+
+
+def parse_mix(text):
+    mix = dict.fromkeys(REQUESTS, 0)
+    for item in text.split(","):
+        kind, _, weight = item.partition("=")
+        kind = kind.strip()
+        if kind not in REQUESTS:
+            raise argparse.ArgumentTypeError(f"unknown request kind '{kind}' (use {', '.join(REQUESTS)})")
+        try:
+            mix[kind] = float(weight)
+        except ValueError:
+            raise argparse.ArgumentTypeError(f"bad weight for '{kind}': '{weight}'")
+    if sum(mix.values()) <= 0:
+        raise argparse.ArgumentTypeError("the mix needs at least one positive weight")
+    return mix
+
+
+def percentile(sorted_values, pct):
+    """Nearest-rank percentile of an already sorted list."""
+    if not sorted_values:
+        return None
+    rank = max(1, int(round(pct / 100.0 * len(sorted_values) + 0.5)))
+    return sorted_values[min(rank, len(sorted_values)) - 1]
+
+
+def multipart_body(name, size):
+    boundary = "----esploadtest%08x" % random.getrandbits(32)
+    content = bytes(random.getrandbits(8) for _ in range(size))
+    body = (
+        f"--{boundary}\r\n"
+        f'Content-Disposition: form-data; name="file"; filename="{name}"\r\n'
+        "Content-Type: application/octet-stream\r\n\r\n"
+    ).encode() + content + f"\r\n--{boundary}--\r\n".encode()
+    return body, f"multipart/form-data; boundary={boundary}"
+
+
+class Recorder:
+    """Results of every request, shared by the client threads."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.latencies = {kind: [] for kind in REQUESTS}
+        self.errors = {kind: {} for kind in REQUESTS}
+        self.bytes = {kind: 0 for kind in REQUESTS}
+
+    def add(self, kind, seconds, size, error):
+        with self.lock:
+            if error is None:
+                self.latencies[kind].append(seconds)
+                self.bytes[kind] += size
+            else:
+                self.errors[kind][error] = self.errors[kind].get(error, 0) + 1
+
+
+class HeapSampler(threading.Thread):
+    """Polls /metrics for the free heap; the device's own low-water mark is read too."""
+
+    def __init__(self, host, port, interval, timeout):
+        super().__init__(daemon=True)
+        self.host = host
+        self.port = port
+        self.interval = interval
+        self.timeout = timeout
+        self.stop_event = threading.Event()
+        self.samples = []
+        self.min_free_reported = None
+
+    def read(self):
+        conn = http.client.HTTPConnection(self.host, self.port, timeout=self.timeout)
+        try:
+            conn.request("GET", "/metrics")
+            response = conn.getresponse()
+            text = response.read().decode("utf-8", "replace")
+        finally:
+            conn.close()
+        if response.status != 200:
+            return None, None
+        values = {}
+        for line in text.splitlines():
+            if line.startswith("#"):
+                continue
+            name, _, value = line.rpartition(" ")
+            values[name] = value
+        free = values.get("heap_free_bytes")
+        min_free = values.get("heap_min_free_bytes")
+        return (int(float(free)) if free else None, int(float(min_free)) if min_free else None)
+
+    def run(self):
+        while not self.stop_event.is_set():
+            try:
+                free, min_free = self.read()
+                if free is not None:
+                    self.samples.append(free)
+                if min_free is not None:
+                    self.min_free_reported = min_free
+            except (OSError, http.client.HTTPException):
+                pass
+            self.stop_event.wait(self.interval)
+
+    def stop(self):
+        self.stop_event.set()
+        self.join()
+        # One more read after the load, so the device low-water mark covers the whole run
+        try:
+            free, min_free = self.read()
+            if free is not None:
+                self.samples.append(free)
+            if min_free is not None:
+                self.min_free_reported = min_free
+        except (OSError, http.client.HTTPException):
+            pass
+
+
+def client(args, mix, recorder, deadline, budget, budget_lock, seed):
+    rng = random.Random(seed)
+    kinds = [kind for kind, weight in mix.items() if weight > 0]
+    weights = [mix[kind] for kind in kinds]
+    conn = None
+
+    while time.monotonic() < deadline:
+        if budget is not None:
+            with budget_lock:
+                if budget[0] <= 0:
+                    break
+                budget[0] -= 1
+
+        kind = rng.choices(kinds, weights)[0]
+        method, path = rng.choice(REQUESTS[kind])
+        path = path.format(file=urllib.parse.quote(rng.choice(args.files)))
+        headers = {}
+        body = None
+        if kind == "upload":
+            body, headers["Content-Type"] = multipart_body(args.upload_name, args.upload_size)
+
+        # The device server handles one connection at a time, so a fresh
+        # connection per request (the default) is what browsers mostly cost it
+        if conn is None or not args.keep_alive:
+            conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+        if not args.keep_alive:
+            headers["Connection"] = "close"
+
+        start = time.monotonic()
+        error = None
+        size = 0
+        try:
+            conn.request(method, path, body=body, headers=headers)
+            response = conn.getresponse()
+            size = len(response.read())
+            if response.status >= 400:
+                error = f"http_{response.status}"
+        except TimeoutError:
+            error = "timeout"
+        except (OSError, http.client.HTTPException) as e:
+            error = type(e).__name__
+        elapsed = time.monotonic() - start
+
+        if error is not None or not args.keep_alive:
+            conn.close()
+            conn = None
+        recorder.add(kind, elapsed, size, error)
+
+    if conn is not None:
+        conn.close()
+
+
+def summarize(latencies, errors, byte_count, elapsed):
+    latencies = sorted(latencies)
+    error_count = sum(errors.values())
+    total = len(latencies) + error_count
+    summary = {
+        "requests": total,
+        "ok": len(latencies),
+        "errors": error_count,
+        "error_rate": round(error_count / total, 4) if total else 0.0,
+        "throughput_rps": round(len(latencies) / elapsed, 2) if elapsed > 0 else 0.0,
+        "bytes": byte_count,
+    }
+    for pct in PERCENTILES:
+        value = percentile(latencies, pct)
+        summary[f"p{pct}_ms"] = round(value * 1000, 1) if value is not None else None
+    summary["max_ms"] = round(latencies[-1] * 1000, 1) if latencies else None
+    if errors:
+        summary["error_kinds"] = dict(sorted(errors.items()))
+    return summary
+
+
+def build_report(args, mix, recorder, sampler, elapsed):
+    kinds = {}
+    all_latencies = []
+    all_errors = {}
+    all_bytes = 0
+    for kind in REQUESTS:
+        if mix[kind] <= 0:
+            continue
+        kinds[kind] = summarize(recorder.latencies[kind], recorder.errors[kind], recorder.bytes[kind], elapsed)
+        all_latencies.extend(recorder.latencies[kind])
+        for error, count in recorder.errors[kind].items():
+            all_errors[error] = all_errors.get(error, 0) + count
+        all_bytes += recorder.bytes[kind]
+
+    heap = None
+    if sampler is not None:
+        heap = {
+            "samples": len(sampler.samples),
+            "min_free_sampled": min(sampler.samples) if sampler.samples else None,
+            "max_free_sampled": max(sampler.samples) if sampler.samples else None,
+            "min_free_reported": sampler.min_free_reported,
+        }
+
+    return {
+        "host": args.host,
+        "started": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime(time.time() - elapsed)),
+        "duration_s": round(elapsed, 2),
+        "concurrency": args.concurrency,
+        "keep_alive": args.keep_alive,
+        "mix": {kind: weight for kind, weight in mix.items() if weight > 0},
+        "overall": summarize(all_latencies, all_errors, all_bytes, elapsed),
+        "kinds": kinds,
+        "heap": heap,
+    }
+
+
+def print_report(report, baseline):
+    columns = ["requests", "error_rate", "throughput_rps", "p50_ms", "p95_ms", "p99_ms", "max_ms"]
+    print(f"\n{report['host']}: {report['duration_s']} s, concurrency {report['concurrency']}")
+    print(f"{'kind':<10}" + "".join(f"{c:>16}" for c in columns))
+
+    rows = list(report["kinds"].items()) + [("overall", report["overall"])]
+    for kind, summary in rows:
+        before = None
+        if baseline is not None:
+            before = baseline["overall"] if kind == "overall" else baseline.get("kinds", {}).get(kind)
+        cells = []
+        for column in columns:
+            value = summary.get(column)
+            text = "-" if value is None else str(value)
+            if before is not None and isinstance(value, (int, float)) and isinstance(before.get(column), (int, float)):
+                delta = value - before[column]
+                text += f" ({delta:+.4g})"
+            cells.append(f"{text:>16}")
+        print(f"{kind:<10}" + "".join(cells))
+
+    for kind, summary in report["kinds"].items():
+        for error, count in summary.get("error_kinds", {}).items():
+            print(f"  {kind} {error}: {count}")
+
+    heap = report["heap"]
+    if heap is not None:
+        print(f"heap: lowest free seen {heap['min_free_sampled']} bytes over {heap['samples']} samples, "
+              f"device low-water mark {heap['min_free_reported']} bytes")
+        if baseline is not None and baseline.get("heap") and baseline["heap"].get("min_free_sampled") is not None \
+                and heap["min_free_sampled"] is not None:
+            print(f"      lowest free vs baseline: {heap['min_free_sampled'] - baseline['heap']['min_free_sampled']:+d} bytes")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Load test the device web server")
+    parser.add_argument("host", help="device IP address or mDNS name")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--concurrency", type=int, default=3, help="parallel clients (default 3)")
+    parser.add_argument("--duration", type=float, default=60, help="seconds to run (default 60)")
+    parser.add_argument("--requests", type=int, help="stop after this many requests instead")
+    parser.add_argument("--mix", type=parse_mix, default=DEFAULT_MIX,
+                        help="weights per kind, e.g. page=2,api=3,download=1,upload=0")
+    parser.add_argument("--files", default="/index.html", help="comma-separated files for download requests")
+    parser.add_argument("--upload-name", default="loadtest.bin", help="file name uploads write to")
+    parser.add_argument("--upload-size", type=int, default=4096, help="bytes per upload (default 4096)")
+    parser.add_argument("--keep-alive", action="store_true", help="reuse each client's connection")
+    parser.add_argument("--timeout", type=float, default=10, help="per-request timeout in seconds")
+    parser.add_argument("--heap-interval", type=float, default=2,
+                        help="seconds between /metrics heap samples, 0 to disable (default 2)")
+    parser.add_argument("--seed", type=int, default=1, help="seed for the request sequence")
+    parser.add_argument("--report", help="write the JSON report to this file ('-' for stdout)")
+    parser.add_argument("--baseline", help="earlier JSON report to compare against")
+    parser.add_argument("--max-error-rate", type=float, default=0.01,
+                        help="fail when the overall error rate is above this (default 0.01)")
+    args = parser.parse_args()
+    args.files = [f if f.startswith("/") else "/" + f for f in args.files.split(",") if f]
+
+    baseline = None
+    if args.baseline:
+        with open(args.baseline, "r") as f:
+            baseline = json.load(f)
+
+    mix = args.mix
+    if mix["upload"] > 0:
+        print(f"Note: uploads write /{args.upload_name} ({args.upload_size} bytes) to flash on every request",
+              file=sys.stderr)
+
+    sampler = None
+    if args.heap_interval > 0:
+        sampler = HeapSampler(args.host, args.port, args.heap_interval, args.timeout)
+        sampler.start()
+
+    recorder = Recorder()
+    budget = [args.requests] if args.requests is not None else None
+    budget_lock = threading.Lock()
+    start = time.monotonic()
+    deadline = start + args.duration if args.requests is None else float("inf")
+
+    threads = [
+        threading.Thread(target=client, args=(args, mix, recorder, deadline, budget, budget_lock, args.seed + i),
+                         daemon=True)
+        for i in range(args.concurrency)
+    ]
+    for thread in threads:
+        thread.start()
+    try:
+        for thread in threads:
+            thread.join()
+    except KeyboardInterrupt:
+        print("Interrupted, reporting what has run so far", file=sys.stderr)
+    elapsed = time.monotonic() - start
+
+    if sampler is not None:
+        sampler.stop()
+
+    report = build_report(args, mix, recorder, sampler, elapsed)
+    print_report(report, baseline)
+
+    if args.report == "-":
+        json.dump(report, sys.stdout, indent=2, sort_keys=True)
+        print()
+    elif args.report:
+        with open(args.report, "w") as f:
+            json.dump(report, f, indent=2, sort_keys=True)
+            f.write("\n")
+
+    if report["overall"]["error_rate"] > args.max_error_rate:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
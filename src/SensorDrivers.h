@@ -0,0 +1,79 @@
+#ifndef SENSOR_DRIVERS_H
+#define SENSOR_DRIVERS_H
+
+#include <Arduino.h>
+#include <DHT22Async.h>
+#include <SensorRegistry.h>
+
+// Sensor drivers for SensorRegistry (see SensorSlot for the driver contract)
+
+// ESP32 internal temperature sensor. Not very accurate; mainly for monitoring.
+class CpuTemperatureSensor {
+public:
+    static const uint8_t CHANNEL_COUNT = 1;
+    static const uint32_t MIN_PERIOD_MS = 1000;
+    static const uint32_t READ_COST_US = 100;
+
+    const SensorChannel& channel(uint8_t index) const {
+        static const SensorChannel channels[CHANNEL_COUNT] = {{"cpu_temp", "°C"}};
+        return channels[index];
+    }
+
+    bool begin() { return true; }
+
+    SensorReadStatus read(float* values) {
+        values[0] = temperatureRead();
+        return SENSOR_READ_OK;
+    }
+};
+
+// DHT22 on the RMT receiver; one transaction yields both channels. The task
+// sleeps while the ~5 ms frame is captured.
+class DHT22Sensor {
+public:
+    static const uint8_t CHANNEL_COUNT = 2;
+    static const uint32_t MIN_PERIOD_MS = DHT22Async::MIN_INTERVAL_MS;
+    static const uint32_t READ_COST_US = 8000;
+
+    // Further probes need their own channel names and RMT channel
+    explicit DHT22Sensor(uint8_t pin, const char* temperatureName = "temperature",
+                         const char* humidityName = "humidity",
+                         rmt_channel_t rmtChannel = DHT22_DEFAULT_RMT_CHANNEL)
+        : _dht(pin, rmtChannel), _lastTimestamp(0) {
+        _channels[0].name = temperatureName;
+        _channels[0].unit = "°C";
+        _channels[1].name = humidityName;
+        _channels[1].unit = "%";
+    }
+
+    const SensorChannel& channel(uint8_t index) const { return _channels[index]; }
+
+    bool begin() { return _dht.begin(); }
+
+    SensorReadStatus read(float* values) {
+        DHT22Result result;
+        // Failures are logged by the driver's task
+        if (!_dht.read(result)) {
+            return SENSOR_READ_FAILED;
+        }
+
+        // Inside the sensor's minimum interval the driver hands back its cached result
+        if (result.timestamp == _lastTimestamp) {
+            return SENSOR_READ_NOT_READY;
+        }
+        _lastTimestamp = result.timestamp;
+
+        values[0] = result.temperature;
+        values[1] = result.humidity;
+        return SENSOR_READ_OK;
+    }
+
+    DHT22Async& dht() { return _dht; }
+
+private:
+    DHT22Async _dht;
+    SensorChannel _channels[CHANNEL_COUNT];
+    uint32_t _lastTimestamp;
+};
+
+#endif
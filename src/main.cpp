@@ -3,10 +3,10 @@
  * Features: LED control, MQTT integration, Web interface, OTA updates
  */
 
-#include <DHT.h>
 #include <WiFi.h>
+#include <WiFiConnection.h>
 #include <ArduinoJson.h>
-#include <Preferences.h>
+#include <DeviceConfig.h>
 #include <WebServer.h>
 #include <ESPmDNS.h>
 #include <LittleFS.h>
@@ -15,6 +15,24 @@
 #include <Update.h>
 #include <FS.h>
 #include <HTTPClient.h>
+#include <SensorSampler.h>
+#include <SensorRegistry.h>
+#include <TimeSeriesStore.h>
+#include <EventStream.h>
+#include <FileCatalog.h>
+#include <TemplateCache.h>
+#include <BackgroundJobs.h>
+#include <BootTimeline.h>
+#include <ESPMetrics.h>
+#include <HeapMonitor.h>
+#include <DeviceLog.h>
+#include <SpanTracer.h>
+#include <LoopWatchdog.h>
+#include <DutyCycle.h>
+#include <esp_sleep.h>
+#include <esp_sntp.h>
+#include <time.h>
+#include "SensorDrivers.h"
 
 // --- Configuration Constants ---
 const char* mqtt_user = "steve";
@@ -22,8 +40,8 @@ const char* mqtt_pass = "Doctor*9";
 const int FIRMWARE_VERSION = 928; // v9.14
 const char* GITHUB_REPO = "stevennolte/ESP_Sandbox";
 const unsigned long updateInterval = 5 * 60 * 1000; // 5 minutes
-String wifi_ssid = "SSEI";         // Default SSID, can be updated via web interface
-String wifi_password = "Nd14il!la"; // Default password, can be updated via web interface
+const char* DEFAULT_WIFI_SSID = "SSEI";          // Used until credentials are saved via the web interface
+const char* DEFAULT_WIFI_PASSWORD = "Nd14il!la";
 
 // --- HTTP Constants ---
 const int HTTP_TIMEOUT_SHORT = 15000;  // 15 seconds
@@ -33,7 +51,6 @@ const char* USER_AGENT_CHECKER = "ESP32-Template-Checker";
 
 // --- Hardware Configuration ---
 #define DHT_PIN 4          // DHT22 data pin
-#define DHT_TYPE DHT22     // DHT sensor type
 const int ledPin = 2;         // Built-in LED
 const int ledChannel = 0;     // PWM channel
 const int ledFreq = 5000;     // PWM frequency
@@ -42,42 +59,227 @@ const int ledResolution = 8;  // 8-bit resolution (0-255)
 // --- Network Configuration ---
 String mqtt_server_ip = "192.168.1.12"; // Default fallback IP
 const int mqtt_port = 1883;
-String client_id = "ESP_Default"; // Loaded from preferences
+const char* DEFAULT_CLIENT_ID = "ESP_Default";
 
 // --- Global Variables ---
-int ledBrightness = 128;  // Default brightness (0-255)
+const uint8_t DEFAULT_LED_BRIGHTNESS = 128;  // 0-255
 unsigned long lastUpdateCheck = 0;
-unsigned long lastWiFiCheck = 0;
-const unsigned long wifiCheckInterval = 30 * 1000; // Check WiFi every 30 seconds
+bool networkStarted = false;        // Deferred boot work is queued once WiFi first connects
+bool firstHttpRecorded = false;
+
+// --- Telemetry Configuration ---
+// CBOR frame schema 2: window mean, min and max of each built-in channel in TelemetryMetric
+// order (schema 1, one point sample per metric, is no longer sent). Channels of additional
+// sensors are published on their own topics in either format.
+const uint16_t TELEMETRY_SCHEMA_ENV_WINDOW_V2 = 2;
+const int TELEMETRY_VALUES_PER_METRIC = 3;
+// Schema 3 (low-power profile): one point sample of each built-in channel, timestamped with
+// UTC epoch ms when it was taken (ms since power-on if the clock never synced)
+const uint16_t TELEMETRY_SCHEMA_ENV_BATCH_V3 = 3;
+
+// --- Sensor Channels ---
+// Every registered sensor contributes consecutive SensorSampler channels, each
+// published through its own PublishPolicy. The built-in sensors are registered
+// first, so their channels have fixed indices (order matches TELEMETRY_SCHEMA_ENV_WINDOW_V2).
+enum TelemetryMetric {
+  METRIC_CPU_TEMP,
+  METRIC_DHT_TEMP,
+  METRIC_DHT_HUMIDITY,
+  METRIC_COUNT
+};
+PublishPolicy publishPolicies[SENSOR_SAMPLER_MAX_CHANNELS];
+uint32_t lastPublishedSample = 0; // SensorSampler sequence last run through the publish policies
 
 // --- Timing Constants ---
+const unsigned long SENSOR_SAMPLE_INTERVAL = 1000; // Scheduler round; must not exceed the fastest sensor period
+const size_t SENSOR_STATS_WINDOW = 60;             // Samples per statistics window (1 min CPU, 2 min DHT22)
 const unsigned long LED_PULSE_DURATION = 50;
+const unsigned long LIVE_UPDATE_POLL_INTERVAL = 50;  // Idle slice between web/live-update polls
+const unsigned long LIVE_STATUS_INTERVAL = 1000;     // How often heap/RSSI/connection state is compared
 const unsigned long MAIN_LOOP_DELAY = 1000;
-const unsigned long NETWORK_STABILIZATION_DELAY = 2000;
 const unsigned long REBOOT_DELAY = 3000;
+const unsigned long HEAP_SAMPLE_INTERVAL = 60 * 1000; // Free heap / largest block samples in /api/v1/heap
 
 // --- Network Constants ---
-const int WIFI_MAX_ATTEMPTS = 30;
-const int WIFI_RECONNECT_ATTEMPTS = 20;
-const int WIFI_RETRY_DELAY = 500;
+const char* NTP_SERVER_PRIMARY = "pool.ntp.org";
+const char* NTP_SERVER_SECONDARY = "time.nist.gov";
+const time_t MIN_VALID_EPOCH = 1700000000; // Anything earlier means NTP has not synced yet
+
+// --- History Configuration ---
+const size_t HISTORY_MAX_BYTES = 256 * 1024;    // LittleFS space for /ts segments
+const uint32_t HISTORY_DEFAULT_RANGE = 3600;    // Seconds returned when "from" is omitted
+const size_t HISTORY_CHUNK_SIZE = 1024;         // Response bytes buffered per sendContent()
+const size_t HEAP_CHUNK_SIZE = 1024;            // Same, for /api/v1/heap
+
+// --- File Listing Configuration ---
+const size_t FILE_LIST_DEFAULT_LIMIT = 50;      // Files per page when "limit" is omitted
+const size_t FILE_LIST_MAX_LIMIT = 200;
+const size_t FILE_LIST_CHUNK_SIZE = 1024;       // Response bytes buffered per sendContent()
+const size_t FILE_DOWNLOAD_CHUNK_SIZE = 4096;   // Bytes read from flash per socket write (streamFile uses ~1.4 KB)
+const int FILE_DOWNLOAD_MAX_RANGES = 8;         // Larger multi-range requests get the whole file
+
+// --- Background Job Configuration ---
+const uint32_t BACKGROUND_JOB_STACK = 12 * 1024; // HTTPS (TLS handshake) and JSON parsing run on this task
+
+// --- Low-Power Profile ---
+// Built with -DLOW_POWER_PROFILE the device deep-sleeps between samples instead
+// of running loop(): every wake stores a sample in RTC memory and every
+// LOW_POWER_PUBLISH_EVERY'th wake connects and publishes the batch
+#ifndef LOW_POWER_PERIOD_S
+#define LOW_POWER_PERIOD_S 60
+#endif
+#ifndef LOW_POWER_PUBLISH_EVERY
+#define LOW_POWER_PUBLISH_EVERY 10
+#endif
+const unsigned long LOW_POWER_CONNECT_TIMEOUT = 10000; // WiFi plus MQTT, per session
+const unsigned long LOW_POWER_NTP_TIMEOUT = 2000;      // The RTC clock drifts, so every session re-syncs
+const unsigned long LOW_POWER_FLUSH_DELAY = 100;       // Lets the last frames leave before WiFi goes down
+
+// --- Loop Watchdog ---
+// Sections of loop() that overrun their budget are logged and counted. Built
+// with -DLOOP_WATCHDOG_ESCALATE_MS=<ms>, a section still running that long
+// past its budget is treated as hung and the task watchdog resets the device.
+#ifndef LOOP_WATCHDOG_ESCALATE_MS
+#define LOOP_WATCHDOG_ESCALATE_MS 0
+#endif
+
+// --- Metrics Configuration ---
+const size_t HTTP_MAX_ROUTE_METRICS = 32; // Routes with their own latency series; the rest count as "other"
 
 // --- Object Instances ---
-Preferences preferences;
+DeviceConfig deviceConfig("esp-config"); // Settings live here; NVS is written back in the background
+WiFiConnection wifiConnection;            // Fast (re)connect from the cached BSSID, channel and lease
 WebServer server(80);
-DHT dht(DHT_PIN, DHT_TYPE);
 WiFiClient espClient;
 ESPMQTTManager mqttManager(mqtt_user, mqtt_pass, "192.168.1.12", mqtt_port);
 ESPOTAUpdater otaUpdater(GITHUB_REPO, FIRMWARE_VERSION);
+EventStream liveEvents;
+SensorSlot<CpuTemperatureSensor> cpuSensor("cpu");
+SensorSlot<DHT22Sensor> dhtSensor("dht22", DHT_PIN);
+SensorRegistry sensorRegistry;
+SensorSampler sensorSampler(0, SENSOR_SAMPLE_INTERVAL); // Channel count set once sensors are registered
+TimeSeriesStore history(LittleFS, "/ts", HISTORY_MAX_BYTES);
+FileCatalog fileCatalog(LittleFS);
+TemplateCache templateCache(LittleFS); // PSRAM preload where available, LRU in internal RAM otherwise
+uint32_t lastHistorySample[SENSOR_SAMPLER_MAX_CHANNELS] = {0}; // Reading timestamps already added to the history
+BackgroundJobs backgroundJobs; // Template sync, OTA checks and broker discovery, off the loop task
+HeapMonitor heapMonitor;       // Heap retained per subsystem and fragmentation over time
+BootTimeline bootTimeline;
+LogModule logApp("app");             // Setup, WiFi, OTA callbacks, MQTT commands
+LogModule logWeb("web");             // HTTP handlers
+LogModule logTemplates("templates"); // Template sync from GitHub
+#ifdef LOW_POWER_PROFILE
+RTC_DATA_ATTR DutyCycleState dutyCycleState; // Batch and clock, kept through deep sleep
+DutyCycleController dutyCycle(dutyCycleState, {LOW_POWER_PERIOD_S * 1000UL, LOW_POWER_PUBLISH_EVERY});
+#endif
+
+// --- Watchdog Sections ---
+// What the loop task is doing, with how long it may take (ms). Time in a
+// nested section is charged to that section, not to "loop".
+WatchdogSection loopSection("loop", 1000);
+WatchdogSection httpSection("http", 10000);                  // One handleClient() call, uploads and downloads included
+WatchdogSection wifiSection("wifi", 1000);
+WatchdogSection networkStartSection("network_start", 3000);  // mDNS and queueing the boot jobs
+WatchdogSection mqttConnectSection("mqtt_connect", 5000);    // One broker connection attempt
+WatchdogSection mqttLoopSection("mqtt_loop", 2000);
+WatchdogSection jobsSection("jobs_poll", 2000);              // Completions of finished background jobs
+WatchdogSection otaInstallSection("ota_install", 180000);    // Firmware download and flash; ends in a reboot
+WatchdogSection publishSection("publish", 2000);
+WatchdogSection historySection("history", 2000);             // LittleFS appends
+WatchdogSection configSection("config", 2000);               // NVS write-back
+WatchdogSection liveUpdatesSection("live_updates", 2000);
+WatchdogSection idleSection("idle", MAIN_LOOP_DELAY + 1000); // The polling slices between passes
+
+// --- Heap Tags ---
+// Subsystems that HeapScopes charge heap usage to (added to heapMonitor in this order)
+enum HeapTag {
+  HEAP_TAG_WEB,
+  HEAP_TAG_MQTT,
+  HEAP_TAG_OTA,
+  HEAP_TAG_TEMPLATES,
+  HEAP_TAG_JSON,
+  HEAP_TAG_COUNT
+};
+const char* HEAP_TAG_NAMES[HEAP_TAG_COUNT] = {"web", "mqtt", "ota", "templates", "json"};
+
+// --- Background Jobs ---
+// Each job's run function executes on the worker task and only fills in its
+// result fields; the completion applies them on the loop task.
+enum TemplateSyncMode {
+  TEMPLATE_SYNC_BOOT,   // Download only if templates are missing or the firmware changed
+  TEMPLATE_SYNC_CHECK,  // Download if the repository has a newer commit
+  TEMPLATE_SYNC_FORCE   // Always download
+};
+
+struct TemplateSync {
+  TemplateSyncMode mode;
+  String storedCommit;        // Copied from deviceConfig when the job is queued
+  int storedFirmwareVersion;
+  bool filesWritten;          // Results
+  bool firmwareChanged;
+  String latestCommit;        // Set once every file downloaded
+};
+TemplateSync templateSync;
+String pendingFirmwareUrl;   // Found by the OTA check, installed on the loop task
+String discoveredServerIP;
+
+// Notes each request the server dispatches; never handles one itself
+class RequestProbe : public RequestHandler {
+public:
+  bool seen = false;       // Any request since boot
+  bool dispatched = false; // A request in the current handleClient() call
+  String uri;              // Its path; server.uri() is empty once it is answered
+  bool canHandle(HTTPMethod, String uri) override {
+    seen = true;
+    dispatched = true;
+    this->uri = uri;
+    return false;
+  }
+};
+RequestProbe requestProbe;
+
+// --- Metrics ---
+// Exported at /metrics; MQTT and OTA timings are recorded by their libraries
+const char* HTTP_LATENCY_HELP = "Time to read, handle and answer one HTTP request";
+MetricHistogram httpOtherLatency("http_request_duration_seconds", HTTP_LATENCY_HELP, "route=\"other\"");
+MetricHistogram loopDuration("loop_duration_seconds", "Work done per main loop pass, excluding the LED pulse and idle slice");
+MetricHistogram templateSyncDuration("template_sync_duration_seconds", "Run time of the template sync job", "",
+                                     MetricHistogram::SLOW_BUCKETS_US, MetricHistogram::SLOW_BUCKET_COUNT);
+MetricGauge heapFreeGauge("heap_free_bytes", "Free internal heap");
+MetricGauge heapMinFreeGauge("heap_min_free_bytes", "Lowest free internal heap since boot");
+MetricGauge uptimeGauge("uptime_seconds", "Time since reset");
+MetricGauge wifiRssiGauge("wifi_rssi_dbm", "WiFi signal strength (NaN while disconnected)");
+MetricGauge mqttConnectedGauge("mqtt_connected", "1 while connected to the broker");
+MetricGauge jobsPendingGauge("background_jobs_pending", "Background jobs queued or running");
+MetricGauge heapLargestBlockGauge("heap_largest_free_block_bytes", "Largest free internal heap block");
+MetricGauge heapFragmentationGauge("heap_fragmentation_ratio", "1 - largest free block / free heap");
+MetricGauge heapRetainedGauges[HEAP_TAG_COUNT] = {
+  {"heap_retained_bytes", "Internal heap left allocated by each subsystem's scopes", "tag=\"web\""},
+  {"heap_retained_bytes", "Internal heap left allocated by each subsystem's scopes", "tag=\"mqtt\""},
+  {"heap_retained_bytes", "Internal heap left allocated by each subsystem's scopes", "tag=\"ota\""},
+  {"heap_retained_bytes", "Internal heap left allocated by each subsystem's scopes", "tag=\"templates\""},
+  {"heap_retained_bytes", "Internal heap left allocated by each subsystem's scopes", "tag=\"json\""}
+};
+
+// Latency series of the routes registered through timedRoute()
+struct RouteMetric {
+  const char* path;
+  MetricHistogram* latency;
+};
+RouteMetric routeMetrics[HTTP_MAX_ROUTE_METRICS];
+size_t routeMetricCount = 0;
 
 // --- Function Declarations ---
-float readCPUTemperature();
-float readDHTTemperature();
-float readDHTHumidity();
+void registerSensors();
+String formatReading(const SensorReading& reading, const char* unit);
+String formatWindow(const SensorReading& reading);
 String getBoardType();
 void setup_wifi();
-void checkWiFiConnection();
-String loadHTMLTemplate(const char* filename);
+void onWiFiLinkChanged(const WiFiLink& link, void* context);
+void sendTemplate(const char* path);
+void sendTemplate(const char* path, const TemplateVar* vars, size_t count);
 void handleFileList();
+void handleFilesApi();
 void handleFileDownload();
 void handleFileUpload();
 void handleFileUploadComplete();
@@ -89,50 +291,71 @@ void handleNetworkScan();
 void handleUpdateTemplate();
 void handleUpdateTemplateAction();
 void handleForceTemplateUpdate();
-void checkForTemplateUpdate();
 bool downloadTemplate();
-void forceTemplateUpdate();
-void ensureTemplateExists();
+bool queueTemplateSync(TemplateSyncMode mode);
+void queueUpdateCheck();
+void queueServerDiscovery();
+void startNetworkServices();
+void serveHttp();
 void handleDebug();
+void registerMQTTCommands();
+void loadPublishPolicies();
+void publishSensorReadings(const SensorSnapshot& snapshot, unsigned long currentTime);
+bool publishChannel(uint8_t channel, float value);
+void handleSensorsApi();
+void handleHistoryApi();
+void handleEvents();
+void pushLiveUpdates(unsigned long currentTime);
+void recordHistory(const SensorSnapshot& snapshot);
+void handleBootApi();
+void handleHeapApi();
+void handleLogsApi();
+#ifdef SPAN_TRACING
+void handleTraceApi();
+#endif
+void handleMetrics();
+const char* timedRoute(const char* path);
+#ifdef LOW_POWER_PROFILE
+void runLowPowerWake();
+#endif
 
 // --- Utility Functions ---
 String makeGitHubAPICall(const String& endpoint);
 bool downloadFileFromGitHub(const String& filePath, const String& localPath);
+String fetchLatestCommit();
 void updateStoredCommitHash();
-String loadTemplate(const char* templatePath);
 
 // --- OTA Update Callbacks ---
 void onUpdateAvailable(int currentVersion, int newVersion, const String& downloadUrl) {
-  Serial.printf("*** UPDATE AVAILABLE ***\n");
-  Serial.printf("Current version: %d, New version: %d\n", currentVersion, newVersion);
-  Serial.printf("Download URL: %s\n", downloadUrl.c_str());
+  DLOG_I(logApp, "*** UPDATE AVAILABLE ***");
+  DLOG_I(logApp, "Current version: %d, New version: %d", currentVersion, newVersion);
+  DLOG_I(logApp, "Download URL: %s", downloadUrl.c_str());
   
-  // Automatically start the update process
-  Serial.println("Starting automatic firmware update...");
-  otaUpdater.performUpdate(downloadUrl.c_str());
+  // Called from the update check job; completeUpdateCheck() starts the update on the loop task
+  pendingFirmwareUrl = downloadUrl;
 }
 
 void onUpdateProgress(size_t progress, size_t total) {
-  Serial.printf("OTA Progress: %d/%d bytes (%d%%)\n", progress, total, (progress * 100) / total);
+  DLOG_D(logApp, "OTA Progress: %d/%d bytes (%d%%)", progress, total, (progress * 100) / total);
 }
 
 void onUpdateComplete(bool success, const String& message) {
   if (success) {
-    Serial.println("*** OTA UPDATE SUCCESSFUL ***");
+    DLOG_I(logApp, "*** OTA UPDATE SUCCESSFUL ***");
     
     // Download latest templates after successful firmware update
-    Serial.println("Downloading latest web templates...");
+    DLOG_I(logApp, "Downloading latest web templates...");
     if (downloadTemplate()) {
       updateStoredCommitHash();
-      Serial.println("✓ Templates updated with firmware");
+      DLOG_I(logApp, "✓ Templates updated with firmware");
     } else {
-      Serial.println("⚠ Some templates failed to download - device will attempt to download missing templates on next boot");
+      DLOG_W(logApp, "⚠ Some templates failed to download - device will attempt to download missing templates on next boot");
     }
     
-    Serial.println("Rebooting...");
+    DLOG_I(logApp, "Rebooting...");
   } else {
-    Serial.println("*** OTA UPDATE FAILED ***");
-    Serial.printf("Error: %s\n", message.c_str());
+    DLOG_E(logApp, "*** OTA UPDATE FAILED ***");
+    DLOG_E(logApp, "Error: %s", message.c_str());
   }
 }
 
@@ -145,160 +368,183 @@ String getBoardType() {
 #endif
 }
 
-// --- Temperature Functions ---
-float readCPUTemperature() {
-  // ESP32 internal temperature sensor
-  // Note: This is not very accurate and is mainly for monitoring purposes
-  return temperatureRead();
+// --- Sensor Registration ---
+// Built-in sensors first (their channels are the TelemetryMetric indices), then any
+// additional probes. The registry staggers reads and feeds the sampler task.
+void registerSensors() {
+  sensorRegistry.add(cpuSensor);
+  sensorRegistry.add(dhtSensor);
+  
+  sensorSampler.setChannelCount(sensorRegistry.channelCount());
+  if (sensorRegistry.begin()) {
+    DLOG_I(logApp, "✓ %u sensors, %u channels", sensorRegistry.sensorCount(), sensorRegistry.channelCount());
+  }
 }
 
-float readDHTTemperature() {
-  float temp = dht.readTemperature();
-  if (isnan(temp)) {
-    Serial.println("Failed to read temperature from DHT sensor!");
-    return -999.0; // Return error value
-  }
-  return temp;
+String formatReading(const SensorReading& reading, const char* unit) {
+  return reading.valid ? String(reading.value, 1) + unit : String("Error");
 }
 
-float readDHTHumidity() {
-  float humidity = dht.readHumidity();
-  if (isnan(humidity)) {
-    Serial.println("Failed to read humidity from DHT sensor!");
-    return -999.0; // Return error value
+String formatWindow(const SensorReading& reading) {
+  const WindowSummary& window = reading.window;
+  if (window.count == 0) {
+    return "No samples";
   }
-  return humidity;
+  return "mean " + String(window.mean, 2) + ", min " + String(window.min, 1) + ", max " + String(window.max, 1) +
+         ", σ " + String(sqrtf(window.variance), 2) + " (" + String(window.count) + " samples)";
 }
 
 // --- WiFi Setup ---
+// Start connecting and return; wifiConnection.loop() finishes the job and
+// startNetworkServices() runs from loop() once connected
 void setup_wifi() {
-  Serial.print("Connecting to WiFi");
+  DLOG_I(logApp, "Connecting to WiFi %s in the background", deviceConfig.wifiSsid());
   
-  // Configure WiFi for better reconnection behavior
-  WiFi.mode(WIFI_STA);
-  WiFi.setAutoReconnect(true);
-  WiFi.persistent(true);
+  WiFiLink storedLink;
+  bool haveLink = deviceConfig.getBlob("wifi_link", &storedLink, sizeof(storedLink));
+  wifiConnection.setLinkCallback(onWiFiLinkChanged);
   
-  WiFi.begin(wifi_ssid.c_str(), wifi_password.c_str());
+  bootTimeline.begin("wifi_connect");
+  wifiConnection.begin(deviceConfig.wifiSsid(), deviceConfig.wifiPassword(), haveLink ? &storedLink : nullptr);
+}
+
+// NVS copy of the link, for the first connect after a power cycle
+void onWiFiLinkChanged(const WiFiLink& link, void*) {
+  deviceConfig.setBlob("wifi_link", &link, sizeof(link));
+}
+
+// Everything that needs the network, once per boot after the first connection
+void startNetworkServices() {
+  WatchdogScope watchdogScope(networkStartSection);
+  bootTimeline.end("wifi_connect");
+  DLOG_I(logApp, "WiFi connected!");
+  DLOG_I(logApp, "IP address: %s", WiFi.localIP().toString().c_str());
+  DLOG_I(logApp, "Signal strength: %d dBm", WiFi.RSSI());
+  DLOG_I(logApp, "MAC address: %s", WiFi.macAddress().c_str());
   
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < WIFI_MAX_ATTEMPTS) {
-    delay(WIFI_RETRY_DELAY);
-    Serial.print(".");
-    attempts++;
-  }
+  // Wall clock for history timestamps (UTC); syncs in the background
+  configTime(0, 0, NTP_SERVER_PRIMARY, NTP_SERVER_SECONDARY);
   
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi connected!");
-    Serial.printf("IP address: %s\n", WiFi.localIP().toString().c_str());
-    Serial.printf("Signal strength: %d dBm\n", WiFi.RSSI());
-    Serial.printf("MAC address: %s\n", WiFi.macAddress().c_str());
+  if (!MDNS.begin(deviceConfig.clientId())) {
+    DLOG_E(logApp, "ERROR: mDNS failed to start");
   } else {
-    Serial.println("\nFailed to connect to WiFi!");
+    MDNS.addService("http", "tcp", 80);
+    DLOG_I(logApp, "✓ mDNS: http://%s.local", deviceConfig.clientId());
   }
   
-  delay(NETWORK_STABILIZATION_DELAY);
+  // Templates first (pages may be missing on a fresh device), then the OTA
+  // check; the broker scan is slowest and MQTT already uses the cached address
+  queueTemplateSync(TEMPLATE_SYNC_BOOT);
+  queueUpdateCheck();
+  queueServerDiscovery();
 }
 
-// --- WiFi Connection Monitor ---
-void checkWiFiConnection() {
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi connection lost! Attempting to reconnect...");
-    
-    // Try to reconnect
-    WiFi.disconnect();
-    delay(1000);
-    WiFi.begin(wifi_ssid.c_str(), wifi_password.c_str());
-    
-    int attempts = 0;
-    while (WiFi.status() != WL_CONNECTED && attempts < WIFI_RECONNECT_ATTEMPTS) {
-      delay(WIFI_RETRY_DELAY);
-      Serial.print(".");
-      attempts++;
-    }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-      Serial.println("\n✓ WiFi reconnected!");
-      Serial.printf("IP address: %s\n", WiFi.localIP().toString().c_str());
-      Serial.printf("Signal strength: %d dBm\n", WiFi.RSSI());
-    } else {
-      Serial.println("\n✗ Failed to reconnect to WiFi");
-    }
+// --- Template Rendering ---
+// Small writes (placeholder values, short literals) are combined before they hit the socket
+struct TemplateWriter {
+  char buffer[512];
+  size_t used;
+};
+
+void flushTemplateWriter(TemplateWriter& writer) {
+  if (writer.used > 0) {
+    server.sendContent(writer.buffer, writer.used);
+    writer.used = 0;
   }
 }
 
-// Function to load and process HTML template
-String loadHTMLTemplate(const char* filename) {
-  if (!LittleFS.exists(filename)) {
-    return "<!DOCTYPE html><html><body><h1>Error: Template file not found</h1></body></html>";
+void writeTemplateChunk(const char* data, size_t length, void* context) {
+  TemplateWriter* writer = static_cast<TemplateWriter*>(context);
+  if (writer->used + length > sizeof(writer->buffer)) {
+    flushTemplateWriter(*writer);
   }
-  
-  File file = LittleFS.open(filename, "r");
-  if (!file) {
-    return "<!DOCTYPE html><html><body><h1>Error: Could not open template file</h1></body></html>";
+  if (length >= sizeof(writer->buffer)) {
+    server.sendContent(data, length); // Straight from the cache
+    return;
+  }
+  memcpy(writer->buffer + writer->used, data, length);
+  writer->used += length;
+}
+
+// Serve a cached template. Without substitutions the cached bytes are sent
+// as they are; otherwise the page is rendered while it is sent.
+void sendTemplate(const char* path, const TemplateVar* vars, size_t count) {
+  size_t length;
+  const char* text = templateCache.get(path, length);
+  if (text == nullptr) {
+    DLOG_W(logWeb, "Template not found: %s", path);
+    server.send(500, "text/html", "<!DOCTYPE html><html><body><h1>Error: Template not found</h1><p>Path: " + String(path) + "</p></body></html>");
+    return;
   }
   
-  String html = file.readString();
-  file.close();
-  
-  // Replace placeholders with actual values
-  html.replace("{{CLIENT_ID}}", client_id);
-  html.replace("{{IP_ADDRESS}}", WiFi.localIP().toString());
-  html.replace("{{LED_BRIGHTNESS}}", String(ledBrightness));
-  html.replace("{{MQTT_SERVER}}", mqtt_server_ip);
-  html.replace("{{WIFI_RSSI}}", String(WiFi.RSSI()));
-  html.replace("{{WIFI_STATUS}}", WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected");
-  
-  // Add environmental sensor data
-  float dhtTemp = readDHTTemperature();
-  float dhtHumidity = readDHTHumidity();
-  html.replace("{{DHT_TEMPERATURE}}", dhtTemp != -999.0 ? String(dhtTemp, 1) + "°C" : "Error");
-  html.replace("{{DHT_HUMIDITY}}", dhtHumidity != -999.0 ? String(dhtHumidity, 1) + "%" : "Error");
-  
-  // Add template version info
-  preferences.begin("esp-config", true);
-  String templateCommit = preferences.getString("last_commit", "Unknown");
-  preferences.end();
-  html.replace("{{TEMPLATE_VERSION}}", templateCommit.length() > 7 ? templateCommit.substring(0, 7) : templateCommit);
+  if (count == 0) {
+    server.send_P(200, "text/html", text, length);
+    return;
+  }
   
-  return html;
+  server.setContentLength(TemplateCache::render(text, length, vars, count, nullptr, nullptr));
+  server.send(200, "text/html", "");
+  TemplateWriter writer;
+  writer.used = 0;
+  TemplateCache::render(text, length, vars, count, writeTemplateChunk, &writer);
+  flushTemplateWriter(writer);
+}
+
+void sendTemplate(const char* path) {
+  sendTemplate(path, nullptr, 0);
+}
+
+template <size_t N>
+void sendTemplate(const char* path, const TemplateVar (&vars)[N]) {
+  sendTemplate(path, vars, N);
 }
 
 // --- Web Server Functions ---
 void handleRoot() {
-  String html = loadHTMLTemplate("/index.html");
-  server.send(200, "text/html", html);
+  // Environmental sensor data cached by the sampler task
+  SensorSnapshot sensors;
+  sensorSampler.read(sensors);
+  
+  TemplateVar vars[] = {
+    {"CLIENT_ID", deviceConfig.clientId()},
+    {"IP_ADDRESS", WiFi.localIP().toString()},
+    {"LED_BRIGHTNESS", String(deviceConfig.ledBrightness())},
+    {"MQTT_SERVER", mqtt_server_ip},
+    {"WIFI_RSSI", String(WiFi.RSSI())},
+    {"WIFI_STATUS", WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected"},
+    {"DHT_TEMPERATURE", formatReading(sensors.readings[METRIC_DHT_TEMP], "°C")},
+    {"DHT_HUMIDITY", formatReading(sensors.readings[METRIC_DHT_HUMIDITY], "%")},
+    {"TEMPLATE_VERSION", deviceConfig.lastCommit()[0] ? String(deviceConfig.lastCommit()).substring(0, 7) : String("Unknown")}
+  };
+  sendTemplate("/index.html", vars);
 }
 
 void handleSetClientId() {
   if (server.hasArg("client_id")) {
     String newClientId = server.arg("client_id");
     if (newClientId.length() > 0 && newClientId.length() <= 32) {
-      client_id = newClientId;
-      preferences.begin("esp-config", false);
-      preferences.putString("client_id", client_id);
-      preferences.end();
+      deviceConfig.setClientId(newClientId.c_str());
       
       // Update MQTT topics with new client_id
-      mqttManager.updateTopics(client_id);
+      mqttManager.updateTopics(deviceConfig.clientId());
       
       // Restart mDNS with new hostname
       MDNS.end();
-      if (!MDNS.begin(client_id.c_str())) {
-        Serial.println("Error restarting mDNS with new hostname");
+      if (!MDNS.begin(deviceConfig.clientId())) {
+        DLOG_W(logWeb, "Error restarting mDNS with new hostname");
       } else {
-        Serial.println("mDNS restarted with new hostname: " + client_id);
+        DLOG_I(logWeb, "mDNS restarted with new hostname: %s", deviceConfig.clientId());
         MDNS.addService("http", "tcp", 80);
       }
       
-      String html = loadTemplate("simple_response.html");
-      html.replace("{{TITLE}}", "Updated");
-      html.replace("{{HEADER}}", "Client ID Updated");
-      html.replace("{{MESSAGE}}", "New Client ID: <strong>" + client_id + "</strong>");
-      html.replace("{{EXTRA_CONTENT}}", 
-        "<p>New mDNS address: <strong>http://" + client_id + ".local</strong></p>"
-        "<p>Device will reconnect to MQTT with new ID.</p>");
-      server.send(200, "text/html", html);
+      TemplateVar vars[] = {
+        {"TITLE", "Updated"},
+        {"HEADER", "Client ID Updated"},
+        {"MESSAGE", "New Client ID: <strong>" + newClientId + "</strong>"},
+        {"EXTRA_CONTENT", "<p>New mDNS address: <strong>http://" + newClientId + ".local</strong></p>"
+                          "<p>Device will reconnect to MQTT with new ID.</p>"}
+      };
+      sendTemplate("/templates/simple_response.html", vars);
       
       // Force MQTT reconnection with new client ID
       mqttManager.disconnect();
@@ -314,17 +560,16 @@ void handleBrightness() {
   if (server.hasArg("brightness")) {
     int newBrightness = server.arg("brightness").toInt();
     if (newBrightness >= 0 && newBrightness <= 255) {
-      ledBrightness = newBrightness;
-      preferences.begin("esp-config", false);
-      preferences.putInt("led_brightness", ledBrightness);
-      preferences.end();
+      // Written back once the slider stops moving
+      deviceConfig.setLedBrightness(newBrightness);
       
-      String html = loadTemplate("simple_response.html");
-      html.replace("{{TITLE}}", "Brightness Updated");
-      html.replace("{{HEADER}}", "LED Brightness Updated");
-      html.replace("{{MESSAGE}}", "New Brightness: <strong>" + String(ledBrightness) + "</strong>");
-      html.replace("{{EXTRA_CONTENT}}", "");
-      server.send(200, "text/html", html);
+      TemplateVar vars[] = {
+        {"TITLE", "Brightness Updated"},
+        {"HEADER", "LED Brightness Updated"},
+        {"MESSAGE", "New Brightness: <strong>" + String(newBrightness) + "</strong>"},
+        {"EXTRA_CONTENT", ""}
+      };
+      sendTemplate("/templates/simple_response.html", vars);
     } else {
       server.send(400, "text/plain", "Invalid brightness value. Must be 0-255.");
     }
@@ -340,27 +585,188 @@ void handleReboot() {
 }
 
 // --- File Management Functions ---
+// The page fetches its rows from /api/v1/files
 void handleFileList() {
-  String html = loadTemplate("file_manager.html");
+  sendTemplate("/templates/file_manager.html");
+}
+
+struct FileListStream {
+  String buffer;
+  size_t files;
+  bool withHash;
+};
+
+bool streamFileEntry(const FileCatalog::Entry& entry, void* context) {
+  FileListStream* stream = static_cast<FileListStream*>(context);
   
-  // Build file list
-  String fileList = "";
-  File root = LittleFS.open("/");
-  File file = root.openNextFile();
-  while (file) {
-    String fileName = file.name();
-    fileList += "<tr><td>" + fileName + "</td>";
-    fileList += "<td>" + String(file.size()) + " bytes</td>";
-    fileList += "<td><a href='/download?file=" + fileName + "'>Download</a></td></tr>";
-    file = root.openNextFile();
+  StaticJsonDocument<256> doc;
+  doc["path"] = entry.path;
+  doc["size"] = entry.size;
+  if (entry.modified > 0) {
+    doc["modified"] = (uint32_t)entry.modified;
+  }
+  uint32_t crc;
+  if (stream->withHash && fileCatalog.hash(entry, crc)) {
+    char hex[9];
+    snprintf(hex, sizeof(hex), "%08lx", (unsigned long)crc);
+    doc["crc32"] = hex;
   }
   
-  // Replace placeholder
-  html.replace("{{FILE_LIST}}", fileList);
+  if (stream->files > 0) {
+    stream->buffer += ',';
+  }
+  char json[320];
+  serializeJson(doc, json, sizeof(json));
+  stream->buffer += json;
+  stream->files++;
+  
+  if (stream->buffer.length() >= FILE_LIST_CHUNK_SIZE) {
+    server.sendContent(stream->buffer);
+    stream->buffer = "";
+  }
+  return server.client().connected();
+}
+
+// GET /api/v1/files?path=<dir>&cursor=<n>&limit=<n>&hash=1
+// Files below path (recursively), one page per request; pass next_cursor back
+// until it is null. hash=1 adds a CRC32 of each file (cached until it changes).
+void handleFilesApi() {
+  HeapScope heapScope(heapMonitor, HEAP_TAG_JSON);
+  String root = server.hasArg("path") ? server.arg("path") : String("/");
+  uint32_t cursor = strtoul(server.arg("cursor").c_str(), nullptr, 10);
+  size_t limit = server.hasArg("limit") ? strtoul(server.arg("limit").c_str(), nullptr, 10) : FILE_LIST_DEFAULT_LIMIT;
+  limit = constrain(limit, (size_t)1, FILE_LIST_MAX_LIMIT);
+  
+  File dir = LittleFS.open(root);
+  if (!dir || !dir.isDirectory()) {
+    server.send(404, "application/json", "{\"error\":\"no such directory\"}");
+    return;
+  }
+  dir.close();
+  
+  unsigned long startTime = millis();
+  FileListStream stream;
+  stream.buffer.reserve(FILE_LIST_CHUNK_SIZE + 320);
+  stream.files = 0;
+  stream.withHash = server.arg("hash") == "1";
+  
+  StaticJsonDocument<128> header;
+  header["path"] = root;
+  header["cursor"] = cursor;
+  serializeJson(header, stream.buffer);
+  stream.buffer.remove(stream.buffer.length() - 1); // Reopen the object
+  stream.buffer += ",\"files\":[";
+  
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  uint32_t next = fileCatalog.list(root.c_str(), cursor, limit, streamFileEntry, &stream);
+  stream.buffer += "],\"next_cursor\":";
+  stream.buffer += next > 0 ? String(next) : String("null");
+  stream.buffer += "}";
+  server.sendContent(stream.buffer);
+  server.sendContent(""); // Terminates the chunked response
+  
+  DLOG_I(logWeb, "File listing %s from %u: %u files in %lu ms", root.c_str(), (unsigned)cursor, (unsigned)stream.files, millis() - startTime);
+}
+
+// --- File Downloads ---
+struct ByteRange {
+  size_t start;
+  size_t end; // Inclusive
+};
+
+const char* contentTypeFor(const String& path) {
+  if (path.endsWith(".html") || path.endsWith(".htm")) return "text/html";
+  if (path.endsWith(".css")) return "text/css";
+  if (path.endsWith(".js")) return "application/javascript";
+  if (path.endsWith(".json")) return "application/json";
+  if (path.endsWith(".txt") || path.endsWith(".log") || path.endsWith(".csv")) return "text/plain";
+  if (path.endsWith(".png")) return "image/png";
+  if (path.endsWith(".jpg") || path.endsWith(".jpeg")) return "image/jpeg";
+  if (path.endsWith(".svg")) return "image/svg+xml";
+  if (path.endsWith(".ico")) return "image/x-icon";
+  if (path.endsWith(".gz")) return "application/gzip";
+  return "application/octet-stream";
+}
+
+// Parse "bytes=0-99,200-,-500" against a file of the given size. Returns the
+// number of satisfiable ranges, 0 if the header is to be ignored (malformed or
+// too many ranges; the whole file is sent) or -1 if no range overlaps the file.
+int parseRangeHeader(const String& header, size_t size, ByteRange* ranges, int maxRanges) {
+  if (!header.startsWith("bytes=")) {
+    return 0;
+  }
   
-  server.send(200, "text/html", html);
+  const char* p = header.c_str() + 6;
+  int count = 0;
+  while (true) {
+    while (*p == ' ') p++;
+    bool suffix = *p == '-';
+    const char* digits = suffix ? p + 1 : p;
+    if (!isdigit((unsigned char)*digits)) {
+      return 0;
+    }
+    char* end;
+    unsigned long first = strtoul(digits, &end, 10);
+    unsigned long last = ULONG_MAX;
+    p = end;
+    if (!suffix) {
+      if (*p++ != '-') {
+        return 0;
+      }
+      if (isdigit((unsigned char)*p)) {
+        last = strtoul(p, &end, 10);
+        p = end;
+        if (last < first) {
+          return 0;
+        }
+      }
+    }
+    
+    // "-n" is the last n bytes; an open end runs to the end of the file
+    ByteRange range;
+    bool satisfiable = suffix ? (first > 0 && size > 0) : first < size;
+    range.start = suffix ? (first >= size ? 0 : size - first) : first;
+    range.end = suffix || last >= size ? size - 1 : last;
+    if (satisfiable) {
+      if (count == maxRanges) {
+        return 0;
+      }
+      ranges[count++] = range;
+    }
+    
+    while (*p == ' ') p++;
+    if (*p == '\0') {
+      break;
+    }
+    if (*p++ != ',') {
+      return 0;
+    }
+  }
+  return count > 0 ? count : -1;
 }
 
+// Copy length bytes from start through a static buffer (one download at a time on the loop task)
+bool sendFileRange(WiFiClient& client, File& file, size_t start, size_t length) {
+  static uint8_t buffer[FILE_DOWNLOAD_CHUNK_SIZE];
+  if (!file.seek(start)) {
+    return false;
+  }
+  while (length > 0) {
+    size_t count = file.read(buffer, length < sizeof(buffer) ? length : sizeof(buffer));
+    if (count == 0 || client.write(buffer, count) != count) {
+      return false; // Read error or client gone
+    }
+    length -= count;
+  }
+  return true;
+}
+
+// GET/HEAD /download?file=<path>
+// Strong ETag (CRC32 and size, cached by FileCatalog) and Last-Modified allow
+// conditional requests (304); Range requests get 206 with one range or a
+// multipart/byteranges body, so interrupted downloads can resume. A Range
+// with an If-Range that no longer matches gets the full file (200).
 void handleFileDownload() {
   if (!server.hasArg("file")) {
     server.send(400, "text/plain", "Missing file parameter");
@@ -377,14 +783,127 @@ void handleFileDownload() {
     return;
   }
   
-  File file = LittleFS.open(filename, "r");
-  if (!file) {
+  File file;
+  {
+    TRACE_SCOPE("fs.open");
+    file = LittleFS.open(filename, "r");
+  }
+  if (!file || file.isDirectory()) {
     server.send(500, "text/plain", "Failed to open file");
     return;
   }
   
-  server.streamFile(file, "application/octet-stream");
+  size_t size = file.size();
+  time_t modified = file.getLastWrite();
+  const char* contentType = contentTypeFor(filename);
+  
+  char etag[24] = "";
+  FileCatalog::Entry entry = {filename.c_str(), size, modified};
+  uint32_t crc;
+  if (fileCatalog.hash(entry, crc)) {
+    snprintf(etag, sizeof(etag), "\"%08lx-%x\"", (unsigned long)crc, (unsigned)size);
+  }
+  char lastModified[32] = "";
+  if (modified > 0) {
+    struct tm utc;
+    gmtime_r(&modified, &utc);
+    strftime(lastModified, sizeof(lastModified), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+  }
+  
+  server.sendHeader("Accept-Ranges", "bytes");
+  server.sendHeader("Cache-Control", "no-cache"); // Cache, but revalidate every time
+  if (etag[0]) {
+    server.sendHeader("ETag", etag);
+  }
+  if (lastModified[0]) {
+    server.sendHeader("Last-Modified", lastModified);
+  }
+  
+  // If-None-Match wins over If-Modified-Since; the date is compared as the
+  // exact string we sent, which is what clients echo back
+  String ifNoneMatch = server.header("If-None-Match");
+  bool notModified = ifNoneMatch.length() > 0
+                       ? etag[0] && (ifNoneMatch.indexOf(etag) >= 0 || ifNoneMatch.indexOf('*') >= 0)
+                       : lastModified[0] && server.header("If-Modified-Since") == lastModified;
+  if (notModified) {
+    file.close();
+    server.send(304);
+    return;
+  }
+  
+  // If-Range: resume only if the file is still the one the client has part
+  // of; otherwise the Range is ignored and the whole file is sent
+  String ifRange = server.header("If-Range");
+  bool rangeValid = ifRange.length() == 0 || (etag[0] && ifRange == etag) ||
+                    (lastModified[0] && ifRange == lastModified);
+  
+  ByteRange ranges[FILE_DOWNLOAD_MAX_RANGES];
+  int rangeCount = rangeValid && server.hasHeader("Range")
+                     ? parseRangeHeader(server.header("Range"), size, ranges, FILE_DOWNLOAD_MAX_RANGES)
+                     : 0;
+  if (rangeCount < 0) {
+    file.close();
+    server.sendHeader("Content-Range", "bytes */" + String(size));
+    server.send(416, "text/plain", "Range not satisfiable");
+    return;
+  }
+  
+  bool headOnly = server.method() == HTTP_HEAD;
+  WiFiClient client = server.client();
+  unsigned long startTime = millis();
+  size_t bodyBytes = 0;
+  bool ok = true;
+  
+  if (rangeCount == 0) {
+    server.setContentLength(size);
+    server.send(200, contentType, "");
+    bodyBytes = size;
+    ok = headOnly || sendFileRange(client, file, 0, size);
+  } else if (rangeCount == 1) {
+    char contentRange[48];
+    snprintf(contentRange, sizeof(contentRange), "bytes %u-%u/%u", (unsigned)ranges[0].start, (unsigned)ranges[0].end, (unsigned)size);
+    server.sendHeader("Content-Range", contentRange);
+    bodyBytes = ranges[0].end - ranges[0].start + 1;
+    server.setContentLength(bodyBytes);
+    server.send(206, contentType, "");
+    ok = headOnly || sendFileRange(client, file, ranges[0].start, bodyBytes);
+  } else {
+    char boundary[20];
+    snprintf(boundary, sizeof(boundary), "%08lx%08lx", (unsigned long)esp_random(), (unsigned long)esp_random());
+    
+    // Part headers are formatted twice: once to size the body, once to send it
+    char partHeader[160];
+    size_t total = 0;
+    for (int pass = 0; pass < 2 && ok; pass++) {
+      for (int i = 0; i < rangeCount && ok; i++) {
+        int length = snprintf(partHeader, sizeof(partHeader), "\r\n--%s\r\nContent-Type: %s\r\nContent-Range: bytes %u-%u/%u\r\n\r\n",
+                              boundary, contentType, (unsigned)ranges[i].start, (unsigned)ranges[i].end, (unsigned)size);
+        size_t partBytes = ranges[i].end - ranges[i].start + 1;
+        if (pass == 0) {
+          total += length + partBytes;
+        } else if (!headOnly) {
+          ok = client.write((const uint8_t*)partHeader, length) == (size_t)length &&
+               sendFileRange(client, file, ranges[i].start, partBytes);
+        }
+      }
+      int length = snprintf(partHeader, sizeof(partHeader), "\r\n--%s--\r\n", boundary);
+      if (pass == 0) {
+        total += length;
+        bodyBytes = total;
+        server.setContentLength(total);
+        server.send(206, "multipart/byteranges; boundary=" + String(boundary), "");
+      } else if (!headOnly && ok) {
+        ok = client.write((const uint8_t*)partHeader, length) == (size_t)length;
+      }
+    }
+  }
   file.close();
+  
+  if (!headOnly) {
+    unsigned long elapsed = millis() - startTime;
+    DLOG_I(logWeb, "Download %s: %u bytes (%d ranges) in %lu ms, %lu KB/s%s", filename.c_str(), (unsigned)bodyBytes, rangeCount,
+                   elapsed, elapsed > 0 ? (unsigned long)(bodyBytes / elapsed) : 0UL, ok ? "" : " (aborted)");
+  }
 }
 
 void handleFileUpload() {
@@ -392,11 +911,11 @@ void handleFileUpload() {
   
   if (upload.status == UPLOAD_FILE_START) {
     String filename = "/" + upload.filename;
-    Serial.printf("Upload Start: %s\n", filename.c_str());
+    DLOG_I(logWeb, "Upload Start: %s", filename.c_str());
     
     File file = LittleFS.open(filename, "w");
     if (!file) {
-      Serial.println("Failed to create file");
+      DLOG_E(logWeb, "Failed to create file");
       return;
     }
     file.close();
@@ -407,13 +926,13 @@ void handleFileUpload() {
       file.close();
     }
   } else if (upload.status == UPLOAD_FILE_END) {
-    Serial.printf("Upload End: %s, Size: %u\n", upload.filename.c_str(), upload.totalSize);
+    DLOG_I(logWeb, "Upload End: %s, Size: %u", upload.filename.c_str(), upload.totalSize);
+    templateCache.invalidate(("/" + upload.filename).c_str()); // In case a template was replaced
   }
 }
 
 void handleFileUploadComplete() {
-  String html = loadTemplate("upload_complete.html");
-  server.send(200, "text/html", html);
+  sendTemplate("/templates/upload_complete.html");
 }
 
 // --- Firmware Upload Functions ---
@@ -421,7 +940,7 @@ void handleFirmwareUpload() {
   HTTPUpload& upload = server.upload();
   
   if (upload.status == UPLOAD_FILE_START) {
-    Serial.printf("Firmware Upload Start: %s\n", upload.filename.c_str());
+    DLOG_I(logWeb, "Firmware Upload Start: %s", upload.filename.c_str());
     if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
       Update.printError(Serial);
       return;
@@ -432,7 +951,7 @@ void handleFirmwareUpload() {
     }
   } else if (upload.status == UPLOAD_FILE_END) {
     if (Update.end(true)) {
-      Serial.printf("Firmware Update Success: %u bytes\n", upload.totalSize);
+      DLOG_I(logWeb, "Firmware Update Success: %u bytes", upload.totalSize);
     } else {
       Update.printError(Serial);
     }
@@ -440,7 +959,6 @@ void handleFirmwareUpload() {
 }
 
 void handleFirmwareUploadComplete() {
-  String html = loadTemplate("firmware_complete.html");
   String content = "";
   
   if (Update.hasError()) {
@@ -455,8 +973,8 @@ void handleFirmwareUploadComplete() {
     content += "<script>setTimeout(function(){window.location.href='/';}, 5000);</script>";
   }
   
-  html.replace("{{FIRMWARE_CONTENT}}", content);
-  server.send(200, "text/html", html);
+  TemplateVar vars[] = {{"FIRMWARE_CONTENT", content}};
+  sendTemplate("/templates/firmware_complete.html", vars);
   
   if (!Update.hasError()) {
     delay(REBOOT_DELAY);
@@ -466,14 +984,12 @@ void handleFirmwareUploadComplete() {
 
 // --- WiFi Configuration Functions ---
 void handleWifiConfig() {
-  String html = loadTemplate("wifi_config.html");
-  
-  // Replace placeholders with actual values
-  html.replace("{{CURRENT_SSID}}", WiFi.SSID());
-  html.replace("{{SIGNAL_STRENGTH}}", String(WiFi.RSSI()));
-  html.replace("{{WIFI_STATUS}}", WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected");
-  
-  server.send(200, "text/html", html);
+  TemplateVar vars[] = {
+    {"CURRENT_SSID", WiFi.SSID()},
+    {"SIGNAL_STRENGTH", String(WiFi.RSSI())},
+    {"WIFI_STATUS", WiFi.status() == WL_CONNECTED ? "Connected" : "Disconnected"}
+  };
+  sendTemplate("/templates/wifi_config.html", vars);
 }
 
 void handleWifiUpdate() {
@@ -485,16 +1001,14 @@ void handleWifiUpdate() {
   String newSSID = server.arg("ssid");
   String newPassword = server.arg("password");
   
-  // Save new WiFi credentials to preferences
-  preferences.begin("esp-config", false);
-  preferences.putString("wifi_ssid", newSSID);
-  preferences.putString("wifi_password", newPassword);
-  preferences.end();
-  
-  String html = loadTemplate("wifi_updated.html");
-  html.replace("{{NEW_SSID}}", newSSID);
+  // Saved by the configuration flush that runs on restart
+  if (!deviceConfig.setWifiCredentials(newSSID.c_str(), newPassword.c_str())) {
+    server.send(400, "text/plain", "SSID or password too long");
+    return;
+  }
   
-  server.send(200, "text/html", html);
+  TemplateVar vars[] = {{"NEW_SSID", newSSID}};
+  sendTemplate("/templates/wifi_updated.html", vars);
   
   delay(REBOOT_DELAY);
   ESP.restart();
@@ -521,8 +1035,6 @@ void handleNetworkScan() {
 
 // --- Debug Page ---
 void handleDebug() {
-  String html = loadTemplate("debug.html");
-  
   // Build debug sections
   String debugSections = "";
   
@@ -538,6 +1050,7 @@ void handleDebug() {
   debugSections += "<div class='debug-item'><span class='debug-label'>Free Heap:</span><span class='debug-value'>" + String(ESP.getFreeHeap()) + " bytes</span></div>";
   debugSections += "<div class='debug-item'><span class='debug-label'>Min Free Heap:</span><span class='debug-value'>" + String(ESP.getMinFreeHeap()) + " bytes</span></div>";
   debugSections += "<div class='debug-item'><span class='debug-label'>Max Alloc Heap:</span><span class='debug-value'>" + String(ESP.getMaxAllocHeap()) + " bytes</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>Heap Fragmentation:</span><span class='debug-value'>" + String(HeapMonitor::fragmentation(ESP.getFreeHeap(), ESP.getMaxAllocHeap()) * 100, 1) + "% (per subsystem: /api/v1/heap)</span></div>";
   debugSections += "<div class='debug-item'><span class='debug-label'>Uptime:</span><span class='debug-value'>" + String(millis() / 1000) + " seconds</span></div>";
   debugSections += "</div>";
   
@@ -558,13 +1071,21 @@ void handleDebug() {
   // Sensor Information
   debugSections += "<div class='debug-section'>";
   debugSections += "<h2>🌡️ Sensor Information</h2>";
-  float cpuTemp = readCPUTemperature();
-  float dhtTemp = readDHTTemperature();
-  float dhtHumidity = readDHTHumidity();
-  debugSections += "<div class='debug-item'><span class='debug-label'>CPU Temperature:</span><span class='debug-value'>" + String(cpuTemp, 1) + "°C</span></div>";
-  debugSections += "<div class='debug-item'><span class='debug-label'>DHT22 Temperature:</span><span class='debug-value " + String(dhtTemp != -999.0 ? "success" : "error") + "'>" + String(dhtTemp != -999.0 ? String(dhtTemp, 1) + "°C" : "Error") + "</span></div>";
-  debugSections += "<div class='debug-item'><span class='debug-label'>DHT22 Humidity:</span><span class='debug-value " + String(dhtHumidity != -999.0 ? "success" : "error") + "'>" + String(dhtHumidity != -999.0 ? String(dhtHumidity, 1) + "%" : "Error") + "</span></div>";
-  debugSections += "<div class='debug-item'><span class='debug-label'>LED Brightness:</span><span class='debug-value'>" + String(ledBrightness) + "/255</span></div>";
+  SensorSnapshot sensors;
+  sensorSampler.read(sensors);
+  for (int i = 0; i < sensors.channelCount; i++) {
+    const SensorReading& reading = sensors.readings[i];
+    String name = sensorRegistry.channelName(i);
+    debugSections += "<div class='debug-item'><span class='debug-label'>" + name + ":</span><span class='debug-value " + String(reading.valid ? "success" : "error") + "'>" + formatReading(reading, sensorRegistry.channelUnit(i)) + "</span></div>";
+    debugSections += "<div class='debug-item'><span class='debug-label'>" + name + " window:</span><span class='debug-value'>" + formatWindow(reading) + "</span></div>";
+  }
+  for (int i = 0; i < sensorRegistry.sensorCount(); i++) {
+    SensorRegistry::SensorStats stats = sensorRegistry.stats(i);
+    debugSections += "<div class='debug-item'><span class='debug-label'>Sensor " + String(sensorRegistry.sensor(i).name()) + ":</span><span class='debug-value'>" + String(stats.reads) + " reads, " + String(stats.failures) + " failed, " + String(stats.deferrals) + " deferred, last read " + String(stats.lastCostUs) + " µs</span></div>";
+  }
+  debugSections += "<div class='debug-item'><span class='debug-label'>History Storage:</span><span class='debug-value'>" + String(history.totalBytes() / 1024) + " KB (" + String(history.getRecordsWritten()) + " records written, " + String(history.getDroppedSegments()) + " segments expired)</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>Sample Age:</span><span class='debug-value'>" + String(SensorSampler::ageOf(sensors.readings[METRIC_DHT_TEMP], millis())) + " ms (" + String(sensors.sequence) + " samples)</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>LED Brightness:</span><span class='debug-value'>" + String(deviceConfig.ledBrightness()) + "/255</span></div>";
   debugSections += "</div>";
   
   // Timing Information
@@ -572,10 +1093,14 @@ void handleDebug() {
   debugSections += "<h2>⏰ Timing Information</h2>";
   unsigned long currentTime = millis();
   debugSections += "<div class='debug-item'><span class='debug-label'>Current Time:</span><span class='debug-value'>" + String(currentTime) + " ms</span></div>";
+  time_t wallClock = time(nullptr);
+  debugSections += "<div class='debug-item'><span class='debug-label'>Wall Clock (UTC):</span><span class='debug-value " + String(wallClock >= MIN_VALID_EPOCH ? "success" : "error") + "'>" + String(wallClock >= MIN_VALID_EPOCH ? String((unsigned long)wallClock) : String("Not synced")) + "</span></div>";
   debugSections += "<div class='debug-item'><span class='debug-label'>Last Update Check:</span><span class='debug-value'>" + String(lastUpdateCheck) + " ms</span></div>";
   debugSections += "<div class='debug-item'><span class='debug-label'>Time Since Update Check:</span><span class='debug-value'>" + String((currentTime - lastUpdateCheck) / 1000) + " seconds</span></div>";
-  debugSections += "<div class='debug-item'><span class='debug-label'>Last WiFi Check:</span><span class='debug-value'>" + String(lastWiFiCheck) + " ms</span></div>";
-  debugSections += "<div class='debug-item'><span class='debug-label'>Time Since WiFi Check:</span><span class='debug-value'>" + String((currentTime - lastWiFiCheck) / 1000) + " seconds</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>Last WiFi Connect:</span><span class='debug-value'>" + String(wifiConnection.getLastConnectMs()) + " ms (" + String(wifiConnection.lastConnectWasFast() ? "cached BSSID/channel" : "full scan") + ")</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>WiFi Connects:</span><span class='debug-value'>" + String(wifiConnection.getFastConnects()) + " fast, " + String(wifiConnection.getScanConnects()) + " with scan, " + String(wifiConnection.getFastFailures()) + " fast failed, " + String(wifiConnection.getDisconnects()) + " disconnects (" + String(wifiConnection.stateName()) + ")</span></div>";
+  const char* currentJob = backgroundJobs.currentJob();
+  debugSections += "<div class='debug-item'><span class='debug-label'>Background Jobs:</span><span class='debug-value'>" + String(currentJob != nullptr ? currentJob : "Idle") + " (" + String(backgroundJobs.pendingCount()) + " queued, " + String(backgroundJobs.getCompletedCount()) + " completed)</span></div>";
   debugSections += "</div>";
   
   // Storage Information
@@ -587,34 +1112,29 @@ void handleDebug() {
   debugSections += "<div class='debug-item'><span class='debug-label'>LittleFS Used:</span><span class='debug-value'>" + String(usedBytes) + " bytes (" + String(usedBytes/1024) + " KB)</span></div>";
   debugSections += "<div class='debug-item'><span class='debug-label'>LittleFS Free:</span><span class='debug-value'>" + String(totalBytes - usedBytes) + " bytes (" + String((totalBytes - usedBytes)/1024) + " KB)</span></div>";
   debugSections += "<div class='debug-item'><span class='debug-label'>Usage Percentage:</span><span class='debug-value'>" + String((usedBytes * 100) / totalBytes) + "%</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>Template Cache:</span><span class='debug-value'>" + String(templateCache.entryCount()) + " files, " + String(templateCache.bytesCached() / 1024) + " KB in " + String(templateCache.usesPsram() ? "PSRAM" : "RAM (LRU)") + " (" + String(templateCache.getHits()) + " hits, " + String(templateCache.getMisses()) + " misses, " + String(templateCache.getEvictions()) + " evicted)</span></div>";
   debugSections += "</div>";
   
   // Configuration Information
   debugSections += "<div class='debug-section'>";
   debugSections += "<h2>⚙️ Configuration</h2>";
-  preferences.begin("esp-config", true);
-  String storedCommit = preferences.getString("last_commit", "Unknown");
-  int storedFirmwareVersion = preferences.getInt("last_firmware_version", 0);
-  String storedClientId = preferences.getString("client_id", "Not Set");
-  int storedBrightness = preferences.getInt("led_brightness", 0);
-  String storedSSID = preferences.getString("wifi_ssid", "Not Set");
-  preferences.end();
-  
-  debugSections += "<div class='debug-item'><span class='debug-label'>Stored Client ID:</span><span class='debug-value'>" + storedClientId + "</span></div>";
-  debugSections += "<div class='debug-item'><span class='debug-label'>Stored LED Brightness:</span><span class='debug-value'>" + String(storedBrightness) + "</span></div>";
-  debugSections += "<div class='debug-item'><span class='debug-label'>Stored WiFi SSID:</span><span class='debug-value'>" + storedSSID + "</span></div>";
-  debugSections += "<div class='debug-item'><span class='debug-label'>Stored Template Commit:</span><span class='debug-value'>" + (storedCommit.length() > 7 ? storedCommit.substring(0, 7) : storedCommit) + "</span></div>";
-  debugSections += "<div class='debug-item'><span class='debug-label'>Stored Firmware Version:</span><span class='debug-value'>" + String(storedFirmwareVersion) + " (v" + String(storedFirmwareVersion/100) + "." + String(storedFirmwareVersion%100) + ")</span></div>";
+  String storedCommit = deviceConfig.lastCommit()[0] ? String(deviceConfig.lastCommit()).substring(0, 7) : String("Unknown");
+  int storedFirmwareVersion = deviceConfig.lastFirmwareVersion();
+  
+  debugSections += "<div class='debug-item'><span class='debug-label'>Client ID:</span><span class='debug-value'>" + String(deviceConfig.clientId()) + "</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>WiFi SSID:</span><span class='debug-value'>" + String(deviceConfig.wifiSsid()) + "</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>Template Commit:</span><span class='debug-value'>" + storedCommit + "</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>Templates Synced For:</span><span class='debug-value'>" + String(storedFirmwareVersion) + " (v" + String(storedFirmwareVersion/100) + "." + String(storedFirmwareVersion%100) + ")</span></div>";
+  debugSections += "<div class='debug-item'><span class='debug-label'>NVS Write-back:</span><span class='debug-value " + String(deviceConfig.isDirty() ? "error" : "success") + "'>" + String(deviceConfig.isDirty() ? "Pending" : "Saved") + " (" + String(deviceConfig.getFlushCount()) + " flushes, " + String(deviceConfig.getWriteCount()) + " keys written, " + String(deviceConfig.getCoalescedCount()) + " changes coalesced)</span></div>";
   debugSections += "</div>";
   
-  // Replace placeholder
-  html.replace("{{DEBUG_SECTIONS}}", debugSections);
-  
-  server.send(200, "text/html", html);
+  TemplateVar vars[] = {{"DEBUG_SECTIONS", debugSections}};
+  sendTemplate("/templates/debug.html", vars);
 }
 
 // --- Utility Functions ---
 String makeGitHubAPICall(const String& endpoint) {
+  TRACE_SCOPE("github.api");
   HTTPClient http;
   String url = "https://api.github.com/repos/" + String(GITHUB_REPO) + "/" + endpoint;
   
@@ -628,7 +1148,7 @@ String makeGitHubAPICall(const String& endpoint) {
   if (httpCode == HTTP_CODE_OK) {
     result = http.getString();
   } else {
-    Serial.printf("GitHub API call failed: HTTP %d\n", httpCode);
+    DLOG_W(logTemplates, "GitHub API call failed: HTTP %d", httpCode);
   }
   
   http.end();
@@ -636,6 +1156,7 @@ String makeGitHubAPICall(const String& endpoint) {
 }
 
 bool downloadFileFromGitHub(const String& filePath, const String& localPath) {
+  TRACE_SCOPE("github.download");
   HTTPClient http;
   String url = "https://raw.githubusercontent.com/" + String(GITHUB_REPO) + "/main/" + filePath;
   
@@ -655,111 +1176,84 @@ bool downloadFileFromGitHub(const String& filePath, const String& localPath) {
         size_t written = file.print(payload);
         file.close();
         success = written > 0;
-        Serial.printf("Downloaded %d bytes to %s\n", written, localPath.c_str());
+        DLOG_D(logTemplates, "Downloaded %d bytes to %s", written, localPath.c_str());
       }
     }
   } else {
-    Serial.printf("Download failed: HTTP %d\n", httpCode);
+    DLOG_W(logTemplates, "Download failed: HTTP %d", httpCode);
   }
   
   http.end();
   return success;
 }
 
-void updateStoredCommitHash() {
+// SHA of the newest commit on main, or "" if GitHub could not be asked
+String fetchLatestCommit() {
   String response = makeGitHubAPICall("commits/main");
-  if (response.length() > 0) {
-    StaticJsonDocument<1024> doc;
-    if (deserializeJson(doc, response) == DeserializationError::Ok) {
-      String latestCommit = doc["sha"].as<String>();
-      preferences.begin("esp-config", false);
-      preferences.putString("last_commit", latestCommit);
-      preferences.end();
-      Serial.printf("Updated commit hash: %s\n", latestCommit.c_str());
-    }
+  if (response.length() == 0) {
+    return "";
   }
-}
-
-// --- Template Loading Function ---
-String loadTemplate(const char* templatePath) {
-  String fullPath = "/templates/" + String(templatePath);
-  
-  Serial.printf("Attempting to load template: %s\n", fullPath.c_str());
   
-  if (!LittleFS.exists(fullPath)) {
-    Serial.printf("Template not found: %s\n", fullPath.c_str());
-    
-    // List all files in /templates directory for debugging
-    if (LittleFS.exists("/templates")) {
-      Serial.println("Contents of /templates directory:");
-      File templatesDir = LittleFS.open("/templates");
-      File file = templatesDir.openNextFile();
-      while (file) {
-        Serial.printf("  - %s (%d bytes)\n", file.name(), file.size());
-        file = templatesDir.openNextFile();
-      }
-      templatesDir.close();
-    } else {
-      Serial.println("/templates directory does not exist");
-    }
-    
-    return "<!DOCTYPE html><html><body><h1>Error: Template not found</h1><p>Path: " + fullPath + "</p></body></html>";
+  StaticJsonDocument<1024> doc;
+  if (deserializeJson(doc, response) != DeserializationError::Ok) {
+    DLOG_W(logTemplates, "Failed to parse GitHub API response");
+    return "";
   }
-  
-  File file = LittleFS.open(fullPath, "r");
-  if (!file) {
-    Serial.printf("Failed to open template: %s\n", fullPath.c_str());
-    return "<!DOCTYPE html><html><body><h1>Error: Could not open template</h1><p>Path: " + fullPath + "</p></body></html>";
+  return doc["sha"].as<String>();
+}
+
+void updateStoredCommitHash() {
+  String latestCommit = fetchLatestCommit();
+  if (latestCommit.length() > 0) {
+    deviceConfig.setLastCommit(latestCommit.c_str());
+    DLOG_I(logTemplates, "Updated commit hash: %s", latestCommit.c_str());
   }
-  
-  String html = file.readString();
-  file.close();
-  Serial.printf("✓ Template loaded successfully: %s (%d bytes)\n", fullPath.c_str(), html.length());
-  return html;
 }
 
 // --- Template Update Functions ---
 void handleUpdateTemplate() {
-  String html = loadTemplate("template_update.html");
-  
   // Show current template info
-  preferences.begin("esp-config", true);
-  String currentCommit = preferences.getString("last_commit", "Unknown");
-  int storedFirmwareVersion = preferences.getInt("last_firmware_version", 0);
-  preferences.end();
-  
-  // Replace placeholders
-  html.replace("{{GITHUB_REPO}}", String(GITHUB_REPO));
-  html.replace("{{CURRENT_COMMIT}}", currentCommit.length() > 7 ? currentCommit.substring(0, 7) : currentCommit);
-  html.replace("{{TEMPLATE_FIRMWARE_VERSION}}", "v" + String(storedFirmwareVersion/100) + "." + String(storedFirmwareVersion%100));
-  html.replace("{{CURRENT_FIRMWARE_VERSION}}", "v" + String(FIRMWARE_VERSION/100) + "." + String(FIRMWARE_VERSION%100));
-  
-  server.send(200, "text/html", html);
+  String currentCommit = deviceConfig.lastCommit()[0] ? String(deviceConfig.lastCommit()).substring(0, 7) : String("Unknown");
+  int storedFirmwareVersion = deviceConfig.lastFirmwareVersion();
+  
+  TemplateVar vars[] = {
+    {"GITHUB_REPO", GITHUB_REPO},
+    {"CURRENT_COMMIT", currentCommit},
+    {"TEMPLATE_FIRMWARE_VERSION", "v" + String(storedFirmwareVersion/100) + "." + String(storedFirmwareVersion%100)},
+    {"CURRENT_FIRMWARE_VERSION", "v" + String(FIRMWARE_VERSION/100) + "." + String(FIRMWARE_VERSION%100)}
+  };
+  sendTemplate("/templates/template_update.html", vars);
 }
 
 void handleUpdateTemplateAction() {
-  Serial.println("Manual template update requested...");
-  checkForTemplateUpdate();
-  server.send(200, "text/plain", "Template check completed - see serial output for details");
+  DLOG_I(logTemplates, "Manual template update requested...");
+  if (queueTemplateSync(TEMPLATE_SYNC_CHECK)) {
+    server.send(200, "text/plain", "Template check started - see serial output for details");
+  } else {
+    server.send(200, "text/plain", "A template update is already running - see serial output for details");
+  }
 }
 
 void handleForceTemplateUpdate() {
-  Serial.println("Force template update requested...");
-  forceTemplateUpdate();
-  server.send(200, "text/plain", "Force template update completed - see serial output for details");
+  DLOG_I(logTemplates, "Force template update requested...");
+  if (queueTemplateSync(TEMPLATE_SYNC_FORCE)) {
+    server.send(200, "text/plain", "Force template update started - see serial output for details");
+  } else {
+    server.send(200, "text/plain", "A template update is already running - see serial output for details");
+  }
 }
 
 bool downloadTemplate() {
-  Serial.println("Starting template download...");
+  DLOG_I(logTemplates, "Starting template download...");
   
   // Create templates directory if it doesn't exist
   if (!LittleFS.exists("/templates")) {
-    Serial.println("Creating /templates directory...");
+    DLOG_I(logTemplates, "Creating /templates directory...");
     LittleFS.mkdir("/templates");
     if (LittleFS.exists("/templates")) {
-      Serial.println("✓ /templates directory created");
+      DLOG_I(logTemplates, "✓ /templates directory created");
     } else {
-      Serial.println("✗ Failed to create /templates directory");
+      DLOG_E(logTemplates, "✗ Failed to create /templates directory");
     }
   }
   
@@ -793,15 +1287,15 @@ bool downloadTemplate() {
   bool allSuccess = true;
   int fileCount = sizeof(templateFiles) / sizeof(templateFiles[0]);
   
-  Serial.printf("Downloading %d template files...\n", fileCount);
+  DLOG_I(logTemplates, "Downloading %d template files...", fileCount);
   
   for (int i = 0; i < fileCount; i++) {
-    Serial.printf("Downloading %s...\n", templateFiles[i]);
+    DLOG_D(logTemplates, "Downloading %s...", templateFiles[i]);
     
     if (downloadFileFromGitHub(String("data/") + templateFiles[i], localPaths[i])) {
-      Serial.printf("✓ Downloaded %s\n", templateFiles[i]);
+      DLOG_D(logTemplates, "✓ Downloaded %s", templateFiles[i]);
     } else {
-      Serial.printf("✗ Failed to download %s\n", templateFiles[i]);
+      DLOG_W(logTemplates, "✗ Failed to download %s", templateFiles[i]);
       allSuccess = false;
     }
     
@@ -810,323 +1304,1307 @@ bool downloadTemplate() {
   }
   
   if (allSuccess) {
-    Serial.println("✓ All template files downloaded successfully");
+    DLOG_I(logTemplates, "✓ All template files downloaded successfully");
   } else {
-    Serial.println("⚠ Some template files failed to download");
+    DLOG_W(logTemplates, "⚠ Some template files failed to download");
   }
-  
   return allSuccess;
 }
 
-void checkForTemplateUpdate() {
-  Serial.println("Checking for template updates...");
+bool templateFilesExist() {
+  return LittleFS.exists("/index.html") &&
+         LittleFS.exists("/templates") &&
+         LittleFS.exists("/templates/debug.html") &&
+         LittleFS.exists("/templates/file_manager.html");
+}
+
+// Runs on the background job task: network and flash only, no shared state
+void runTemplateSync(void* context) {
+  TemplateSync* sync = static_cast<TemplateSync*>(context);
+  sync->filesWritten = false;
+  sync->firmwareChanged = false;
+  sync->latestCommit = "";
+  bootTimeline.begin("template_sync");
+  
+  MetricTimer timer(templateSyncDuration);
+  HeapScope heapScope(heapMonitor, HEAP_TAG_TEMPLATES);
+  
+  bool force = sync->mode == TEMPLATE_SYNC_FORCE;
+  if (sync->mode == TEMPLATE_SYNC_BOOT) {
+    if (!templateFilesExist()) {
+      DLOG_W(logTemplates, "Template files not found, downloading from GitHub...");
+      force = true;
+    } else if (sync->storedFirmwareVersion != FIRMWARE_VERSION) {
+      DLOG_I(logTemplates, "Firmware updated from v%d.%d to v%d.%d, downloading latest templates...",
+                           sync->storedFirmwareVersion/100, sync->storedFirmwareVersion%100,
+                           FIRMWARE_VERSION/100, FIRMWARE_VERSION%100);
+      sync->firmwareChanged = true;
+      force = true;
+    } else {
+      DLOG_I(logTemplates, "✓ Templates exist and firmware version matches");
+      bootTimeline.end("template_sync");
+      return;
+    }
+  }
   
-  String response = makeGitHubAPICall("commits/main");
-  if (response.length() == 0) {
-    Serial.println("Failed to get GitHub API response");
-    return;
+  if (force) {
+    DLOG_I(logTemplates, "Force updating all templates...");
+    sync->filesWritten = true;
+    if (downloadTemplate()) {
+      sync->latestCommit = fetchLatestCommit();
+      DLOG_I(logTemplates, "✓ Force update of all templates complete");
+    } else {
+      DLOG_W(logTemplates, "⚠ Force update completed with some failures");
+    }
+  } else {
+    DLOG_I(logTemplates, "Checking for template updates...");
+    String latestCommit = fetchLatestCommit();
+    DLOG_I(logTemplates, "Latest commit: %s", latestCommit.c_str());
+    DLOG_I(logTemplates, "Stored commit: %s", sync->storedCommit.c_str());
+    
+    if (latestCommit.length() == 0) {
+      DLOG_W(logTemplates, "Failed to get the latest template commit");
+    } else if (latestCommit == sync->storedCommit) {
+      DLOG_I(logTemplates, "Templates are up to date");
+    } else {
+      DLOG_I(logTemplates, "Template update needed, downloading all template files...");
+      sync->filesWritten = true;
+      if (downloadTemplate()) {
+        sync->latestCommit = latestCommit;
+        DLOG_I(logTemplates, "✓ All templates updated successfully");
+      } else {
+        DLOG_W(logTemplates, "⚠ Some templates failed to download");
+      }
+    }
   }
+  bootTimeline.end("template_sync");
+}
 
-  StaticJsonDocument<1024> doc;
-  if (deserializeJson(doc, response) != DeserializationError::Ok) {
-    Serial.println("Failed to parse GitHub API response");
+void completeTemplateSync(void* context) {
+  TemplateSync* sync = static_cast<TemplateSync*>(context);
+  HeapScope heapScope(heapMonitor, HEAP_TAG_TEMPLATES);
+  
+  // Serve the new files (files that failed keep their previous contents on flash)
+  if (sync->filesWritten) {
+    templateCache.reload();
+  }
+  if (sync->latestCommit.length() > 0) {
+    deviceConfig.setLastCommit(sync->latestCommit.c_str());
+    DLOG_I(logTemplates, "Updated commit hash: %s", sync->latestCommit.c_str());
+  }
+  if (sync->firmwareChanged) {
+    deviceConfig.setLastFirmwareVersion(FIRMWARE_VERSION);
+    DLOG_I(logTemplates, "✓ Templates synchronized with new firmware");
+  }
+}
+
+// Returns false if a template sync is already queued or running
+bool queueTemplateSync(TemplateSyncMode mode) {
+  if (backgroundJobs.isQueued("template_sync")) {
+    return false;
+  }
+  templateSync.mode = mode;
+  templateSync.storedCommit = deviceConfig.lastCommit();
+  templateSync.storedFirmwareVersion = deviceConfig.lastFirmwareVersion();
+  return backgroundJobs.submit("template_sync", runTemplateSync, completeTemplateSync, &templateSync);
+}
+
+// --- Deferred Network Jobs ---
+void runUpdateCheck(void*) {
+  HeapScope heapScope(heapMonitor, HEAP_TAG_OTA);
+  bootTimeline.begin("ota_check");
+  DLOG_I(logApp, "Checking for firmware updates...");
+  otaUpdater.checkForUpdates();
+  bootTimeline.end("ota_check");
+}
+
+void completeUpdateCheck(void*) {
+  if (pendingFirmwareUrl.length() == 0) {
     return;
   }
+  // Blocks until the device reboots into the new firmware (or the update fails)
+  WatchdogScope watchdogScope(otaInstallSection);
+  HeapScope heapScope(heapMonitor, HEAP_TAG_OTA);
+  String url = pendingFirmwareUrl;
+  pendingFirmwareUrl = "";
+  DLOG_I(logApp, "Starting automatic firmware update...");
+  otaUpdater.performUpdate(url.c_str());
+}
+
+void queueUpdateCheck() {
+  lastUpdateCheck = millis();
+  backgroundJobs.submit("ota_check", runUpdateCheck, completeUpdateCheck);
+}
+
+void runServerDiscovery(void*) {
+  bootTimeline.begin("mqtt_discovery");
+  discoveredServerIP = mqttManager.discoverServer();
+  bootTimeline.end("mqtt_discovery");
+}
 
-  String latestCommit = doc["sha"].as<String>();
-  Serial.printf("Latest commit: %s\n", latestCommit.c_str());
+void completeServerDiscovery(void*) {
+  mqttManager.updateServerIP(discoveredServerIP.c_str());
+  mqtt_server_ip = discoveredServerIP;
   
-  preferences.begin("esp-config", true);
-  String storedCommit = preferences.getString("last_commit", "");
-  preferences.end();
-  Serial.printf("Stored commit: %s\n", storedCommit.c_str());
+  // Remembered so the next boot can connect before discovery has run
+  IPAddress address;
+  if (address.fromString(discoveredServerIP)) {
+    uint32_t raw = address;
+    deviceConfig.setBlob("mqtt_server", &raw, sizeof(raw));
+  }
+}
+
+void queueServerDiscovery() {
+  mqttManager.updateLastDiscoveryTime(millis());
+  backgroundJobs.submit("mqtt_discovery", runServerDiscovery, completeServerDiscovery);
+}
+
+// --- MQTT Command Handlers ---
+// Copy a (non NUL-terminated) MQTT payload into a small stack buffer
+static void copyPayload(char* buffer, size_t size, const uint8_t* payload, unsigned int length) {
+  size_t count = length < size - 1 ? length : size - 1;
+  memcpy(buffer, payload, count);
+  buffer[count] = '\0';
+}
+
+void onBrightnessCommand(const char*, const uint8_t* payload, unsigned int length, void*) {
+  char value[8];
+  copyPayload(value, sizeof(value), payload, length);
+  char* end;
+  long newBrightness = strtol(value, &end, 10);
   
-  if (storedCommit != latestCommit) {
-    Serial.println("Template update needed, downloading all template files...");
-    if (downloadTemplate()) {
-      preferences.begin("esp-config", false);
-      preferences.putString("last_commit", latestCommit);
-      preferences.end();
-      Serial.println("✓ All templates updated successfully");
-    } else {
-      Serial.println("⚠ Some templates failed to download");
-    }
-  } else {
-    Serial.println("Templates are up to date");
+  // Only a whole number from 0 to 255; an empty or non-numeric payload is not 0
+  if (length >= sizeof(value) || end == value || *end != '\0' || newBrightness < 0 || newBrightness > 255) {
+    DLOG_W(logApp, "Ignoring invalid brightness command: %s", value);
+    return;
   }
+  
+  deviceConfig.setLedBrightness(newBrightness);
+  DLOG_I(logApp, "LED brightness set to %ld via MQTT", newBrightness);
 }
 
-void forceTemplateUpdate() {
-  Serial.println("Force updating all templates...");
+void onTelemetryFormatCommand(const char*, const uint8_t* payload, unsigned int length, void*) {
+  char value[8];
+  copyPayload(value, sizeof(value), payload, length);
   
-  if (downloadTemplate()) {
-    updateStoredCommitHash();
-    Serial.println("✓ Force update of all templates complete");
+  ESPMQTTManager::TelemetryEncoding encoding;
+  if (strcasecmp(value, "cbor") == 0) {
+    encoding = ESPMQTTManager::TELEMETRY_CBOR;
+  } else if (strcasecmp(value, "ascii") == 0) {
+    encoding = ESPMQTTManager::TELEMETRY_ASCII;
   } else {
-    Serial.println("⚠ Force update completed with some failures");
+    DLOG_W(logApp, "Ignoring invalid telemetry format: %s", value);
+    return;
   }
+  
+  mqttManager.setTelemetryEncoding(encoding);
+  deviceConfig.setTelemetryFormat((uint8_t)encoding);
+  DLOG_I(logApp, "Telemetry format set to %s via MQTT", value);
 }
 
-void ensureTemplateExists() {
-  // Check if main template files exist
-  bool templatesExist = LittleFS.exists("/index.html") && 
-                       LittleFS.exists("/templates") &&
-                       LittleFS.exists("/templates/debug.html") &&
-                       LittleFS.exists("/templates/file_manager.html");
+// Payload: {"metric":"temperature","deadband":0.3,"min_interval_ms":5000,
+//           "max_interval_ms":300000,"low":null,"high":30,"hysteresis":0.5}
+// Omitted fields keep their current value; null disables a threshold.
+void onPolicyCommand(const char*, const uint8_t* payload, unsigned int length, void*) {
+  StaticJsonDocument<256> doc;
+  if (deserializeJson(doc, payload, length) != DeserializationError::Ok) {
+    DLOG_W(logApp, "Ignoring invalid publish policy command (bad JSON)");
+    return;
+  }
   
-  if (!templatesExist) {
-    Serial.println("Template files not found, downloading from GitHub...");
-    forceTemplateUpdate();
+  const char* metric = doc["metric"] | "";
+  int index = sensorRegistry.findChannel(metric);
+  if (index < 0) {
+    DLOG_W(logApp, "Ignoring publish policy for unknown metric: %s", metric);
     return;
   }
   
-  // Check if this is the first boot after a firmware update
-  preferences.begin("esp-config", true);
-  int storedFirmwareVersion = preferences.getInt("last_firmware_version", 0);
-  preferences.end();
+  PublishPolicyConfig config = publishPolicies[index].config();
+  config.deadband = doc["deadband"] | config.deadband;
+  config.minIntervalMs = doc["min_interval_ms"] | config.minIntervalMs;
+  config.maxIntervalMs = doc["max_interval_ms"] | config.maxIntervalMs;
+  config.hysteresis = doc["hysteresis"] | config.hysteresis;
+  if (doc.containsKey("low")) {
+    config.lowThreshold = doc["low"].isNull() ? NAN : doc["low"].as<float>();
+  }
+  if (doc.containsKey("high")) {
+    config.highThreshold = doc["high"].isNull() ? NAN : doc["high"].as<float>();
+  }
+
+  // Checked on the merged config, so a partial update cannot break the stored one
+  const char* name = sensorRegistry.channelName(index);
+  bool bothThresholds = !isnan(config.lowThreshold) && !isnan(config.highThreshold);
+  if (!(config.deadband >= 0)) {
+    DLOG_W(logApp, "Ignoring publish policy for %s: negative deadband %.2f", name, config.deadband);
+    return;
+  }
+  if (config.maxIntervalMs != 0 && config.maxIntervalMs < config.minIntervalMs) {
+    DLOG_W(logApp, "Ignoring publish policy for %s: max interval %u ms is below min interval %u ms", name,
+                   (unsigned)config.maxIntervalMs, (unsigned)config.minIntervalMs);
+    return;
+  }
+  if (bothThresholds && config.lowThreshold > config.highThreshold) {
+    DLOG_W(logApp, "Ignoring publish policy for %s: low threshold %.1f is above high threshold %.1f", name,
+                   config.lowThreshold, config.highThreshold);
+    return;
+  }
+  // A margin wider than the gap would hold a value above high in the low zone
+  if (!(config.hysteresis >= 0) ||
+      (bothThresholds && config.hysteresis > config.highThreshold - config.lowThreshold)) {
+    DLOG_W(logApp, "Ignoring publish policy for %s: hysteresis %.2f is negative or wider than the thresholds' gap",
+                   name, config.hysteresis);
+    return;
+  }
+
+  publishPolicies[index].configure(config);
   
-  if (storedFirmwareVersion != FIRMWARE_VERSION) {
-    Serial.printf("Firmware updated from v%d.%d to v%d.%d, downloading latest templates...\n", 
-                  storedFirmwareVersion/100, storedFirmwareVersion%100,
-                  FIRMWARE_VERSION/100, FIRMWARE_VERSION%100);
-    
-    // Download latest templates
-    forceTemplateUpdate();
+  char key[16];
+  snprintf(key, sizeof(key), "pol_%s", sensorRegistry.channelName(index));
+  deviceConfig.setBlob(key, &config, sizeof(config));
+  
+  DLOG_I(logApp, "Publish policy for %s: deadband %.2f, interval %u-%u ms, thresholds %.1f/%.1f",
+                 sensorRegistry.channelName(index), config.deadband, (unsigned)config.minIntervalMs, (unsigned)config.maxIntervalMs,
+                 config.lowThreshold, config.highThreshold);
+}
+
+void onTemplateSyncCommand(const char*, const uint8_t*, unsigned int, void*) {
+  DLOG_I(logApp, "Template sync requested via MQTT");
+  if (!queueTemplateSync(TEMPLATE_SYNC_CHECK)) {
+    DLOG_I(logApp, "Template sync already running");
+  }
+}
+
+void registerMQTTCommands() {
+  mqttManager.onCommand("brightness/set", onBrightnessCommand);
+  mqttManager.onCommand("template_sync", onTemplateSyncCommand);
+  mqttManager.onCommand("telemetry_format/set", onTelemetryFormatCommand);
+  mqttManager.onCommand("policy/set", onPolicyCommand);
+}
+
+// --- Publish Policy Management ---
+void loadPublishPolicies() {
+  // Defaults: report meaningful changes, with a 5 minute heartbeat
+  PublishPolicyConfig defaults[METRIC_COUNT] = {
+    PublishPolicy::defaults(1.0, 5 * 60 * 1000UL),  // CPU temperature (°C)
+    PublishPolicy::defaults(0.3, 5 * 60 * 1000UL),  // DHT22 temperature (°C)
+    PublishPolicy::defaults(2.0, 5 * 60 * 1000UL)   // DHT22 humidity (%)
+  };
+  PublishPolicyConfig probeDefault = PublishPolicy::defaults(0.5, 5 * 60 * 1000UL);
+  
+  for (int i = 0; i < sensorRegistry.channelCount(); i++) {
+    char key[16];
+    snprintf(key, sizeof(key), "pol_%s", sensorRegistry.channelName(i));
     
-    // Update stored firmware version
-    preferences.begin("esp-config", false);
-    preferences.putInt("last_firmware_version", FIRMWARE_VERSION);
-    preferences.end();
+    PublishPolicyConfig config = i < METRIC_COUNT ? defaults[i] : probeDefault;
+    deviceConfig.getBlob(key, &config, sizeof(config)); // Leaves the default if nothing is stored
+    publishPolicies[i].configure(config);
+  }
+}
+
+// Run the window means through the publish policies and publish what they let through.
+// The deadband compares window means, so a single glitched sample does not
+// count as a change; thresholds are checked on the latest sample so an alert
+// goes out one sample period after the crossing, spikes included.
+void publishSensorReadings(const SensorSnapshot& snapshot, unsigned long currentTime) {
+  uint8_t channelCount = snapshot.channelCount;
+  float readings[SENSOR_SAMPLER_MAX_CHANNELS];
+  float latest[SENSOR_SAMPLER_MAX_CHANNELS];
+  for (int i = 0; i < channelCount; i++) {
+    const SensorReading& reading = snapshot.readings[i];
+    readings[i] = reading.window.count > 0 ? reading.window.mean : NAN;
+    latest[i] = reading.valid ? reading.value : NAN;
+  }
+  
+  PublishPolicy::Decision decisions[SENSOR_SAMPLER_MAX_CHANNELS];
+  bool anyDue = false;
+  bool builtinDue = false;
+  for (int i = 0; i < channelCount; i++) {
+    decisions[i] = publishPolicies[i].evaluate(readings[i], latest[i], currentTime);
+    anyDue = anyDue || decisions[i] != PublishPolicy::SUPPRESS;
+    builtinDue = builtinDue || (i < METRIC_COUNT && decisions[i] != PublishPolicy::SUPPRESS);
+  }
+  
+  // Nothing is marked published while offline, so due readings go out after reconnect
+  if (!anyDue || !mqttManager.isConnected()) {
+    return;
+  }
+  
+  bool cbor = mqttManager.getTelemetryEncoding() == ESPMQTTManager::TELEMETRY_CBOR;
+  if (cbor && builtinDue) {
+    // One binary frame carries every built-in window, so all of them count as published
+    float values[METRIC_COUNT * TELEMETRY_VALUES_PER_METRIC];
+    for (int i = 0; i < METRIC_COUNT; i++) {
+      const WindowSummary& window = snapshot.readings[i].window;
+      values[i * TELEMETRY_VALUES_PER_METRIC] = readings[i];
+      values[i * TELEMETRY_VALUES_PER_METRIC + 1] = window.count > 0 ? window.min : NAN;
+      values[i * TELEMETRY_VALUES_PER_METRIC + 2] = window.count > 0 ? window.max : NAN;
+    }
+    if (mqttManager.publishTelemetry(TELEMETRY_SCHEMA_ENV_WINDOW_V2, currentTime, values,
+                                     METRIC_COUNT * TELEMETRY_VALUES_PER_METRIC)) {
+      bootTimeline.mark("first_publish");
+      for (int i = 0; i < METRIC_COUNT; i++) {
+        if (!isnan(readings[i])) {
+          publishPolicies[i].markPublished(readings[i], latest[i], currentTime);
+        }
+      }
+    }
+  }
+  
+  for (int i = cbor ? METRIC_COUNT : 0; i < channelCount; i++) {
+    if (decisions[i] == PublishPolicy::SUPPRESS) {
+      continue;
+    }
     
-    Serial.println("✓ Templates synchronized with new firmware");
+    if (publishChannel(i, readings[i])) {
+      bootTimeline.mark("first_publish");
+      publishPolicies[i].markPublished(readings[i], latest[i], currentTime);
+      if (decisions[i] == PublishPolicy::PUBLISH_ALERT) {
+        DLOG_W(logApp, "ALERT: %s crossed a threshold (%.1f)", sensorRegistry.channelName(i), latest[i]);
+      }
+    }
+  }
+}
+
+// Built-in channels keep their established topics; other channels publish to
+// home/esp/[client_id]/[channel name]
+bool publishChannel(uint8_t channel, float value) {
+  switch (channel) {
+    case METRIC_CPU_TEMP: return mqttManager.publishCpuTemperature(value);
+    case METRIC_DHT_TEMP: return mqttManager.publishTemperature(value);
+    case METRIC_DHT_HUMIDITY: return mqttManager.publishHumidity(value);
+    default: return mqttManager.publishMetric(sensorRegistry.channelName(channel), value, sensorRegistry.channelUnit(channel));
+  }
+}
+
+// --- Sensor API ---
+// Window aggregates of every metric as JSON
+void handleSensorsApi() {
+  HeapScope heapScope(heapMonitor, HEAP_TAG_JSON);
+  SensorSnapshot sensors;
+  sensorSampler.read(sensors);
+  uint32_t now = millis();
+  
+  String json = "{\"sequence\":" + String(sensors.sequence);
+  json += ",\"interval_ms\":" + String(SENSOR_SAMPLE_INTERVAL);
+  json += ",\"metrics\":{";
+  for (int i = 0; i < sensors.channelCount; i++) {
+    const SensorReading& reading = sensors.readings[i];
+    const WindowSummary& window = reading.window;
+    if (i > 0) json += ",";
+    json += "\"" + String(sensorRegistry.channelName(i)) + "\":{";
+    json += "\"unit\":\"" + String(sensorRegistry.channelUnit(i)) + "\",";
+    json += "\"valid\":" + String(reading.valid ? "true" : "false");
+    json += ",\"age_ms\":" + String(SensorSampler::ageOf(reading, now));
+    json += ",\"count\":" + String(window.count);
+    if (window.count > 0) {
+      json += ",\"mean\":" + String(window.mean, 3);
+      json += ",\"min\":" + String(window.min, 2);
+      json += ",\"max\":" + String(window.max, 2);
+      json += ",\"variance\":" + String(window.variance, 4);
+      json += ",\"ema\":" + String(window.ema, 3);
+    }
+    json += "}";
+  }
+  json += "}}";
+  
+  server.send(200, "application/json", json);
+}
+
+// --- History ---
+// Feed new samples into the time-series store once the wall clock is valid
+void recordHistory(const SensorSnapshot& snapshot) {
+  time_t now = time(nullptr);
+  if (now < MIN_VALID_EPOCH) {
+    return;
+  }
+  
+  for (int i = 0; i < snapshot.channelCount; i++) {
+    const SensorReading& reading = snapshot.readings[i];
+    if (reading.valid && reading.timestamp != lastHistorySample[i]) {
+      history.add(i, (uint32_t)now, reading.value);
+      lastHistorySample[i] = reading.timestamp;
+    }
+  }
+}
+
+struct HistoryStream {
+  String buffer;
+  size_t points;
+};
+
+bool streamHistoryPoint(const TimeSeriesStore::Point& point, void* context) {
+  HistoryStream* stream = static_cast<HistoryStream*>(context);
+  
+  char entry[80];
+  snprintf(entry, sizeof(entry), "%s[%lu,%.2f,%.2f,%.2f,%lu]", stream->points > 0 ? "," : "",
+           (unsigned long)point.time, point.mean, point.min, point.max, (unsigned long)point.count);
+  stream->buffer += entry;
+  stream->points++;
+  
+  if (stream->buffer.length() >= HISTORY_CHUNK_SIZE) {
+    server.sendContent(stream->buffer);
+    stream->buffer = "";
+  }
+  return server.client().connected(); // Stop reading flash once the client is gone
+}
+
+// GET /api/v1/history?metric=<name>&from=<epoch s>&to=<epoch s>&step=<s>
+// Points are [time, mean, min, max, samples], streamed in chunks
+void handleHistoryApi() {
+  HeapScope heapScope(heapMonitor, HEAP_TAG_JSON);
+  int metric = sensorRegistry.findChannel(server.arg("metric").c_str());
+  if (metric < 0) {
+    server.send(400, "application/json", "{\"error\":\"unknown metric\"}");
+    return;
+  }
+  
+  uint32_t to = server.hasArg("to") ? strtoul(server.arg("to").c_str(), nullptr, 10) : (uint32_t)time(nullptr);
+  uint32_t from = server.hasArg("from") ? strtoul(server.arg("from").c_str(), nullptr, 10)
+                                        : (to > HISTORY_DEFAULT_RANGE ? to - HISTORY_DEFAULT_RANGE : 0);
+  uint32_t step = server.hasArg("step") ? strtoul(server.arg("step").c_str(), nullptr, 10) : 0;
+  if (from > to) {
+    server.send(400, "application/json", "{\"error\":\"from is after to\"}");
+    return;
+  }
+  
+  uint32_t resolution = history.resolutionFor(from, step);
+  unsigned long startTime = millis();
+  
+  HistoryStream stream;
+  stream.buffer.reserve(HISTORY_CHUNK_SIZE + 80);
+  stream.points = 0;
+  stream.buffer = "{\"metric\":\"" + String(sensorRegistry.channelName(metric)) + "\",\"from\":" + String(from) +
+                  ",\"to\":" + String(to) + ",\"resolution\":" + String(resolution) +
+                  ",\"step\":" + String(step > resolution ? step : resolution) + ",\"points\":[";
+  
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  history.query(metric, from, to, step, streamHistoryPoint, &stream);
+  stream.buffer += "]}";
+  server.sendContent(stream.buffer);
+  server.sendContent(""); // Terminates the chunked response
+  
+  DLOG_I(logWeb, "History query %s: %u points in %lu ms", sensorRegistry.channelName(metric), (unsigned)stream.points, millis() - startTime);
+}
+
+// --- Live Updates (Server-Sent Events) ---
+// Dashboard state as last pushed to subscribers; events only carry what changed
+struct LiveStatus {
+  uint32_t freeHeap;
+  int rssi;
+  bool wifiConnected;
+  bool mqttConnected;
+};
+LiveStatus lastLiveStatus = {0, 0, false, false};
+float lastLiveValue[SENSOR_SAMPLER_MAX_CHANNELS];
+uint32_t lastLiveSequence = 0;
+unsigned long lastLiveStatusCheck = 0;
+
+bool liveValueChanged(float previous, float current) {
+  if (isnan(previous) || isnan(current)) {
+    return isnan(previous) != isnan(current);
+  }
+  return fabsf(current - previous) >= 0.05f; // Values are shown with one decimal
+}
+
+// {"seq":N,"metrics":{"temperature":{"v":21.4,"mean":21.32,"u":"°C"},...}}
+// with every channel (full) or only channels whose value changed. Sets a bit
+// in sent for every channel included.
+String buildSensorEvent(const SensorSnapshot& snapshot, bool full, uint32_t* sent = nullptr) {
+  String json = "{\"seq\":" + String(snapshot.sequence) + ",\"metrics\":{";
+  bool empty = true;
+  for (int i = 0; i < snapshot.channelCount; i++) {
+    const SensorReading& reading = snapshot.readings[i];
+    float value = reading.valid ? reading.value : NAN;
+    if (!full && !liveValueChanged(lastLiveValue[i], value)) {
+      continue;
+    }
+    if (!empty) json += ",";
+    empty = false;
+    if (sent != nullptr) *sent |= 1UL << i;
+    json += "\"" + String(sensorRegistry.channelName(i)) + "\":{\"v\":" + (isnan(value) ? String("null") : String(value, 1));
+    json += ",\"mean\":" + (reading.window.count > 0 ? String(reading.window.mean, 2) : String("null"));
+    json += ",\"u\":\"" + String(sensorRegistry.channelUnit(i)) + "\"}";
+  }
+  json += "}}";
+  return empty ? String() : json;
+}
+
+LiveStatus currentLiveStatus() {
+  LiveStatus status;
+  status.freeHeap = ESP.getFreeHeap();
+  status.wifiConnected = WiFi.status() == WL_CONNECTED;
+  status.rssi = status.wifiConnected ? WiFi.RSSI() : 0;
+  status.mqttConnected = mqttManager.isConnected();
+  return status;
+}
+
+String buildStatusEvent(const LiveStatus& status) {
+  return "{\"heap\":" + String(status.freeHeap) + ",\"rssi\":" + String(status.rssi) +
+         ",\"wifi\":" + String(status.wifiConnected ? "true" : "false") +
+         ",\"mqtt\":" + String(status.mqttConnected ? "true" : "false") + "}";
+}
+
+// GET /events: subscribe and receive the full state, then deltas
+void handleEvents() {
+  int slot = liveEvents.subscribe(server.client());
+  if (slot < 0) {
+    server.send(503, "text/plain", "Too many live viewers");
+    return;
+  }
+  
+  SensorSnapshot sensors;
+  sensorSampler.read(sensors);
+  liveEvents.send(slot, "sensors", buildSensorEvent(sensors, true).c_str());
+  liveEvents.send(slot, "status", buildStatusEvent(currentLiveStatus()).c_str());
+  DLOG_I(logWeb, "Live viewer connected (%u/%u)", (unsigned)liveEvents.subscriberCount(), (unsigned)EVENT_STREAM_MAX_SUBSCRIBERS);
+}
+
+// Pushes are built once per change and shared by every viewer; nothing is
+// computed while nobody is subscribed
+void pushLiveUpdates(unsigned long currentTime) {
+  WatchdogScope watchdogScope(liveUpdatesSection);
+  liveEvents.poll(currentTime);
+  if (!liveEvents.hasSubscribers()) {
+    return;
+  }
+  
+  if (sensorSampler.sequence() != lastLiveSequence) {
+    SensorSnapshot sensors;
+    sensorSampler.read(sensors);
+    uint32_t sent = 0;
+    String event = buildSensorEvent(sensors, false, &sent);
+    if (event.length() > 0) {
+      liveEvents.broadcast("sensors", event.c_str());
+      // Channels left out keep their baseline, so slow drift still adds up to a push
+      for (int i = 0; i < sensors.channelCount; i++) {
+        if (sent & (1UL << i)) {
+          lastLiveValue[i] = sensors.readings[i].valid ? sensors.readings[i].value : NAN;
+        }
+      }
+    }
+    lastLiveSequence = sensors.sequence;
+  }
+  
+  if (currentTime - lastLiveStatusCheck >= LIVE_STATUS_INTERVAL) {
+    lastLiveStatusCheck = currentTime;
+    LiveStatus status = currentLiveStatus();
+    bool changed = status.wifiConnected != lastLiveStatus.wifiConnected ||
+                   status.mqttConnected != lastLiveStatus.mqttConnected ||
+                   abs(status.rssi - lastLiveStatus.rssi) >= 3 ||
+                   abs((int32_t)(status.freeHeap - lastLiveStatus.freeHeap)) >= 1024;
+    if (changed) {
+      liveEvents.broadcast("status", buildStatusEvent(status).c_str());
+      lastLiveStatus = status;
+    }
+  }
+}
+
+// --- Boot Status ---
+const char* resetReasonName(esp_reset_reason_t reason) {
+  switch (reason) {
+    case ESP_RST_POWERON: return "power_on";
+    case ESP_RST_EXT: return "external";
+    case ESP_RST_SW: return "software";
+    case ESP_RST_PANIC: return "panic";
+    case ESP_RST_INT_WDT: return "interrupt_watchdog";
+    case ESP_RST_TASK_WDT: return "task_watchdog";
+    case ESP_RST_WDT: return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deep_sleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    case ESP_RST_SDIO: return "sdio";
+    default: return "unknown";
+  }
+}
+
+// Phase and milestone times in ms since reset. A phase that has not ended
+// has "end_ms": null; a milestone that has not happened is null.
+void handleBootApi() {
+  HeapScope heapScope(heapMonitor, HEAP_TAG_JSON);
+  String phases = "";
+  String milestones = "";
+  for (size_t i = 0; i < bootTimeline.count(); i++) {
+    BootTimeline::Entry entry;
+    if (!bootTimeline.get(i, entry)) {
+      break;
+    }
+    if (entry.milestone) {
+      milestones += ",\"" + String(entry.name) + "_ms\":" + String(entry.startMs);
+      continue;
+    }
+    if (phases.length() > 0) phases += ",";
+    phases += "{\"name\":\"" + String(entry.name) + "\",\"start_ms\":" + String(entry.startMs);
+    if (entry.running) {
+      phases += ",\"end_ms\":null,\"duration_ms\":null}";
+    } else {
+      phases += ",\"end_ms\":" + String(entry.endMs) + ",\"duration_ms\":" + String(entry.endMs - entry.startMs) + "}";
+    }
+  }
+  
+  // The milestones this release is compared on are always present
+  const char* tracked[] = {"setup_done", "first_http_response", "mqtt_connected", "first_publish"};
+  for (size_t i = 0; i < sizeof(tracked) / sizeof(tracked[0]); i++) {
+    if (!bootTimeline.has(tracked[i])) {
+      milestones += ",\"" + String(tracked[i]) + "_ms\":null";
+    }
+  }
+  
+  const char* currentJob = backgroundJobs.currentJob();
+  String json = "{\"firmware_version\":" + String(FIRMWARE_VERSION);
+  json += ",\"reset_reason\":\"" + String(resetReasonName(esp_reset_reason())) + "\"";
+  json += ",\"uptime_ms\":" + String(millis());
+  json += ",\"phases\":[" + phases + "]";
+  json += ",\"milestones\":{" + (milestones.length() > 0 ? milestones.substring(1) : String("")) + "}";
+  json += ",\"wifi\":{\"state\":\"" + String(wifiConnection.stateName()) + "\"";
+  json += ",\"last_connect_ms\":" + String(wifiConnection.getLastConnectMs());
+  json += ",\"last_connect_fast\":" + String(wifiConnection.lastConnectWasFast() ? "true" : "false");
+  json += ",\"fast_connects\":" + String(wifiConnection.getFastConnects());
+  json += ",\"scan_connects\":" + String(wifiConnection.getScanConnects());
+  json += ",\"disconnects\":" + String(wifiConnection.getDisconnects()) + "}";
+  if (currentJob != nullptr) {
+    json += ",\"jobs\":{\"current\":\"" + String(currentJob) + "\"";
+  } else {
+    json += ",\"jobs\":{\"current\":null";
+  }
+  json += ",\"pending\":" + String(backgroundJobs.pendingCount());
+  json += ",\"completed\":" + String(backgroundJobs.getCompletedCount()) + "}";
+  
+  // Stalls per section since boot, and the section a watchdog reset was stuck in
+  const WatchdogEscalation* escalation = LoopWatchdog::lastEscalation();
+  json += ",\"watchdog\":{\"stalls\":{";
+  bool firstSection = true;
+  for (const WatchdogSection* entry = WatchdogSection::first(); entry != nullptr; entry = entry->next()) {
+    if (entry->stallCount() == 0) {
+      continue;
+    }
+    json += String(firstSection ? "" : ",") + "\"" + entry->name() + "\":{\"count\":" + String(entry->stallCount());
+    json += ",\"longest_ms\":" + String(entry->longestStallMs()) + "}";
+    firstSection = false;
+  }
+  json += "},\"last_reset\":";
+  if (escalation != nullptr) {
+    json += "{\"section\":\"" + String(escalation->section) + "\"";
+    json += ",\"duration_ms\":" + String(escalation->durationMs);
+    json += ",\"stack_free_bytes\":" + String(escalation->stackFreeBytes) + "}";
   } else {
-    Serial.println("✓ Templates exist and firmware version matches");
+    json += "null";
+  }
+  json += "}}";
+  
+  server.send(200, "application/json", json);
+}
+
+// --- Heap Status ---
+// Current heap, what each subsystem has retained, and the sample series
+// (one row per HEAP_SAMPLE_INTERVAL, oldest first, columns as listed)
+void handleHeapApi() {
+  uint32_t heapFree = HeapMonitor::freeBytes();
+  uint32_t heapLargest = HeapMonitor::largestFreeBlock();
+  
+  String json;
+  json.reserve(HEAP_CHUNK_SIZE + 160);
+  json = "{\"free\":" + String(heapFree);
+  json += ",\"min_free\":" + String(ESP.getMinFreeHeap());
+  json += ",\"largest_free_block\":" + String(heapLargest);
+  json += ",\"fragmentation\":" + String(HeapMonitor::fragmentation(heapFree, heapLargest), 3);
+  json += ",\"tags\":{";
+  for (int i = 0; i < heapMonitor.tagCount(); i++) {
+    HeapMonitor::TagStats stats = heapMonitor.tagStats(i);
+    if (i > 0) {
+      json += ",";
+    }
+    json += "\"" + String(heapMonitor.tagName(i)) + "\":{\"scopes\":" + String(stats.scopes);
+    json += ",\"retained\":" + String(stats.retained);
+    json += ",\"high_water\":" + String(stats.highWater);
+    json += ",\"largest_scope\":" + String(stats.largestScope);
+    json += ",\"block_loss\":" + String(stats.blockLoss) + "}";
+  }
+  json += "},\"interval_s\":" + String(heapMonitor.sampleIntervalMs() / 1000);
+  json += ",\"columns\":[\"uptime_s\",\"free\",\"largest_free_block\",\"min_free\",\"fragmentation\"";
+  for (int i = 0; i < heapMonitor.tagCount(); i++) {
+    json += ",\"" + String(heapMonitor.tagName(i)) + "\"";
+  }
+  json += "],\"samples\":[";
+  
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  size_t count = heapMonitor.sampleCount();
+  for (size_t i = 0; i < count; i++) {
+    HeapMonitor::Sample sample;
+    if (!heapMonitor.getSample(i, sample)) {
+      break;
+    }
+    if (i > 0) {
+      json += ",";
+    }
+    json += "[" + String(sample.uptimeS) + "," + String(sample.freeBytes) + "," + String(sample.largestBlock) + "," +
+            String(sample.minFreeBytes) + "," + String(HeapMonitor::fragmentation(sample.freeBytes, sample.largestBlock), 3);
+    for (int t = 0; t < heapMonitor.tagCount(); t++) {
+      json += "," + String(sample.retained[t]);
+    }
+    json += "]";
+    if (json.length() >= HEAP_CHUNK_SIZE) {
+      server.sendContent(json);
+      json = "";
+    }
+  }
+  json += "]}";
+  server.sendContent(json);
+  server.sendContent(""); // Terminates the chunked response
+}
+
+// --- Logs ---
+// GET: recent log lines as text, from ?since= (the X-Log-Next header of the
+// previous response) on. POST ?module=&level=: change a module's level.
+// Both end with the modules and their levels.
+void handleLogsApi() {
+  if (server.method() == HTTP_POST) {
+    LogModule* module = LogModule::find(server.arg("module").c_str());
+    uint8_t level;
+    if (module == nullptr || !DeviceLog::parseLevel(server.arg("level").c_str(), level)) {
+      server.send(400, "text/plain", "Unknown module or level");
+      return;
+    }
+    module->setLevel(level);
+    DLOG_I(logWeb, "Log level of %s set to %s", module->name(), DeviceLog::levelName(level));
+  }
+  
+  uint32_t since = server.hasArg("since") ? strtoul(server.arg("since").c_str(), nullptr, 10) : 0;
+  uint32_t next = DeviceLog::lineCount(); // The body stops here too, so no line comes twice
+  server.sendHeader("X-Log-Next", String(next));
+  server.sendHeader("Cache-Control", "no-store");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/plain; charset=utf-8", "");
+  TemplateWriter writer;
+  writer.used = 0;
+  if (server.method() != HTTP_POST) {
+    DeviceLog::writeRecent(writeTemplateChunk, &writer, since, next);
+  }
+  
+  String footer = "# dropped " + String(DeviceLog::droppedCount()) + ", compiled level " +
+                  DeviceLog::levelName(DLOG_MIN_LEVEL) + "\n";
+  for (const LogModule* module = LogModule::first(); module != nullptr; module = module->next()) {
+    footer += "# module " + String(module->name()) + " " + DeviceLog::levelName(module->level()) + "\n";
+  }
+  writeTemplateChunk(footer.c_str(), footer.length(), &writer);
+  flushTemplateWriter(writer);
+  server.sendContent(""); // Terminates the chunked response
+}
+
+// --- Metrics Export ---
+// Register a route's latency series; returns path so it can wrap the server.on() argument
+const char* timedRoute(const char* path) {
+  if (routeMetricCount < HTTP_MAX_ROUTE_METRICS) {
+    // Label text lives as long as the histogram, i.e. until reboot
+    String labels = "route=\"" + String(path) + "\"";
+    routeMetrics[routeMetricCount].path = path;
+    routeMetrics[routeMetricCount].latency = new MetricHistogram("http_request_duration_seconds", HTTP_LATENCY_HELP,
+                                                                 strdup(labels.c_str()));
+    routeMetricCount++;
+  }
+  return path;
+}
+
+// Unregistered paths (404s, scanners) share one series so the label set stays bounded
+MetricHistogram& routeLatency(const String& uri) {
+  for (size_t i = 0; i < routeMetricCount; i++) {
+    if (uri == routeMetrics[i].path) {
+      return *routeMetrics[i].latency;
+    }
+  }
+  return httpOtherLatency;
+}
+
+#ifdef SPAN_TRACING
+// Span name of a request: its registered path
+const char* routeName(const String& uri) {
+  for (size_t i = 0; i < routeMetricCount; i++) {
+    if (uri == routeMetrics[i].path) {
+      return routeMetrics[i].path;
+    }
+  }
+  return "http.other";
+}
+
+// --- Trace Export ---
+// The span ring as Chrome trace-event JSON; open the file in Perfetto or chrome://tracing
+void handleTraceApi() {
+  server.sendHeader("Content-Disposition", "attachment; filename=\"trace.json\"");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "application/json", "");
+  TemplateWriter writer;
+  writer.used = 0;
+  Tracer::write(writeTemplateChunk, &writer);
+  flushTemplateWriter(writer);
+  server.sendContent(""); // Terminates the chunked response
+}
+#endif
+
+// Prometheus text format; gauges are sampled here, everything else is updated where it happens
+void handleMetrics() {
+  heapFreeGauge.set(ESP.getFreeHeap());
+  heapMinFreeGauge.set(ESP.getMinFreeHeap());
+  uptimeGauge.set(millis() / 1000.0f);
+  wifiRssiGauge.set(wifiConnection.isConnected() ? WiFi.RSSI() : NAN);
+  mqttConnectedGauge.set(mqttManager.isConnected() ? 1 : 0);
+  jobsPendingGauge.set(backgroundJobs.pendingCount());
+  uint32_t heapFree = HeapMonitor::freeBytes();
+  uint32_t heapLargest = HeapMonitor::largestFreeBlock();
+  heapLargestBlockGauge.set(heapLargest);
+  heapFragmentationGauge.set(HeapMonitor::fragmentation(heapFree, heapLargest));
+  for (int i = 0; i < HEAP_TAG_COUNT; i++) {
+    heapRetainedGauges[i].set(heapMonitor.tagStats(i).retained);
+  }
+  
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, ESPMetrics::CONTENT_TYPE, "");
+  TemplateWriter writer;
+  writer.used = 0;
+  ESPMetrics::write(writeTemplateChunk, &writer);
+  flushTemplateWriter(writer);
+  server.sendContent(""); // Terminates the chunked response
+}
+
+void serveHttp() {
+  WatchdogScope watchdogScope(httpSection);
+  requestProbe.dispatched = false;
+  uint32_t start = micros();
+  {
+    HeapScope heapScope(heapMonitor, HEAP_TAG_WEB);
+    server.handleClient();
+  }
+  if (requestProbe.dispatched) {
+    uint32_t elapsed = micros() - start;
+    routeLatency(requestProbe.uri).observe(elapsed);
+    TRACE_SPAN_US(routeName(requestProbe.uri), elapsed);
+  }
+  if (requestProbe.seen && !firstHttpRecorded) {
+    bootTimeline.mark("first_http_response");
+    firstHttpRecorded = true;
   }
 }
 
 // --- Web Server Setup ---
 void setupWebServer() {
-  // Initialize mDNS
-  if (!MDNS.begin(client_id.c_str())) {
-    Serial.println("ERROR: mDNS failed to start");
-  } else {
-    MDNS.addService("http", "tcp", 80);
-    Serial.printf("✓ mDNS: http://%s.local\n", client_id.c_str());
-  }
+  // Consulted before every route, so it must be added first
+  server.addHandler(&requestProbe);
   
   // Setup routes
-  server.on("/", handleRoot);
-  server.on("/set", HTTP_POST, handleSetClientId);
-  server.on("/brightness", HTTP_POST, handleBrightness);
-  server.on("/reboot", handleReboot);
+  server.on(timedRoute("/"), handleRoot);
+  server.on(timedRoute("/set"), HTTP_POST, handleSetClientId);
+  server.on(timedRoute("/brightness"), HTTP_POST, handleBrightness);
+  server.on(timedRoute("/reboot"), handleReboot);
   
   // File management routes
-  server.on("/files", handleFileList);
-  server.on("/download", handleFileDownload);
-  server.on("/upload", HTTP_POST, handleFileUploadComplete, handleFileUpload);
+  server.on(timedRoute("/files"), handleFileList);
+  server.on(timedRoute("/download"), handleFileDownload);
+  server.on(timedRoute("/upload"), HTTP_POST, handleFileUploadComplete, handleFileUpload);
   
   // Firmware upload routes
-  server.on("/firmware", []() {
-    String html = loadTemplate("firmware_upload.html");
-    server.send(200, "text/html", html);
+  server.on(timedRoute("/firmware"), []() {
+    sendTemplate("/templates/firmware_upload.html");
   });
-  server.on("/firmware-upload", HTTP_POST, handleFirmwareUploadComplete, handleFirmwareUpload);
+  server.on(timedRoute("/firmware-upload"), HTTP_POST, handleFirmwareUploadComplete, handleFirmwareUpload);
   
   // WiFi configuration routes
-  server.on("/wifi", handleWifiConfig);
-  server.on("/wifi-update", HTTP_POST, handleWifiUpdate);
-  server.on("/scan-networks", handleNetworkScan);
+  server.on(timedRoute("/wifi"), handleWifiConfig);
+  server.on(timedRoute("/wifi-update"), HTTP_POST, handleWifiUpdate);
+  server.on(timedRoute("/scan-networks"), handleNetworkScan);
   
   // Template update routes
-  server.on("/update-template", handleUpdateTemplate);
-  server.on("/update-template-action", HTTP_POST, handleUpdateTemplateAction);
-  server.on("/force-template-update", HTTP_POST, handleForceTemplateUpdate);
+  server.on(timedRoute("/update-template"), handleUpdateTemplate);
+  server.on(timedRoute("/update-template-action"), HTTP_POST, handleUpdateTemplateAction);
+  server.on(timedRoute("/force-template-update"), HTTP_POST, handleForceTemplateUpdate);
   
   // Debug page route
-  server.on("/debug", handleDebug);
+  server.on(timedRoute("/debug"), handleDebug);
+  
+  // JSON API routes
+  server.on(timedRoute("/api/v1/sensors"), HTTP_GET, handleSensorsApi);
+  server.on(timedRoute("/api/v1/history"), HTTP_GET, handleHistoryApi);
+  server.on(timedRoute("/api/v1/files"), HTTP_GET, handleFilesApi);
+  server.on(timedRoute("/api/v1/boot"), HTTP_GET, handleBootApi);
+  server.on(timedRoute("/api/v1/heap"), HTTP_GET, handleHeapApi);
+  server.on(timedRoute("/api/v1/logs"), handleLogsApi);
+#ifdef SPAN_TRACING
+  server.on(timedRoute("/api/v1/trace"), HTTP_GET, handleTraceApi);
+#endif
+  server.on(timedRoute("/events"), HTTP_GET, handleEvents);
+  server.on(timedRoute("/metrics"), HTTP_GET, handleMetrics);
+  
+  // Headers the download handler needs (WebServer drops all others)
+  static const char* collectedHeaders[] = {"Range", "If-Range", "If-None-Match", "If-Modified-Since"};
+  server.collectHeaders(collectedHeaders, sizeof(collectedHeaders) / sizeof(collectedHeaders[0]));
   
   server.begin();
-  Serial.printf("✓ Web server: http://%s\n", WiFi.localIP().toString().c_str());
+  DLOG_I(logApp, "✓ Web server listening on port 80");
 }
 
 // --- Configuration Management ---
-void loadClientId() {
-  preferences.begin("esp-config", true); // read-only
-  client_id = preferences.getString("client_id", "ESP_Default");
-  ledBrightness = preferences.getInt("led_brightness", 128);
+// The only NVS read of the device settings; everything else reads deviceConfig
+void loadConfiguration() {
+  DeviceConfigDefaults defaults = {
+    DEFAULT_CLIENT_ID,
+    DEFAULT_LED_BRIGHTNESS,
+    ESPMQTTManager::TELEMETRY_ASCII,
+    DEFAULT_WIFI_SSID,
+    DEFAULT_WIFI_PASSWORD
+  };
+  deviceConfig.begin(defaults);
   
-  // Load WiFi credentials if saved
-  String saved_ssid = preferences.getString("wifi_ssid", "");
-  String saved_password = preferences.getString("wifi_password", "");
+  // Update MQTT topics with loaded client_id
+  mqttManager.updateTopics(deviceConfig.clientId());
+  mqttManager.setTelemetryEncoding(deviceConfig.telemetryFormat() == ESPMQTTManager::TELEMETRY_CBOR ?
+                                   ESPMQTTManager::TELEMETRY_CBOR : ESPMQTTManager::TELEMETRY_ASCII);
   
-  preferences.end();
+  DLOG_I(logApp, "✓ Client ID: %s", deviceConfig.clientId());
+  DLOG_I(logApp, "✓ LED Brightness: %d", deviceConfig.ledBrightness());
+  DLOG_I(logApp, "✓ WiFi: %s", deviceConfig.wifiSsid());
+}
+
+// --- Low-Power Wake Cycle ---
+#ifdef LOW_POWER_PROFILE
+// One point sample of each built-in sensor; failed reads are NAN
+void readLowPowerSample(float* values) {
+  for (int i = 0; i < METRIC_COUNT; i++) {
+    values[i] = NAN;
+  }
   
-  // Update WiFi credentials if they were saved
-  if (saved_ssid.length() > 0) {
-    wifi_ssid = saved_ssid;
-    wifi_password = saved_password;
+  if (cpuSensor.begin()) {
+    cpuSensor.read(&values[METRIC_CPU_TEMP]);
   }
   
-  // Update MQTT topics with loaded client_id
-  mqttManager.updateTopics(client_id);
+  // The DHT22 stays powered through deep sleep, so its first read after a wake is valid
+  float dht[DHT22Sensor::CHANNEL_COUNT];
+  if (dhtSensor.begin() && dhtSensor.read(dht) == SENSOR_READ_OK) {
+    values[METRIC_DHT_TEMP] = dht[0];
+    values[METRIC_DHT_HUMIDITY] = dht[1];
+  }
+}
+
+// Send the buffered records oldest first, stopping at the first failure
+void publishLowPowerBatch() {
+  // A wake-up connect is normally done before NTP answers
+  unsigned long ntpStart = millis();
+  while (sntp_get_sync_status() != SNTP_SYNC_STATUS_COMPLETED && millis() - ntpStart < LOW_POWER_NTP_TIMEOUT) {
+    delay(20);
+  }
   
-  Serial.printf("✓ Client ID: %s\n", client_id.c_str());
-  Serial.printf("✓ LED Brightness: %d\n", ledBrightness);
-  if (saved_ssid.length() > 0) {
-    Serial.printf("✓ Saved WiFi: %s\n", saved_ssid.c_str());
+  struct timeval now;
+  gettimeofday(&now, nullptr);
+  bool clockValid = now.tv_sec >= MIN_VALID_EPOCH;
+  uint64_t nowMs = (uint64_t)now.tv_sec * 1000 + now.tv_usec / 1000;
+  uint32_t awakeMs = millis();
+  
+  size_t pending = dutyCycle.pending();
+  size_t sent = 0;
+  float latest[METRIC_COUNT];
+  while (sent < pending) {
+    const DutyCycleRecord& record = dutyCycle.record(sent);
+    uint64_t timestamp = clockValid ? nowMs - dutyCycle.recordAgeMs(sent, awakeMs) : record.clockMs;
+    if (!mqttManager.publishTelemetry(TELEMETRY_SCHEMA_ENV_BATCH_V3, timestamp, record.values, METRIC_COUNT)) {
+      break;
+    }
+    memcpy(latest, record.values, sizeof(latest));
+    sent++;
+  }
+  dutyCycle.published(sent);
+  if (sent < pending) {
+    dutyCycle.publishFailed();
+  }
+  DLOG_I(logApp, "Low-power session: %u of %u records published%s", (unsigned)sent, (unsigned)pending,
+                 clockValid ? "" : " (clock not synced)");
+  
+  // Newest values on the per-metric topics as well, for dashboards
+  if (sent > 0) {
+    for (int i = 0; i < METRIC_COUNT; i++) {
+      if (!isnan(latest[i])) {
+        publishChannel(i, latest[i]);
+      }
+    }
   }
 }
 
+// Bring up WiFi (fast reconnect from the RTC link) and MQTT, publish the batch
+// and take the network down again
+void runLowPowerSession() {
+  loadConfiguration();
+  uint32_t cachedServer;
+  if (deviceConfig.getBlob("mqtt_server", &cachedServer, sizeof(cachedServer))) {
+    mqtt_server_ip = IPAddress(cachedServer).toString();
+    mqttManager.updateServerIP(mqtt_server_ip.c_str());
+  }
+  mqttManager.begin(deviceConfig.clientId());
+  
+  WiFiLink storedLink;
+  bool haveLink = deviceConfig.getBlob("wifi_link", &storedLink, sizeof(storedLink));
+  wifiConnection.setLinkCallback(onWiFiLinkChanged);
+  wifiConnection.begin(deviceConfig.wifiSsid(), deviceConfig.wifiPassword(), haveLink ? &storedLink : nullptr);
+  
+  bool ntpStarted = false;
+  unsigned long start = millis();
+  while (!mqttManager.isConnected() && millis() - start < LOW_POWER_CONNECT_TIMEOUT) {
+    wifiConnection.loop(millis());
+    if (wifiConnection.isConnected()) {
+      if (!ntpStarted) {
+        configTime(0, 0, NTP_SERVER_PRIMARY, NTP_SERVER_SECONDARY);
+        ntpStarted = true;
+      }
+      mqttManager.connect();
+    }
+    delay(10);
+  }
+  
+  if (mqttManager.isConnected()) {
+    dutyCycle.connected();
+    publishLowPowerBatch();
+    mqttManager.disconnect();
+    delay(LOW_POWER_FLUSH_DELAY);
+  } else {
+    DLOG_W(logApp, "Low-power session: no connection (WiFi %s), keeping %u records", wifiConnection.stateName(),
+                   (unsigned)dutyCycle.pending());
+    dutyCycle.connectFailed();
+  }
+  
+  // Deep sleep skips the shutdown handler that would save a changed WiFi link
+  deviceConfig.flush();
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+}
+
+// One wake: sample, publish the batch if a session is due, sleep. Never returns;
+// the next wake starts again from reset.
+void runLowPowerWake() {
+  Serial.begin(115200);
+  DeviceLog::begin(Serial);
+  dutyCycle.begin(esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER, METRIC_COUNT);
+  
+  float values[METRIC_COUNT];
+  readLowPowerSample(values);
+  dutyCycle.addSample(values);
+  
+  const DutyCycleState& state = dutyCycle.state();
+  DLOG_I(logApp, "Wake %lu: %u records buffered, next step %s", (unsigned long)state.wakes,
+                 (unsigned)dutyCycle.pending(), DutyCycleController::phaseName(dutyCycle.phase()));
+  
+  if (dutyCycle.phase() == DUTY_CYCLE_CONNECT) {
+    runLowPowerSession();
+  }
+  
+  uint32_t sleepMs = dutyCycle.sleepMs(millis());
+  DLOG_I(logApp, "Sleeping %lu ms (awake %lu ms, duty cycle %.2f%%, %lu sessions, %lu failed, %lu dropped)",
+                 (unsigned long)sleepMs, (unsigned long)state.lastAwakeMs, dutyCycle.dutyCycle() * 100,
+                 (unsigned long)state.sessions, (unsigned long)state.failedSessions, (unsigned long)state.dropped);
+  DeviceLog::flush();
+  esp_sleep_enable_timer_wakeup((uint64_t)sleepMs * 1000);
+  esp_deep_sleep_start();
+}
+#endif
+
+// Only local work happens here, so the web server is up within a second or
+// two of reset; anything that needs the network runs from loop() once WiFi
+// connects (startNetworkServices()), the slow parts on the background job task.
 void setup() {
+#ifdef LOW_POWER_PROFILE
+  runLowPowerWake(); // Ends in deep sleep; loop() never runs
+#endif
+  bootTimeline.begin("setup");
+  
+  for (int i = 0; i < HEAP_TAG_COUNT; i++) {
+    heapMonitor.addTag(HEAP_TAG_NAMES[i]);
+  }
+  heapMonitor.begin(HEAP_SAMPLE_INTERVAL);
+#ifdef SPAN_TRACING
+  Tracer::begin(psramFound() ? TRACE_BUFFER_EVENTS : 512); // 48 KB in PSRAM, 12 KB of internal RAM otherwise
+#endif
+  
   // Initialize serial communication
   Serial.begin(115200);
-  Serial.println("\n=== ESP32 IoT Device Starting ===");
-  Serial.printf("Board Type: %s\n", getBoardType().c_str());
-  Serial.printf("Firmware Version: %d (v%d.%d)\n", FIRMWARE_VERSION, FIRMWARE_VERSION/100, FIRMWARE_VERSION%100);
+  DeviceLog::begin(Serial);
+  DLOG_I(logApp, "=== ESP32 IoT Device Starting ===");
+  DLOG_I(logApp, "Board Type: %s", getBoardType().c_str());
+  DLOG_I(logApp, "Firmware Version: %d (v%d.%d)", FIRMWARE_VERSION, FIRMWARE_VERSION/100, FIRMWARE_VERSION%100);
+  
+  // Watch this task (loop() runs on it too) for sections that overrun their budget
+  LoopWatchdog::begin(LOOP_WATCHDOG_ESCALATE_MS);
+  const WatchdogEscalation* escalation = LoopWatchdog::lastEscalation();
+  if (escalation != nullptr) {
+    DLOG_E(logApp, "Reset by the loop watchdog: %s hung for %lu ms (%lu bytes of stack never used)",
+           escalation->section, (unsigned long)escalation->durationMs, (unsigned long)escalation->stackFreeBytes);
+  }
   
   // Initialize hardware
   ledcSetup(ledChannel, ledFreq, ledResolution);
   ledcAttachPin(ledPin, ledChannel);
   ledcWrite(ledChannel, 0); // Start with LED off
   
-  // Initialize DHT sensor
-  dht.begin();
-  Serial.println("✓ DHT22 sensor initialized");
+  // Register sensors and start background sampling
+  bootTimeline.begin("sensors");
+  registerSensors();
+  sensorSampler.setWindow(SENSOR_STATS_WINDOW);
+  sensorSampler.begin(SensorRegistry::sampleFunction, &sensorRegistry);
+  bootTimeline.end("sensors");
   
   // Initialize filesystem
+  bootTimeline.begin("filesystem");
   if (!LittleFS.begin(true)) {
-    Serial.println("ERROR: Failed to mount LittleFS");
+    DLOG_E(logApp, "ERROR: Failed to mount LittleFS");
     return;
   }
-  Serial.println("✓ LittleFS mounted");
+  DLOG_I(logApp, "✓ LittleFS mounted");
+  if (history.begin()) {
+    DLOG_I(logApp, "✓ History store: %u bytes", (unsigned)history.totalBytes());
+  }
+  bootTimeline.end("filesystem");
 
   // Load saved configuration
-  loadClientId();
-
-  // Connect to WiFi
+  bootTimeline.begin("config");
+  loadConfiguration();
+  loadPublishPolicies();
+  registerMQTTCommands();
+  bootTimeline.end("config");
+
+  // Serve whatever templates are on flash; the template sync job refreshes them
+  bootTimeline.begin("templates");
+  templateCache.addPath("/index.html");
+  templateCache.addPath("/templates");
+  templateCache.begin();
+  bootTimeline.end("templates");
+
+  // Connect to WiFi (finishes in the background)
   setup_wifi();
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("ERROR: Cannot continue without WiFi");
-    return;
-  }
-  
-  // Ensure web template exists and is up to date
-  ensureTemplateExists();
-
-  // Debug: List all files in LittleFS
-  Serial.println("=== LittleFS Contents ===");
-  File root = LittleFS.open("/");
-  File file = root.openNextFile();
-  while (file) {
-    if (file.isDirectory()) {
-      Serial.printf("DIR:  %s\n", file.name());
-      File subFile = file.openNextFile();
-      while (subFile) {
-        Serial.printf("  FILE: %s (%d bytes)\n", subFile.name(), subFile.size());
-        subFile = file.openNextFile();
-      }
-    } else {
-      Serial.printf("FILE: %s (%d bytes)\n", file.name(), file.size());
-    }
-    file = root.openNextFile();
-  }
-  root.close();
-  Serial.println("=== End LittleFS Contents ===");
 
   // Initialize web server
+  bootTimeline.begin("web_server");
   setupWebServer();
+  bootTimeline.end("web_server");
 
-  // Initialize OTA updater
+  // Initialize OTA updater; the first check is a background job
   otaUpdater.setUpdateAvailableCallback(onUpdateAvailable);
   otaUpdater.setUpdateProgressCallback(onUpdateProgress);
   otaUpdater.setUpdateCompleteCallback(onUpdateComplete);
   otaUpdater.setBoardType(getBoardType());
   otaUpdater.enableAutoUpdate(false); // Disable auto-update to prevent duplicates
-
-  // Perform initial update check
-  Serial.println("Checking for firmware updates...");
-  otaUpdater.checkForUpdates();
-  lastUpdateCheck = millis();
   
-  // Initialize MQTT (moved to end for better stability)
-  mqtt_server_ip = mqttManager.discoverServer();
-  mqttManager.updateServerIP(mqtt_server_ip);
-  mqttManager.begin(client_id);
-  Serial.printf("✓ MQTT server: %s\n", mqtt_server_ip.c_str());
+  // Initialize MQTT with the broker found last time; discovery runs once WiFi is up
+  uint32_t cachedServer;
+  if (deviceConfig.getBlob("mqtt_server", &cachedServer, sizeof(cachedServer))) {
+    mqtt_server_ip = IPAddress(cachedServer).toString();
+    mqttManager.updateServerIP(mqtt_server_ip.c_str());
+  }
+  mqttManager.begin(deviceConfig.clientId());
+  DLOG_I(logApp, "✓ MQTT server: %s", mqtt_server_ip.c_str());
+  
+  backgroundJobs.begin(BACKGROUND_JOB_STACK);
   
-  Serial.println("=== Setup Complete ===\n");
+  bootTimeline.end("setup");
+  bootTimeline.mark("setup_done");
+  DLOG_I(logApp, "=== Setup Complete (%lu ms) ===", millis());
 }
 
 void loop() {
   unsigned long currentTime = millis();
   
   // LED heartbeat indicator
-  ledcWrite(ledChannel, ledBrightness);
+  ledcWrite(ledChannel, deviceConfig.ledBrightness());
   delay(LED_PULSE_DURATION);
   ledcWrite(ledChannel, 0);
+  uint32_t workStart = micros();
+  WatchdogScope watchdogScope(loopSection);
   
   // Handle web server requests
-  server.handleClient();
+  serveHttp();
+  {
+    WatchdogScope wifiScope(wifiSection);
+    wifiConnection.loop(currentTime);
+  }
+  
+  // Deferred boot work, once per boot when WiFi first comes up
+  if (!networkStarted && wifiConnection.isConnected()) {
+    networkStarted = true;
+    startNetworkServices();
+  }
   
   // MQTT connection and message handling
-  if (!mqttManager.isConnected()) {
-    mqttManager.connect();
+  if (!mqttManager.isConnected() && wifiConnection.isConnected()) {
+    WatchdogScope connectScope(mqttConnectSection);
+    if (mqttManager.connect()) {
+      bootTimeline.mark("mqtt_connected");
+    }
+  }
+  {
+    TRACE_SCOPE("mqtt.loop");
+    WatchdogScope mqttScope(mqttLoopSection);
+    HeapScope heapScope(heapMonitor, HEAP_TAG_MQTT);
+    mqttManager.loop();
   }
-  mqttManager.loop();
 
-  // Periodic tasks with timing
-  
-  // WiFi connection monitoring (every 30 seconds)
-  if (currentTime - lastWiFiCheck > wifiCheckInterval) {
-    checkWiFiConnection();
-    lastWiFiCheck = currentTime;
+  // Apply the results of finished background jobs
+  {
+    WatchdogScope jobsScope(jobsSection);
+    backgroundJobs.poll();
   }
+
+  // Periodic tasks with timing
   
-  // Environmental data publishing (every 10 seconds)
-  if (mqttManager.shouldPublishTemperature(currentTime)) {
-    float cpuTemp = readCPUTemperature();
-    float dhtTemp = readDHTTemperature();
-    float dhtHumidity = readDHTHumidity();
-    
-    // Publish CPU temperature (for system monitoring)
-    mqttManager.publishCpuTemperature(cpuTemp);
-    // mqttManager.publishTemperature(dhtTemp);
-    // Publish DHT22 data (environmental monitoring)
-    if (dhtTemp != -999.0) {
-      Serial.printf("DHT Temperature: %.1f°C\n", dhtTemp);
-      mqttManager.publishTemperature(dhtTemp);
-      // TODO: Add publishEnvironmentalTemperature method to MQTT manager
+  // Policy-driven publishing of each new sample set (the sampler task reads every 2 seconds)
+  if (sensorSampler.sequence() != lastPublishedSample) {
+    SensorSnapshot sensors;
+    sensorSampler.read(sensors);
+    {
+      TRACE_SCOPE("publish");
+      WatchdogScope publishScope(publishSection);
+      HeapScope heapScope(heapMonitor, HEAP_TAG_MQTT);
+      publishSensorReadings(sensors, currentTime);
     }
-    
-    if (dhtHumidity != -999.0) {
-      Serial.printf("DHT Humidity: %.1f%%\n", dhtHumidity);
-      // TODO: Add publishHumidity method to MQTT manager
+    {
+      TRACE_SCOPE("history");
+      WatchdogScope historyScope(historySection);
+      recordHistory(sensors);
     }
-    
-    mqttManager.updateLastPublishTime(currentTime);
+    lastPublishedSample = sensors.sequence;
   }
 
   // Firmware version publishing (every 5 minutes)
   if (mqttManager.shouldPublishFirmwareVersion(currentTime)) {
+    WatchdogScope publishScope(publishSection);
     mqttManager.publishFirmwareVersion(FIRMWARE_VERSION);
     mqttManager.updateLastVersionPublishTime(currentTime);
   }
 
+  // Write back settings changed from the web UI or MQTT once they settle
+  {
+    WatchdogScope configScope(configSection);
+    deviceConfig.loop(currentTime);
+  }
+  
+  heapMonitor.loop(currentTime);
+
   // OTA update checking (every 5 minutes)
-  if (currentTime - lastUpdateCheck > updateInterval) {
-    otaUpdater.checkForUpdates();
-    lastUpdateCheck = currentTime;
+  if (networkStarted && currentTime - lastUpdateCheck > updateInterval) {
+    queueUpdateCheck();
   }
 
   // MQTT server re-discovery (every 15 minutes)
-  if (mqttManager.shouldRediscoverServer(currentTime)) {
-    Serial.println("Re-discovering MQTT server...");
-    String newMQTTServer = mqttManager.discoverServer();
-    mqttManager.updateServerIP(newMQTTServer);
-    mqtt_server_ip = newMQTTServer;
-    mqttManager.updateLastDiscoveryTime(currentTime);
+  if (networkStarted && mqttManager.shouldRediscoverServer(currentTime)) {
+    DLOG_I(logApp, "Re-discovering MQTT server...");
+    queueServerDiscovery();
   }
 
-  delay(MAIN_LOOP_DELAY);
+  uint32_t workUs = micros() - workStart;
+  loopDuration.observe(workUs);
+  TRACE_SPAN_US("loop", workUs);
+  
+  // Idle until the next pass, still serving HTTP, reacting to WiFi events and pushing live updates
+  unsigned long idleStart = millis();
+  WatchdogScope idleScope(idleSection);
+  while (millis() - idleStart < MAIN_LOOP_DELAY) {
+    serveHttp();
+    {
+      WatchdogScope wifiScope(wifiSection);
+      wifiConnection.loop(millis());
+    }
+    pushLiveUpdates(millis());
+    delay(LIVE_UPDATE_POLL_INTERVAL);
+  }
 }
-
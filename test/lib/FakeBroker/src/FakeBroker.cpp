@@ -0,0 +1,339 @@
+#include "FakeBroker.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const uint8_t PACKET_CONNECT = 1;
+static const uint8_t PACKET_PUBLISH = 3;
+static const uint8_t PACKET_PUBACK = 4;
+static const uint8_t PACKET_SUBSCRIBE = 8;
+static const uint8_t PACKET_UNSUBSCRIBE = 10;
+static const uint8_t PACKET_PINGREQ = 12;
+static const uint8_t PACKET_DISCONNECT = 14;
+
+static bool sendAll(int fd, const uint8_t* data, size_t length) {
+    while (length > 0) {
+        ssize_t sent = send(fd, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return true;
+}
+
+// Reads exactly length bytes; gives up when the connection closes or the broker stops
+static bool readAll(int fd, uint8_t* data, size_t length, const std::atomic<bool>& running) {
+    while (length > 0) {
+        struct pollfd waiting = {fd, POLLIN, 0};
+        if (poll(&waiting, 1, 50) == 0) {
+            if (!running) {
+                return false;
+            }
+            continue;
+        }
+        ssize_t received = recv(fd, data, length, 0);
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        length -= (size_t)received;
+    }
+    return true;
+}
+
+FakeBroker::FakeBroker()
+    : _listenFd(-1), _port(0), _clientFd(-1), _running(false), _maxUnacknowledged(0), _reusedPacketIds(0),
+      _connects(0), _acksSent(0), _acksDropped(0), _holdAcks(false), _lossProbability(0), _lossState(1) {}
+
+FakeBroker::~FakeBroker() {
+    stop();
+}
+
+bool FakeBroker::start() {
+    _listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_listenFd < 0) {
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(_listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+    socklen_t length = sizeof(address);
+    if (bind(_listenFd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(_listenFd, 4) != 0 ||
+        getsockname(_listenFd, (struct sockaddr*)&address, &length) != 0) {
+        close(_listenFd);
+        _listenFd = -1;
+        return false;
+    }
+    _port = ntohs(address.sin_port);
+    _running = true;
+    _thread = std::thread(&FakeBroker::run, this);
+    return true;
+}
+
+void FakeBroker::stop() {
+    if (!_running) {
+        return;
+    }
+    _running = false;
+    dropClient();
+    _thread.join();
+    close(_listenFd);
+    _listenFd = -1;
+}
+
+void FakeBroker::run() {
+    while (_running) {
+        struct pollfd waiting = {_listenFd, POLLIN, 0};
+        if (poll(&waiting, 1, 50) <= 0) {
+            continue;
+        }
+        int fd = accept(_listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            continue;
+        }
+        // Acks go out one small write at a time; Nagle would hold them back
+        int noDelay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        _clientFd = fd;
+        serve(fd);
+        _clientFd = -1;
+        close(fd);
+    }
+}
+
+void FakeBroker::serve(int fd) {
+    while (_running) {
+        uint8_t header;
+        if (!readAll(fd, &header, 1, _running)) {
+            return;
+        }
+        uint32_t remaining = 0;
+        uint32_t multiplier = 1;
+        uint8_t digit;
+        do {
+            if (multiplier > 128UL * 128 * 128 || !readAll(fd, &digit, 1, _running)) {
+                return;
+            }
+            remaining += (digit & 0x7F) * multiplier;
+            multiplier *= 128;
+        } while (digit & 0x80);
+        std::vector<uint8_t> body(remaining);
+        if (remaining > 0 && !readAll(fd, body.data(), remaining, _running)) {
+            return;
+        }
+        if (!handlePacket(fd, header, body)) {
+            return;
+        }
+    }
+}
+
+bool FakeBroker::handlePacket(int fd, uint8_t header, const std::vector<uint8_t>& body) {
+    uint8_t type = header >> 4;
+    if (type == PACKET_CONNECT) {
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _connects++;
+            // A new session: acks of the old connection are gone
+            _heldAcks.clear();
+        }
+        _changed.notify_all();
+        const uint8_t connack[] = {0x20, 0x02, 0x00, 0x00};
+        return sendAll(fd, connack, sizeof(connack));
+    }
+    if (type == PACKET_PUBLISH) {
+        if (body.size() < 2) {
+            return false;
+        }
+        Publish publish;
+        size_t topicLength = ((size_t)body[0] << 8) | body[1];
+        size_t position = 2 + topicLength;
+        publish.qos = (header >> 1) & 0x03;
+        if (position + (publish.qos > 0 ? 2 : 0) > body.size()) {
+            return false;
+        }
+        publish.topic.assign((const char*)body.data() + 2, topicLength);
+        publish.dup = (header & 0x08) != 0;
+        publish.retain = (header & 0x01) != 0;
+        publish.packetId = 0;
+        if (publish.qos > 0) {
+            publish.packetId = ((uint16_t)body[position] << 8) | body[position + 1];
+            position += 2;
+        }
+        publish.payload.assign((const char*)body.data() + position, body.size() - position);
+
+        bool sendAck = false;
+        {
+            std::lock_guard<std::mutex> lock(_lock);
+            _publishes.push_back(publish);
+            if (publish.qos == 1) {
+                bool known = false;
+                for (uint16_t id : _unacknowledged) {
+                    known = known || id == publish.packetId;
+                }
+                if (known && !publish.dup) {
+                    _reusedPacketIds++;
+                } else if (!known) {
+                    _unacknowledged.push_back(publish.packetId);
+                    _maxUnacknowledged = std::max(_maxUnacknowledged, _unacknowledged.size());
+                }
+                if (_holdAcks) {
+                    _heldAcks.push_back(publish.packetId);
+                } else if (dropNextAck()) {
+                    _acksDropped++;
+                } else {
+                    sendAck = true;
+                }
+            }
+        }
+        _changed.notify_all();
+        if (sendAck) {
+            sendPubAck(fd, publish.packetId);
+        }
+        return true;
+    }
+    if (type == PACKET_SUBSCRIBE || type == PACKET_UNSUBSCRIBE) {
+        if (body.size() < 2) {
+            return false;
+        }
+        if (type == PACKET_SUBSCRIBE) {
+            const uint8_t suback[] = {0x90, 0x03, body[0], body[1], 0x00};
+            return sendAll(fd, suback, sizeof(suback));
+        }
+        const uint8_t unsuback[] = {0xB0, 0x02, body[0], body[1]};
+        return sendAll(fd, unsuback, sizeof(unsuback));
+    }
+    if (type == PACKET_PINGREQ) {
+        const uint8_t pingresp[] = {0xD0, 0x00};
+        return sendAll(fd, pingresp, sizeof(pingresp));
+    }
+    if (type == PACKET_DISCONNECT) {
+        return false;
+    }
+    return true; // PUBACKs from the client and anything else are ignored
+}
+
+// Settled before the ack is sent: the client may reuse the ID as soon as it arrives
+void FakeBroker::sendPubAck(int fd, uint16_t packetId) {
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _acksSent++;
+        for (size_t i = 0; i < _unacknowledged.size(); i++) {
+            if (_unacknowledged[i] == packetId) {
+                _unacknowledged.erase(_unacknowledged.begin() + i);
+                break;
+            }
+        }
+    }
+    _changed.notify_all();
+    const uint8_t puback[] = {PACKET_PUBACK << 4, 0x02, (uint8_t)(packetId >> 8), (uint8_t)(packetId & 0xFF)};
+    sendAll(fd, puback, sizeof(puback));
+}
+
+// xorshift32, so a seed gives the same losses on every host
+bool FakeBroker::dropNextAck() {
+    if (_lossProbability <= 0) {
+        return false;
+    }
+    _lossState ^= _lossState << 13;
+    _lossState ^= _lossState >> 17;
+    _lossState ^= _lossState << 5;
+    return (_lossState / 4294967296.0) < _lossProbability;
+}
+
+void FakeBroker::setPubAckLoss(double probability, uint32_t seed) {
+    std::lock_guard<std::mutex> lock(_lock);
+    _lossProbability = probability;
+    _lossState = seed != 0 ? seed : 1;
+}
+
+void FakeBroker::holdPubAcks(bool hold) {
+    std::vector<uint16_t> release;
+    {
+        std::lock_guard<std::mutex> lock(_lock);
+        _holdAcks = hold;
+        if (!hold) {
+            release.swap(_heldAcks);
+        }
+    }
+    int fd = _clientFd;
+    for (uint16_t packetId : release) {
+        if (fd >= 0) {
+            sendPubAck(fd, packetId);
+        }
+    }
+}
+
+void FakeBroker::dropClient() {
+    int fd = _clientFd;
+    if (fd >= 0) {
+        shutdown(fd, SHUT_RDWR);
+    }
+}
+
+size_t FakeBroker::publishCount() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _publishes.size();
+}
+
+std::vector<FakeBroker::Publish> FakeBroker::publishes() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _publishes;
+}
+
+size_t FakeBroker::unacknowledged() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _unacknowledged.size();
+}
+
+size_t FakeBroker::maxUnacknowledged() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _maxUnacknowledged;
+}
+
+uint32_t FakeBroker::reusedPacketIds() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _reusedPacketIds;
+}
+
+uint32_t FakeBroker::connectCount() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _connects;
+}
+
+uint32_t FakeBroker::pubAcksSent() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _acksSent;
+}
+
+uint32_t FakeBroker::pubAcksDropped() {
+    std::lock_guard<std::mutex> lock(_lock);
+    return _acksDropped;
+}
+
+bool FakeBroker::waitForPublishes(size_t count, uint32_t timeoutMs) {
+    std::unique_lock<std::mutex> lock(_lock);
+    return _changed.wait_for(lock, std::chrono::milliseconds(timeoutMs),
+                             [this, count]() { return _publishes.size() >= count; });
+}
+
+void FakeBroker::clear() {
+    std::lock_guard<std::mutex> lock(_lock);
+    _publishes.clear();
+    _unacknowledged.clear();
+    _maxUnacknowledged = 0;
+    _reusedPacketIds = 0;
+    _acksSent = 0;
+    _acksDropped = 0;
+}
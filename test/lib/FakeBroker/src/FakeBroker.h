@@ -0,0 +1,83 @@
+#ifndef FAKE_BROKER_H
+#define FAKE_BROKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// MQTT 3.1.1 broker on 127.0.0.1 for host tests. Serves one client at a time
+// on its own thread: answers CONNECT, SUBSCRIBE, UNSUBSCRIBE and PINGREQ,
+// records every PUBLISH, and acknowledges QoS 1 ones unless told not to.
+class FakeBroker {
+public:
+    struct Publish {
+        std::string topic;
+        std::string payload;
+        uint8_t qos;
+        bool dup;
+        bool retain;
+        uint16_t packetId; // 0 for QoS 0
+    };
+
+    FakeBroker();
+    ~FakeBroker();
+
+    // Listens on an ephemeral port; see port()
+    bool start();
+    void stop();
+    uint16_t port() const { return _port; }
+
+    // Drop this share of PUBACKs (0..1), decided by a generator seeded with seed
+    void setPubAckLoss(double probability, uint32_t seed);
+    // While held, PUBACKs are queued instead of sent; releasing sends them in order
+    void holdPubAcks(bool hold);
+    // Close the client's connection, as a broker restart or network drop would
+    void dropClient();
+
+    size_t publishCount();
+    std::vector<Publish> publishes();
+    // QoS 1 publishes not yet acknowledged (held or dropped acks included)
+    size_t unacknowledged();
+    size_t maxUnacknowledged();
+    // QoS 1 publishes without DUP whose packet ID was still unacknowledged
+    uint32_t reusedPacketIds();
+    uint32_t connectCount();
+    uint32_t pubAcksSent();
+    uint32_t pubAcksDropped();
+    bool waitForPublishes(size_t count, uint32_t timeoutMs);
+    void clear();
+
+private:
+    int _listenFd;
+    uint16_t _port;
+    std::atomic<int> _clientFd;
+    std::atomic<bool> _running;
+    std::thread _thread;
+
+    std::mutex _lock;
+    std::condition_variable _changed;
+    std::vector<Publish> _publishes;
+    std::vector<uint16_t> _unacknowledged;
+    std::vector<uint16_t> _heldAcks;
+    size_t _maxUnacknowledged;
+    uint32_t _reusedPacketIds;
+    uint32_t _connects;
+    uint32_t _acksSent;
+    uint32_t _acksDropped;
+    bool _holdAcks;
+    double _lossProbability;
+    uint32_t _lossState;
+
+    void run();
+    void serve(int fd);
+    bool handlePacket(int fd, uint8_t header, const std::vector<uint8_t>& body);
+    void sendPubAck(int fd, uint16_t packetId);
+    bool dropNextAck();
+};
+
+#endif
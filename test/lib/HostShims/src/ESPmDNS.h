@@ -0,0 +1,24 @@
+#ifndef HOST_ESP_MDNS_H
+#define HOST_ESP_MDNS_H
+
+#include <stdint.h>
+
+// Nothing is advertised on a host; the responder only remembers its state
+class MDNSResponder {
+public:
+    bool begin(const char* hostName) { _started = hostName != nullptr && hostName[0] != '\0'; return _started; }
+    void end() { _started = false; }
+    bool addService(const char* service, const char* protocol, uint16_t port) {
+        (void)service;
+        (void)protocol;
+        (void)port;
+        return _started;
+    }
+
+private:
+    bool _started = false;
+};
+
+extern MDNSResponder MDNS;
+
+#endif
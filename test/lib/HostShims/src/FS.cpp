@@ -0,0 +1,276 @@
+#include "FS.h"
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs {
+
+struct FileImpl {
+    std::string hostPath;
+    std::string path;   // On the FS
+    FILE* handle;       // nullptr for a directory
+    std::vector<std::string> entries;
+    size_t nextEntry;
+    const std::string* root;
+
+    FileImpl() : handle(nullptr), nextEntry(0), root(nullptr) {}
+    ~FileImpl() {
+        if (handle != nullptr) {
+            fclose(handle);
+        }
+    }
+};
+
+static bool isHostDirectory(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+static void listDirectory(FileImpl& impl) {
+    impl.entries.clear();
+    impl.nextEntry = 0;
+    DIR* dir = opendir(impl.hostPath.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            impl.entries.push_back(entry->d_name);
+        }
+    }
+    closedir(dir);
+    // Host directory order varies; tests want the same order on every run
+    std::sort(impl.entries.begin(), impl.entries.end());
+}
+
+// Creates every missing directory above hostPath
+static bool makeParents(const std::string& hostPath, size_t rootLength) {
+    for (size_t slash = hostPath.find('/', rootLength + 1); slash != std::string::npos;
+         slash = hostPath.find('/', slash + 1)) {
+        std::string parent = hostPath.substr(0, slash);
+        if (::mkdir(parent.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t File::write(uint8_t value) {
+    return write(&value, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!_impl || _impl->handle == nullptr) {
+        return 0;
+    }
+    return fwrite(buffer, 1, size, _impl->handle);
+}
+
+int File::available() {
+    if (!_impl || _impl->handle == nullptr) {
+        return 0;
+    }
+    size_t total = size();
+    size_t at = position();
+    return at < total ? (int)(total - at) : 0;
+}
+
+int File::read() {
+    uint8_t value;
+    return read(&value, 1) == 1 ? value : -1;
+}
+
+int File::peek() {
+    if (!_impl || _impl->handle == nullptr) {
+        return -1;
+    }
+    int value = fgetc(_impl->handle);
+    if (value != EOF) {
+        ungetc(value, _impl->handle);
+    }
+    return value == EOF ? -1 : value;
+}
+
+void File::flush() {
+    if (_impl && _impl->handle != nullptr) {
+        fflush(_impl->handle);
+    }
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    if (!_impl || _impl->handle == nullptr) {
+        return 0;
+    }
+    return fread(buffer, 1, size, _impl->handle);
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+    if (!_impl || _impl->handle == nullptr) {
+        return false;
+    }
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    return fseek(_impl->handle, (long)position, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!_impl || _impl->handle == nullptr) {
+        return 0;
+    }
+    long at = ftell(_impl->handle);
+    return at > 0 ? (size_t)at : 0;
+}
+
+size_t File::size() const {
+    if (!_impl || _impl->handle == nullptr) {
+        return 0;
+    }
+    fflush(_impl->handle);
+    struct stat info;
+    return fstat(fileno(_impl->handle), &info) == 0 ? (size_t)info.st_size : 0;
+}
+
+void File::close() {
+    _impl.reset();
+}
+
+File::operator bool() const {
+    return (bool)_impl;
+}
+
+time_t File::getLastWrite() {
+    if (!_impl) {
+        return 0;
+    }
+    flush();
+    struct stat info;
+    return stat(_impl->hostPath.c_str(), &info) == 0 ? info.st_mtime : 0;
+}
+
+const char* File::path() const {
+    return _impl ? _impl->path.c_str() : nullptr;
+}
+
+const char* File::name() const {
+    if (!_impl) {
+        return nullptr;
+    }
+    size_t slash = _impl->path.rfind('/');
+    return _impl->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+bool File::isDirectory() {
+    return _impl && _impl->handle == nullptr;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!isDirectory()) {
+        return File();
+    }
+    while (_impl->nextEntry < _impl->entries.size()) {
+        const std::string& entry = _impl->entries[_impl->nextEntry++];
+        std::string child = _impl->path == "/" ? "/" + entry : _impl->path + "/" + entry;
+        FileImplPtr impl = std::make_shared<FileImpl>();
+        impl->root = _impl->root;
+        impl->path = child;
+        impl->hostPath = *_impl->root + child;
+        if (isHostDirectory(impl->hostPath)) {
+            listDirectory(*impl);
+            return File(impl);
+        }
+        impl->handle = fopen(impl->hostPath.c_str(), mode[0] == 'a' ? "ab" : (mode[0] == 'w' ? "wb" : "rb"));
+        if (impl->handle != nullptr) {
+            return File(impl);
+        }
+    }
+    return File();
+}
+
+String File::getNextFileName() {
+    if (!isDirectory() || _impl->nextEntry >= _impl->entries.size()) {
+        return String();
+    }
+    const std::string& entry = _impl->entries[_impl->nextEntry++];
+    std::string child = _impl->path == "/" ? "/" + entry : _impl->path + "/" + entry;
+    return String(child.c_str());
+}
+
+void File::rewindDirectory() {
+    if (isDirectory()) {
+        listDirectory(*_impl);
+    }
+}
+
+std::string FS::hostPath(const char* path) const {
+    if (path == nullptr || path[0] != '/') {
+        return std::string();
+    }
+    std::string result = _root + path;
+    // The FS has no trailing slashes: "/logs/" is "/logs"
+    while (result.size() > _root.size() + 1 && result.back() == '/') {
+        result.pop_back();
+    }
+    return result;
+}
+
+File FS::open(const char* path, const char* mode, bool create) {
+    std::string host = hostPath(path);
+    if (!mounted() || host.empty() || mode == nullptr) {
+        return File();
+    }
+    FileImplPtr impl = std::make_shared<FileImpl>();
+    impl->root = &_root;
+    impl->hostPath = host;
+    impl->path = host.size() > _root.size() ? host.substr(_root.size()) : "/";
+    if (isHostDirectory(host)) {
+        listDirectory(*impl);
+        return File(impl);
+    }
+    const char* hostMode = mode[0] == 'w' ? "wb" : (mode[0] == 'a' ? "ab" : "rb");
+    if (mode[1] == '+') {
+        hostMode = mode[0] == 'w' ? "w+b" : (mode[0] == 'a' ? "a+b" : "r+b");
+    }
+    if (create && mode[0] != 'r' && !makeParents(host, _root.size())) {
+        return File();
+    }
+    impl->handle = fopen(host.c_str(), hostMode);
+    if (impl->handle == nullptr) {
+        return File();
+    }
+    return File(impl);
+}
+
+bool FS::exists(const char* path) {
+    std::string host = hostPath(path);
+    struct stat info;
+    return mounted() && !host.empty() && stat(host.c_str(), &info) == 0;
+}
+
+bool FS::remove(const char* path) {
+    std::string host = hostPath(path);
+    return mounted() && !host.empty() && !isHostDirectory(host) && unlink(host.c_str()) == 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+    std::string from = hostPath(pathFrom);
+    std::string to = hostPath(pathTo);
+    return mounted() && !from.empty() && !to.empty() && ::rename(from.c_str(), to.c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    std::string host = hostPath(path);
+    if (!mounted() || host.empty()) {
+        return false;
+    }
+    return ::mkdir(host.c_str(), 0755) == 0 || (errno == EEXIST && isHostDirectory(host));
+}
+
+bool FS::rmdir(const char* path) {
+    std::string host = hostPath(path);
+    return mounted() && !host.empty() && host.size() > _root.size() + 1 && ::rmdir(host.c_str()) == 0;
+}
+
+} // namespace fs
@@ -0,0 +1,94 @@
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include "Stream.h"
+#include "WString.h"
+#include <memory>
+#include <string>
+#include <time.h>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FileImpl;
+typedef std::shared_ptr<FileImpl> FileImplPtr;
+
+// A file or directory under the host directory the FS is mounted on. Copies
+// share one handle, as with the core's File.
+class File : public Stream {
+public:
+    File() {}
+    explicit File(FileImplPtr impl) : _impl(impl) {}
+
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+    size_t read(uint8_t* buffer, size_t size);
+    size_t readBytes(char* buffer, size_t length) override { return read((uint8_t*)buffer, length); }
+    using Stream::readBytes;
+
+    bool seek(uint32_t position, SeekMode mode);
+    bool seek(uint32_t position) { return seek(position, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    bool setBufferSize(size_t size) { (void)size; return true; }
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char* path() const;
+    const char* name() const;
+
+    bool isDirectory();
+    File openNextFile(const char* mode = FILE_READ);
+    String getNextFileName();
+    void rewindDirectory();
+
+private:
+    FileImplPtr _impl;
+};
+
+class FS {
+public:
+    File open(const char* path, const char* mode = FILE_READ, bool create = false);
+    File open(const String& path, const char* mode = FILE_READ, bool create = false) {
+        return open(path.c_str(), mode, create);
+    }
+    bool exists(const char* path);
+    bool exists(const String& path) { return exists(path.c_str()); }
+    bool remove(const char* path);
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* pathFrom, const char* pathTo);
+    bool rename(const String& pathFrom, const String& pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+    bool mkdir(const char* path);
+    bool mkdir(const String& path) { return mkdir(path.c_str()); }
+    bool rmdir(const char* path);
+    bool rmdir(const String& path) { return rmdir(path.c_str()); }
+
+protected:
+    // Host directory the FS is mounted on; empty until mounted
+    std::string _root;
+
+    bool mounted() const { return !_root.empty(); }
+    // Host path for a path on the FS, or an empty string if it is not absolute
+    std::string hostPath(const char* path) const;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
+using fs::SeekCur;
+using fs::SeekEnd;
+using fs::SeekMode;
+using fs::SeekSet;
+
+#endif
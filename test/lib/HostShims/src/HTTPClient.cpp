@@ -0,0 +1,79 @@
+#include "HTTPClient.h"
+#include "HostInternal.h"
+
+bool HTTPClient::begin(const String& url) {
+    end();
+    if (!url.startsWith("http://") && !url.startsWith("https://")) {
+        return false;
+    }
+    _url = url;
+    return true;
+}
+
+void HTTPClient::end() {
+    _stream.stop();
+    _body.reset();
+    _code = 0;
+}
+
+void HTTPClient::addHeader(const String& name, const String& value, bool first, bool replace) {
+    (void)name;
+    (void)value;
+    (void)first;
+    (void)replace;
+}
+
+int HTTPClient::GET() {
+    if (_url.isEmpty()) {
+        return HTTPC_ERROR_NOT_CONNECTED;
+    }
+    host::Bytes body;
+    if (!host::findHttpResponse(_url.c_str(), _code, body)) {
+        _code = 0;
+        return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+    _body = body;
+    _stream = WiFiClient::fromMemory(body);
+    _stream.setTimeout(_timeoutMs);
+    return _code;
+}
+
+int HTTPClient::getSize() {
+    return _body ? (int)_body->size() : -1;
+}
+
+String HTTPClient::getString() {
+    if (!_body) {
+        return String();
+    }
+    return String((const char*)_body->data(), _body->size());
+}
+
+String HTTPClient::errorToString(int error) {
+    switch (error) {
+    case HTTPC_ERROR_CONNECTION_REFUSED:
+        return String("connection refused");
+    case HTTPC_ERROR_SEND_HEADER_FAILED:
+        return String("send header failed");
+    case HTTPC_ERROR_SEND_PAYLOAD_FAILED:
+        return String("send payload failed");
+    case HTTPC_ERROR_NOT_CONNECTED:
+        return String("not connected");
+    case HTTPC_ERROR_CONNECTION_LOST:
+        return String("connection lost");
+    case HTTPC_ERROR_NO_STREAM:
+        return String("no stream");
+    case HTTPC_ERROR_NO_HTTP_SERVER:
+        return String("no HTTP server");
+    case HTTPC_ERROR_TOO_LESS_RAM:
+        return String("too less ram");
+    case HTTPC_ERROR_ENCODING:
+        return String("Transfer-Encoding not supported");
+    case HTTPC_ERROR_STREAM_WRITE:
+        return String("Stream write error");
+    case HTTPC_ERROR_READ_TIMEOUT:
+        return String("read Timeout");
+    default:
+        return String();
+    }
+}
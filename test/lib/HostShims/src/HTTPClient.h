@@ -0,0 +1,72 @@
+#ifndef HOST_HTTP_CLIENT_H
+#define HOST_HTTP_CLIENT_H
+
+#include "WString.h"
+#include "WiFiClient.h"
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+typedef enum {
+    HTTP_CODE_OK = 200,
+    HTTP_CODE_MOVED_PERMANENTLY = 301,
+    HTTP_CODE_FOUND = 302,
+    HTTP_CODE_NOT_MODIFIED = 304,
+    HTTP_CODE_BAD_REQUEST = 400,
+    HTTP_CODE_UNAUTHORIZED = 401,
+    HTTP_CODE_FORBIDDEN = 403,
+    HTTP_CODE_NOT_FOUND = 404,
+    HTTP_CODE_INTERNAL_SERVER_ERROR = 500,
+} t_http_codes;
+
+typedef enum {
+    HTTPC_DISABLE_FOLLOW_REDIRECTS,
+    HTTPC_STRICT_FOLLOW_REDIRECTS,
+    HTTPC_FORCE_FOLLOW_REDIRECTS,
+} followRedirects_t;
+
+// Answers GETs from the responses registered with HostSim::setHttpResponse();
+// any other URL fails as if the server could not be reached. Nothing goes
+// over the network.
+class HTTPClient {
+public:
+    HTTPClient() : _code(0), _timeoutMs(5000) {}
+
+    bool begin(const String& url);
+    bool begin(WiFiClient& client, const String& url) { (void)client; return begin(url); }
+    void end();
+    bool connected() { return _stream.connected(); }
+
+    void addHeader(const String& name, const String& value, bool first = false, bool replace = true);
+    void setUserAgent(const String& userAgent) { (void)userAgent; }
+    void setTimeout(uint16_t timeoutMs) { _timeoutMs = timeoutMs; }
+    void setConnectTimeout(int32_t timeoutMs) { (void)timeoutMs; }
+    void setFollowRedirects(followRedirects_t follow) { (void)follow; }
+    void setReuse(bool reuse) { (void)reuse; }
+
+    int GET();
+    int getSize();
+    String getString();
+    WiFiClient& getStream() { return _stream; }
+    WiFiClient* getStreamPtr() { return &_stream; }
+
+    static String errorToString(int error);
+
+private:
+    String _url;
+    int _code;
+    uint16_t _timeoutMs;
+    WiFiClient _stream;
+    std::shared_ptr<const std::vector<uint8_t>> _body;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#include "HardwareSerial.h"
+#include <stdio.h>
+
+HardwareSerial Serial;
+
+void HardwareSerial::flush() {
+    fflush(stdout);
+}
+
+size_t HardwareSerial::write(uint8_t value) {
+    return fputc(value, stdout) == EOF ? 0 : 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
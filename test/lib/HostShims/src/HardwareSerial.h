@@ -0,0 +1,31 @@
+#ifndef HOST_HARDWARE_SERIAL_H
+#define HOST_HARDWARE_SERIAL_H
+
+#include "Stream.h"
+
+// Serial writes to stdout; nothing is ever received
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud, uint32_t config = 0, int8_t rxPin = -1, int8_t txPin = -1) {
+        (void)baud;
+        (void)config;
+        (void)rxPin;
+        (void)txPin;
+    }
+    void end() {}
+    void setDebugOutput(bool enabled) { (void)enabled; }
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    void flush() override;
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    operator bool() const { return true; }
+};
+
+extern HardwareSerial Serial;
+
+#endif
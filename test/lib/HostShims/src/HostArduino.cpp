@@ -0,0 +1,210 @@
+#include "HostInternal.h"
+#include <Arduino.h>
+#include <esp_heap_caps.h>
+#include <esp_sleep.h>
+#include <esp_rom_crc.h>
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
+#include <mutex>
+#include <random>
+
+EspClass ESP;
+
+static std::mutex& randomLock = *new std::mutex();
+static std::mt19937& generator = *new std::mt19937(std::random_device()());
+
+uint32_t esp_random() {
+    std::lock_guard<std::mutex> lock(randomLock);
+    return (uint32_t)generator();
+}
+
+void esp_fill_random(void* buffer, size_t length) {
+    uint8_t* bytes = (uint8_t*)buffer;
+    for (size_t i = 0; i < length; i++) {
+        bytes[i] = (uint8_t)esp_random();
+    }
+}
+
+long random(long howBig) {
+    return howBig > 0 ? (long)(esp_random() % (uint32_t)howBig) : 0;
+}
+
+long random(long howSmall, long howBig) {
+    return howSmall < howBig ? howSmall + random(howBig - howSmall) : howSmall;
+}
+
+void randomSeed(unsigned long seed) {
+    if (seed != 0) {
+        std::lock_guard<std::mutex> lock(randomLock);
+        generator.seed((uint32_t)seed);
+    }
+}
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+float temperatureRead() {
+    return HostSim::cpuTemperature() + (float)random(50) / 100.0f;
+}
+
+void configTime(long gmtOffsetSec, int daylightOffsetSec, const char* server1, const char* server2,
+                const char* server3) {
+    (void)gmtOffsetSec;
+    (void)daylightOffsetSec;
+    (void)server1;
+    (void)server2;
+    (void)server3;
+}
+
+bool getLocalTime(struct tm* info, uint32_t ms) {
+    (void)ms;
+    time_t now = time(nullptr);
+    return localtime_r(&now, info) != nullptr;
+}
+
+#if defined(__GLIBC__) && (__GLIBC__ < 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38))
+size_t strlcpy(char* dst, const char* src, size_t size) {
+    size_t length = strlen(src);
+    if (size > 0) {
+        size_t copied = length < size - 1 ? length : size - 1;
+        memcpy(dst, src, copied);
+        dst[copied] = '\0';
+    }
+    return length;
+}
+
+size_t strlcat(char* dst, const char* src, size_t size) {
+    size_t used = strnlen(dst, size);
+    if (used == size) {
+        return size + strlen(src);
+    }
+    return used + strlcpy(dst + used, src, size - used);
+}
+#endif
+
+uint32_t EspClass::getHeapSize() {
+    return host::HEAP_SIZE;
+}
+
+uint32_t EspClass::getFreeHeap() {
+    return host::freeHeapBytes();
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    return host::minimumFreeHeapBytes();
+}
+
+// The device heap fragments; a host's does not, so this is only an upper bound
+uint32_t EspClass::getMaxAllocHeap() {
+    return host::freeHeapBytes();
+}
+
+void EspClass::restart() {
+    esp_restart();
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() {
+    return ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t timeUs) {
+    (void)timeUs;
+    return ESP_OK;
+}
+
+void esp_deep_sleep_start() {
+    esp_restart();
+}
+
+uint32_t esp_get_free_heap_size() {
+    return host::freeHeapBytes();
+}
+
+uint32_t esp_get_minimum_free_heap_size() {
+    return host::minimumFreeHeapBytes();
+}
+
+size_t heap_caps_get_free_size(uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : host::freeHeapBytes();
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : host::minimumFreeHeapBytes();
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+size_t heap_caps_get_total_size(uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? 0 : host::HEAP_SIZE;
+}
+
+void* heap_caps_malloc(size_t size, uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? nullptr : malloc(size);
+}
+
+void* heap_caps_calloc(size_t count, size_t size, uint32_t caps) {
+    return (caps & MALLOC_CAP_SPIRAM) ? nullptr : calloc(count, size);
+}
+
+void heap_caps_free(void* pointer) {
+    free(pointer);
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+esp_err_t esp_task_wdt_init(uint32_t timeoutSeconds, bool panic) {
+    (void)timeoutSeconds;
+    (void)panic;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_task_wdt_add(TaskHandle_t task) {
+    (void)task;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_task_wdt_delete(TaskHandle_t task) {
+    (void)task;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t esp_task_wdt_reset() {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
@@ -0,0 +1,423 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/ringbuf.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Tasks, semaphores and queues are never freed: tasks run until the process
+// exits, and the rest live as long as the globals that own them
+
+struct HostTask {
+    char name[configMAX_TASK_NAME_LEN];
+    uint32_t stackDepth;
+    BaseType_t core;
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifications;
+};
+
+struct HostSemaphore {
+    std::mutex lock;
+    std::condition_variable available;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+};
+
+struct HostQueue {
+    std::mutex lock;
+    std::condition_variable changed;
+    uint8_t* items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t first;
+    UBaseType_t count;
+};
+
+// An item's space counts as used until the receiver returns it
+struct HostRingbuf {
+    std::mutex lock;
+    std::condition_variable changed;
+    size_t size;
+    size_t used;
+    std::deque<uint8_t*> items;
+};
+
+static thread_local HostTask* currentTask = nullptr;
+static thread_local uint32_t threadTag = 0;
+static std::atomic<uint32_t> nextThreadTag(1);
+
+static HostTask* newTask(const char* name, uint32_t stackDepth, BaseType_t core) {
+    HostTask* task = new HostTask();
+    strncpy(task->name, name != nullptr ? name : "", sizeof(task->name) - 1);
+    task->name[sizeof(task->name) - 1] = '\0';
+    task->stackDepth = stackDepth;
+    task->core = core == tskNO_AFFINITY ? 0 : core;
+    task->notifications = 0;
+    return task;
+}
+
+static uint32_t ownTag() {
+    if (threadTag == 0) {
+        threadTag = nextThreadTag.fetch_add(1);
+    }
+    return threadTag;
+}
+
+// Wait on condition for up to ticks; portMAX_DELAY waits forever
+template <typename Predicate>
+static bool waitFor(std::condition_variable& condition, std::unique_lock<std::mutex>& lock, TickType_t ticks,
+                    Predicate ready) {
+    if (ticks == portMAX_DELAY) {
+        condition.wait(lock, ready);
+        return true;
+    }
+    return condition.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+void vPortEnterCritical(portMUX_TYPE* mux) {
+    uint32_t self = ownTag();
+    if (__atomic_load_n(&mux->owner, __ATOMIC_ACQUIRE) == self) {
+        mux->count++;
+        return;
+    }
+    uint32_t expected = 0;
+    while (!__atomic_compare_exchange_n(&mux->owner, &expected, self, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        expected = 0;
+        std::this_thread::yield();
+    }
+    mux->count = 1;
+}
+
+void vPortExitCritical(portMUX_TYPE* mux) {
+    if (--mux->count == 0) {
+        __atomic_store_n(&mux->owner, 0, __ATOMIC_RELEASE);
+    }
+}
+
+BaseType_t xPortGetCoreID() {
+    return xTaskGetCurrentTaskHandle()->core;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char* name, uint32_t stackDepth, void* parameter,
+                                   UBaseType_t priority, TaskHandle_t* createdTask, BaseType_t coreId) {
+    (void)priority;
+    HostTask* task = newTask(name, stackDepth, coreId);
+    if (createdTask != nullptr) {
+        *createdTask = task;
+    }
+    std::thread([code, parameter, task]() {
+        currentTask = task;
+        code(parameter);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth, void* parameter,
+                       UBaseType_t priority, TaskHandle_t* createdTask) {
+    return xTaskCreatePinnedToCore(code, name, stackDepth, parameter, priority, createdTask, tskNO_AFFINITY);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t* previousWakeTime, TickType_t increment) {
+    TickType_t wake = *previousWakeTime + increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(wake - now) > 0) {
+        vTaskDelay(wake - now);
+    }
+    *previousWakeTime = wake;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+TickType_t xTaskGetTickCountFromISR() {
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (currentTask == nullptr) {
+        static HostTask* loopTask = newTask("loopTask", 8192, 1);
+        currentTask = loopTask;
+    }
+    return currentTask;
+}
+
+char* pcTaskGetName(TaskHandle_t task) {
+    return (task != nullptr ? task : xTaskGetCurrentTaskHandle())->name;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return (task != nullptr ? task : xTaskGetCurrentTaskHandle())->stackDepth;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    HostTask* task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->lock);
+    waitFor(task->notified, lock, ticksToWait, [task]() { return task->notifications > 0; });
+    uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clearCountOnExit ? 0 : value - 1;
+    }
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> lock(task->lock);
+        task->notifications++;
+    }
+    task->notified.notify_all();
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* higherPriorityTaskWoken) {
+    xTaskNotifyGive(task);
+    if (higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = pdFALSE;
+    }
+}
+
+void vHostTaskYield() {
+    std::this_thread::yield();
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    HostSemaphore* semaphore = new HostSemaphore();
+    semaphore->count = initialCount;
+    semaphore->maxCount = maxCount;
+    return semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> lock(semaphore->lock);
+    if (!waitFor(semaphore->available, lock, ticksToWait, [semaphore]() { return semaphore->count > 0; })) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    {
+        std::lock_guard<std::mutex> lock(semaphore->lock);
+        if (semaphore->count >= semaphore->maxCount) {
+            return pdFALSE;
+        }
+        semaphore->count++;
+    }
+    semaphore->available.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = pdFALSE;
+    }
+    return xSemaphoreGive(semaphore);
+}
+
+UBaseType_t uxSemaphoreGetCount(SemaphoreHandle_t semaphore) {
+    std::lock_guard<std::mutex> lock(semaphore->lock);
+    return semaphore->count;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    if (length == 0) {
+        return nullptr;
+    }
+    HostQueue* queue = new HostQueue();
+    queue->items = new uint8_t[length * itemSize];
+    queue->length = length;
+    queue->itemSize = itemSize;
+    queue->first = 0;
+    queue->count = 0;
+    return queue;
+}
+
+static BaseType_t queueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait, bool front) {
+    {
+        std::unique_lock<std::mutex> lock(queue->lock);
+        if (!waitFor(queue->changed, lock, ticksToWait, [queue]() { return queue->count < queue->length; })) {
+            return pdFALSE;
+        }
+        UBaseType_t slot;
+        if (front) {
+            queue->first = (queue->first + queue->length - 1) % queue->length;
+            slot = queue->first;
+        } else {
+            slot = (queue->first + queue->count) % queue->length;
+        }
+        memcpy(queue->items + slot * queue->itemSize, item, queue->itemSize);
+        queue->count++;
+    }
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void* item, TickType_t ticksToWait) {
+    return queueSend(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* higherPriorityTaskWoken) {
+    if (higherPriorityTaskWoken != nullptr) {
+        *higherPriorityTaskWoken = pdFALSE;
+    }
+    return queueSend(queue, item, 0, false);
+}
+
+// Meant for queues of length one: replaces the item that is there
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void* item) {
+    {
+        std::lock_guard<std::mutex> lock(queue->lock);
+        if (queue->count == queue->length) {
+            queue->count--;
+        }
+        UBaseType_t slot = (queue->first + queue->count) % queue->length;
+        memcpy(queue->items + slot * queue->itemSize, item, queue->itemSize);
+        queue->count++;
+    }
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+static BaseType_t queueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait, bool remove) {
+    {
+        std::unique_lock<std::mutex> lock(queue->lock);
+        if (!waitFor(queue->changed, lock, ticksToWait, [queue]() { return queue->count > 0; })) {
+            return pdFALSE;
+        }
+        memcpy(item, queue->items + queue->first * queue->itemSize, queue->itemSize);
+        if (!remove) {
+            return pdTRUE;
+        }
+        queue->first = (queue->first + 1) % queue->length;
+        queue->count--;
+    }
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticksToWait) {
+    return queueReceive(queue, item, ticksToWait, true);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t ticksToWait) {
+    return queueReceive(queue, item, ticksToWait, false);
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue) {
+    {
+        std::lock_guard<std::mutex> lock(queue->lock);
+        queue->first = 0;
+        queue->count = 0;
+    }
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->length - queue->count;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete[] queue->items;
+    delete queue;
+}
+
+// Each item is one block: its size, then the data the receiver sees
+static size_t blockSize(const uint8_t* data) {
+    size_t size;
+    memcpy(&size, data - sizeof(size_t), sizeof(size_t));
+    return size;
+}
+
+RingbufHandle_t xRingbufferCreate(size_t bufferSize, RingbufferType_t type) {
+    (void)type;
+    HostRingbuf* ringbuf = new HostRingbuf();
+    ringbuf->size = bufferSize;
+    ringbuf->used = 0;
+    return ringbuf;
+}
+
+BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void* item, size_t itemSize, TickType_t ticksToWait) {
+    if (itemSize > ringbuf->size) {
+        return pdFALSE;
+    }
+    {
+        std::unique_lock<std::mutex> lock(ringbuf->lock);
+        if (!waitFor(ringbuf->changed, lock, ticksToWait,
+                     [ringbuf, itemSize]() { return ringbuf->used + itemSize <= ringbuf->size; })) {
+            return pdFALSE;
+        }
+        uint8_t* block = (uint8_t*)malloc(sizeof(size_t) + itemSize);
+        memcpy(block, &itemSize, sizeof(size_t));
+        memcpy(block + sizeof(size_t), item, itemSize);
+        ringbuf->items.push_back(block + sizeof(size_t));
+        ringbuf->used += itemSize;
+    }
+    ringbuf->changed.notify_all();
+    return pdTRUE;
+}
+
+void* xRingbufferReceive(RingbufHandle_t ringbuf, size_t* itemSize, TickType_t ticksToWait) {
+    std::unique_lock<std::mutex> lock(ringbuf->lock);
+    if (!waitFor(ringbuf->changed, lock, ticksToWait, [ringbuf]() { return !ringbuf->items.empty(); })) {
+        return nullptr;
+    }
+    uint8_t* data = ringbuf->items.front();
+    ringbuf->items.pop_front();
+    if (itemSize != nullptr) {
+        *itemSize = blockSize(data);
+    }
+    return data;
+}
+
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void* item) {
+    uint8_t* data = (uint8_t*)item;
+    {
+        std::lock_guard<std::mutex> lock(ringbuf->lock);
+        ringbuf->used -= blockSize(data);
+    }
+    free(data - sizeof(size_t));
+    ringbuf->changed.notify_all();
+}
+
+void vRingbufferDelete(RingbufHandle_t ringbuf) {
+    for (uint8_t* data : ringbuf->items) {
+        free(data - sizeof(size_t));
+    }
+    delete ringbuf;
+}
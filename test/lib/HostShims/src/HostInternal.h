@@ -0,0 +1,24 @@
+#ifndef HOST_INTERNAL_H
+#define HOST_INTERNAL_H
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+#include "HostSim.h"
+
+// Shared between the shims; tests use HostSim
+namespace host {
+
+typedef std::shared_ptr<const std::vector<uint8_t>> Bytes;
+
+// Canned response registered with HostSim::setHttpResponse()
+bool findHttpResponse(const char* url, int& code, Bytes& body);
+
+// The simulated internal heap: a fixed size minus what the host holds
+const size_t HEAP_SIZE = 320 * 1024;
+size_t freeHeapBytes();
+size_t minimumFreeHeapBytes();
+
+} // namespace host
+
+#endif
@@ -0,0 +1,20 @@
+#include <Arduino.h>
+
+// The firmware's setup() and loop(), when they are linked in
+void setup() __attribute__((weak));
+void loop() __attribute__((weak));
+
+// Runs the firmware in src/ on the host (pio run -e native), as the core's
+// loop task does. Weak, so test programs keep their own main().
+__attribute__((weak)) int main() {
+    if (setup == nullptr || loop == nullptr) {
+        fprintf(stderr, "No setup() and loop() to run\n");
+        return 1;
+    }
+    // The log leaves line by line, as from the UART, even into a pipe or file
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    setup();
+    while (true) {
+        loop();
+    }
+}
@@ -0,0 +1,116 @@
+#include "driver/rmt.h"
+#include "HostSim.h"
+#include <math.h>
+#include <vector>
+
+struct RmtChannel {
+    bool configured;
+    RingbufHandle_t ringbuf;
+};
+
+static RmtChannel channels[RMT_CHANNEL_MAX];
+
+static bool validChannel(rmt_channel_t channel) {
+    return channel >= RMT_CHANNEL_0 && channel < RMT_CHANNEL_MAX;
+}
+
+// The five bytes a DHT22 sends: humidity and temperature in tenths (the
+// temperature's sign in the top bit), then the checksum
+static void encodeReading(float celsius, float humidity, uint8_t bytes[5]) {
+    uint16_t tenthsRh = (uint16_t)lroundf(humidity * 10.0f);
+    uint16_t tenthsC = (uint16_t)lroundf(fabsf(celsius) * 10.0f) & 0x7FFF;
+    if (celsius < 0) {
+        tenthsC |= 0x8000;
+    }
+    bytes[0] = tenthsRh >> 8;
+    bytes[1] = tenthsRh & 0xFF;
+    bytes[2] = tenthsC >> 8;
+    bytes[3] = tenthsC & 0xFF;
+    bytes[4] = (uint8_t)(bytes[0] + bytes[1] + bytes[2] + bytes[3]);
+}
+
+// Nominal timings, as the receiver sees them from the moment the bus is released
+static std::vector<rmt_item32_t> frameItems(const uint8_t bytes[5]) {
+    std::vector<uint16_t> levels = {1, 0, 1};
+    std::vector<uint16_t> durations = {30, 80, 80};
+    for (int i = 0; i < 40; i++) {
+        bool one = (bytes[i / 8] >> (7 - i % 8)) & 1;
+        levels.push_back(0);
+        durations.push_back(50);
+        levels.push_back(1);
+        durations.push_back(one ? 70 : 26);
+    }
+    levels.push_back(0);
+    durations.push_back(50);
+
+    // Pairs of pulses per item; the bus idles high after the last one
+    std::vector<rmt_item32_t> items;
+    for (size_t i = 0; i < levels.size(); i += 2) {
+        rmt_item32_t item;
+        item.val = 0;
+        item.level0 = levels[i];
+        item.duration0 = durations[i];
+        item.level1 = i + 1 < levels.size() ? levels[i + 1] : 1;
+        item.duration1 = i + 1 < levels.size() ? durations[i + 1] : 0;
+        items.push_back(item);
+    }
+    return items;
+}
+
+esp_err_t rmt_config(const rmt_config_t* config) {
+    if (config == nullptr || !validChannel(config->channel) || config->rmt_mode != RMT_MODE_RX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    channels[config->channel].configured = true;
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_install(rmt_channel_t channel, size_t rxBufferSize, int interruptFlags) {
+    (void)interruptFlags;
+    if (!validChannel(channel) || !channels[channel].configured) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (channels[channel].ringbuf != nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    channels[channel].ringbuf = xRingbufferCreate(rxBufferSize, RINGBUF_TYPE_NOSPLIT);
+    return ESP_OK;
+}
+
+esp_err_t rmt_driver_uninstall(rmt_channel_t channel) {
+    if (!validChannel(channel) || channels[channel].ringbuf == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    vRingbufferDelete(channels[channel].ringbuf);
+    channels[channel].ringbuf = nullptr;
+    return ESP_OK;
+}
+
+esp_err_t rmt_get_ringbuf_handle(rmt_channel_t channel, RingbufHandle_t* ringbuf) {
+    if (!validChannel(channel) || ringbuf == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *ringbuf = channels[channel].ringbuf;
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_start(rmt_channel_t channel, bool resetIndex) {
+    (void)resetIndex;
+    if (!validChannel(channel) || channels[channel].ringbuf == nullptr) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    float celsius = HostSim::dht22Temperature();
+    float humidity = HostSim::dht22Humidity();
+    if (isnan(celsius) || isnan(humidity)) {
+        return ESP_OK; // No sensor answers
+    }
+    uint8_t bytes[5];
+    encodeReading(celsius, humidity, bytes);
+    std::vector<rmt_item32_t> items = frameItems(bytes);
+    xRingbufferSend(channels[channel].ringbuf, items.data(), items.size() * sizeof(rmt_item32_t), 0);
+    return ESP_OK;
+}
+
+esp_err_t rmt_rx_stop(rmt_channel_t channel) {
+    return validChannel(channel) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
@@ -0,0 +1,312 @@
+#include "HostSim.h"
+#include "HostInternal.h"
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// --- Clock ---
+
+static std::atomic<bool> virtualTime(false);
+static std::atomic<uint64_t> skippedUs(0);
+
+void HostSim::setVirtualTime(bool enabled) {
+    virtualTime = enabled;
+}
+
+void HostSim::advanceMs(uint32_t ms) {
+    skippedUs += (uint64_t)ms * 1000;
+}
+
+uint64_t HostSim::nowUs() {
+    // Local, so it is set by the first call even during static initialization
+    static const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::now() - startTime;
+    return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() + skippedUs.load();
+}
+
+unsigned long millis() {
+    return (unsigned long)(uint32_t)(HostSim::nowUs() / 1000);
+}
+
+unsigned long micros() {
+    return (unsigned long)(uint32_t)HostSim::nowUs();
+}
+
+int64_t esp_timer_get_time() {
+    return (int64_t)HostSim::nowUs();
+}
+
+void delay(uint32_t ms) {
+    if (virtualTime) {
+        HostSim::advanceMs(ms);
+        std::this_thread::yield();
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(uint32_t us) {
+    if (virtualTime) {
+        skippedUs += us;
+        return;
+    }
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void yield() {
+    std::this_thread::yield();
+}
+
+// --- Restart ---
+
+static const int SHUTDOWN_HANDLER_SLOTS = 5;  // As in ESP-IDF
+static shutdown_handler_t shutdownHandlers[SHUTDOWN_HANDLER_SLOTS];
+static HostSim::RestartHandler restartHandler = nullptr;
+static std::atomic<uint32_t> restarts(0);
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) {
+    for (int i = 0; i < SHUTDOWN_HANDLER_SLOTS; i++) {
+        if (shutdownHandlers[i] == handler) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (shutdownHandlers[i] == nullptr) {
+            shutdownHandlers[i] = handler;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t esp_unregister_shutdown_handler(shutdown_handler_t handler) {
+    for (int i = 0; i < SHUTDOWN_HANDLER_SLOTS; i++) {
+        if (shutdownHandlers[i] == handler) {
+            shutdownHandlers[i] = nullptr;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_INVALID_STATE;
+}
+
+void HostSim::runShutdownHandlers() {
+    // Last registered runs first, as on the device
+    for (int i = SHUTDOWN_HANDLER_SLOTS - 1; i >= 0; i--) {
+        if (shutdownHandlers[i] != nullptr) {
+            shutdownHandlers[i]();
+        }
+    }
+}
+
+void HostSim::setRestartHandler(RestartHandler handler) {
+    restartHandler = handler;
+}
+
+uint32_t HostSim::restartCount() {
+    return restarts;
+}
+
+void esp_restart() {
+    restarts++;
+    HostSim::runShutdownHandlers();
+    fflush(stdout);
+    if (restartHandler == nullptr) {
+        exit(0);
+    }
+    restartHandler();
+}
+
+esp_reset_reason_t esp_reset_reason() {
+    return ESP_RST_POWERON;
+}
+
+// --- Heap ---
+
+static thread_local uint32_t threadAllocations = 0;
+static std::atomic<size_t> liveBytes(0);
+static std::atomic<size_t> peakLiveBytes(0);
+
+uint32_t HostSim::allocationCount() {
+    return threadAllocations;
+}
+
+size_t HostSim::liveHeapBytes() {
+    return liveBytes;
+}
+
+size_t host::freeHeapBytes() {
+    size_t live = liveBytes;
+    return live < HEAP_SIZE ? HEAP_SIZE - live : 0;
+}
+
+size_t host::minimumFreeHeapBytes() {
+    size_t peak = peakLiveBytes;
+    return peak < HEAP_SIZE ? HEAP_SIZE - peak : 0;
+}
+
+#ifdef __GLIBC__
+// Every allocation in the process passes through here; glibc exports the
+// real allocator under these names
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* pointer);
+}
+
+static void* tracked(void* pointer) {
+    if (pointer != nullptr) {
+        threadAllocations++;
+        size_t live = liveBytes += malloc_usable_size(pointer);
+        size_t peak = peakLiveBytes;
+        while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live)) {
+        }
+    }
+    return pointer;
+}
+
+static void untrack(void* pointer) {
+    if (pointer != nullptr) {
+        liveBytes -= malloc_usable_size(pointer);
+    }
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+    return tracked(__libc_malloc(size));
+}
+
+void* calloc(size_t count, size_t size) {
+    return tracked(__libc_calloc(count, size));
+}
+
+void* realloc(void* pointer, size_t size) {
+    if (pointer == nullptr) {
+        return malloc(size);
+    }
+    size_t before = malloc_usable_size(pointer);
+    void* moved = __libc_realloc(pointer, size);
+    if (moved != nullptr || size == 0) {
+        liveBytes -= before;
+    }
+    return tracked(moved);
+}
+
+void free(void* pointer) {
+    untrack(pointer);
+    __libc_free(pointer);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    return tracked(__libc_memalign(alignment, size));
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** result, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void* pointer = memalign(alignment, size);
+    if (pointer == nullptr) {
+        return ENOMEM;
+    }
+    *result = pointer;
+    return 0;
+}
+
+} // extern "C"
+#endif
+
+// --- HTTP ---
+
+struct CannedResponse {
+    int code;
+    host::Bytes body;
+};
+
+// Leaked, so task threads still running at exit never see it destroyed
+static std::mutex& httpLock = *new std::mutex();
+static std::map<std::string, CannedResponse>& httpResponses = *new std::map<std::string, CannedResponse>();
+
+void HostSim::setHttpResponse(const char* url, int code, const uint8_t* body, size_t length) {
+    CannedResponse response;
+    response.code = code;
+    response.body = std::make_shared<const std::vector<uint8_t>>(body, body + length);
+    std::lock_guard<std::mutex> lock(httpLock);
+    httpResponses[url] = response;
+}
+
+void HostSim::setHttpResponse(const char* url, int code, const char* body) {
+    setHttpResponse(url, code, (const uint8_t*)body, strlen(body));
+}
+
+void HostSim::clearHttpResponses() {
+    std::lock_guard<std::mutex> lock(httpLock);
+    httpResponses.clear();
+}
+
+bool host::findHttpResponse(const char* url, int& code, Bytes& body) {
+    std::lock_guard<std::mutex> lock(httpLock);
+    auto found = httpResponses.find(url);
+    if (found == httpResponses.end()) {
+        return false;
+    }
+    code = found->second.code;
+    body = found->second.body;
+    return true;
+}
+
+// --- Filesystem ---
+
+static char fsRootPath[512];
+
+void HostSim::setFsRoot(const char* path) {
+    strlcpy(fsRootPath, path, sizeof(fsRootPath));
+}
+
+const char* HostSim::fsRoot() {
+    if (fsRootPath[0] == '\0') {
+        const char* fromEnvironment = getenv("HOST_FS_ROOT");
+        setFsRoot(fromEnvironment != nullptr && fromEnvironment[0] != '\0' ? fromEnvironment : "littlefs");
+    }
+    return fsRootPath;
+}
+
+// --- Sensors ---
+
+static std::atomic<float> cpuCelsius(45.0f);
+
+void HostSim::setCpuTemperature(float celsius) {
+    cpuCelsius = celsius;
+}
+
+float HostSim::cpuTemperature() {
+    return cpuCelsius;
+}
+
+static std::atomic<float> dht22Celsius(21.5f);
+static std::atomic<float> dht22Rh(45.0f);
+
+void HostSim::setDht22Reading(float celsius, float humidity) {
+    dht22Celsius = celsius;
+    dht22Rh = humidity;
+}
+
+float HostSim::dht22Temperature() {
+    return dht22Celsius;
+}
+
+float HostSim::dht22Humidity() {
+    return dht22Rh;
+}
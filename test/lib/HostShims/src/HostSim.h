@@ -0,0 +1,60 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// What a host test can see and steer of the simulated device. Only the
+// native build has this header; firmware code must not include it.
+class HostSim {
+public:
+    // --- Clock ---
+    // With virtual time on, delay() advances millis()/micros() instead of
+    // sleeping, so code that waits (e.g. the second before an OTA reboot)
+    // costs nothing. The clock keeps running in real time either way.
+    static void setVirtualTime(bool enabled);
+    static void advanceMs(uint32_t ms);
+    static uint64_t nowUs();
+
+    // --- Restart ---
+    // ESP.restart() and esp_restart() run the shutdown handlers and then the
+    // handler set here. Without one the process exits. The firmware treats a
+    // restart as not returning, so a handler that returns lets the caller
+    // run on; tests only use that to count restarts.
+    typedef void (*RestartHandler)();
+    static void setRestartHandler(RestartHandler handler);
+    static uint32_t restartCount();
+    static void runShutdownHandlers();
+
+    // --- Heap ---
+    // Allocations (malloc, calloc, realloc, new) made by the calling thread
+    // since it started. Counted on glibc hosts only; elsewhere it stays 0.
+    static uint32_t allocationCount();
+    // Bytes all threads hold on the heap, as the simulated heap sees them
+    static size_t liveHeapBytes();
+
+    // --- HTTP ---
+    // Response HTTPClient returns for a GET of exactly this URL. The body is
+    // copied. Requests to other URLs fail to connect.
+    static void setHttpResponse(const char* url, int code, const uint8_t* body, size_t length);
+    static void setHttpResponse(const char* url, int code, const char* body);
+    static void clearHttpResponses();
+
+    // --- Filesystem ---
+    // Host directory LittleFS.begin() mounts; defaults to $HOST_FS_ROOT or,
+    // without it, ./littlefs
+    static void setFsRoot(const char* path);
+    static const char* fsRoot();
+
+    // --- Sensors ---
+    // temperatureRead() returns this plus up to 0.5 degrees of noise
+    static void setCpuTemperature(float celsius);
+    static float cpuTemperature();
+    // What the DHT22 on the RMT receiver reports; NaN for no answer, as
+    // from an unplugged sensor. Starts at 21.5 degrees and 45 %RH.
+    static void setDht22Reading(float celsius, float humidity);
+    static float dht22Temperature();
+    static float dht22Humidity();
+};
+
+#endif
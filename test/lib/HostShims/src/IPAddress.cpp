@@ -0,0 +1,40 @@
+#include "IPAddress.h"
+#include <stdio.h>
+
+const IPAddress INADDR_NONE(0, 0, 0, 0);
+
+bool IPAddress::fromString(const char* address) {
+    uint8_t bytes[4];
+    int part = 0;
+    unsigned value = 0;
+    bool digits = false;
+    for (const char* p = address; ; p++) {
+        if (*p >= '0' && *p <= '9') {
+            value = value * 10 + (*p - '0');
+            if (value > 255) {
+                return false;
+            }
+            digits = true;
+        } else if ((*p == '.' || *p == '\0') && digits && part < 4) {
+            bytes[part++] = (uint8_t)value;
+            value = 0;
+            digits = false;
+            if (*p == '\0') {
+                break;
+            }
+        } else {
+            return false;
+        }
+    }
+    if (part != 4) {
+        return false;
+    }
+    memcpy(_bytes, bytes, sizeof(_bytes));
+    return true;
+}
+
+String IPAddress::toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", _bytes[0], _bytes[1], _bytes[2], _bytes[3]);
+    return String(text);
+}
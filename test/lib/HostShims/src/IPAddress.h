@@ -0,0 +1,47 @@
+#ifndef HOST_IP_ADDRESS_H
+#define HOST_IP_ADDRESS_H
+
+#include <stdint.h>
+#include "WString.h"
+
+// <netinet/in.h> defines INADDR_NONE as a number; the Arduino core's is an IPAddress
+#ifdef INADDR_NONE
+#undef INADDR_NONE
+#endif
+
+// IPv4 address as the ESP32 core has it. Converts to and from a uint32_t in
+// network byte order.
+class IPAddress {
+public:
+    IPAddress() : _value(0) {}
+    IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth) {
+        _bytes[0] = first;
+        _bytes[1] = second;
+        _bytes[2] = third;
+        _bytes[3] = fourth;
+    }
+    IPAddress(uint32_t address) : _value(address) {}
+    IPAddress(const uint8_t* address) { memcpy(_bytes, address, sizeof(_bytes)); }
+
+    bool fromString(const char* address);
+    bool fromString(const String& address) { return fromString(address.c_str()); }
+
+    operator uint32_t() const { return _value; }
+    bool operator==(const IPAddress& other) const { return _value == other._value; }
+    bool operator!=(const IPAddress& other) const { return _value != other._value; }
+    uint8_t operator[](int index) const { return _bytes[index]; }
+    uint8_t& operator[](int index) { return _bytes[index]; }
+
+    String toString() const;
+    uint8_t* raw_address() { return _bytes; }
+
+private:
+    union {
+        uint8_t _bytes[4];
+        uint32_t _value;
+    };
+};
+
+extern const IPAddress INADDR_NONE;
+
+#endif
@@ -0,0 +1,99 @@
+#include "LittleFS.h"
+#include "HostSim.h"
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+fs::LittleFSFS LittleFS;
+
+static const size_t PARTITION_BYTES = 1441792;
+static const size_t BLOCK_BYTES = 4096;
+
+// Like mkdir -p
+static bool makeDirectories(const std::string& path) {
+    for (size_t slash = path.find('/', 1); ; slash = path.find('/', slash + 1)) {
+        std::string prefix = slash == std::string::npos ? path : path.substr(0, slash);
+        if (::mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) {
+            return false;
+        }
+        if (slash == std::string::npos) {
+            return true;
+        }
+    }
+}
+
+// Counts the blocks the files under path take; deletes everything on the way if asked
+static size_t walk(const std::string& path, bool remove) {
+    size_t blocks = 0;
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        return 0;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        std::string child = path + "/" + entry->d_name;
+        struct stat info;
+        if (stat(child.c_str(), &info) != 0) {
+            continue;
+        }
+        if (S_ISDIR(info.st_mode)) {
+            blocks += walk(child, remove);
+            if (remove) {
+                ::rmdir(child.c_str());
+            }
+        } else {
+            blocks += ((size_t)info.st_size + BLOCK_BYTES - 1) / BLOCK_BYTES;
+            if (remove) {
+                unlink(child.c_str());
+            }
+        }
+    }
+    closedir(dir);
+    return blocks;
+}
+
+namespace fs {
+
+bool LittleFSFS::begin(bool formatOnFail, const char* basePath, uint8_t maxOpenFiles, const char* partitionLabel) {
+    (void)formatOnFail;
+    (void)basePath;
+    (void)maxOpenFiles;
+    (void)partitionLabel;
+    if (mounted()) {
+        return true;
+    }
+    std::string root = HostSim::fsRoot();
+    while (root.size() > 1 && root.back() == '/') {
+        root.pop_back();
+    }
+    if (root.empty() || !makeDirectories(root)) {
+        return false;
+    }
+    _root = root;
+    return true;
+}
+
+bool LittleFSFS::format() {
+    if (!mounted()) {
+        return false;
+    }
+    walk(_root, true);
+    return true;
+}
+
+size_t LittleFSFS::totalBytes() {
+    return PARTITION_BYTES;
+}
+
+size_t LittleFSFS::usedBytes() {
+    return mounted() ? walk(_root, false) * BLOCK_BYTES : 0;
+}
+
+void LittleFSFS::end() {
+    _root.clear();
+}
+
+} // namespace fs
@@ -0,0 +1,25 @@
+#ifndef HOST_LITTLEFS_H
+#define HOST_LITTLEFS_H
+
+#include "FS.h"
+
+namespace fs {
+
+// Mounts HostSim::fsRoot(); reports the capacity of the default 1.4 MB
+// LittleFS partition of a 4 MB board
+class LittleFSFS : public FS {
+public:
+    bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpenFiles = 10,
+               const char* partitionLabel = "spiffs");
+    // Deletes everything under the root
+    bool format();
+    size_t totalBytes();
+    size_t usedBytes();
+    void end();
+};
+
+} // namespace fs
+
+extern fs::LittleFSFS LittleFS;
+
+#endif
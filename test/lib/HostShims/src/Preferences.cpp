@@ -0,0 +1,170 @@
+#include "Preferences.h"
+#include <map>
+#include <math.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+typedef std::map<std::string, std::vector<uint8_t>> Namespace;
+
+// Leaked, so task threads still running at exit never see it destroyed
+static std::mutex& storeLock = *new std::mutex();
+static std::map<std::string, Namespace>& store = *new std::map<std::string, Namespace>();
+
+static const size_t KEY_SIZE = 16;  // NVS limit, terminator included
+static const size_t ENTRY_CAPACITY = 630;  // A 20 KB NVS partition
+
+static bool validKey(const char* key) {
+    return key != nullptr && key[0] != '\0' && strlen(key) < KEY_SIZE;
+}
+
+bool Preferences::begin(const char* name, bool readOnly, const char* partitionLabel) {
+    (void)partitionLabel;
+    if (_started) {
+        return false;
+    }
+    if (name == nullptr || name[0] == '\0' || strlen(name) >= NAME_SIZE) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    if (store.find(name) == store.end()) {
+        if (readOnly) {
+            return false;
+        }
+        store[name];
+    }
+    strncpy(_name, name, NAME_SIZE);
+    _readOnly = readOnly;
+    _started = true;
+    return true;
+}
+
+void Preferences::end() {
+    _started = false;
+}
+
+bool Preferences::clear() {
+    if (!_started || _readOnly) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    store[_name].clear();
+    return true;
+}
+
+bool Preferences::remove(const char* key) {
+    if (!_started || _readOnly || !validKey(key)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    return store[_name].erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    if (!_started || !validKey(key)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    Namespace& entries = store[_name];
+    return entries.find(key) != entries.end();
+}
+
+size_t Preferences::putValue(const char* key, const void* value, size_t length) {
+    if (!_started || _readOnly || !validKey(key)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    const uint8_t* bytes = (const uint8_t*)value;
+    store[_name][key].assign(bytes, bytes + length);
+    return length;
+}
+
+bool Preferences::readValue(const char* key, void* value, size_t length) {
+    if (!_started || !validKey(key)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    Namespace& entries = store[_name];
+    auto found = entries.find(key);
+    if (found == entries.end() || found->second.size() != length) {
+        return false;
+    }
+    memcpy(value, found->second.data(), length);
+    return true;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    if (value == nullptr) {
+        return 0;
+    }
+    // Stored with the terminator, as NVS does; the core returns strlen
+    size_t length = strlen(value);
+    return putValue(key, value, length + 1) > 0 ? length : 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t length) {
+    if (value == nullptr || length == 0) {
+        return 0;
+    }
+    return putValue(key, value, length);
+}
+
+size_t Preferences::getString(const char* key, char* value, size_t maxLength) {
+    if (!_started || !validKey(key) || value == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    Namespace& entries = store[_name];
+    auto found = entries.find(key);
+    if (found == entries.end() || found->second.size() > maxLength) {
+        return 0;
+    }
+    memcpy(value, found->second.data(), found->second.size());
+    return found->second.size();
+}
+
+String Preferences::getString(const char* key, const String defaultValue) {
+    if (!_started || !validKey(key)) {
+        return defaultValue;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    Namespace& entries = store[_name];
+    auto found = entries.find(key);
+    if (found == entries.end()) {
+        return defaultValue;
+    }
+    return String((const char*)found->second.data());
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    if (!_started || !validKey(key)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    Namespace& entries = store[_name];
+    auto found = entries.find(key);
+    return found != entries.end() ? found->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char* key, void* buffer, size_t maxLength) {
+    if (!_started || !validKey(key) || buffer == nullptr) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(storeLock);
+    Namespace& entries = store[_name];
+    auto found = entries.find(key);
+    if (found == entries.end() || found->second.size() > maxLength) {
+        return 0;
+    }
+    memcpy(buffer, found->second.data(), found->second.size());
+    return found->second.size();
+}
+
+size_t Preferences::freeEntries() {
+    std::lock_guard<std::mutex> lock(storeLock);
+    size_t used = 0;
+    for (auto& entry : store) {
+        used += entry.second.size();
+    }
+    return used < ENTRY_CAPACITY ? ENTRY_CAPACITY - used : 0;
+}
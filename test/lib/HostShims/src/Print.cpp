@@ -0,0 +1,65 @@
+#include "Print.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t count = 0;
+    while (size-- > 0 && write(*buffer++) == 1) {
+        count++;
+    }
+    return count;
+}
+
+size_t Print::printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    size_t count = vprintf(format, args);
+    va_end(args);
+    return count;
+}
+
+// Formats on the stack like the core; longer text takes one heap buffer
+size_t Print::vprintf(const char* format, va_list args) {
+    char local[64];
+    va_list copy;
+    va_copy(copy, args);
+    int length = vsnprintf(local, sizeof(local), format, copy);
+    va_end(copy);
+    if (length < 0) {
+        return 0;
+    }
+    if ((size_t)length < sizeof(local)) {
+        return write((const uint8_t*)local, length);
+    }
+
+    char* text = static_cast<char*>(malloc(length + 1));
+    if (text == nullptr) {
+        return 0;
+    }
+    vsnprintf(text, length + 1, format, args);
+    size_t count = write((const uint8_t*)text, length);
+    free(text);
+    return count;
+}
+
+size_t Print::print(long value, int base) {
+    return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(long long value, int base) {
+    return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long long value, int base) {
+    return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(double value, int digits) {
+    char text[40];
+    int length = snprintf(text, sizeof(text), "%.*f", digits, value);
+    return length > 0 ? write((const uint8_t*)text, (size_t)length < sizeof(text) ? length : sizeof(text) - 1) : 0;
+}
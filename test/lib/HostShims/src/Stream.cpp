@@ -0,0 +1,68 @@
+#include "Stream.h"
+#include "Arduino.h"
+
+int Stream::timedRead() {
+    unsigned long start = millis();
+    do {
+        int value = read();
+        if (value >= 0) {
+            return value;
+        }
+        yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+int Stream::timedPeek() {
+    unsigned long start = millis();
+    do {
+        int value = peek();
+        if (value >= 0) {
+            return value;
+        }
+        yield();
+    } while (millis() - start < _timeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int value = timedRead();
+        if (value < 0) {
+            break;
+        }
+        buffer[count++] = (char)value;
+    }
+    return count;
+}
+
+size_t Stream::readBytesUntil(char terminator, char* buffer, size_t length) {
+    size_t count = 0;
+    while (count < length) {
+        int value = timedRead();
+        if (value < 0 || value == terminator) {
+            break;
+        }
+        buffer[count++] = (char)value;
+    }
+    return count;
+}
+
+String Stream::readString() {
+    String text;
+    int value;
+    while ((value = timedRead()) >= 0) {
+        text += (char)value;
+    }
+    return text;
+}
+
+String Stream::readStringUntil(char terminator) {
+    String text;
+    int value;
+    while ((value = timedRead()) >= 0 && value != terminator) {
+        text += (char)value;
+    }
+    return text;
+}
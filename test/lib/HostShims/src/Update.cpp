@@ -0,0 +1,136 @@
+#include "Update.h"
+#include <esp_rom_crc.h>
+#include <stdlib.h>
+#include <string.h>
+
+UpdateClass Update;
+
+static const uint8_t IMAGE_MAGIC = 0xE9;
+
+static const char* const errorTexts[] = {
+    "No Error",
+    "Flash Write Failed",
+    "Flash Erase Failed",
+    "Flash Read Failed",
+    "Not Enough Space",
+    "Bad Size Given",
+    "Stream Read Timeout",
+    "MD5 Check Failed",
+    "Wrong Magic Byte",
+    "Could Not Activate The Firmware",
+    "Partition Could Not be Found",
+    "Bad Argument",
+    "Aborted",
+};
+
+UpdateClass::UpdateClass()
+    : _buffer(nullptr), _bufferLength(0), _size(0), _progress(0), _error(UPDATE_ERROR_OK), _crc(0), _imageCrc(0),
+      _imagesAccepted(0) {}
+
+void UpdateClass::reset() {
+    free(_buffer);
+    _buffer = nullptr;
+    _bufferLength = 0;
+    _size = 0;
+    _progress = 0;
+    _crc = 0;
+}
+
+bool UpdateClass::begin(size_t size, int command, int ledPin, uint8_t ledOn, const char* label) {
+    (void)ledPin;
+    (void)ledOn;
+    (void)label;
+    if (_size > 0) {
+        return false;
+    }
+    _error = UPDATE_ERROR_OK;
+    if (size == 0 || command != U_FLASH) {
+        _error = size == 0 ? UPDATE_ERROR_SIZE : UPDATE_ERROR_BAD_ARGUMENT;
+        return false;
+    }
+    if (size == UPDATE_SIZE_UNKNOWN) {
+        size = PARTITION_SIZE;
+    } else if (size > PARTITION_SIZE) {
+        _error = UPDATE_ERROR_SIZE;
+        return false;
+    }
+    _buffer = (uint8_t*)malloc(SECTOR_SIZE);
+    if (_buffer == nullptr) {
+        _error = UPDATE_ERROR_SPACE;
+        return false;
+    }
+    _size = size;
+    return true;
+}
+
+bool UpdateClass::flushSector() {
+    if (_progress == 0 && _buffer[0] != IMAGE_MAGIC) {
+        _error = UPDATE_ERROR_MAGIC_BYTE;
+        return false;
+    }
+    _crc = esp_rom_crc32_le(_crc, _buffer, _bufferLength);
+    _progress += _bufferLength;
+    _bufferLength = 0;
+    return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t length) {
+    if (hasError() || !isRunning()) {
+        return 0;
+    }
+    if (length > remaining()) {
+        _error = UPDATE_ERROR_SPACE;
+        return 0;
+    }
+    size_t written = 0;
+    while (written < length) {
+        size_t chunk = SECTOR_SIZE - _bufferLength;
+        if (chunk > length - written) {
+            chunk = length - written;
+        }
+        memcpy(_buffer + _bufferLength, data + written, chunk);
+        _bufferLength += chunk;
+        written += chunk;
+        // The last bytes of an image of known size go out as soon as they arrive
+        if ((_bufferLength == SECTOR_SIZE || _progress + _bufferLength == _size) && !flushSector()) {
+            reset();
+            return 0;
+        }
+    }
+    return length;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+    if (hasError() || _size == 0) {
+        return false;
+    }
+    if (evenIfRemaining) {
+        if (_bufferLength > 0 && !flushSector()) {
+            reset();
+            return false;
+        }
+        _size = _progress;
+    }
+    if (!isFinished()) {
+        _error = UPDATE_ERROR_ABORT;
+        reset();
+        return false;
+    }
+    _imageCrc = _crc;
+    _imagesAccepted++;
+    reset();
+    return true;
+}
+
+void UpdateClass::abort() {
+    reset();
+    _error = UPDATE_ERROR_ABORT;
+}
+
+const char* UpdateClass::errorString() {
+    return _error < sizeof(errorTexts) / sizeof(errorTexts[0]) ? errorTexts[_error] : "UNKNOWN";
+}
+
+void UpdateClass::printError(Print& out) {
+    out.println(errorString());
+}
@@ -0,0 +1,74 @@
+#ifndef HOST_UPDATE_H
+#define HOST_UPDATE_H
+
+#include "Print.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define UPDATE_ERROR_OK (0)
+#define UPDATE_ERROR_WRITE (1)
+#define UPDATE_ERROR_ERASE (2)
+#define UPDATE_ERROR_READ (3)
+#define UPDATE_ERROR_SPACE (4)
+#define UPDATE_ERROR_SIZE (5)
+#define UPDATE_ERROR_STREAM (6)
+#define UPDATE_ERROR_MD5 (7)
+#define UPDATE_ERROR_MAGIC_BYTE (8)
+#define UPDATE_ERROR_ACTIVATE (9)
+#define UPDATE_ERROR_NO_PARTITION (10)
+#define UPDATE_ERROR_BAD_ARGUMENT (11)
+#define UPDATE_ERROR_ABORT (12)
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+#define U_FLASH 0
+#define U_SPIFFS 100
+
+// The OTA writer with the checks the core makes (partition size, the image
+// magic byte, a complete image at end()) and its 4 KB sector buffer. Nothing
+// is stored: the image is counted and checksummed, then dropped.
+class UpdateClass {
+public:
+    UpdateClass();
+
+    bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = 0,
+               const char* label = nullptr);
+    size_t write(uint8_t* data, size_t length);
+    bool end(bool evenIfRemaining = false);
+    void abort();
+
+    void printError(Print& out);
+    const char* errorString();
+    bool hasError() { return _error != UPDATE_ERROR_OK; }
+    uint8_t getError() { return _error; }
+    bool isRunning() { return _size > 0; }
+    bool isFinished() { return _progress == _size; }
+    size_t size() { return _size; }
+    size_t progress() { return _progress; }
+    size_t remaining() { return _size - _progress; }
+
+    // Host only: CRC-32 of the last image end() accepted, and how many
+    // images have been accepted
+    uint32_t imageCrc() { return _imageCrc; }
+    uint32_t imagesAccepted() { return _imagesAccepted; }
+
+private:
+    static const size_t SECTOR_SIZE = 4096;
+    static const size_t PARTITION_SIZE = 1966080;  // app0 in the default partition table
+
+    uint8_t* _buffer;
+    size_t _bufferLength;
+    size_t _size;
+    size_t _progress;
+    uint8_t _error;
+    uint32_t _crc;
+    uint32_t _imageCrc;
+    uint32_t _imagesAccepted;
+
+    bool flushSector();
+    void reset();
+};
+
+extern UpdateClass Update;
+
+#endif
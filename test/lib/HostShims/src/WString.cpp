@@ -0,0 +1,543 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Longest number text: 64 bits in base 2, a sign and the terminator
+static const size_t NUMBER_BUFFER_SIZE = 66;
+
+static void formatUnsigned(char* buffer, unsigned long long value, unsigned char base, bool negative) {
+    char digits[NUMBER_BUFFER_SIZE];
+    size_t count = 0;
+    if (base < 2 || base > 36) {
+        base = 10;
+    }
+    do {
+        unsigned digit = (unsigned)(value % base);
+        digits[count++] = (char)(digit < 10 ? '0' + digit : 'a' + digit - 10);
+        value /= base;
+    } while (value > 0);
+
+    size_t pos = 0;
+    if (negative) {
+        buffer[pos++] = '-';
+    }
+    while (count > 0) {
+        buffer[pos++] = digits[--count];
+    }
+    buffer[pos] = '\0';
+}
+
+// Negative values are signed only in base 10, as in the core
+static void formatSigned(char* buffer, long long value, unsigned char base) {
+    if (base == 10 && value < 0) {
+        formatUnsigned(buffer, 0ULL - (unsigned long long)value, base, true);
+    } else {
+        formatUnsigned(buffer, (unsigned long long)value, base, false);
+    }
+}
+
+static void formatFloat(char* buffer, double value, unsigned int decimalPlaces) {
+    snprintf(buffer, NUMBER_BUFFER_SIZE, "%.*f", decimalPlaces > 30 ? 30 : (int)decimalPlaces, value);
+}
+
+void String::init() {
+    _heap = nullptr;
+    _capacity = 0;
+    _length = 0;
+    _inline[0] = '\0';
+}
+
+String::String(const char* cstr) {
+    init();
+    if (cstr != nullptr) {
+        copy(cstr, strlen(cstr));
+    }
+}
+
+String::String(const char* cstr, unsigned int length) {
+    init();
+    if (cstr != nullptr) {
+        copy(cstr, length);
+    }
+}
+
+String::String(const String& str) {
+    init();
+    *this = str;
+}
+
+String::String(String&& rval) {
+    init();
+    move(rval);
+}
+
+String::String(StringSumHelper&& rval) {
+    init();
+    move(rval);
+}
+
+String::String(char c) {
+    init();
+    char text[2] = {c, '\0'};
+    *this = text;
+}
+
+#define STRING_FROM_INTEGER(Type, Format)              \
+    String::String(Type value, unsigned char base) {   \
+        init();                                        \
+        char text[NUMBER_BUFFER_SIZE];                 \
+        Format(text, value, base);                     \
+        *this = text;                                  \
+    }
+
+static void formatU(char* buffer, unsigned long long value, unsigned char base) {
+    formatUnsigned(buffer, value, base, false);
+}
+
+STRING_FROM_INTEGER(unsigned char, formatU)
+STRING_FROM_INTEGER(int, formatSigned)
+STRING_FROM_INTEGER(unsigned int, formatU)
+STRING_FROM_INTEGER(long, formatSigned)
+STRING_FROM_INTEGER(unsigned long, formatU)
+STRING_FROM_INTEGER(long long, formatSigned)
+STRING_FROM_INTEGER(unsigned long long, formatU)
+
+String::String(float value, unsigned int decimalPlaces) {
+    init();
+    char text[NUMBER_BUFFER_SIZE];
+    formatFloat(text, value, decimalPlaces);
+    *this = text;
+}
+
+String::String(double value, unsigned int decimalPlaces) {
+    init();
+    char text[NUMBER_BUFFER_SIZE];
+    formatFloat(text, value, decimalPlaces);
+    *this = text;
+}
+
+String::~String() {
+    free(_heap);
+}
+
+bool String::reserve(unsigned int size) {
+    if (capacity() >= size) {
+        return true;
+    }
+    return changeBuffer(size);
+}
+
+// The core's allocator: inline below 10 characters, otherwise a heap buffer
+// rounded up to 16 bytes and grown with realloc
+bool String::changeBuffer(unsigned int maxLength) {
+    if (maxLength < SSO_SIZE - 1) {
+        if (_heap != nullptr) {
+            memcpy(_inline, _heap, maxLength);
+            _inline[maxLength] = '\0';
+            free(_heap);
+            _heap = nullptr;
+            _capacity = 0;
+        }
+        return true;
+    }
+
+    size_t newSize = (maxLength + 16) & ~(size_t)0xF;
+    char* buffer = static_cast<char*>(realloc(_heap, newSize));
+    if (buffer == nullptr) {
+        return false;
+    }
+    if (_heap == nullptr) {
+        memcpy(buffer, _inline, SSO_SIZE);
+    }
+    _heap = buffer;
+    _capacity = (unsigned int)newSize - 1;
+    return true;
+}
+
+void String::setLength(unsigned int length) {
+    _length = length;
+    wbuffer()[length] = '\0';
+}
+
+String& String::copy(const char* cstr, unsigned int length) {
+    if (!reserve(length)) {
+        setLength(0);
+        return *this;
+    }
+    memmove(wbuffer(), cstr, length);
+    setLength(length);
+    return *this;
+}
+
+void String::move(String& rhs) {
+    if (this == &rhs) {
+        return;
+    }
+    free(_heap);
+    _heap = rhs._heap;
+    _capacity = rhs._capacity;
+    _length = rhs._length;
+    memcpy(_inline, rhs._inline, SSO_SIZE);
+    rhs.init();
+}
+
+String& String::operator=(const String& rhs) {
+    if (this != &rhs) {
+        copy(rhs.c_str(), rhs._length);
+    }
+    return *this;
+}
+
+String& String::operator=(const char* cstr) {
+    if (cstr == nullptr) {
+        setLength(0);
+        return *this;
+    }
+    return copy(cstr, strlen(cstr));
+}
+
+String& String::operator=(String&& rval) {
+    move(rval);
+    return *this;
+}
+
+String& String::operator=(StringSumHelper&& rval) {
+    move(rval);
+    return *this;
+}
+
+bool String::concat(const char* cstr, unsigned int length) {
+    if (cstr == nullptr) {
+        return false;
+    }
+    if (length == 0) {
+        return true;
+    }
+    unsigned int newLength = _length + length;
+    // cstr may point into this string's own buffer, which reserve() can move
+    const char* base = c_str();
+    bool self = cstr >= base && cstr < base + _length;
+    size_t offset = self ? (size_t)(cstr - base) : 0;
+    if (!reserve(newLength)) {
+        return false;
+    }
+    memmove(wbuffer() + _length, self ? c_str() + offset : cstr, length);
+    setLength(newLength);
+    return true;
+}
+
+bool String::concat(const String& str) {
+    return concat(str.c_str(), str._length);
+}
+
+bool String::concat(const char* cstr) {
+    return cstr != nullptr && concat(cstr, strlen(cstr));
+}
+
+bool String::concat(char c) {
+    return concat(&c, 1);
+}
+
+bool String::concatNumber(const char* text) {
+    return concat(text, strlen(text));
+}
+
+#define STRING_CONCAT_INTEGER(Type, Format)  \
+    bool String::concat(Type value) {        \
+        char text[NUMBER_BUFFER_SIZE];       \
+        Format(text, value, 10);             \
+        return concatNumber(text);           \
+    }
+
+STRING_CONCAT_INTEGER(unsigned char, formatU)
+STRING_CONCAT_INTEGER(int, formatSigned)
+STRING_CONCAT_INTEGER(unsigned int, formatU)
+STRING_CONCAT_INTEGER(long, formatSigned)
+STRING_CONCAT_INTEGER(unsigned long, formatU)
+STRING_CONCAT_INTEGER(long long, formatSigned)
+STRING_CONCAT_INTEGER(unsigned long long, formatU)
+
+bool String::concat(float value) {
+    char text[NUMBER_BUFFER_SIZE];
+    formatFloat(text, value, 2);
+    return concatNumber(text);
+}
+
+bool String::concat(double value) {
+    char text[NUMBER_BUFFER_SIZE];
+    formatFloat(text, value, 2);
+    return concatNumber(text);
+}
+
+#define STRING_SUM(Type)                                                   \
+    StringSumHelper& operator+(const StringSumHelper& lhs, Type rhs) {     \
+        StringSumHelper& sum = const_cast<StringSumHelper&>(lhs);          \
+        sum.concat(rhs);                                                   \
+        return sum;                                                        \
+    }
+
+STRING_SUM(const String&)
+STRING_SUM(const char*)
+STRING_SUM(char)
+STRING_SUM(unsigned char)
+STRING_SUM(int)
+STRING_SUM(unsigned int)
+STRING_SUM(long)
+STRING_SUM(unsigned long)
+STRING_SUM(long long)
+STRING_SUM(unsigned long long)
+STRING_SUM(float)
+STRING_SUM(double)
+STRING_SUM(const __FlashStringHelper*)
+
+int String::compareTo(const String& str) const {
+    return strcmp(c_str(), str.c_str());
+}
+
+bool String::equals(const String& str) const {
+    return _length == str._length && memcmp(c_str(), str.c_str(), _length) == 0;
+}
+
+bool String::equals(const char* cstr) const {
+    if (cstr == nullptr) {
+        return _length == 0;
+    }
+    return strcmp(c_str(), cstr) == 0;
+}
+
+bool String::equalsIgnoreCase(const String& str) const {
+    if (_length != str._length) {
+        return false;
+    }
+    for (unsigned int i = 0; i < _length; i++) {
+        if (tolower((unsigned char)c_str()[i]) != tolower((unsigned char)str.c_str()[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool String::equalsConstantTime(const String& str) const {
+    if (_length != str._length) {
+        return false;
+    }
+    unsigned char difference = 0;
+    for (unsigned int i = 0; i < _length; i++) {
+        difference |= (unsigned char)(c_str()[i] ^ str.c_str()[i]);
+    }
+    return difference == 0;
+}
+
+bool String::startsWith(const String& prefix) const {
+    return _length >= prefix._length && memcmp(c_str(), prefix.c_str(), prefix._length) == 0;
+}
+
+bool String::startsWith(const String& prefix, unsigned int offset) const {
+    return offset <= _length && _length - offset >= prefix._length &&
+           memcmp(c_str() + offset, prefix.c_str(), prefix._length) == 0;
+}
+
+bool String::endsWith(const String& suffix) const {
+    return _length >= suffix._length && memcmp(c_str() + _length - suffix._length, suffix.c_str(), suffix._length) == 0;
+}
+
+char String::charAt(unsigned int index) const {
+    return index < _length ? c_str()[index] : '\0';
+}
+
+void String::setCharAt(unsigned int index, char c) {
+    if (index < _length) {
+        wbuffer()[index] = c;
+    }
+}
+
+char String::operator[](unsigned int index) const {
+    return charAt(index);
+}
+
+char& String::operator[](unsigned int index) {
+    static char dummy;
+    if (index >= _length) {
+        dummy = '\0';
+        return dummy;
+    }
+    return wbuffer()[index];
+}
+
+void String::getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index) const {
+    if (bufsize == 0 || buf == nullptr) {
+        return;
+    }
+    if (index >= _length) {
+        buf[0] = '\0';
+        return;
+    }
+    unsigned int count = bufsize - 1;
+    if (count > _length - index) {
+        count = _length - index;
+    }
+    memcpy(buf, c_str() + index, count);
+    buf[count] = '\0';
+}
+
+int String::indexOf(char ch) const {
+    return indexOf(ch, 0);
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if (fromIndex >= _length) {
+        return -1;
+    }
+    const char* found = static_cast<const char*>(memchr(c_str() + fromIndex, ch, _length - fromIndex));
+    return found != nullptr ? (int)(found - c_str()) : -1;
+}
+
+int String::indexOf(const String& str) const {
+    return indexOf(str, 0);
+}
+
+int String::indexOf(const String& str, unsigned int fromIndex) const {
+    if (fromIndex > _length) {
+        return -1;
+    }
+    const char* found = strstr(c_str() + fromIndex, str.c_str());
+    return found != nullptr ? (int)(found - c_str()) : -1;
+}
+
+int String::lastIndexOf(char ch) const {
+    return _length > 0 ? lastIndexOf(ch, _length - 1) : -1;
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+    if (_length == 0) {
+        return -1;
+    }
+    if (fromIndex >= _length) {
+        fromIndex = _length - 1;
+    }
+    for (int i = (int)fromIndex; i >= 0; i--) {
+        if (c_str()[i] == ch) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int String::lastIndexOf(const String& str) const {
+    return _length >= str._length ? lastIndexOf(str, _length - str._length) : -1;
+}
+
+int String::lastIndexOf(const String& str, unsigned int fromIndex) const {
+    if (str._length == 0 || str._length > _length) {
+        return -1;
+    }
+    if (fromIndex > _length - str._length) {
+        fromIndex = _length - str._length;
+    }
+    for (int i = (int)fromIndex; i >= 0; i--) {
+        if (memcmp(c_str() + i, str.c_str(), str._length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+String String::substring(unsigned int beginIndex, unsigned int endIndex) const {
+    if (beginIndex > endIndex) {
+        unsigned int swap = beginIndex;
+        beginIndex = endIndex;
+        endIndex = swap;
+    }
+    if (beginIndex >= _length) {
+        return String();
+    }
+    if (endIndex > _length) {
+        endIndex = _length;
+    }
+    return String(c_str() + beginIndex, endIndex - beginIndex);
+}
+
+void String::replace(char find, char replace) {
+    char* text = wbuffer();
+    for (unsigned int i = 0; i < _length; i++) {
+        if (text[i] == find) {
+            text[i] = replace;
+        }
+    }
+}
+
+void String::replace(const String& find, const String& replace) {
+    if (_length == 0 || find._length == 0) {
+        return;
+    }
+    String result;
+    unsigned int pos = 0;
+    int match;
+    while ((match = indexOf(find, pos)) >= 0) {
+        result.concat(c_str() + pos, (unsigned int)match - pos);
+        result.concat(replace);
+        pos = (unsigned int)match + find._length;
+    }
+    if (pos == 0) {
+        return;
+    }
+    result.concat(c_str() + pos, _length - pos);
+    *this = static_cast<String&&>(result);
+}
+
+void String::remove(unsigned int index) {
+    remove(index, (unsigned int)-1);
+}
+
+void String::remove(unsigned int index, unsigned int count) {
+    if (index >= _length) {
+        return;
+    }
+    if (count > _length - index) {
+        count = _length - index;
+    }
+    char* text = wbuffer();
+    memmove(text + index, text + index + count, _length - index - count);
+    setLength(_length - count);
+}
+
+void String::toLowerCase() {
+    for (char& c : *this) {
+        c = (char)tolower((unsigned char)c);
+    }
+}
+
+void String::toUpperCase() {
+    for (char& c : *this) {
+        c = (char)toupper((unsigned char)c);
+    }
+}
+
+void String::trim() {
+    const char* text = c_str();
+    unsigned int start = 0;
+    while (start < _length && isspace((unsigned char)text[start])) {
+        start++;
+    }
+    unsigned int end = _length;
+    while (end > start && isspace((unsigned char)text[end - 1])) {
+        end--;
+    }
+    if (start > 0) {
+        memmove(wbuffer(), text + start, end - start);
+    }
+    setLength(end - start);
+}
+
+long String::toInt() const {
+    return atol(c_str());
+}
+
+float String::toFloat() const {
+    return (float)atof(c_str());
+}
+
+double String::toDouble() const {
+    return atof(c_str());
+}
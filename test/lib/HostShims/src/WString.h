@@ -0,0 +1,177 @@
+#ifndef HOST_WSTRING_H
+#define HOST_WSTRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+class __FlashStringHelper;
+class StringSumHelper;
+
+// The Arduino String with the ESP32 core's small-string buffer: contents
+// shorter than 10 characters are stored inline, longer ones on the heap in
+// 16-byte steps. Growth and allocation follow the core's rules, so
+// allocation counts taken on a host match the device.
+class String {
+public:
+    String(const char* cstr = "");
+    String(const char* cstr, unsigned int length);
+    String(const String& str);
+    String(const __FlashStringHelper* str) : String(reinterpret_cast<const char*>(str)) {}
+    String(String&& rval);
+    String(StringSumHelper&& rval);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+    ~String();
+
+    // Returns false if the memory could not be allocated
+    bool reserve(unsigned int size);
+    unsigned int length() const { return _length; }
+    bool isEmpty() const { return _length == 0; }
+
+    String& operator=(const String& rhs);
+    String& operator=(const char* cstr);
+    String& operator=(const __FlashStringHelper* str) { return *this = reinterpret_cast<const char*>(str); }
+    String& operator=(String&& rval);
+    String& operator=(StringSumHelper&& rval);
+
+    bool concat(const String& str);
+    bool concat(const char* cstr);
+    bool concat(const char* cstr, unsigned int length);
+    bool concat(const uint8_t* cstr, unsigned int length) { return concat((const char*)cstr, length); }
+    bool concat(char c);
+    bool concat(unsigned char value);
+    bool concat(int value);
+    bool concat(unsigned int value);
+    bool concat(long value);
+    bool concat(unsigned long value);
+    bool concat(long long value);
+    bool concat(unsigned long long value);
+    bool concat(float value);
+    bool concat(double value);
+    bool concat(const __FlashStringHelper* str) { return concat(reinterpret_cast<const char*>(str)); }
+
+    template <typename T>
+    String& operator+=(const T& rhs) {
+        concat(rhs);
+        return *this;
+    }
+
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, const String& rhs);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, const char* cstr);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, char c);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, unsigned char value);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, int value);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, unsigned int value);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, long value);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, unsigned long value);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, long long value);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, unsigned long long value);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, float value);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, double value);
+    friend StringSumHelper& operator+(const StringSumHelper& lhs, const __FlashStringHelper* str);
+
+    explicit operator bool() const { return true; }
+
+    int compareTo(const String& str) const;
+    bool equals(const String& str) const;
+    bool equals(const char* cstr) const;
+    bool operator==(const String& rhs) const { return equals(rhs); }
+    bool operator==(const char* cstr) const { return equals(cstr); }
+    bool operator!=(const String& rhs) const { return !equals(rhs); }
+    bool operator!=(const char* cstr) const { return !equals(cstr); }
+    bool operator<(const String& rhs) const { return compareTo(rhs) < 0; }
+    bool operator>(const String& rhs) const { return compareTo(rhs) > 0; }
+    bool operator<=(const String& rhs) const { return compareTo(rhs) <= 0; }
+    bool operator>=(const String& rhs) const { return compareTo(rhs) >= 0; }
+    bool equalsIgnoreCase(const String& str) const;
+    bool equalsConstantTime(const String& str) const;
+    bool startsWith(const String& prefix) const;
+    bool startsWith(const String& prefix, unsigned int offset) const;
+    bool endsWith(const String& suffix) const;
+
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator[](unsigned int index) const;
+    char& operator[](unsigned int index);
+    void getBytes(unsigned char* buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char* buf, unsigned int bufsize, unsigned int index = 0) const {
+        getBytes((unsigned char*)buf, bufsize, index);
+    }
+    const char* c_str() const { return buffer(); }
+    char* begin() { return wbuffer(); }
+    char* end() { return wbuffer() + _length; }
+    const char* begin() const { return c_str(); }
+    const char* end() const { return c_str() + _length; }
+
+    int indexOf(char ch) const;
+    int indexOf(char ch, unsigned int fromIndex) const;
+    int indexOf(const String& str) const;
+    int indexOf(const String& str, unsigned int fromIndex) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(char ch, unsigned int fromIndex) const;
+    int lastIndexOf(const String& str) const;
+    int lastIndexOf(const String& str, unsigned int fromIndex) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _length); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String& find, const String& replace);
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    long toInt() const;
+    float toFloat() const;
+    double toDouble() const;
+
+private:
+    // Size of the ESP32 core's inline buffer (a 32-bit pointer, two 16-bit fields and 3 bytes)
+    static const unsigned int SSO_SIZE = 11;
+
+    char* _heap;              // nullptr while the contents are inline
+    unsigned int _capacity;   // Of the heap buffer, without the terminator
+    unsigned int _length;
+    char _inline[SSO_SIZE];
+
+    const char* buffer() const { return _heap != nullptr ? _heap : _inline; }
+    char* wbuffer() { return _heap != nullptr ? _heap : _inline; }
+    unsigned int capacity() const { return _heap != nullptr ? _capacity : SSO_SIZE - 1; }
+    void init();
+    bool changeBuffer(unsigned int maxLength);
+    String& copy(const char* cstr, unsigned int length);
+    void move(String& rhs);
+    void setLength(unsigned int length);
+    bool concatNumber(const char* text);
+};
+
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* p) : String(p) {}
+    StringSumHelper(char c) : String(c) {}
+    StringSumHelper(unsigned char num) : String(num) {}
+    StringSumHelper(int num) : String(num) {}
+    StringSumHelper(unsigned int num) : String(num) {}
+    StringSumHelper(long num) : String(num) {}
+    StringSumHelper(unsigned long num) : String(num) {}
+    StringSumHelper(long long num) : String(num) {}
+    StringSumHelper(unsigned long long num) : String(num) {}
+    StringSumHelper(float num) : String(num) {}
+    StringSumHelper(double num) : String(num) {}
+};
+
+inline bool operator==(const char* lhs, const String& rhs) { return rhs.equals(lhs); }
+inline bool operator!=(const char* lhs, const String& rhs) { return !rhs.equals(lhs); }
+
+#endif
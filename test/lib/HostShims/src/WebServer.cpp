@@ -0,0 +1,663 @@
+#include "WebServer.h"
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Redefined by the system headers above
+#undef INADDR_NONE
+
+// What on() registers: one function for the request, one for upload pieces
+class FunctionRequestHandler : public RequestHandler {
+public:
+    FunctionRequestHandler(WebServer::THandlerFunction handler, WebServer::THandlerFunction uploadHandler,
+                           const String& uri, HTTPMethod method)
+        : _handler(handler), _uploadHandler(uploadHandler), _uri(uri), _method(method) {}
+
+    bool canHandle(HTTPMethod method, String uri) override {
+        return (_method == HTTP_ANY || _method == method) && uri == _uri;
+    }
+
+    bool canUpload(String uri) override { return _uploadHandler && canHandle(HTTP_POST, uri); }
+
+    bool handle(WebServer& server, HTTPMethod method, String uri) override {
+        (void)server;
+        if (!canHandle(method, uri)) {
+            return false;
+        }
+        _handler();
+        return true;
+    }
+
+    void upload(WebServer& server, String uri, HTTPUpload& upload) override {
+        (void)server;
+        (void)upload;
+        if (canUpload(uri)) {
+            _uploadHandler();
+        }
+    }
+
+private:
+    WebServer::THandlerFunction _handler;
+    WebServer::THandlerFunction _uploadHandler;
+    String _uri;
+    HTTPMethod _method;
+};
+
+WebServer::WebServer(int port)
+    : _port(port),
+      _listenFd(-1),
+      _firstHandler(nullptr),
+      _lastHandler(nullptr),
+      _currentHandler(nullptr),
+      _currentStatus(HC_NONE),
+      _statusChange(0),
+      _currentMethod(HTTP_ANY),
+      _currentVersion(0),
+      _currentUpload(nullptr),
+      _contentLength(CONTENT_LENGTH_NOT_SET),
+      _chunked(false) {}
+
+WebServer::~WebServer() {
+    close();
+    RequestHandler* handler = _firstHandler;
+    while (handler != nullptr) {
+        RequestHandler* next = handler->next();
+        if (dynamic_cast<FunctionRequestHandler*>(handler) != nullptr) {
+            delete handler; // addHandler()'s belong to the caller
+        }
+        handler = next;
+    }
+}
+
+void WebServer::begin() {
+    close();
+    int port = _port < 1024 ? _port + 8000 : _port;
+    const char* fromEnvironment = getenv("HOST_HTTP_PORT");
+    if (fromEnvironment != nullptr && fromEnvironment[0] != '\0') {
+        port = atoi(fromEnvironment);
+    }
+    // Loopback only, as WiFiClient connects, unless HOST_NETWORK=1
+    const char* network = getenv("HOST_NETWORK");
+    bool anyAddress = network != nullptr && strcmp(network, "1") == 0;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(anyAddress ? INADDR_ANY : INADDR_LOOPBACK);
+    // lwIP queues few connections; the rest wait in the host's SYN backlog
+    if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 4) != 0) {
+        fprintf(stderr, "WebServer: cannot listen on port %d: %s\n", port, strerror(errno));
+        if (fd >= 0) {
+            ::close(fd);
+        }
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    _listenFd = fd;
+}
+
+void WebServer::begin(uint16_t port) {
+    _port = port;
+    begin();
+}
+
+void WebServer::close() {
+    if (_listenFd >= 0) {
+        ::close(_listenFd);
+        _listenFd = -1;
+    }
+    _currentClient = WiFiClient();
+    _currentStatus = HC_NONE;
+    resetRequest();
+}
+
+void WebServer::on(const String& uri, THandlerFunction handler) {
+    on(uri, HTTP_ANY, handler);
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler) {
+    addHandler(new FunctionRequestHandler(handler, nullptr, uri, method));
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler) {
+    addHandler(new FunctionRequestHandler(handler, uploadHandler, uri, method));
+}
+
+void WebServer::addHandler(RequestHandler* handler) {
+    if (_lastHandler == nullptr) {
+        _firstHandler = handler;
+    } else {
+        _lastHandler->next(handler);
+    }
+    _lastHandler = handler;
+}
+
+// Same states and timeouts as the core
+void WebServer::handleClient() {
+    if (_currentStatus == HC_NONE) {
+        int fd = _listenFd >= 0 ? accept(_listenFd, nullptr, nullptr) : -1;
+        if (fd < 0) {
+            delay(1);
+            return;
+        }
+        _currentClient = WiFiClient(fd);
+        _currentStatus = HC_WAIT_READ;
+        _statusChange = millis();
+    }
+
+    bool keepCurrentClient = false;
+    if (_currentClient.connected()) {
+        switch (_currentStatus) {
+        case HC_WAIT_READ:
+            if (_currentClient.available()) {
+                if (parseRequest()) {
+                    _contentLength = CONTENT_LENGTH_NOT_SET;
+                    handleRequest();
+                    if (_currentClient.connected()) {
+                        _currentStatus = HC_WAIT_CLOSE;
+                        _statusChange = millis();
+                        keepCurrentClient = true;
+                    }
+                }
+            } else if (millis() - _statusChange <= HTTP_MAX_DATA_WAIT) {
+                keepCurrentClient = true;
+            }
+            break;
+        case HC_WAIT_CLOSE:
+            keepCurrentClient = millis() - _statusChange <= HTTP_MAX_CLOSE_WAIT;
+            break;
+        case HC_NONE:
+            break;
+        }
+    }
+
+    if (!keepCurrentClient) {
+        _currentClient = WiFiClient();
+        _currentStatus = HC_NONE;
+        resetRequest();
+    }
+    yield();
+}
+
+void WebServer::resetRequest() {
+    delete _currentUpload;
+    _currentUpload = nullptr;
+}
+
+bool WebServer::readLine(String& line, unsigned long timeoutMs) {
+    _currentClient.setTimeout(timeoutMs);
+    line = _currentClient.readStringUntil('\n');
+    if (line.length() > 0 && line[line.length() - 1] == '\r') {
+        line.remove(line.length() - 1);
+    }
+    return _currentClient.connected() || line.length() > 0;
+}
+
+static HTTPMethod parseMethod(const String& text) {
+    if (text == "POST") {
+        return HTTP_POST;
+    } else if (text == "HEAD") {
+        return HTTP_HEAD;
+    } else if (text == "PUT") {
+        return HTTP_PUT;
+    } else if (text == "DELETE") {
+        return HTTP_DELETE;
+    } else if (text == "OPTIONS") {
+        return HTTP_OPTIONS;
+    } else if (text == "PATCH") {
+        return HTTP_PATCH;
+    }
+    return HTTP_GET;
+}
+
+bool WebServer::parseRequest() {
+    String requestLine;
+    readLine(requestLine, HTTP_MAX_DATA_WAIT);
+    int methodEnd = requestLine.indexOf(' ');
+    int urlEnd = methodEnd < 0 ? -1 : requestLine.indexOf(' ', methodEnd + 1);
+    if (methodEnd < 0 || urlEnd < 0) {
+        return false;
+    }
+    String url = requestLine.substring(methodEnd + 1, urlEnd);
+    String version = requestLine.substring(urlEnd + 1);
+    _currentVersion = version == "HTTP/1.0" ? 0 : 1;
+    _currentMethod = parseMethod(requestLine.substring(0, methodEnd));
+
+    String query;
+    int queryStart = url.indexOf('?');
+    if (queryStart >= 0) {
+        query = url.substring(queryStart + 1);
+        url = url.substring(0, queryStart);
+    }
+    _currentUri = url;
+    _args.clear();
+    _hostHeader = "";
+    for (Pair& header : _headers) {
+        header.value = "";
+    }
+
+    _currentHandler = nullptr;
+    for (RequestHandler* handler = _firstHandler; handler != nullptr; handler = handler->next()) {
+        if (handler->canHandle(_currentMethod, _currentUri)) {
+            _currentHandler = handler;
+            break;
+        }
+    }
+
+    String contentType;
+    size_t contentLength = 0;
+    String line;
+    while (readLine(line, HTTP_MAX_DATA_WAIT) && line.length() > 0) {
+        int colon = line.indexOf(':');
+        if (colon < 0) {
+            continue;
+        }
+        String name = line.substring(0, colon);
+        String value = line.substring(colon + 1);
+        value.trim();
+        for (Pair& header : _headers) {
+            if (header.key.equalsIgnoreCase(name)) {
+                header.value = value;
+            }
+        }
+        if (name.equalsIgnoreCase("Host")) {
+            _hostHeader = value;
+        } else if (name.equalsIgnoreCase("Content-Type")) {
+            contentType = value;
+        } else if (name.equalsIgnoreCase("Content-Length")) {
+            contentLength = strtoul(value.c_str(), nullptr, 10);
+        }
+    }
+
+    bool hasBody = _currentMethod == HTTP_POST || _currentMethod == HTTP_PUT || _currentMethod == HTTP_PATCH ||
+                   _currentMethod == HTTP_DELETE;
+    if (!hasBody) {
+        parseArguments(query);
+        return true;
+    }
+
+    if (contentType.startsWith("multipart/")) {
+        int boundaryStart = contentType.indexOf("boundary=");
+        if (boundaryStart < 0) {
+            return false;
+        }
+        String boundary = contentType.substring(boundaryStart + 9);
+        if (boundary.startsWith("\"")) {
+            boundary = boundary.substring(1, boundary.length() - 1);
+        }
+        parseArguments(query);
+        return parseForm(boundary, contentLength);
+    }
+
+    // Other bodies are read whole: form fields join the query, anything else is "plain"
+    String body;
+    if (contentLength > 0) {
+        char* buffer = (char*)malloc(contentLength + 1);
+        if (buffer == nullptr) {
+            return false;
+        }
+        _currentClient.setTimeout(HTTP_MAX_POST_WAIT);
+        size_t received = _currentClient.readBytes(buffer, contentLength);
+        buffer[received] = '\0';
+        body = String(buffer, received);
+        free(buffer);
+        if (received < contentLength) {
+            return false;
+        }
+    }
+    bool encoded = contentType.startsWith("application/x-www-form-urlencoded");
+    if (encoded && body.length() > 0) {
+        if (query.length() > 0) {
+            query += '&';
+        }
+        query += body;
+    }
+    parseArguments(query);
+    if (!encoded && contentLength > 0) {
+        _args.push_back({String("plain"), body});
+    }
+    return true;
+}
+
+void WebServer::parseArguments(const String& query) {
+    int start = 0;
+    while (start < (int)query.length()) {
+        int end = query.indexOf('&', start);
+        if (end < 0) {
+            end = query.length();
+        }
+        String item = query.substring(start, end);
+        start = end + 1;
+        if (item.length() == 0) {
+            continue;
+        }
+        int equals = item.indexOf('=');
+        if (equals < 0) {
+            _args.push_back({urlDecode(item), String()});
+        } else {
+            _args.push_back({urlDecode(item.substring(0, equals)), urlDecode(item.substring(equals + 1))});
+        }
+    }
+}
+
+// Streams the parts: fields become arguments, files go to the upload handler
+bool WebServer::parseForm(const String& boundary, size_t contentLength) {
+    size_t remaining = contentLength;
+    _currentClient.setTimeout(HTTP_MAX_POST_WAIT);
+    auto nextByte = [this, &remaining]() -> int {
+        if (remaining == 0) {
+            return -1;
+        }
+        char value;
+        if (_currentClient.readBytes(&value, 1) != 1) {
+            return -1;
+        }
+        remaining--;
+        return (uint8_t)value;
+    };
+    auto nextLine = [&nextByte](String& line) -> bool {
+        line = "";
+        int value;
+        while ((value = nextByte()) >= 0 && value != '\n') {
+            if (value != '\r') {
+                line += (char)value;
+            }
+        }
+        return value == '\n';
+    };
+    // Hands every byte before the delimiter to sink. The delimiter starts with
+    // the only CR in it, so after a mismatch a CR is the only restart point.
+    String delimiter = "\r\n--" + boundary;
+    auto readPart = [&nextByte, &delimiter](std::function<void(uint8_t)> sink) -> bool {
+        size_t matched = 0;
+        while (matched < delimiter.length()) {
+            int value = nextByte();
+            if (value < 0) {
+                return false;
+            }
+            if (value == delimiter[matched]) {
+                matched++;
+                continue;
+            }
+            for (size_t i = 0; i < matched; i++) {
+                sink(delimiter[i]);
+            }
+            matched = value == '\r' ? 1 : 0;
+            if (matched == 0) {
+                sink((uint8_t)value);
+            }
+        }
+        return true;
+    };
+
+    String line;
+    if (!nextLine(line) || line != "--" + boundary) {
+        return false;
+    }
+    while (true) {
+        String name;
+        String filename;
+        String type;
+        while (nextLine(line) && line.length() > 0) {
+            String lower = line;
+            lower.toLowerCase();
+            if (lower.startsWith("content-disposition:")) {
+                int nameStart = line.indexOf("name=\"");
+                if (nameStart >= 0) {
+                    name = line.substring(nameStart + 6, line.indexOf('"', nameStart + 6));
+                }
+                int fileStart = line.indexOf("filename=\"");
+                if (fileStart >= 0) {
+                    filename = line.substring(fileStart + 10, line.indexOf('"', fileStart + 10));
+                }
+            } else if (lower.startsWith("content-type:")) {
+                type = line.substring(13);
+                type.trim();
+            }
+        }
+
+        if (filename.length() == 0) {
+            String value;
+            if (!readPart([&value](uint8_t byte) { value += (char)byte; })) {
+                return false;
+            }
+            _args.push_back({name, value});
+        } else {
+            delete _currentUpload;
+            _currentUpload = new HTTPUpload();
+            HTTPUpload& upload = *_currentUpload;
+            upload.status = UPLOAD_FILE_START;
+            upload.filename = filename;
+            upload.name = name;
+            upload.type = type;
+            upload.totalSize = 0;
+            upload.currentSize = 0;
+            bool canUpload = _currentHandler != nullptr && _currentHandler->canUpload(_currentUri);
+            if (canUpload) {
+                _currentHandler->upload(*this, _currentUri, upload);
+            }
+            upload.status = UPLOAD_FILE_WRITE;
+            auto sendPiece = [this, &upload, canUpload]() {
+                if (canUpload) {
+                    _currentHandler->upload(*this, _currentUri, upload);
+                }
+                upload.totalSize += upload.currentSize;
+                upload.currentSize = 0;
+            };
+            bool complete = readPart([&upload, &sendPiece](uint8_t byte) {
+                upload.buf[upload.currentSize++] = byte;
+                if (upload.currentSize == HTTP_UPLOAD_BUFLEN) {
+                    sendPiece();
+                }
+            });
+            if (upload.currentSize > 0) {
+                sendPiece();
+            }
+            upload.status = complete ? UPLOAD_FILE_END : UPLOAD_FILE_ABORTED;
+            if (canUpload) {
+                _currentHandler->upload(*this, _currentUri, upload);
+            }
+            if (!complete) {
+                return false;
+            }
+        }
+
+        // "--" after the delimiter ends the body; a line break starts another part
+        nextLine(line);
+        if (line.startsWith("--")) {
+            return true;
+        }
+    }
+}
+
+void WebServer::handleRequest() {
+    bool handled = _currentHandler != nullptr && _currentHandler->handle(*this, _currentMethod, _currentUri);
+    if (!handled && _notFoundHandler) {
+        _notFoundHandler();
+        handled = true;
+    }
+    if (!handled) {
+        send(404, "text/html", "Not found: " + _currentUri);
+    }
+    finalizeResponse();
+    // As in the core: uri() is empty once the request has been answered
+    _currentUri = "";
+}
+
+void WebServer::finalizeResponse() {
+    if (_chunked) {
+        sendContent("", 0);
+    }
+}
+
+String WebServer::arg(const String& name) {
+    for (const Pair& argument : _args) {
+        if (argument.key == name) {
+            return argument.value;
+        }
+    }
+    return String();
+}
+
+String WebServer::arg(int index) {
+    return index >= 0 && index < (int)_args.size() ? _args[index].value : String();
+}
+
+String WebServer::argName(int index) {
+    return index >= 0 && index < (int)_args.size() ? _args[index].key : String();
+}
+
+bool WebServer::hasArg(const String& name) {
+    for (const Pair& argument : _args) {
+        if (argument.key == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WebServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+    _headers.clear();
+    for (size_t i = 0; i < headerKeysCount; i++) {
+        _headers.push_back({String(headerKeys[i]), String()});
+    }
+}
+
+String WebServer::header(const String& name) {
+    for (const Pair& header : _headers) {
+        if (header.key.equalsIgnoreCase(name)) {
+            return header.value;
+        }
+    }
+    return String();
+}
+
+String WebServer::header(int index) {
+    return index >= 0 && index < (int)_headers.size() ? _headers[index].value : String();
+}
+
+String WebServer::headerName(int index) {
+    return index >= 0 && index < (int)_headers.size() ? _headers[index].key : String();
+}
+
+bool WebServer::hasHeader(const String& name) {
+    return header(name).length() > 0;
+}
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+    String line = name + ": " + value + "\r\n";
+    if (first) {
+        _responseHeaders = line + _responseHeaders;
+    } else {
+        _responseHeaders += line;
+    }
+}
+
+void WebServer::prepareHeader(String& response, int code, const char* contentType, size_t contentLength) {
+    response = "HTTP/1." + String(_currentVersion) + " " + String(code) + " " + responseCodeText(code) + "\r\n";
+    sendHeader("Content-Type", contentType != nullptr ? contentType : "text/html", true);
+    if (_contentLength == CONTENT_LENGTH_NOT_SET) {
+        sendHeader("Content-Length", String((unsigned long)contentLength));
+    } else if (_contentLength != CONTENT_LENGTH_UNKNOWN) {
+        sendHeader("Content-Length", String((unsigned long)_contentLength));
+    } else if (_currentVersion > 0) {
+        // Length unknown and the client speaks HTTP/1.1: send chunks
+        _chunked = true;
+        sendHeader("Accept-Ranges", "none");
+        sendHeader("Transfer-Encoding", "chunked");
+    }
+    sendHeader("Connection", "close");
+    response += _responseHeaders;
+    response += "\r\n";
+    _responseHeaders = "";
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+    String header;
+    prepareHeader(header, code, contentType, content.length());
+    write(header.c_str(), header.length());
+    if (content.length() > 0) {
+        sendContent(content);
+    }
+}
+
+void WebServer::send_P(int code, const char* contentType, const char* content) {
+    send_P(code, contentType, content, content != nullptr ? strlen(content) : 0);
+}
+
+void WebServer::send_P(int code, const char* contentType, const char* content, size_t contentLength) {
+    String header;
+    prepareHeader(header, code, contentType, contentLength);
+    write(header.c_str(), header.length());
+    if (contentLength > 0) {
+        sendContent(content, contentLength);
+    }
+}
+
+void WebServer::sendContent(const char* content, size_t contentLength) {
+    if (_chunked) {
+        char chunkSize[12];
+        snprintf(chunkSize, sizeof(chunkSize), "%zx\r\n", contentLength);
+        write(chunkSize, strlen(chunkSize));
+    }
+    write(content, contentLength);
+    if (_chunked) {
+        write("\r\n", 2);
+        if (contentLength == 0) {
+            _chunked = false;
+        }
+    }
+}
+
+void WebServer::write(const char* data, size_t length) {
+    if (length > 0) {
+        _currentClient.write((const uint8_t*)data, length);
+    }
+}
+
+String WebServer::urlDecode(const String& text) {
+    String decoded;
+    for (unsigned int i = 0; i < text.length(); i++) {
+        char c = text[i];
+        if (c == '+') {
+            decoded += ' ';
+        } else if (c == '%' && i + 2 < text.length()) {
+            char hex[3] = {text[i + 1], text[i + 2], '\0'};
+            decoded += (char)strtol(hex, nullptr, 16);
+            i += 2;
+        } else {
+            decoded += c;
+        }
+    }
+    return decoded;
+}
+
+const char* WebServer::responseCodeText(int code) {
+    switch (code) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Request Entity Too Large";
+    case 416: return "Range Not Satisfiable";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "";
+    }
+}
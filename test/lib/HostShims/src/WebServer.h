@@ -0,0 +1,172 @@
+#ifndef HOST_WEB_SERVER_H
+#define HOST_WEB_SERVER_H
+
+#include <functional>
+#include <vector>
+#include "WString.h"
+#include "WiFiClient.h"
+
+// The ESP32 core's WebServer on a host socket, with the same request
+// handling: one client at a time, handlers tried in the order they were
+// added, "Connection: close" on every response, multipart file uploads fed
+// to the upload handler in HTTP_UPLOAD_BUFLEN pieces, and only the headers
+// named in collectHeaders() kept. Like the core, handleClient() waits up to
+// HTTP_MAX_CLOSE_WAIT for the client to hang up before taking the next one.
+//
+// Ports below 1024 need root on most hosts, so those listen 8000 higher
+// (80 on 8080); $HOST_HTTP_PORT, when set, overrides the port.
+
+// Values as in the core's http_parser
+typedef enum {
+    HTTP_DELETE = 0,
+    HTTP_GET = 1,
+    HTTP_HEAD = 2,
+    HTTP_POST = 3,
+    HTTP_PUT = 4,
+    HTTP_OPTIONS = 6,
+    HTTP_PATCH = 28,
+    HTTP_ANY = 255,
+} HTTPMethod;
+
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+#define HTTP_UPLOAD_BUFLEN 1436
+#define HTTP_MAX_DATA_WAIT 5000  // ms to wait for the client to send the request
+#define HTTP_MAX_POST_WAIT 5000  // ms to wait for POST data to arrive
+#define HTTP_MAX_CLOSE_WAIT 2000 // ms to wait for the client to close the connection
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+struct HTTPUpload {
+    HTTPUploadStatus status;
+    String filename;
+    String name;
+    String type;
+    size_t totalSize;   // File size so far
+    size_t currentSize; // Bytes in buf
+    uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+class WebServer;
+
+class RequestHandler {
+public:
+    virtual ~RequestHandler() {}
+    virtual bool canHandle(HTTPMethod method, String uri) { (void)method; (void)uri; return false; }
+    virtual bool canUpload(String uri) { (void)uri; return false; }
+    virtual bool handle(WebServer& server, HTTPMethod method, String uri) {
+        (void)server;
+        (void)method;
+        (void)uri;
+        return false;
+    }
+    virtual void upload(WebServer& server, String uri, HTTPUpload& upload) {
+        (void)server;
+        (void)uri;
+        (void)upload;
+    }
+
+    RequestHandler* next() { return _next; }
+    void next(RequestHandler* handler) { _next = handler; }
+
+private:
+    RequestHandler* _next = nullptr;
+};
+
+class WebServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    explicit WebServer(int port = 80);
+    ~WebServer();
+
+    void begin();
+    void begin(uint16_t port);
+    void handleClient();
+    void close();
+    void stop() { close(); }
+
+    void on(const String& uri, THandlerFunction handler);
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler);
+    void on(const String& uri, HTTPMethod method, THandlerFunction handler, THandlerFunction uploadHandler);
+    void addHandler(RequestHandler* handler);
+    void onNotFound(THandlerFunction handler) { _notFoundHandler = handler; }
+
+    String uri() { return _currentUri; }
+    HTTPMethod method() { return _currentMethod; }
+    WiFiClient client() { return _currentClient; }
+    HTTPUpload& upload() { return *_currentUpload; }
+
+    String arg(const String& name);
+    String arg(int index);
+    String argName(int index);
+    int args() { return (int)_args.size(); }
+    bool hasArg(const String& name);
+
+    void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+    String header(const String& name);
+    String header(int index);
+    String headerName(int index);
+    int headers() { return (int)_headers.size(); }
+    bool hasHeader(const String& name);
+    String hostHeader() { return _hostHeader; }
+
+    void send(int code, const char* contentType = nullptr, const String& content = String(""));
+    void send(int code, char* contentType, const String& content) { send(code, (const char*)contentType, content); }
+    void send(int code, const String& contentType, const String& content) { send(code, contentType.c_str(), content); }
+    void send_P(int code, const char* contentType, const char* content);
+    void send_P(int code, const char* contentType, const char* content, size_t contentLength);
+
+    void setContentLength(const size_t contentLength) { _contentLength = contentLength; }
+    void sendHeader(const String& name, const String& value, bool first = false);
+    void sendContent(const String& content) { sendContent(content.c_str(), content.length()); }
+    void sendContent(const char* content, size_t contentLength);
+    void sendContent_P(const char* content) { sendContent(content, strlen(content)); }
+    void sendContent_P(const char* content, size_t size) { sendContent(content, size); }
+
+    static String urlDecode(const String& text);
+
+private:
+    enum ClientStatus { HC_NONE, HC_WAIT_READ, HC_WAIT_CLOSE };
+
+    struct Pair {
+        String key;
+        String value;
+    };
+
+    int _port;
+    int _listenFd;
+    RequestHandler* _firstHandler;
+    RequestHandler* _lastHandler;
+    RequestHandler* _currentHandler;
+    THandlerFunction _notFoundHandler;
+
+    WiFiClient _currentClient;
+    ClientStatus _currentStatus;
+    unsigned long _statusChange;
+    HTTPMethod _currentMethod;
+    String _currentUri;
+    uint8_t _currentVersion;
+    std::vector<Pair> _args;
+    std::vector<Pair> _headers; // Collected names, with values once a request has them
+    String _hostHeader;
+    HTTPUpload* _currentUpload;
+
+    String _responseHeaders;
+    size_t _contentLength;
+    bool _chunked;
+
+    bool parseRequest();
+    void parseArguments(const String& query);
+    bool parseForm(const String& boundary, size_t contentLength);
+    void handleRequest();
+    void finalizeResponse();
+    void prepareHeader(String& response, int code, const char* contentType, size_t contentLength);
+    void write(const char* data, size_t length);
+    bool readLine(String& line, unsigned long timeoutMs);
+    void resetRequest();
+    static const char* responseCodeText(int code);
+};
+
+#endif
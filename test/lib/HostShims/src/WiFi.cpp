@@ -0,0 +1,137 @@
+#include "WiFi.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_netif.h"
+#include "lwip/dhcp.h"
+
+WiFiClass WiFi;
+
+static uint8_t stationMac[6] = {0x02, 0xE5, 0x32, 0x00, 0x00, 0x01};
+static uint8_t accessPointMac[6] = {0x02, 0xE5, 0x32, 0x00, 0x00, 0xAA};
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel, const uint8_t* bssid,
+                             bool connect) {
+    (void)passphrase;
+    (void)channel;
+    (void)bssid;
+    if (ssid == nullptr || ssid[0] == '\0' || _mode == WIFI_MODE_NULL) {
+        return WL_CONNECT_FAILED;
+    }
+    _ssid = ssid;
+    if (!connect) {
+        return _status;
+    }
+    arduino_event_info_t info;
+    memset(&info, 0, sizeof(info));
+    _status = WL_CONNECTED;
+    raise(ARDUINO_EVENT_WIFI_STA_CONNECTED, info);
+    raise(ARDUINO_EVENT_WIFI_STA_GOT_IP, info);
+    return _status;
+}
+
+bool WiFiClass::disconnect(bool wifiOff, bool eraseAp) {
+    (void)eraseAp;
+    bool wasConnected = _status == WL_CONNECTED;
+    _status = WL_DISCONNECTED;
+    if (wasConnected) {
+        arduino_event_info_t info;
+        memset(&info, 0, sizeof(info));
+        info.wifi_sta_disconnected.reason = WIFI_REASON_ASSOC_LEAVE;
+        raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, info);
+    }
+    if (wifiOff) {
+        _mode = WIFI_MODE_NULL;
+    }
+    return true;
+}
+
+// The address always stays on loopback, so a static one is only accepted
+bool WiFiClass::config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1, IPAddress dns2) {
+    (void)localIp;
+    (void)gateway;
+    (void)subnet;
+    (void)dns1;
+    (void)dns2;
+    return true;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    if (mode == WIFI_MODE_NULL && _status == WL_CONNECTED) {
+        disconnect();
+    }
+    _mode = mode;
+    return true;
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback, arduino_event_id_t event) {
+    if (_handlerCount == sizeof(_handlers) / sizeof(_handlers[0])) {
+        return 0;
+    }
+    _handlers[_handlerCount].callback = callback;
+    _handlers[_handlerCount].event = event;
+    return ++_handlerCount;
+}
+
+void WiFiClass::raise(arduino_event_id_t event, arduino_event_info_t info) {
+    for (size_t i = 0; i < _handlerCount; i++) {
+        if (_handlers[i].event == ARDUINO_EVENT_MAX || _handlers[i].event == event) {
+            _handlers[i].callback(event, info);
+        }
+    }
+}
+
+String WiFiClass::SSID() {
+    return _status == WL_CONNECTED ? _ssid : String();
+}
+
+String WiFiClass::macAddress() {
+    char text[18];
+    snprintf(text, sizeof(text), "%02X:%02X:%02X:%02X:%02X:%02X", stationMac[0], stationMac[1], stationMac[2],
+             stationMac[3], stationMac[4], stationMac[5]);
+    return String(text);
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+    memcpy(mac, stationMac, sizeof(stationMac));
+    return mac;
+}
+
+uint8_t* WiFiClass::BSSID() {
+    return accessPointMac;
+}
+
+int16_t WiFiClass::scanNetworks(bool async) {
+    (void)async;
+    _scanCount = 1;
+    return _scanCount;
+}
+
+String WiFiClass::SSID(uint8_t index) {
+    return index < _scanCount ? _ssid : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t index) {
+    return index < _scanCount ? RSSI() : 0;
+}
+
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t index) {
+    (void)index;
+    return WIFI_AUTH_WPA2_PSK;
+}
+
+// --- esp_netif ---
+
+struct esp_netif_obj {
+    struct netif impl;
+};
+
+static struct dhcp stationLease = {86400, 43200, 75600};
+static esp_netif_t station = {{&stationLease}};
+
+esp_netif_t* esp_netif_get_handle_from_ifkey(const char* ifKey) {
+    return strcmp(ifKey, "WIFI_STA_DEF") == 0 ? &station : nullptr;
+}
+
+void* esp_netif_get_netif_impl(esp_netif_t* netif) {
+    return netif != nullptr ? &netif->impl : nullptr;
+}
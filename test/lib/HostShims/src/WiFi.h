@@ -0,0 +1,100 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <functional>
+#include "IPAddress.h"
+#include "WString.h"
+#include "WiFiClient.h"
+#include "esp_wifi_types.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+    WL_NO_SHIELD = 255,
+} wl_status_t;
+
+#define WIFI_OFF WIFI_MODE_NULL
+#define WIFI_STA WIFI_MODE_STA
+#define WIFI_AP WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_READY = 0,
+    ARDUINO_EVENT_WIFI_SCAN_DONE,
+    ARDUINO_EVENT_WIFI_STA_START,
+    ARDUINO_EVENT_WIFI_STA_STOP,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP6,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP,
+    ARDUINO_EVENT_MAX
+} arduino_event_id_t;
+
+typedef union {
+    wifi_event_sta_disconnected_t wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+typedef size_t wifi_event_id_t;
+
+// A station on the host's loopback address. It starts associated; begin()
+// connects at once and disconnect() drops the link, each raising the events
+// the core would, on the calling thread. A scan finds the one network.
+class WiFiClass {
+public:
+    wl_status_t status() { return _status; }
+    bool isConnected() { return _status == WL_CONNECTED; }
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0,
+                      const uint8_t* bssid = nullptr, bool connect = true);
+    bool disconnect(bool wifiOff = false, bool eraseAp = false);
+    bool config(IPAddress localIp, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(),
+                IPAddress dns2 = IPAddress());
+    bool mode(wifi_mode_t mode);
+    wifi_mode_t getMode() { return _mode; }
+    void persistent(bool persistent) { (void)persistent; }
+    bool setAutoReconnect(bool autoReconnect) { (void)autoReconnect; return true; }
+    wifi_event_id_t onEvent(WiFiEventFuncCb callback, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    IPAddress gatewayIP() { return IPAddress(127, 0, 0, 1); }
+    IPAddress subnetMask() { return IPAddress(255, 0, 0, 0); }
+    IPAddress dnsIP(uint8_t index = 0) { (void)index; return IPAddress(127, 0, 0, 1); }
+    int8_t RSSI() { return -55; }
+    String SSID();
+    String macAddress();
+    uint8_t* macAddress(uint8_t* mac);
+    int32_t channel() { return 6; }
+    uint8_t* BSSID();
+    String getHostname() { return String("esp32-host"); }
+
+    int16_t scanNetworks(bool async = false);
+    void scanDelete() { _scanCount = 0; }
+    String SSID(uint8_t index);
+    int32_t RSSI(uint8_t index);
+    wifi_auth_mode_t encryptionType(uint8_t index);
+
+private:
+    wl_status_t _status = WL_CONNECTED;
+    wifi_mode_t _mode = WIFI_MODE_STA;
+    String _ssid = "host";
+    int16_t _scanCount = 0;
+    struct Handler {
+        WiFiEventFuncCb callback;
+        arduino_event_id_t event;
+    };
+    Handler _handlers[8];
+    size_t _handlerCount = 0;
+
+    void raise(arduino_event_id_t event, arduino_event_info_t info);
+};
+
+extern WiFiClass WiFi;
+
+#endif
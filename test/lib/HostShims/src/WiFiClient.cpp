@@ -0,0 +1,315 @@
+#include "WiFiClient.h"
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Redefined by the system headers above
+#undef INADDR_NONE
+
+static const size_t RX_BUFFER_SIZE = 1436;  // One TCP segment, as the core reads
+static const int32_t DEFAULT_CONNECT_TIMEOUT_MS = 3000;
+
+struct WiFiClient::Connection {
+    int fd;
+    bool open;
+    std::shared_ptr<const std::vector<uint8_t>> memory;
+    size_t memoryPosition;
+    uint8_t rx[RX_BUFFER_SIZE];
+    size_t rxStart;
+    size_t rxEnd;
+
+    Connection() : fd(-1), open(false), memoryPosition(0), rxStart(0), rxEnd(0) {}
+    ~Connection() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+};
+
+static bool allowedAddress(uint32_t address) {
+    const char* network = getenv("HOST_NETWORK");
+    if (network != nullptr && strcmp(network, "1") == 0) {
+        return true;
+    }
+    return (ntohl(address) >> 24) == 127;
+}
+
+WiFiClient::WiFiClient() {}
+
+WiFiClient::WiFiClient(int fd) : _connection(std::make_shared<Connection>()) {
+    _connection->fd = fd;
+    _connection->open = fd >= 0;
+}
+
+WiFiClient::~WiFiClient() {}
+
+WiFiClient WiFiClient::fromMemory(std::shared_ptr<const std::vector<uint8_t>> bytes) {
+    WiFiClient client;
+    client._connection = std::make_shared<Connection>();
+    client._connection->memory = bytes;
+    client._connection->open = true;
+    return client;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip, port, DEFAULT_CONNECT_TIMEOUT_MS);
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port, int32_t timeoutMs) {
+    stop();
+    if (!allowedAddress((uint32_t)ip)) {
+        return 0;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return 0;
+    }
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = (uint32_t)ip;
+
+    // Connect without blocking, then wait up to the timeout
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    int result = ::connect(fd, (struct sockaddr*)&address, sizeof(address));
+    if (result != 0 && errno == EINPROGRESS) {
+        struct pollfd waiting = {fd, POLLOUT, 0};
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (poll(&waiting, 1, timeoutMs) == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 &&
+            error == 0) {
+            result = 0;
+        }
+    }
+    if (result != 0) {
+        close(fd);
+        return 0;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+    _connection = std::make_shared<Connection>();
+    _connection->fd = fd;
+    _connection->open = true;
+    return 1;
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    return connect(host, port, DEFAULT_CONNECT_TIMEOUT_MS);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port, int32_t timeoutMs) {
+    IPAddress ip;
+    if (!ip.fromString(host)) {
+        struct addrinfo hints;
+        memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* found = nullptr;
+        if (getaddrinfo(host, nullptr, &hints, &found) != 0 || found == nullptr) {
+            return 0;
+        }
+        ip = IPAddress((uint32_t)((struct sockaddr_in*)found->ai_addr)->sin_addr.s_addr);
+        freeaddrinfo(found);
+    }
+    return connect(ip, port, timeoutMs);
+}
+
+size_t WiFiClient::write(uint8_t value) {
+    return write(&value, 1);
+}
+
+size_t WiFiClient::write(const uint8_t* buffer, size_t size) {
+    if (!_connection || !_connection->open) {
+        return 0;
+    }
+    if (_connection->fd < 0) {
+        return size;
+    }
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t result = send(_connection->fd, buffer + sent, size - sent, MSG_NOSIGNAL);
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            _connection->open = false;
+            break;
+        }
+        sent += (size_t)result;
+    }
+    return sent;
+}
+
+// Reads what has arrived into the buffer without waiting; false if nothing is buffered
+bool WiFiClient::fill() {
+    if (!_connection) {
+        return false;
+    }
+    Connection& connection = *_connection;
+    if (connection.rxStart < connection.rxEnd) {
+        return true;
+    }
+    if (connection.fd < 0 || !connection.open) {
+        return false;
+    }
+    ssize_t result = recv(connection.fd, connection.rx, sizeof(connection.rx), MSG_DONTWAIT);
+    if (result == 0 || (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        connection.open = false;
+    }
+    if (result <= 0) {
+        return false;
+    }
+    connection.rxStart = 0;
+    connection.rxEnd = (size_t)result;
+    return true;
+}
+
+int WiFiClient::available() {
+    if (!_connection) {
+        return 0;
+    }
+    if (_connection->memory) {
+        return (int)(_connection->memory->size() - _connection->memoryPosition);
+    }
+    if (!fill()) {
+        return 0;
+    }
+    int waiting = 0;
+    if (_connection->open && ioctl(_connection->fd, FIONREAD, &waiting) != 0) {
+        waiting = 0;
+    }
+    return (int)(_connection->rxEnd - _connection->rxStart) + waiting;
+}
+
+int WiFiClient::read() {
+    uint8_t value;
+    return read(&value, 1) == 1 ? value : -1;
+}
+
+int WiFiClient::read(uint8_t* buffer, size_t size) {
+    if (!_connection) {
+        return -1;
+    }
+    Connection& connection = *_connection;
+    if (connection.memory) {
+        size_t left = connection.memory->size() - connection.memoryPosition;
+        size_t count = size < left ? size : left;
+        memcpy(buffer, connection.memory->data() + connection.memoryPosition, count);
+        connection.memoryPosition += count;
+        return count > 0 ? (int)count : -1;
+    }
+    size_t count = 0;
+    while (count < size && fill()) {
+        size_t chunk = connection.rxEnd - connection.rxStart;
+        if (chunk > size - count) {
+            chunk = size - count;
+        }
+        memcpy(buffer + count, connection.rx + connection.rxStart, chunk);
+        connection.rxStart += chunk;
+        count += chunk;
+    }
+    return count > 0 ? (int)count : -1;
+}
+
+// Waits up to the Stream timeout for the rest, like the core
+size_t WiFiClient::readBytes(char* buffer, size_t length) {
+    size_t count = 0;
+    unsigned long start = millis();
+    while (count < length) {
+        int result = read((uint8_t*)buffer + count, length - count);
+        if (result > 0) {
+            count += (size_t)result;
+            continue;
+        }
+        if (!connected() || millis() - start >= _timeout) {
+            break;
+        }
+        if (_connection->fd >= 0) {
+            struct pollfd waiting = {_connection->fd, POLLIN, 0};
+            poll(&waiting, 1, 1);
+        }
+    }
+    return count;
+}
+
+int WiFiClient::peek() {
+    if (!_connection) {
+        return -1;
+    }
+    if (_connection->memory) {
+        return _connection->memoryPosition < _connection->memory->size()
+                   ? (*_connection->memory)[_connection->memoryPosition]
+                   : -1;
+    }
+    return fill() ? _connection->rx[_connection->rxStart] : -1;
+}
+
+void WiFiClient::stop() {
+    _connection.reset();
+}
+
+uint8_t WiFiClient::connected() {
+    if (!_connection || !_connection->open) {
+        return 0;
+    }
+    if (_connection->memory) {
+        return _connection->memoryPosition < _connection->memory->size();
+    }
+    uint8_t probe;
+    ssize_t result = recv(_connection->fd, &probe, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (result == 0 || (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        _connection->open = false;
+    }
+    return _connection->open;
+}
+
+int WiFiClient::fd() const {
+    return _connection ? _connection->fd : -1;
+}
+
+int WiFiClient::setNoDelay(bool noDelay) {
+    int flag = noDelay ? 1 : 0;
+    if (fd() < 0) {
+        return -1;
+    }
+    return setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+static bool socketAddress(int fd, bool peer, struct sockaddr_in& address) {
+    socklen_t length = sizeof(address);
+    memset(&address, 0, sizeof(address));
+    if (fd < 0) {
+        return false;
+    }
+    int result = peer ? getpeername(fd, (struct sockaddr*)&address, &length)
+                      : getsockname(fd, (struct sockaddr*)&address, &length);
+    return result == 0;
+}
+
+IPAddress WiFiClient::remoteIP() const {
+    struct sockaddr_in address;
+    return socketAddress(fd(), true, address) ? IPAddress((uint32_t)address.sin_addr.s_addr) : IPAddress();
+}
+
+uint16_t WiFiClient::remotePort() const {
+    struct sockaddr_in address;
+    return socketAddress(fd(), true, address) ? ntohs(address.sin_port) : 0;
+}
+
+IPAddress WiFiClient::localIP() const {
+    struct sockaddr_in address;
+    return socketAddress(fd(), false, address) ? IPAddress((uint32_t)address.sin_addr.s_addr) : IPAddress();
+}
+
+uint16_t WiFiClient::localPort() const {
+    struct sockaddr_in address;
+    return socketAddress(fd(), false, address) ? ntohs(address.sin_port) : 0;
+}
@@ -0,0 +1,57 @@
+#ifndef HOST_WIFI_CLIENT_H
+#define HOST_WIFI_CLIENT_H
+
+#include "Client.h"
+#include <memory>
+#include <vector>
+
+// A TCP client over a host socket. Copies share the connection, as in the
+// core. Only loopback addresses are reachable unless HOST_NETWORK=1 is set,
+// so a test can never reach a real broker or server by accident.
+class WiFiClient : public Client {
+public:
+    WiFiClient();
+    // Takes over a connected socket (the host WebServer's accepted clients)
+    explicit WiFiClient(int fd);
+    ~WiFiClient() override;
+
+    int connect(IPAddress ip, uint16_t port) override;
+    int connect(IPAddress ip, uint16_t port, int32_t timeoutMs);
+    int connect(const char* host, uint16_t port) override;
+    int connect(const char* host, uint16_t port, int32_t timeoutMs);
+    size_t write(uint8_t value) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+    int available() override;
+    int read() override;
+    int read(uint8_t* buffer, size_t size) override;
+    size_t readBytes(char* buffer, size_t length) override;
+    using Stream::readBytes;
+    int peek() override;
+    void flush() override {}
+    void stop() override;
+    uint8_t connected() override;
+    operator bool() override { return connected(); }
+    bool operator==(const WiFiClient& other) const { return _connection == other._connection; }
+    bool operator!=(const WiFiClient& other) const { return _connection != other._connection; }
+
+    int fd() const;
+    int setNoDelay(bool noDelay);
+    IPAddress remoteIP() const;
+    uint16_t remotePort() const;
+    IPAddress localIP() const;
+    uint16_t localPort() const;
+
+    // Host only: a client that reads bytes from memory and discards writes
+    // (what HTTPClient::getStream() returns for a canned response)
+    static WiFiClient fromMemory(std::shared_ptr<const std::vector<uint8_t>> bytes);
+
+    struct Connection;
+
+private:
+    std::shared_ptr<Connection> _connection;
+
+    bool fill();
+};
+
+#endif
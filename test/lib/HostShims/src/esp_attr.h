@@ -0,0 +1,15 @@
+#ifndef HOST_ESP_ATTR_H
+#define HOST_ESP_ATTR_H
+
+// Memory placement has no meaning on a host. RTC memory is ordinary memory,
+// so it survives a simulated restart only within the same process.
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_FAST_ATTR
+#define RTC_SLOW_ATTR
+#define EXT_RAM_ATTR
+#define NOINIT_ATTR
+
+#endif
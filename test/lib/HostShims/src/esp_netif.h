@@ -0,0 +1,11 @@
+#ifndef HOST_ESP_NETIF_H
+#define HOST_ESP_NETIF_H
+
+// The station interface only ("WIFI_STA_DEF"); its lwIP netif carries the
+// lease the host's pretend DHCP server handed out (see lwip/dhcp.h)
+typedef struct esp_netif_obj esp_netif_t;
+
+esp_netif_t* esp_netif_get_handle_from_ifkey(const char* ifKey);
+void* esp_netif_get_netif_impl(esp_netif_t* netif);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HOST_FREERTOS_RINGBUF_H
+#define HOST_FREERTOS_RINGBUF_H
+
+#include "FreeRTOS.h"
+
+// ESP-IDF ring buffer, no-split type only: each item is received whole and
+// must be returned before its space is free again
+struct HostRingbuf;
+typedef HostRingbuf* RingbufHandle_t;
+
+typedef enum {
+    RINGBUF_TYPE_NOSPLIT = 0,
+} RingbufferType_t;
+
+RingbufHandle_t xRingbufferCreate(size_t bufferSize, RingbufferType_t type);
+BaseType_t xRingbufferSend(RingbufHandle_t ringbuf, const void* item, size_t itemSize, TickType_t ticksToWait);
+void* xRingbufferReceive(RingbufHandle_t ringbuf, size_t* itemSize, TickType_t ticksToWait);
+void vRingbufferReturnItem(RingbufHandle_t ringbuf, void* item);
+void vRingbufferDelete(RingbufHandle_t ringbuf);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef HOST_LWIP_DHCP_H
+#define HOST_LWIP_DHCP_H
+
+#include <stdint.h>
+
+// The lease timers of lwIP's DHCP client state, in seconds as offered by
+// the server. The host's lease is one day, renewed after half of it.
+struct dhcp {
+    uint32_t offered_t0_lease;
+    uint32_t offered_t1_renew;
+    uint32_t offered_t2_rebind;
+};
+
+struct netif {
+    struct dhcp* dhcp;
+};
+
+#define netif_dhcp_data(netif) ((netif)->dhcp)
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_LWIP_SOCKETS_H
+#define HOST_LWIP_SOCKETS_H
+
+// lwIP's BSD socket API is the host's
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// The Arduino core's INADDR_NONE is an IPAddress
+#ifdef INADDR_NONE
+#undef INADDR_NONE
+#endif
+
+#endif
@@ -0,0 +1,249 @@
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <ESPOTAUpdater.h>
+#include <FixedString.h>
+#include <HostSim.h>
+#include <ReleaseVersion.h>
+#include <TemplateCache.h>
+#include <TopicRouter.h>
+#include <chrono>
+#include <esp_rom_crc.h>
+#include <unity.h>
+#include <vector>
+
+// Host benchmarks of the paths that run per request or per sample. Times are
+// host CPU times, useful to compare runs before and after a change, not to
+// predict the device. Allocation counts carry over: String, the libraries and
+// ArduinoJson allocate the same way on both.
+//
+//   pio test -e native -f test_benchmarks -v
+
+struct BenchResult {
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+// One untimed call first, so first-use setup is not counted
+template <typename Body>
+static BenchResult bench(const char* name, uint32_t iterations, Body body) {
+    body();
+    uint32_t allocationsBefore = HostSim::allocationCount();
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        body();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    uint32_t allocations = HostSim::allocationCount() - allocationsBefore;
+
+    BenchResult result;
+    result.nsPerOp = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count() / iterations;
+    result.allocsPerOp = (double)allocations / iterations;
+    printf("%-28s %10.1f ns/op %8.2f allocs/op\n", name, result.nsPerOp, result.allocsPerOp);
+    return result;
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+// --- Template rendering ---
+
+static const char INDEX_TEMPLATE[] =
+    "<!DOCTYPE html><html><head><title>{{CLIENT_ID}}</title></head><body>"
+    "<h1>{{CLIENT_ID}}</h1><table>"
+    "<tr><td>IP</td><td>{{IP_ADDRESS}}</td></tr>"
+    "<tr><td>LED</td><td>{{LED_BRIGHTNESS}}</td></tr>"
+    "<tr><td>MQTT</td><td>{{MQTT_SERVER}}</td></tr>"
+    "<tr><td>RSSI</td><td>{{WIFI_RSSI}} dBm</td></tr>"
+    "<tr><td>WiFi</td><td>{{WIFI_STATUS}}</td></tr>"
+    "<tr><td>Temperature</td><td>{{DHT_TEMPERATURE}}</td></tr>"
+    "<tr><td>Humidity</td><td>{{DHT_HUMIDITY}}</td></tr>"
+    "<tr><td>{{UNKNOWN}}</td><td>{{TEMPLATE_VERSION}}</td></tr>"
+    "</table></body></html>";
+
+// Collects the output the way the web server's chunk writer does
+struct RenderSink {
+    char buffer[2048];
+    size_t used;
+};
+
+static void writeToSink(const char* data, size_t length, void* context) {
+    RenderSink* sink = (RenderSink*)context;
+    if (sink->used + length <= sizeof(sink->buffer)) {
+        memcpy(sink->buffer + sink->used, data, length);
+        sink->used += length;
+    }
+}
+
+// Rendering does not allocate; only building the variables does
+void test_render_template() {
+    TemplateVar vars[] = {
+        {"CLIENT_ID", "esp32-kitchen"},    {"IP_ADDRESS", "192.168.1.42"},  {"LED_BRIGHTNESS", "128"},
+        {"MQTT_SERVER", "192.168.1.10"},   {"WIFI_RSSI", "-61"},            {"WIFI_STATUS", "Connected"},
+        {"DHT_TEMPERATURE", "21.4 °C"},    {"DHT_HUMIDITY", "48.0 %"},      {"TEMPLATE_VERSION", "3f2a9c1"},
+    };
+    const size_t count = sizeof(vars) / sizeof(vars[0]);
+    RenderSink sink;
+    BenchResult result = bench("template render", 20000, [&]() {
+        sink.used = 0;
+        size_t length = TemplateCache::render(INDEX_TEMPLATE, sizeof(INDEX_TEMPLATE) - 1, vars, count, nullptr, nullptr);
+        TemplateCache::render(INDEX_TEMPLATE, sizeof(INDEX_TEMPLATE) - 1, vars, count, writeToSink, &sink);
+        TEST_ASSERT_EQUAL(length, sink.used);
+    });
+    TEST_ASSERT_EQUAL_FLOAT(0.0, result.allocsPerOp);
+
+    // As handleRoot() does it: the values are built for every request
+    bench("template render + vars", 20000, [&]() {
+        int rssi = -61;
+        uint8_t brightness = 128;
+        String commit = String("3f2a9c1d0e").substring(0, 7);
+        TemplateVar requestVars[] = {
+            {"CLIENT_ID", "esp32-kitchen"},          {"IP_ADDRESS", IPAddress(192, 168, 1, 42).toString()},
+            {"LED_BRIGHTNESS", String(brightness)}, {"MQTT_SERVER", "192.168.1.10"},
+            {"WIFI_RSSI", String(rssi)},            {"WIFI_STATUS", "Connected"},
+            {"DHT_TEMPERATURE", String(21.4f, 1) + " °C"}, {"DHT_HUMIDITY", String(48.0f, 1) + " %"},
+            {"TEMPLATE_VERSION", commit},
+        };
+        sink.used = 0;
+        TemplateCache::render(INDEX_TEMPLATE, sizeof(INDEX_TEMPLATE) - 1, requestVars, count, writeToSink, &sink);
+    });
+}
+
+// --- JSON building ---
+
+// One entry of /api/v1/files, built as streamFileEntry() builds it
+void test_json_file_entry() {
+    const char* path = "/templates/settings/network.html";
+    size_t size = 18432;
+    uint32_t modified = 1760000000;
+    uint32_t crc = 0x3c9a51fe;
+    char json[320];
+    size_t length = 0;
+    bench("json file entry", 20000, [&]() {
+        StaticJsonDocument<256> doc;
+        doc["path"] = path;
+        doc["size"] = size;
+        doc["modified"] = modified;
+        char hex[9];
+        snprintf(hex, sizeof(hex), "%08lx", (unsigned long)crc);
+        doc["crc32"] = hex;
+        length = serializeJson(doc, json, sizeof(json));
+    });
+    TEST_ASSERT_EQUAL_STRING(
+        "{\"path\":\"/templates/settings/network.html\",\"size\":18432,\"modified\":1760000000,\"crc32\":\"3c9a51fe\"}",
+        json);
+    TEST_ASSERT_EQUAL(strlen(json), length);
+
+    // The page header, serialized into the chunk String
+    String root("/templates");
+    String buffer;
+    buffer.reserve(1024 + 320);
+    bench("json list header", 20000, [&]() {
+        buffer = "";
+        StaticJsonDocument<128> header;
+        header["path"] = root;
+        header["cursor"] = 40;
+        serializeJson(header, buffer);
+    });
+    TEST_ASSERT_EQUAL_STRING("{\"path\":\"/templates\",\"cursor\":40}", buffer.c_str());
+}
+
+// --- Version parsing ---
+
+void test_parse_version() {
+    int version = 0;
+    BenchResult result = bench("version parse", 200000, [&]() { version = ReleaseVersion::parse("v9.14"); });
+    TEST_ASSERT_EQUAL(914, version);
+    TEST_ASSERT_EQUAL_FLOAT(0.0, result.allocsPerOp);
+
+    result = bench("version parse (legacy)", 200000, [&]() { version = ReleaseVersion::parse("v9"); });
+    TEST_ASSERT_EQUAL(900, version);
+    TEST_ASSERT_EQUAL_FLOAT(0.0, result.allocsPerOp);
+}
+
+// --- Topic formatting ---
+
+static uint32_t routed = 0;
+
+static void countRoute(const char* topic, const uint8_t* payload, unsigned int length, void* context) {
+    (void)topic;
+    (void)payload;
+    (void)length;
+    (void)context;
+    routed++;
+}
+
+void test_format_topic() {
+    const char* clientId = "esp32-kitchen";
+    FixedString<64> topic;
+    BenchResult result = bench("topic format", 200000, [&]() {
+        topic.format("home/esp/%s/%s", clientId, "temperature");
+    });
+    TEST_ASSERT_EQUAL_STRING("home/esp/esp32-kitchen/temperature", topic.c_str());
+    TEST_ASSERT_EQUAL_FLOAT(0.0, result.allocsPerOp);
+
+    // What the String concatenation it replaced costs
+    String joined;
+    bench("topic format (String)", 200000, [&]() {
+        joined = String("home/esp/") + clientId + "/" + "temperature";
+    });
+    TEST_ASSERT_EQUAL_STRING(topic.c_str(), joined.c_str());
+
+    TopicRouter router;
+    TEST_ASSERT_TRUE(router.add("home/esp/esp32-kitchen/led/set", countRoute));
+    TEST_ASSERT_TRUE(router.add("home/esp/esp32-kitchen/reboot", countRoute));
+    TEST_ASSERT_TRUE(router.add("home/esp/+/policy/#", countRoute));
+    TEST_ASSERT_TRUE(router.add("home/esp/broadcast/#", countRoute));
+    const uint8_t payload[] = "200";
+    routed = 0;
+    result = bench("topic route", 200000, [&]() {
+        router.dispatch("home/esp/esp32-kitchen/policy/temperature", payload, sizeof(payload) - 1);
+    });
+    TEST_ASSERT_EQUAL(200001, routed);
+    TEST_ASSERT_EQUAL_FLOAT(0.0, result.allocsPerOp);
+}
+
+// --- OTA write loop ---
+
+static const char* FIRMWARE_URL = "https://example.com/firmware.bin";
+static const size_t FIRMWARE_SIZE = 1024 * 1024;
+
+static void countRestart() {}
+
+// Download and flash loop of ESPOTAUpdater for a 1 MB image served from
+// memory; the second before the reboot passes in virtual time
+void test_ota_write_loop() {
+    std::vector<uint8_t> image(FIRMWARE_SIZE);
+    for (size_t i = 0; i < image.size(); i++) {
+        image[i] = (uint8_t)(i * 31 + 7);
+    }
+    image[0] = 0xE9; // Image magic, checked by Update
+    HostSim::setHttpResponse(FIRMWARE_URL, 200, image.data(), image.size());
+    HostSim::setVirtualTime(true);
+    HostSim::setRestartHandler(countRestart);
+
+    ESPOTAUpdater updater("owner/repo", 100);
+    uint32_t restartsBefore = HostSim::restartCount();
+    uint32_t acceptedBefore = Update.imagesAccepted();
+    const uint32_t iterations = 20;
+    BenchResult result = bench("ota install 1 MB", iterations, [&]() { updater.performUpdate(FIRMWARE_URL); });
+    printf("%-28s %10.1f MB/s\n", "ota install throughput", FIRMWARE_SIZE / result.nsPerOp * 1e9 / (1024 * 1024));
+
+    TEST_ASSERT_EQUAL(iterations + 1, Update.imagesAccepted() - acceptedBefore);
+    TEST_ASSERT_EQUAL(iterations + 1, HostSim::restartCount() - restartsBefore);
+    TEST_ASSERT_EQUAL_HEX32(esp_rom_crc32_le(0, image.data(), image.size()), Update.imageCrc());
+
+    HostSim::setRestartHandler(nullptr);
+    HostSim::setVirtualTime(false);
+    HostSim::clearHttpResponses();
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_render_template);
+    RUN_TEST(test_json_file_entry);
+    RUN_TEST(test_parse_version);
+    RUN_TEST(test_format_topic);
+    RUN_TEST(test_ota_write_loop);
+    return UNITY_END();
+}
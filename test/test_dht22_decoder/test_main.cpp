@@ -0,0 +1,137 @@
+#include <DHT22Decoder.h>
+#include <unity.h>
+#include <vector>
+
+// DHT22Decoder against pulse trains as the RMT receiver hands them over:
+// alternating levels in microseconds, ending with a zero-duration item.
+
+// 65.2 %RH, 23.5 °C (02 8C 00 EB, checksum 79), captured from a sensor on
+// GPIO 4. The first high is the pull-up taking the released bus, then the
+// sensor's 80/80 us response, then the 40 bits.
+static const DHT22Pulse RECORDED_FRAME[] = {
+    {1, 30}, {0, 79}, {1, 84}, {0, 48}, {1, 23}, {0, 56}, {1, 23}, {0, 53},
+    {1, 27}, {0, 48}, {1, 27}, {0, 51}, {1, 23}, {0, 49}, {1, 26}, {0, 54},
+    {1, 68}, {0, 51}, {1, 23}, {0, 56}, {1, 71}, {0, 48}, {1, 29}, {0, 49},
+    {1, 24}, {0, 48}, {1, 27}, {0, 54}, {1, 68}, {0, 51}, {1, 68}, {0, 56},
+    {1, 29}, {0, 50}, {1, 25}, {0, 54}, {1, 24}, {0, 56}, {1, 23}, {0, 52},
+    {1, 27}, {0, 50}, {1, 23}, {0, 51}, {1, 25}, {0, 49}, {1, 27}, {0, 49},
+    {1, 27}, {0, 48}, {1, 27}, {0, 51}, {1, 71}, {0, 56}, {1, 71}, {0, 53},
+    {1, 71}, {0, 55}, {1, 25}, {0, 52}, {1, 69}, {0, 50}, {1, 28}, {0, 51},
+    {1, 68}, {0, 52}, {1, 72}, {0, 55}, {1, 25}, {0, 55}, {1, 70}, {0, 49},
+    {1, 68}, {0, 56}, {1, 71}, {0, 50}, {1, 74}, {0, 53}, {1, 24}, {0, 55},
+    {1, 26}, {0, 48}, {1, 73}, {0, 49}, {1, 0},
+};
+static const size_t RECORDED_COUNT = sizeof(RECORDED_FRAME) / sizeof(RECORDED_FRAME[0]);
+
+// Index of the high pulse carrying data bit 0 in RECORDED_FRAME
+static const size_t FIRST_BIT = 4;
+
+void setUp() {}
+void tearDown() {}
+
+static std::vector<DHT22Pulse> recorded() {
+    return std::vector<DHT22Pulse>(RECORDED_FRAME, RECORDED_FRAME + RECORDED_COUNT);
+}
+
+// A frame with nominal timings for the given bytes (checksum included)
+static std::vector<DHT22Pulse> synthesize(const uint8_t bytes[5]) {
+    std::vector<DHT22Pulse> pulses = {{1, 30}, {0, 80}, {1, 80}};
+    for (size_t i = 0; i < 40; i++) {
+        bool one = (bytes[i / 8] >> (7 - i % 8)) & 1;
+        pulses.push_back({0, 50});
+        pulses.push_back({1, (uint16_t)(one ? 70 : 26)});
+    }
+    pulses.push_back({0, 50});
+    pulses.push_back({1, 0});
+    return pulses;
+}
+
+static DHT22Status decode(const std::vector<DHT22Pulse>& pulses, DHT22Result& result) {
+    return DHT22Decoder::decode(pulses.data(), pulses.size(), result);
+}
+
+void test_recorded_frame_decodes() {
+    DHT22Result result;
+    TEST_ASSERT_EQUAL(DHT22_OK, DHT22Decoder::decode(RECORDED_FRAME, RECORDED_COUNT, result));
+    TEST_ASSERT_EQUAL(DHT22_OK, result.status);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 65.2f, result.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 23.5f, result.temperature);
+    const uint8_t expected[5] = {0x02, 0x8C, 0x00, 0xEB, 0x79};
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, result.raw, 5);
+}
+
+void test_leading_glitches_and_empty_items_are_skipped() {
+    std::vector<DHT22Pulse> pulses = recorded();
+    // Ringing while the bus is released, before the sensor answers
+    const DHT22Pulse glitches[] = {{1, 3}, {0, 2}, {1, 0}, {0, 1}, {1, 4}, {0, 0}};
+    pulses.insert(pulses.begin(), glitches, glitches + sizeof(glitches) / sizeof(glitches[0]));
+    // Zero-duration highs between data bits, as a split RMT item produces
+    pulses.insert(pulses.begin() + 6 + FIRST_BIT + 10, {1, 0});
+    pulses.insert(pulses.begin() + 6 + FIRST_BIT + 41, {1, 0});
+
+    DHT22Result result;
+    TEST_ASSERT_EQUAL(DHT22_OK, decode(pulses, result));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 65.2f, result.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 23.5f, result.temperature);
+}
+
+void test_short_frame_fails_bit_count() {
+    // Capture cut off after 39 data bits
+    std::vector<DHT22Pulse> pulses(RECORDED_FRAME, RECORDED_FRAME + FIRST_BIT + 2 * 39 - 1);
+    pulses.push_back({0, 0});
+    // Without the pull-up and response highs, which would otherwise pad it to 40
+    pulses.erase(pulses.begin(), pulses.begin() + FIRST_BIT - 1);
+
+    DHT22Result result;
+    TEST_ASSERT_EQUAL(DHT22_ERROR_BIT_COUNT, decode(pulses, result));
+    TEST_ASSERT_EQUAL(DHT22_ERROR_BIT_COUNT, result.status);
+    TEST_ASSERT_TRUE(isnan(result.temperature));
+    TEST_ASSERT_TRUE(isnan(result.humidity));
+
+    TEST_ASSERT_EQUAL(DHT22_ERROR_BIT_COUNT, DHT22Decoder::decode(RECORDED_FRAME, 0, result));
+}
+
+void test_bad_checksum_is_rejected() {
+    std::vector<DHT22Pulse> pulses = recorded();
+    // Flip the lowest humidity bit (bit 15): 0x8C becomes 0x8D
+    pulses[FIRST_BIT + 2 * 15].durationUs = 70;
+
+    DHT22Result result;
+    TEST_ASSERT_EQUAL(DHT22_ERROR_CHECKSUM, decode(pulses, result));
+    TEST_ASSERT_TRUE(isnan(result.temperature));
+    TEST_ASSERT_TRUE(isnan(result.humidity));
+    // The raw bytes are kept for diagnosis
+    TEST_ASSERT_EQUAL_HEX8(0x8D, result.raw[1]);
+    TEST_ASSERT_EQUAL_HEX8(0x79, result.raw[4]);
+}
+
+void test_negative_temperature() {
+    // 35.0 %RH, -10.1 °C: the sign is the top bit, not two's complement
+    const uint8_t bytes[5] = {0x01, 0x5E, 0x80, 0x65, 0x44};
+    DHT22Result result;
+    TEST_ASSERT_EQUAL(DHT22_OK, decode(synthesize(bytes), result));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 35.0f, result.humidity);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -10.1f, result.temperature);
+
+    // -0.1 °C, just below freezing
+    const uint8_t nearZero[5] = {0x01, 0x5E, 0x80, 0x01, 0xE0};
+    TEST_ASSERT_EQUAL(DHT22_OK, decode(synthesize(nearZero), result));
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, -0.1f, result.temperature);
+}
+
+void test_status_names() {
+    TEST_ASSERT_EQUAL_STRING("ok", DHT22Decoder::statusName(DHT22_OK));
+    TEST_ASSERT_EQUAL_STRING("checksum", DHT22Decoder::statusName(DHT22_ERROR_CHECKSUM));
+    TEST_ASSERT_EQUAL_STRING("bit count", DHT22Decoder::statusName(DHT22_ERROR_BIT_COUNT));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_recorded_frame_decodes);
+    RUN_TEST(test_leading_glitches_and_empty_items_are_skipped);
+    RUN_TEST(test_short_frame_fails_bit_count);
+    RUN_TEST(test_bad_checksum_is_rejected);
+    RUN_TEST(test_negative_temperature);
+    RUN_TEST(test_status_names);
+    return UNITY_END();
+}
@@ -0,0 +1,218 @@
+#include <DutyCycle.h>
+#include <unity.h>
+
+// DutyCycleController across simulated deep sleeps. Each wake builds a new
+// controller over the same state, as the firmware does with the copy in RTC
+// memory.
+//
+//   pio test -e native -f test_duty_cycle
+
+static const DutyCycleConfig CONFIG = {60000, 5}; // A wake per minute, a session every 5th
+static const uint32_t AWAKE_MS = 200;
+static const uint8_t CHANNELS = 2;
+
+enum Network {
+    NETWORK_UP,
+    NETWORK_DOWN,     // Connecting fails
+    NETWORK_PARTIAL   // Connects, delivers one record, then fails
+};
+
+static DutyCycleState rtc;
+
+struct WakeResult {
+    bool session;  // The wake brought up the network
+    size_t sent;   // Records delivered
+    uint32_t sleepMs;
+};
+
+// One wake from begin() to sleep, taking value on both channels
+static WakeResult wake(bool fromSleep, float value, Network network) {
+    DutyCycleController controller(rtc, CONFIG);
+    controller.begin(fromSleep, CHANNELS);
+    TEST_ASSERT_EQUAL(DUTY_CYCLE_SAMPLE, controller.phase());
+    const float values[CHANNELS] = {value, value + 0.5f};
+    controller.addSample(values);
+
+    WakeResult result = {controller.phase() == DUTY_CYCLE_CONNECT, 0, 0};
+    if (result.session) {
+        if (network == NETWORK_DOWN) {
+            controller.connectFailed();
+        } else {
+            controller.connected();
+            TEST_ASSERT_EQUAL(DUTY_CYCLE_PUBLISH, controller.phase());
+            if (network == NETWORK_PARTIAL) {
+                controller.published(1);
+                result.sent = 1;
+                controller.publishFailed();
+            } else {
+                result.sent = controller.pending();
+                controller.published(result.sent);
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(DUTY_CYCLE_SLEEP, controller.phase());
+    result.sleepMs = controller.sleepMs(AWAKE_MS);
+    return result;
+}
+
+void setUp() {
+    // Whatever was in RTC memory before power-on
+    memset(&rtc, 0xA5, sizeof(rtc));
+}
+
+void tearDown() {}
+
+void test_publishes_every_nth_wake() {
+    // The first wake after power-on publishes right away
+    WakeResult first = wake(false, 20.0f, NETWORK_UP);
+    TEST_ASSERT_TRUE(first.session);
+    TEST_ASSERT_EQUAL(1, first.sent);
+    TEST_ASSERT_EQUAL_UINT32(CONFIG.periodMs - AWAKE_MS, first.sleepMs);
+
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 4; i++) {
+            WakeResult result = wake(true, 21.0f + i, NETWORK_UP);
+            TEST_ASSERT_FALSE(result.session);
+            TEST_ASSERT_EQUAL_UINT16(i + 1, rtc.count);
+        }
+        WakeResult fifth = wake(true, 25.0f, NETWORK_UP);
+        TEST_ASSERT_TRUE(fifth.session);
+        TEST_ASSERT_EQUAL(5, fifth.sent);
+        TEST_ASSERT_EQUAL_UINT16(0, rtc.count);
+    }
+    TEST_ASSERT_EQUAL_UINT32(16, rtc.wakes);
+    TEST_ASSERT_EQUAL_UINT32(4, rtc.sessions);
+    TEST_ASSERT_EQUAL_UINT32(0, rtc.failedSessions);
+    TEST_ASSERT_EQUAL_UINT64(16ULL * CONFIG.periodMs, rtc.clockMs);
+
+    DutyCycleController controller(rtc, CONFIG);
+    TEST_ASSERT_FLOAT_WITHIN(0.0001f, (float)AWAKE_MS / CONFIG.periodMs, controller.dutyCycle());
+}
+
+void test_record_ages_follow_the_clock() {
+    wake(false, 20.0f, NETWORK_UP);
+    for (int i = 0; i < 3; i++) {
+        wake(true, 21.0f + i, NETWORK_UP);
+    }
+
+    DutyCycleController controller(rtc, CONFIG);
+    controller.begin(true, CHANNELS);
+    TEST_ASSERT_EQUAL(3, controller.pending());
+    // Taken one, two and three periods before this wake began
+    TEST_ASSERT_EQUAL_UINT64(3 * CONFIG.periodMs + 50, controller.recordAgeMs(0, 50));
+    TEST_ASSERT_EQUAL_UINT64(CONFIG.periodMs + 50, controller.recordAgeMs(2, 50));
+    TEST_ASSERT_EQUAL_FLOAT(21.0f, controller.record(0).values[0]);
+    TEST_ASSERT_EQUAL_FLOAT(21.5f, controller.record(0).values[1]);
+    TEST_ASSERT_TRUE(isnan(controller.record(0).values[CHANNELS]));
+}
+
+void test_full_buffer_drops_oldest_records() {
+    wake(false, 0.0f, NETWORK_UP);
+    // Every session fails, so the buffer fills up and then overflows
+    const int wakes = DUTY_CYCLE_CAPACITY + 7;
+    for (int i = 1; i <= wakes; i++) {
+        wake(true, (float)i, NETWORK_DOWN);
+    }
+    TEST_ASSERT_EQUAL_UINT16(DUTY_CYCLE_CAPACITY, rtc.count);
+    TEST_ASSERT_EQUAL_UINT32(7, rtc.dropped);
+    TEST_ASSERT_EQUAL_UINT32(wakes / CONFIG.publishEvery, rtc.failedSessions);
+
+    DutyCycleController controller(rtc, CONFIG);
+    controller.begin(true, CHANNELS);
+    TEST_ASSERT_EQUAL_FLOAT(8.0f, controller.record(0).values[0]);
+    TEST_ASSERT_EQUAL_FLOAT((float)wakes, controller.record(DUTY_CYCLE_CAPACITY - 1).values[0]);
+
+    // The next sessions deliver the whole batch, oldest first
+    while (rtc.wakesSinceSession != CONFIG.publishEvery - 1) {
+        wake(true, 100.0f, NETWORK_DOWN);
+    }
+    WakeResult recovered = wake(true, 200.0f, NETWORK_UP);
+    TEST_ASSERT_TRUE(recovered.session);
+    TEST_ASSERT_EQUAL(DUTY_CYCLE_CAPACITY, recovered.sent);
+    TEST_ASSERT_EQUAL_UINT16(0, rtc.count);
+}
+
+void test_failed_publish_keeps_the_rest_of_the_batch() {
+    wake(false, 0.0f, NETWORK_UP);
+    for (int i = 1; i <= 4; i++) {
+        wake(true, (float)i, NETWORK_UP);
+    }
+    WakeResult partial = wake(true, 5.0f, NETWORK_PARTIAL);
+    TEST_ASSERT_TRUE(partial.session);
+    TEST_ASSERT_EQUAL(1, partial.sent);
+    TEST_ASSERT_EQUAL_UINT16(4, rtc.count);
+    TEST_ASSERT_EQUAL_UINT32(1, rtc.failedSessions);
+    TEST_ASSERT_EQUAL_UINT32(1, rtc.sessions); // Only the one after power-on
+
+    // No retry on the next wake; the batch goes with the next session
+    for (int i = 6; i <= 9; i++) {
+        TEST_ASSERT_FALSE(wake(true, (float)i, NETWORK_UP).session);
+    }
+    DutyCycleController controller(rtc, CONFIG);
+    controller.begin(true, CHANNELS);
+    TEST_ASSERT_EQUAL_FLOAT(2.0f, controller.record(0).values[0]);
+
+    WakeResult next = wake(true, 10.0f, NETWORK_UP);
+    TEST_ASSERT_EQUAL(9, next.sent);
+    TEST_ASSERT_EQUAL_UINT32(2, rtc.sessions);
+}
+
+void test_cold_boot_discards_rtc_contents() {
+    // Power-on with RTC memory holding garbage that happens to look valid
+    rtc.magic = DutyCycleController::STATE_MAGIC;
+    rtc.channelCount = CHANNELS;
+    WakeResult powerOn = wake(false, 20.0f, NETWORK_UP);
+    TEST_ASSERT_TRUE(powerOn.session);
+    TEST_ASSERT_EQUAL(1, powerOn.sent);
+    TEST_ASSERT_EQUAL_UINT32(1, rtc.wakes);
+    TEST_ASSERT_EQUAL_UINT32(0, rtc.dropped);
+}
+
+void test_timer_wake_with_invalid_state_starts_fresh() {
+    // Timer wake, but the state is not ours (e.g. a firmware update changed the layout)
+    WakeResult badMagic = wake(true, 20.0f, NETWORK_UP);
+    TEST_ASSERT_TRUE(badMagic.session);
+    TEST_ASSERT_EQUAL(1, badMagic.sent);
+    TEST_ASSERT_EQUAL_UINT32(1, rtc.wakes);
+
+    // Magic intact, ring indices out of range
+    wake(true, 21.0f, NETWORK_UP);
+    rtc.first = DUTY_CYCLE_CAPACITY;
+    TEST_ASSERT_TRUE(wake(true, 22.0f, NETWORK_UP).session);
+    TEST_ASSERT_EQUAL_UINT32(1, rtc.wakes);
+
+    wake(true, 21.0f, NETWORK_UP);
+    rtc.count = DUTY_CYCLE_CAPACITY + 1;
+    TEST_ASSERT_TRUE(wake(true, 22.0f, NETWORK_UP).session);
+    TEST_ASSERT_EQUAL_UINT16(0, rtc.count);
+
+    // A different channel count means a different sensor setup
+    wake(true, 21.0f, NETWORK_UP);
+    DutyCycleController controller(rtc, CONFIG);
+    controller.begin(true, CHANNELS + 1);
+    TEST_ASSERT_EQUAL_UINT32(1, rtc.wakes);
+    TEST_ASSERT_EQUAL_UINT8(CHANNELS + 1, rtc.channelCount);
+}
+
+void test_long_wake_sleeps_the_minimum() {
+    DutyCycleController controller(rtc, CONFIG);
+    controller.begin(false, CHANNELS);
+    const float values[CHANNELS] = {1.0f, 2.0f};
+    controller.addSample(values);
+    controller.connectFailed();
+    TEST_ASSERT_EQUAL_UINT32(DUTY_CYCLE_MIN_SLEEP_MS, controller.sleepMs(CONFIG.periodMs));
+    TEST_ASSERT_EQUAL_UINT64(CONFIG.periodMs + DUTY_CYCLE_MIN_SLEEP_MS, rtc.clockMs);
+    TEST_ASSERT_EQUAL_STRING("sleep", DutyCycleController::phaseName(controller.phase()));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_publishes_every_nth_wake);
+    RUN_TEST(test_record_ages_follow_the_clock);
+    RUN_TEST(test_full_buffer_drops_oldest_records);
+    RUN_TEST(test_failed_publish_keeps_the_rest_of_the_batch);
+    RUN_TEST(test_cold_boot_discards_rtc_contents);
+    RUN_TEST(test_timer_wake_with_invalid_state_starts_fresh);
+    RUN_TEST(test_long_wake_sleeps_the_minimum);
+    return UNITY_END();
+}
@@ -0,0 +1,261 @@
+#include <Arduino.h>
+#include <FakeBroker.h>
+#include <MQTTClientTap.h>
+#include <MQTTOutbox.h>
+#include <WiFiClient.h>
+#include <chrono>
+#include <unity.h>
+
+// MQTTOutbox and the MQTTClientTap PUBACK parser against a broker that
+// loses acknowledgements, over a real loopback socket.
+//
+//   pio test -e native -f test_mqtt_outbox -v
+
+static const unsigned long RETRY_TIMEOUT_MS = 10;
+static const uint32_t THROUGHPUT_MESSAGES = 20000;
+
+static FakeBroker broker;
+
+// One client connection: outbox -> tap -> socket, and PUBACKs seen by the
+// tap back into the outbox
+struct Connection {
+    WiFiClient socket;
+    MQTTClientTap tap;
+    MQTTOutbox outbox;
+
+    Connection() : tap(socket) {
+        outbox.setRetryTimeout(RETRY_TIMEOUT_MS);
+        outbox.setWriter(write, this);
+        tap.setPubAckCallback(pubAck, this);
+    }
+
+    bool open() {
+        if (!tap.connect("127.0.0.1", broker.port())) {
+            return false;
+        }
+        socket.setNoDelay(true);
+        // CONNECT, MQTT 3.1.1, clean session, client ID "outbox"
+        const uint8_t connect[] = {0x10, 18, 0, 4, 'M', 'Q', 'T', 'T', 4, 0x02, 0, 60, 0, 6, 'o', 'u', 't', 'b', 'o', 'x'};
+        return tap.write(connect, sizeof(connect)) == sizeof(connect);
+    }
+
+    // Reads what the broker sent, then lets the outbox retransmit
+    void pump() {
+        uint8_t buffer[256];
+        while (tap.available() > 0) {
+            tap.read(buffer, sizeof(buffer));
+        }
+        outbox.poll(tap.connected(), millis());
+    }
+
+    bool pumpUntilIdle(uint32_t timeoutMs) {
+        uint32_t start = millis();
+        while (outbox.inFlight() > 0) {
+            if (millis() - start > timeoutMs) {
+                return false;
+            }
+            pump();
+        }
+        return true;
+    }
+
+    static bool write(const uint8_t* data, size_t length, void* context) {
+        return static_cast<Connection*>(context)->tap.write(data, length) == length;
+    }
+
+    static void pubAck(uint16_t packetId, void* context) {
+        static_cast<Connection*>(context)->outbox.onPubAck(packetId, millis());
+    }
+};
+
+static const uint8_t PAYLOAD[] = "21.5";
+
+static uint16_t publish(Connection& connection) {
+    return connection.outbox.publish("home/esp/test/temperature_f", PAYLOAD, sizeof(PAYLOAD) - 1, false, true,
+                                     millis());
+}
+
+void setUp() {
+    broker.clear();
+    broker.setPubAckLoss(0, 1);
+    broker.holdPubAcks(false);
+}
+
+void tearDown() {}
+
+void test_window_limits_messages_in_flight() {
+    Connection connection;
+    TEST_ASSERT_TRUE(connection.open());
+    broker.holdPubAcks(true);
+
+    for (size_t i = 0; i < connection.outbox.window(); i++) {
+        TEST_ASSERT_NOT_EQUAL(0, publish(connection));
+    }
+    TEST_ASSERT_EQUAL(0, publish(connection));
+    TEST_ASSERT_EQUAL_UINT32(1, connection.outbox.stats().rejected);
+    TEST_ASSERT_TRUE(broker.waitForPublishes(connection.outbox.window(), 1000));
+    TEST_ASSERT_EQUAL(connection.outbox.window(), broker.unacknowledged());
+
+    broker.holdPubAcks(false);
+    TEST_ASSERT_TRUE(connection.pumpUntilIdle(1000));
+    TEST_ASSERT_EQUAL_UINT32(connection.outbox.window(), connection.outbox.stats().delivered);
+    TEST_ASSERT_NOT_EQUAL(0, publish(connection));
+    TEST_ASSERT_TRUE(connection.pumpUntilIdle(1000));
+}
+
+void test_invalid_messages_are_counted_apart() {
+    Connection connection;
+    uint8_t large[MQTT_OUTBOX_MAX_PAYLOAD + 1] = {0};
+    TEST_ASSERT_EQUAL(0, connection.outbox.publish(nullptr, PAYLOAD, 4, false, false, millis()));
+    TEST_ASSERT_EQUAL(0, connection.outbox.publish("t", large, sizeof(large), false, false, millis()));
+    TEST_ASSERT_EQUAL_UINT32(2, connection.outbox.stats().invalid);
+    TEST_ASSERT_EQUAL_UINT32(0, connection.outbox.stats().rejected);
+}
+
+void test_lost_puback_is_retransmitted_with_dup() {
+    Connection connection;
+    TEST_ASSERT_TRUE(connection.open());
+    broker.setPubAckLoss(1.0, 1);
+
+    uint16_t packetId = publish(connection);
+    TEST_ASSERT_TRUE(broker.waitForPublishes(1, 1000));
+    for (int i = 0; i < 1000 && broker.publishCount() < 3; i++) {
+        connection.pump();
+        delay(1);
+    }
+    broker.setPubAckLoss(0, 1);
+    TEST_ASSERT_TRUE(connection.pumpUntilIdle(1000));
+
+    std::vector<FakeBroker::Publish> received = broker.publishes();
+    TEST_ASSERT_TRUE(received.size() >= 3);
+    TEST_ASSERT_FALSE(received[0].dup);
+    for (size_t i = 0; i < received.size(); i++) {
+        TEST_ASSERT_EQUAL_UINT16(packetId, received[i].packetId);
+        TEST_ASSERT_EQUAL_STRING("21.5", received[i].payload.c_str());
+        if (i > 0) {
+            TEST_ASSERT_TRUE(received[i].dup);
+        }
+    }
+    TEST_ASSERT_EQUAL_UINT32(received.size() - 1, connection.outbox.stats().retransmitted);
+    TEST_ASSERT_EQUAL_UINT32(1, connection.outbox.stats().delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, broker.unacknowledged());
+}
+
+void test_reconnect_resends_in_flight_with_dup() {
+    Connection connection;
+    TEST_ASSERT_TRUE(connection.open());
+    broker.holdPubAcks(true);
+    uint16_t first = publish(connection);
+    uint16_t second = publish(connection);
+    TEST_ASSERT_TRUE(broker.waitForPublishes(2, 1000));
+
+    // The broker drops the session; the held acks are lost with it
+    broker.dropClient();
+    for (int i = 0; i < 1000 && connection.tap.connected(); i++) {
+        delay(1);
+    }
+    connection.tap.stop();
+    broker.holdPubAcks(false);
+    TEST_ASSERT_TRUE(connection.open());
+    connection.outbox.onReconnect();
+    TEST_ASSERT_TRUE(connection.pumpUntilIdle(1000));
+
+    std::vector<FakeBroker::Publish> received = broker.publishes();
+    TEST_ASSERT_EQUAL(4, received.size());
+    TEST_ASSERT_EQUAL_UINT16(first, received[2].packetId);
+    TEST_ASSERT_TRUE(received[2].dup);
+    TEST_ASSERT_EQUAL_UINT16(second, received[3].packetId);
+    TEST_ASSERT_TRUE(received[3].dup);
+    TEST_ASSERT_EQUAL_UINT32(2, connection.outbox.stats().delivered);
+}
+
+// Packet IDs wrap at 65535, skip 0 and skip an ID whose message is still
+// awaiting its PUBACK
+void test_packet_ids_are_reused_only_when_free() {
+    MQTTOutbox outbox;
+    uint16_t lastWritten = 0;
+    outbox.setWriter(
+        [](const uint8_t* data, size_t length, void* context) {
+            // Packet ID follows the 1-byte header, 1-byte length, 2-byte topic length and 1-byte topic
+            (void)length;
+            *static_cast<uint16_t*>(context) = ((uint16_t)data[5] << 8) | data[6];
+            return true;
+        },
+        &lastWritten);
+
+    uint16_t stuck = outbox.publish("t", PAYLOAD, 4, false, true, 0);
+    TEST_ASSERT_EQUAL_UINT16(1, stuck);
+    TEST_ASSERT_EQUAL_UINT16(stuck, lastWritten);
+
+    uint16_t previous = stuck;
+    bool wrapped = false;
+    for (uint32_t i = 0; i < 70000; i++) {
+        uint16_t packetId = outbox.publish("t", PAYLOAD, 4, false, true, 0);
+        TEST_ASSERT_NOT_EQUAL(0, packetId);
+        TEST_ASSERT_NOT_EQUAL(stuck, packetId);
+        TEST_ASSERT_EQUAL_UINT16(packetId, lastWritten);
+        if (packetId < previous) {
+            TEST_ASSERT_EQUAL_UINT16(65535, previous);
+            TEST_ASSERT_EQUAL_UINT16(2, packetId);
+            wrapped = true;
+        }
+        previous = packetId;
+        TEST_ASSERT_TRUE(outbox.onPubAck(packetId, 0));
+    }
+    TEST_ASSERT_TRUE(wrapped);
+    TEST_ASSERT_FALSE(outbox.onPubAck(previous, 0)); // Duplicate PUBACK
+    TEST_ASSERT_EQUAL(1, outbox.inFlight());
+    TEST_ASSERT_TRUE(outbox.onPubAck(stuck, 0));
+    TEST_ASSERT_EQUAL(0, outbox.inFlight());
+}
+
+void test_throughput_with_lossy_broker() {
+    Connection connection;
+    connection.outbox.setMaxAttempts(20);
+    TEST_ASSERT_TRUE(connection.open());
+    broker.setPubAckLoss(0.02, 12345);
+
+    auto start = std::chrono::steady_clock::now();
+    uint32_t sent = 0;
+    uint32_t idleLoops = 0;
+    while (sent < THROUGHPUT_MESSAGES && idleLoops < 5000000) {
+        if (publish(connection) != 0) {
+            sent++;
+            idleLoops = 0;
+        } else {
+            idleLoops++;
+        }
+        connection.pump();
+    }
+    TEST_ASSERT_EQUAL_UINT32(THROUGHPUT_MESSAGES, sent);
+    TEST_ASSERT_TRUE(connection.pumpUntilIdle(5000));
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const MQTTOutbox::Stats& stats = connection.outbox.stats();
+    printf("%u messages, %u acks lost, %u retransmitted: %.0f msgs/s\n", (unsigned)THROUGHPUT_MESSAGES,
+           (unsigned)broker.pubAcksDropped(), (unsigned)stats.retransmitted, THROUGHPUT_MESSAGES / seconds);
+
+    TEST_ASSERT_EQUAL_UINT32(THROUGHPUT_MESSAGES, stats.delivered);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.dropped);
+    TEST_ASSERT_TRUE(broker.pubAcksDropped() > 0);
+    TEST_ASSERT_TRUE(stats.retransmitted >= broker.pubAcksDropped());
+    TEST_ASSERT_TRUE(broker.maxUnacknowledged() <= connection.outbox.window());
+    TEST_ASSERT_EQUAL_UINT32(0, broker.reusedPacketIds());
+    TEST_ASSERT_EQUAL_UINT32(0, broker.unacknowledged());
+}
+
+int main() {
+    if (!broker.start()) {
+        return 1;
+    }
+    UNITY_BEGIN();
+    RUN_TEST(test_window_limits_messages_in_flight);
+    RUN_TEST(test_invalid_messages_are_counted_apart);
+    RUN_TEST(test_lost_puback_is_retransmitted_with_dup);
+    RUN_TEST(test_reconnect_resends_in_flight_with_dup);
+    RUN_TEST(test_packet_ids_are_reused_only_when_free);
+    RUN_TEST(test_throughput_with_lossy_broker);
+    int failures = UNITY_END();
+    broker.stop();
+    return failures;
+}
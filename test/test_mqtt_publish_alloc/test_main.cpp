@@ -0,0 +1,89 @@
+#include <Arduino.h>
+#include <ESPMQTTManager.h>
+#include <FakeBroker.h>
+#include <HostSim.h>
+#include <unity.h>
+
+// The periodic publishes run every few seconds for the life of the device,
+// so none of them may touch the heap once the client is connected: topics
+// are inline strings, payloads are formatted on the stack, and QoS 1
+// messages are copied into the outbox's fixed slots.
+//
+//   pio test -e native -f test_mqtt_publish_alloc
+
+static const uint32_t ROUNDS = 200;
+
+static FakeBroker broker;
+static ESPMQTTManager* mqtt = nullptr;
+
+void setUp() {}
+void tearDown() {}
+
+// Runs the client until the broker has seen count publishes and every QoS 1
+// message is acknowledged
+static bool settle(size_t count) {
+    for (int i = 0; i < 2000; i++) {
+        mqtt->loop();
+        if (broker.publishCount() >= count && mqtt->getMessagesInFlight() == 0) {
+            return true;
+        }
+        delay(1);
+    }
+    return false;
+}
+
+static void publishAll() {
+    TEST_ASSERT_TRUE(mqtt->publishTemperature(71.3f));
+    TEST_ASSERT_TRUE(mqtt->publishCpuTemperature(45.2f));
+    TEST_ASSERT_TRUE(mqtt->publishFirmwareVersion(914));
+}
+
+void test_connects_to_broker() {
+    TEST_ASSERT_TRUE(broker.start());
+    mqtt = new ESPMQTTManager("user", "pass", "127.0.0.1", broker.port());
+    mqtt->begin("esp32-test");
+    TEST_ASSERT_TRUE(mqtt->connect());
+    TEST_ASSERT_EQUAL_UINT32(1, broker.connectCount());
+}
+
+void test_publishes_reach_broker() {
+    broker.clear();
+    publishAll();
+    TEST_ASSERT_TRUE(settle(3));
+
+    std::vector<FakeBroker::Publish> received = broker.publishes();
+    TEST_ASSERT_EQUAL(3, received.size());
+    TEST_ASSERT_EQUAL_STRING(mqtt->getTempTopic(), received[0].topic.c_str());
+    TEST_ASSERT_EQUAL_STRING("71.3", received[0].payload.c_str());
+    TEST_ASSERT_EQUAL_UINT8(0, received[0].qos);
+    TEST_ASSERT_EQUAL_STRING(mqtt->getCpuTempTopic(), received[1].topic.c_str());
+    TEST_ASSERT_EQUAL_STRING("45.2", received[1].payload.c_str());
+    TEST_ASSERT_EQUAL_STRING(mqtt->getFirmwareVersionTopic(), received[2].topic.c_str());
+    TEST_ASSERT_EQUAL_STRING("914", received[2].payload.c_str());
+    TEST_ASSERT_EQUAL_UINT8(1, received[2].qos);
+    TEST_ASSERT_TRUE(received[2].retain);
+}
+
+void test_publishes_do_not_allocate() {
+    broker.clear();
+    uint32_t allocationsBefore = HostSim::allocationCount();
+    for (uint32_t i = 0; i < ROUNDS; i++) {
+        publishAll();
+        TEST_ASSERT_TRUE(settle((i + 1) * 3));
+    }
+    uint32_t allocations = HostSim::allocationCount() - allocationsBefore;
+
+    printf("%u publish rounds: %u allocations\n", (unsigned)ROUNDS, (unsigned)allocations);
+    TEST_ASSERT_EQUAL_UINT32(0, allocations);
+    TEST_ASSERT_EQUAL(ROUNDS * 3, broker.publishCount());
+    TEST_ASSERT_EQUAL_UINT32(0, broker.unacknowledged());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_connects_to_broker);
+    RUN_TEST(test_publishes_reach_broker);
+    RUN_TEST(test_publishes_do_not_allocate);
+    broker.stop();
+    return UNITY_END();
+}
@@ -0,0 +1,278 @@
+#include <Arduino.h>
+#include <HostSim.h>
+#include <LittleFS.h>
+#include <TimeSeriesStore.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <unity.h>
+#include <vector>
+
+// TimeSeriesStore on LittleFS backed by a temporary host directory
+//
+//   pio test -e native -f test_time_series_store
+
+// An hour boundary, so the first tier 0 segment starts at T0
+static const uint32_t T0 = 1699999200;
+static const uint8_t METRIC = 1;
+
+void setUp() {
+    LittleFS.format();
+}
+
+void tearDown() {}
+
+static bool collect(const TimeSeriesStore::Point& point, void* context) {
+    static_cast<std::vector<TimeSeriesStore::Point>*>(context)->push_back(point);
+    return true;
+}
+
+static std::vector<TimeSeriesStore::Point> query(TimeSeriesStore& store, uint32_t from, uint32_t to, uint32_t step) {
+    std::vector<TimeSeriesStore::Point> points;
+    store.query(METRIC, from, to, step, collect, &points);
+    return points;
+}
+
+// One sample every interval seconds in [from, to); the value is the time offset from T0
+static void addSamples(TimeSeriesStore& store, uint32_t from, uint32_t to, uint32_t interval) {
+    for (uint32_t time = from; time < to; time += interval) {
+        store.add(METRIC, time, (float)(time - T0));
+    }
+}
+
+static size_t fileSize(const char* path) {
+    File file = LittleFS.open(path, FILE_READ);
+    return file ? file.size() : 0;
+}
+
+void test_segments_roll_over_each_hour() {
+    TimeSeriesStore store(LittleFS);
+    TEST_ASSERT_TRUE(store.begin());
+    // Two hours of 10 s samples; the sample at T0 + 7200 closes the last bucket
+    addSamples(store, T0, T0 + 7201, 10);
+    TEST_ASSERT_TRUE(store.flush());
+
+    char path[40];
+    snprintf(path, sizeof(path), "/ts/0/%lu.seg", (unsigned long)T0);
+    TEST_ASSERT_EQUAL(360 * sizeof(TimeSeriesRecord), fileSize(path));
+    snprintf(path, sizeof(path), "/ts/0/%lu.idx", (unsigned long)T0);
+    // One index entry per 64 records: 0, 64, ..., 320
+    TEST_ASSERT_EQUAL(6 * 8, fileSize(path));
+    snprintf(path, sizeof(path), "/ts/0/%lu.seg", (unsigned long)(T0 + 3600));
+    TEST_ASSERT_EQUAL(360 * sizeof(TimeSeriesRecord), fileSize(path));
+    snprintf(path, sizeof(path), "/ts/0/%lu.seg", (unsigned long)(T0 + 7200));
+    TEST_ASSERT_FALSE(LittleFS.exists(path));
+    // Closed buckets only: the last minute and quarter hour are still open
+    TEST_ASSERT_EQUAL_UINT32(720 + 119 + 7, store.getRecordsWritten());
+
+    // A query spanning the boundary reads both segments
+    std::vector<TimeSeriesStore::Point> points = query(store, T0 + 3500, T0 + 3700, 10);
+    TEST_ASSERT_EQUAL(21, points.size());
+    TEST_ASSERT_EQUAL_UINT32(T0 + 3500, points.front().time);
+    TEST_ASSERT_EQUAL_UINT32(T0 + 3700, points.back().time);
+}
+
+void test_downsampling_into_coarser_tiers() {
+    TimeSeriesStore store(LittleFS);
+    TEST_ASSERT_TRUE(store.begin());
+    // 30 minutes of 1 s samples, valued 0..1799, and 70 s more to close the
+    // last minute and quarter hour of that range
+    addSamples(store, T0, T0 + 1871, 1);
+    TEST_ASSERT_TRUE(store.flush());
+
+    std::vector<TimeSeriesStore::Point> tenSeconds = query(store, T0, T0 + 1799, 10);
+    TEST_ASSERT_EQUAL(180, tenSeconds.size());
+    TEST_ASSERT_EQUAL_UINT32(10, tenSeconds[0].count);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 4.5f, tenSeconds[0].mean);
+
+    TEST_ASSERT_EQUAL_UINT32(60, store.resolutionFor(T0, 60));
+    std::vector<TimeSeriesStore::Point> minutes = query(store, T0, T0 + 1799, 60);
+    TEST_ASSERT_EQUAL(30, minutes.size());
+    TEST_ASSERT_EQUAL_UINT32(T0 + 120, minutes[2].time);
+    TEST_ASSERT_EQUAL_UINT32(60, minutes[2].count);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, 149.5f, minutes[2].mean);
+    TEST_ASSERT_EQUAL_FLOAT(120.0f, minutes[2].min);
+    TEST_ASSERT_EQUAL_FLOAT(179.0f, minutes[2].max);
+
+    std::vector<TimeSeriesStore::Point> quarters = query(store, T0, T0 + 1799, 900);
+    TEST_ASSERT_EQUAL(2, quarters.size());
+    TEST_ASSERT_EQUAL_UINT32(900, quarters[1].count);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1349.5f, quarters[1].mean);
+    TEST_ASSERT_EQUAL_FLOAT(900.0f, quarters[1].min);
+    TEST_ASSERT_EQUAL_FLOAT(1799.0f, quarters[1].max);
+
+    // A step between tiers is served from the finer tier and merged
+    std::vector<TimeSeriesStore::Point> fiveMinutes = query(store, T0, T0 + 1799, 300);
+    TEST_ASSERT_EQUAL(6, fiveMinutes.size());
+    TEST_ASSERT_EQUAL_UINT32(300, fiveMinutes[5].count);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, 1649.5f, fiveMinutes[5].mean);
+}
+
+void test_storage_cap_drops_oldest_fine_segments() {
+    const size_t cap = 24 * 1024;
+    TimeSeriesStore store(LittleFS, "/ts", cap);
+    TEST_ASSERT_TRUE(store.begin());
+    // Eight hours of 10 s samples: 8 tier 0 segments of 7200 bytes each
+    addSamples(store, T0, T0 + 8 * 3600 + 1, 10);
+    TEST_ASSERT_TRUE(store.flush());
+
+    TEST_ASSERT_TRUE(store.getDroppedSegments() > 0);
+    // The cap is checked when a segment is started, so it can be exceeded by
+    // what was written since: at most an hour of all three tiers here
+    size_t hourBytes = (360 + 60 + 4) * sizeof(TimeSeriesRecord) + 8 * 8;
+    TEST_ASSERT_TRUE(store.totalBytes() <= cap + hourBytes);
+
+    // Recent fine history is kept, the oldest is gone
+    std::vector<TimeSeriesStore::Point> recent = query(store, T0 + 7 * 3600, T0 + 8 * 3600 - 1, 10);
+    TEST_ASSERT_EQUAL(360, recent.size());
+    // The first hours of 10 s buckets are gone, so that range comes from the 1 min tier
+    TEST_ASSERT_EQUAL_UINT32(60, store.resolutionFor(T0, 10));
+    std::vector<TimeSeriesStore::Point> oldest = query(store, T0, T0 + 3599, 10);
+    TEST_ASSERT_EQUAL(60, oldest.size());
+    TEST_ASSERT_EQUAL_UINT32(T0, oldest.front().time);
+    TEST_ASSERT_EQUAL_UINT32(6, oldest.front().count);
+
+    // Coarse history still reaches back to the start
+    std::vector<TimeSeriesStore::Point> coarse = query(store, T0, T0 + 8 * 3600 - 1, 900);
+    TEST_ASSERT_EQUAL(31, coarse.size()); // The last quarter hour is still open
+    TEST_ASSERT_EQUAL_UINT32(T0, coarse.front().time);
+    TEST_ASSERT_EQUAL_UINT32(90, coarse.front().count);
+
+    // begin() after a reboot applies the cap to what is on flash
+    TimeSeriesStore rebooted(LittleFS, "/ts", cap);
+    TEST_ASSERT_TRUE(rebooted.begin());
+    TEST_ASSERT_TRUE(rebooted.totalBytes() <= cap);
+}
+
+void test_range_query_seeks_through_the_index() {
+    TimeSeriesStore store(LittleFS);
+    TEST_ASSERT_TRUE(store.begin());
+    addSamples(store, T0, T0 + 3 * 3600 + 1, 10);
+    TEST_ASSERT_TRUE(store.flush());
+
+    // Ranges starting before, on and after indexed records (every 640 s)
+    const uint32_t starts[] = {T0 + 3600 + 630, T0 + 3600 + 640, T0 + 3600 + 650, T0 + 3600 + 1234};
+    for (uint32_t from : starts) {
+        uint32_t to = from + 600;
+        std::vector<TimeSeriesStore::Point> points = query(store, from, to, 10);
+        uint32_t first = from + (10 - from % 10) % 10;
+        TEST_ASSERT_EQUAL((to - first) / 10 + 1, points.size());
+        for (size_t i = 0; i < points.size(); i++) {
+            TEST_ASSERT_EQUAL_UINT32(first + i * 10, points[i].time);
+            TEST_ASSERT_EQUAL_FLOAT((float)(points[i].time - T0), points[i].mean);
+        }
+    }
+
+    // Break the first record of the second hour: a query that seeks past it
+    // through the index is unaffected, one that scanned from the start of the
+    // segment would stop at the bad time
+    char path[40];
+    snprintf(path, sizeof(path), "/ts/0/%lu.seg", (unsigned long)(T0 + 3600));
+    File segment = LittleFS.open(path, "r+");
+    TEST_ASSERT_TRUE(segment);
+    TimeSeriesRecord broken = {};
+    broken.time = UINT32_MAX;
+    broken.metric = METRIC;
+    broken.count = 1;
+    TEST_ASSERT_EQUAL(sizeof(broken), segment.write((const uint8_t*)&broken, sizeof(broken)));
+    segment.close();
+    TEST_ASSERT_EQUAL(60, query(store, T0 + 3600 + 1234, T0 + 3600 + 1834, 10).size());
+    TEST_ASSERT_EQUAL(0, query(store, T0 + 3600, T0 + 3600 + 600, 10).size());
+
+    // A callback returning false stops the query
+    size_t delivered = store.query(
+        METRIC, T0, T0 + 3 * 3600, 10, [](const TimeSeriesStore::Point&, void*) { return false; }, nullptr);
+    TEST_ASSERT_EQUAL(1, delivered);
+    TEST_ASSERT_TRUE(query(store, T0 + 4 * 3600, T0 + 5 * 3600, 10).empty());
+    TEST_ASSERT_TRUE(query(store, T0 + 100, T0 + 50, 10).empty());
+}
+
+// Open buckets live in RAM only, so a reboot loses the samples in them; a
+// bucket written on both sides of a reboot is merged by queries
+void test_reboot_loses_open_buckets_and_merges_duplicates() {
+    {
+        TimeSeriesStore store(LittleFS);
+        TEST_ASSERT_TRUE(store.begin());
+        // 1 s samples for 95 s: 10 s buckets up to T0 + 80 and the first
+        // minute are written; T0 + 90, minute T0 + 60 and the first quarter
+        // hour are open
+        addSamples(store, T0, T0 + 95, 1);
+        TEST_ASSERT_TRUE(store.flush());
+        TEST_ASSERT_EQUAL_UINT32(9 + 1, store.getRecordsWritten());
+    }
+
+    // Before NTP corrects it, the clock restarts a few seconds early, inside the bucket at T0 + 80
+    TimeSeriesStore store(LittleFS);
+    TEST_ASSERT_TRUE(store.begin());
+    addSamples(store, T0 + 85, T0 + 191, 1);
+    TEST_ASSERT_TRUE(store.flush());
+
+    std::vector<TimeSeriesStore::Point> points = query(store, T0, T0 + 179, 10);
+    TEST_ASSERT_EQUAL(18, points.size());
+    // Written before the reboot (80..89) and again after it (85..89): one point
+    TEST_ASSERT_EQUAL_UINT32(T0 + 80, points[8].time);
+    TEST_ASSERT_EQUAL_UINT32(15, points[8].count);
+    TEST_ASSERT_FLOAT_WITHIN(0.001f, (845.0f + 435.0f) / 15, points[8].mean);
+    TEST_ASSERT_EQUAL_FLOAT(80.0f, points[8].min);
+    TEST_ASSERT_EQUAL_FLOAT(89.0f, points[8].max);
+    // 90..94 were in the open bucket when the device rebooted
+    TEST_ASSERT_EQUAL_UINT32(T0 + 90, points[9].time);
+    TEST_ASSERT_EQUAL_UINT32(10, points[9].count);
+    TEST_ASSERT_EQUAL_FLOAT(90.0f, points[9].min);
+
+    // Minute T0 + 60 was open: of it only the samples from after the reboot remain
+    std::vector<TimeSeriesStore::Point> minutes = query(store, T0, T0 + 179, 60);
+    TEST_ASSERT_EQUAL(3, minutes.size());
+    TEST_ASSERT_EQUAL_UINT32(60, minutes[0].count);
+    TEST_ASSERT_EQUAL_UINT32(T0 + 60, minutes[1].time);
+    TEST_ASSERT_EQUAL_UINT32(35, minutes[1].count);
+    TEST_ASSERT_EQUAL_FLOAT(85.0f, minutes[1].min);
+    TEST_ASSERT_EQUAL_UINT32(60, minutes[2].count);
+}
+
+// Returns, so the test carries on after esp_restart()
+static void ignoreRestart() {}
+
+// Closed buckets wait in RAM for the next flush; a restart writes them out first
+void test_restart_flushes_pending_records() {
+    HostSim::setRestartHandler(ignoreRestart);
+    {
+        TimeSeriesStore store(LittleFS);
+        TEST_ASSERT_TRUE(store.begin());
+        // Buckets T0, T0 + 10 and T0 + 20 are closed but not written yet
+        addSamples(store, T0, T0 + 35, 1);
+        TEST_ASSERT_EQUAL_UINT32(0, store.getRecordsWritten());
+
+        esp_restart();
+        TEST_ASSERT_EQUAL_UINT32(3, store.getRecordsWritten());
+    }
+    HostSim::setRestartHandler(nullptr);
+
+    TimeSeriesStore store(LittleFS);
+    TEST_ASSERT_TRUE(store.begin());
+    std::vector<TimeSeriesStore::Point> points = query(store, T0, T0 + 59, 10);
+    TEST_ASSERT_EQUAL(3, points.size());
+    TEST_ASSERT_EQUAL_UINT32(T0 + 20, points[2].time);
+    TEST_ASSERT_EQUAL_UINT32(10, points[2].count);
+}
+
+int main() {
+    char root[] = "/tmp/ts_store_XXXXXX";
+    if (mkdtemp(root) == nullptr) {
+        return 1;
+    }
+    HostSim::setFsRoot(root);
+    LittleFS.begin();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_segments_roll_over_each_hour);
+    RUN_TEST(test_downsampling_into_coarser_tiers);
+    RUN_TEST(test_storage_cap_drops_oldest_fine_segments);
+    RUN_TEST(test_range_query_seeks_through_the_index);
+    RUN_TEST(test_reboot_loses_open_buckets_and_merges_duplicates);
+    RUN_TEST(test_restart_flushes_pending_records);
+    int failures = UNITY_END();
+
+    LittleFS.format();
+    rmdir(root);
+    return failures;
+}